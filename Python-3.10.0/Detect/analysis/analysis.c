@@ -3,25 +3,115 @@
  */
 
 #include <stdbool.h>
+#include "Python.h"
+#include "pycore_interp.h"
 #include "Detect/configs/config.h"
 #include "Detect/analysis/analysis_common.h"
 #include "Detect/analysis/analysis_func_debug.h"
 #include "Detect/analysis/analysis_func_general.h"
-#include "Detect/analysis/analysis_func_reverse_shell.h"
+#include "Detect/analysis/analysis_sequence.h"
 #include "Detect/analysis/analysis_func_malicious_command.h"
 #include "Detect/analysis/analysis_func_illegal_ops.h"
+#include "Detect/analysis/analysis_evidence.h"
+#include "Detect/analysis/analysis_cache.h"
+#include "Detect/analysis/analysis_explore.h"
+#include "Detect/analysis/analysis_decode.h"
+#include "Detect/record/record_coverage.h"
+#include "Detect/virtual/virtual_thread.h"
+#include "Detect/detect_memory.h"
+#include "Detect/utils/dict.h"
+#include "Detect/detect_state.h"
 
-/* 分析函数列表 */
-static PyObject *detect_analysis_func_list;
+/* 分析函数列表，保存在解释器级的detect状态中，每一项为(分析函数, 检测结论权重)元组 */
+#define detect_analysis_func_list (detect_state_get_or_default()->analysis_func_list)
+
+/* 分析函数定义 */
+typedef struct {
+	const char *name;   // 分析函数名，用于计算规则集的版本
+	analysis_func func; // 分析函数
+	long weight;        // 给出检测结论时计入证据得分的权重
+} DETECT_ANALYSIS_FUNC_DEF;
+
+static DETECT_ANALYSIS_FUNC_DEF g_analysis_func_def[] = {
+	{"general",           detect_analysis_func_general_proc,           100},
+	{"sequence",          detect_analysis_func_sequence_proc,          100},
+	{"malicious_command", detect_analysis_func_malicious_command_proc, 100},
+	{"illegal_ops",       detect_analysis_func_illegal_ops_proc,       100},
+};
+
+/* 得分未达到阈值时给出的恶意结论描述 */
+#define EVIDENCE_SCORE_DESC       "Evidence score exceeds threshold"
+
+/**
+  * @description: 子解释器扫描模式下，检测结论得出后停止当前脚本的执行。脚本可能捕获
+  *               SystemExit，所以每次进入opcode处理时都需要重新调用该函数
+  * @return void
+  */
+void detect_analysis_stop_sub_interpreter() {
+	PyThreadState *tstate = _PyThreadState_GET();
+
+	PyThreadState_SetAsyncExc(tstate->thread_id, PyExc_SystemExit);
+}
 
 /**
-  * @description: 分析模块处理函数，每个opcode执行前触发
+  * @description: 输出最终检测结论。子解释器扫描模式下保存结果并结束脚本执行，否则输出到标准输出并退出进程
+  * @param result_dict 检测结果字典，引用被该函数接管
+  * @return void
+  */
+static void detect_analysis_report(PyObject *result_dict) {
+	DETECT_STATE_T *state = detect_state_get();
+
+	/* 子解释器扫描模式下不能退出进程，保存检测结果并通过异步SystemExit结束脚本执行 */
+	if (state->is_sub_interpreter) {
+		Py_XSETREF(state->result_dict, result_dict);
+		state->is_finished = true;
+		state->need_stop = true;
+		detect_analysis_stop_sub_interpreter();
+		return;
+	}
+
+	/* 保存检测结论到缓存 */
+	detect_analysis_cache_store(result_dict);
+
+	/* 输出检测结果到标准输出 */
+	PyObject_Print(result_dict, stdout, Py_PRINT_RAW);
+	fprintf(stdout, "\n");
+	fflush(stdout);
+
+	/* 退出后续检测，扫描内存模式下跳过解释器清理直接退出 */
+	detect_memory_finish(0);
+	exit(0);
+}
+
+/**
+  * @description: 记录一个加权的检测结论，只保留权重最高的结论
+  * @param result_dict 检测结果字典，引用被该函数接管
+  * @param weight 权重
+  * @return void
+  */
+static void detect_analysis_add_finding(PyObject *result_dict, long weight) {
+	DETECT_STATE_T *state = detect_state_get();
+
+	if (state->finding_dict == NULL || weight > state->finding_weight) {
+		Py_XSETREF(state->finding_dict, result_dict);
+		state->finding_weight = weight;
+	} else {
+		Py_DECREF(result_dict);
+	}
+
+	detect_analysis_evidence_add_score(weight);
+}
+
+/**
+  * @description: 分析模块处理函数，每个opcode执行前触发。各分析函数的结论按权重计入证据得分，
+  *               得分达到阈值时才给出恶意结论并结束检测，否则继续执行到脚本自然结束
   * @return void
   */
 void detect_analysis_main_proc() {
 	int index;
 	DETECT_RUN_STATE last_run_state;
-	PyObject *result_dict = NULL;
+	DETECT_STATE_T *state;
+	PyObject *result_dict = NULL, *item;
 
 	last_run_state = detect_config_get_runtime_state();
 
@@ -29,30 +119,218 @@ void detect_analysis_main_proc() {
 	detect_config_set_runtime_state(RUN_STATE_ANALYSING);
 
 	for (index = 0; index < PyList_Size(detect_analysis_func_list); index++) {
-		analysis_func f = PyLong_AsVoidPtr(PyList_GetItem(detect_analysis_func_list, index));
+		item = PyList_GetItem(detect_analysis_func_list, index);
+		analysis_func f = PyLong_AsVoidPtr(PyTuple_GET_ITEM(item, 0));
 		result_dict = f();
 
 		if (result_dict != NULL) {
-			/* 该检测函数检测出恶意，停止后续检测 */
-			break;
+			detect_analysis_add_finding(result_dict, PyLong_AsLong(PyTuple_GET_ITEM(item, 1)));
 		}
 	}
 
 	/* 恢复运行状态 */
 	detect_config_set_runtime_state(last_run_state);
 
-	/* 检测出恶意 */
-	if (result_dict != NULL) {
-		/* 输出检测结果到标准输出 */
-		PyObject_Print(result_dict, stdout, Py_PRINT_RAW);
-		fprintf(stdout, "\n");
-	    fflush(stdout);
+	/* 证据得分未达到阈值，继续检测 */
+	if (detect_analysis_evidence_get_score() < detect_config_get_runtime_score_threshold()) {
+		return;
+	}
+
+	/* 检测出恶意，没有单个结论时以得分给出结论 */
+	state = detect_state_get();
+	if (state->finding_dict != NULL) {
+		result_dict = state->finding_dict;
+		state->finding_dict = NULL;
+	} else {
+		result_dict = detect_analysis_create_detect_malicious_result_dict(EVIDENCE_SCORE_DESC);
+	}
+
+	detect_analysis_report(result_dict);
+}
+
+/**
+  * @description: 脚本执行结束时生成检测结果。得分未达到阈值但存在检测结论时给出该结论，否则给出正常结论，
+  *               并附带证据得分以及是否需要展平分支再检测一次
+  * @return PyObject*
+  */
+PyObject* detect_analysis_create_finish_result_dict() {
+	DETECT_STATE_T *state = detect_state_get();
+	PyObject *result_dict, *score_obj;
+	long score;
+
+	if (state == NULL || !state->has_init) {
+		return NULL;
+	}
+
+	/* 已经给出最终结论 */
+	if (state->result_dict != NULL) {
+		Py_INCREF(state->result_dict);
+		return state->result_dict;
+	}
 
-		/* 退出后续检测 */
-		exit(0);
+	if (state->finding_dict != NULL) {
+		Py_INCREF(state->finding_dict);
+		return state->finding_dict;
 	}
 
-	return;
+	score       = detect_analysis_evidence_get_score();
+	score_obj   = PyLong_FromLong(score);
+	result_dict = detect_analysis_create_detect_ok_result_dict(NULL);
+	dict_setitem_string_object(result_dict, SCORE_STRING, score_obj);
+	dict_setitem_string_object(result_dict, NEED_SECOND_PASS_STRING,
+							   score >= detect_config_get_runtime_second_pass_score() ? Py_True : Py_False);
+	Py_DECREF(score_obj);
+
+	/* 主脚本的指令覆盖率，覆盖完整时展平分支再检测也不会执行到新的代码 */
+	detect_record_coverage_add_summary(result_dict);
+
+	return result_dict;
+}
+
+/* atexit回调由C代码直接调用，不经过调用指令，改为在python代码中逆序调用 */
+static const char *detect_analysis_atexit_source =
+	"for func, args, kwargs in callbacks:\n"
+	"    try:\n"
+	"        func(*args, **kwargs)\n"
+	"    except BaseException:\n"
+	"        pass\n";
+
+/**
+  * @description: 取出atexit注册的回调并在hook下执行，执行前清空注册表，Py_FinalizeEx中不会重复执行
+  * @return void
+  */
+static void detect_analysis_run_atexit_callbacks() {
+	_Py_IDENTIFIER(atexit);
+	_Py_IDENTIFIER(_clear);
+	struct atexit_state *state = &_PyInterpreterState_GET()->atexit;
+	PyObject *callbacks, *item, *globals, *code, *result;
+
+	if (state->ncallbacks == 0) {
+		return;
+	}
+
+	callbacks = PyList_New(0);
+	if (callbacks == NULL) {
+		return;
+	}
+	for (int i = state->ncallbacks - 1; i >= 0; i--) {
+		atexit_callback *cb = state->callbacks[i];
+		if (cb == NULL) {
+			continue;
+		}
+		if (cb->kwargs != NULL) {
+			item = PyTuple_Pack(3, cb->func, cb->args, cb->kwargs);
+		} else {
+			item = Py_BuildValue("(OO{})", cb->func, cb->args);
+		}
+		if (item == NULL || PyList_Append(callbacks, item) < 0) {
+			Py_XDECREF(item);
+			Py_DECREF(callbacks);
+			return;
+		}
+		Py_DECREF(item);
+	}
+	/* 回调对象已由列表持有，清空注册表 */
+	result = _PyImport_GetModuleId(&PyId_atexit);
+	if (result != NULL) {
+		Py_SETREF(result, _PyObject_CallMethodIdNoArgs(result, &PyId__clear));
+		Py_XDECREF(result);
+	}
+	PyErr_Clear();
+
+	globals = PyDict_New();
+	code = Py_CompileString(detect_analysis_atexit_source, "<atexit>", Py_file_input);
+	if (globals != NULL && code != NULL
+		&& PyDict_SetItemString(globals, "__builtins__", PyEval_GetBuiltins()) == 0
+		&& PyDict_SetItemString(globals, "callbacks", callbacks) == 0) {
+		result = PyEval_EvalCode(code, globals, globals);
+		Py_XDECREF(result);
+	}
+	PyErr_Clear();
+	Py_XDECREF(code);
+	Py_XDECREF(globals);
+	Py_DECREF(callbacks);
+}
+
+/**
+  * @description: 在hook仍然生效时执行解释器退出阶段才会执行的样本代码，载荷可能注册在atexit中，
+  *               或者放在__main__全局对象的析构函数中。顺序与Py_FinalizeEx保持一致：等待线程结束、
+  *               执行atexit回调、清理__main__模块，之后Py_FinalizeEx中不会重复执行
+  * @return void
+  */
+static void detect_analysis_run_exit_handlers() {
+	_Py_IDENTIFIER(threading);
+	_Py_IDENTIFIER(_shutdown);
+	_Py_IDENTIFIER(__main__);
+	PyObject *module, *result;
+
+	PyErr_Clear();
+
+	/* 等待样本创建的非守护线程结束 */
+	module = _PyImport_GetModuleId(&PyId_threading);
+	if (module != NULL) {
+		result = _PyObject_CallMethodIdNoArgs(module, &PyId__shutdown);
+		Py_XDECREF(result);
+		Py_DECREF(module);
+	}
+	PyErr_Clear();
+
+	detect_analysis_run_atexit_callbacks();
+
+	/* 清理__main__模块的全局变量，触发其中对象的析构函数 */
+	module = _PyImport_GetModuleId(&PyId___main__);
+	if (module != NULL) {
+		_PyModule_Clear(module);
+		Py_DECREF(module);
+	}
+	PyGC_Collect();
+	PyErr_Clear();
+}
+
+/**
+  * @description: 分析模块结束函数，脚本自然执行结束后调用，输出检测结果
+  * @return void
+  */
+void detect_analysis_finish_proc() {
+	DETECT_STATE_T *state = detect_state_get();
+	PyObject *result_dict;
+
+	if (!detect_config_get_runtime_is_enable()) {
+		return;
+	}
+
+	/* 运行仍未被调度的虚拟线程，之后探索主脚本中未被调用过的函数，得出检测结论时进程在此退出 */
+	detect_virtual_thread_finish();
+	detect_analysis_explore_proc();
+	detect_analysis_run_exit_handlers();
+
+	result_dict = detect_analysis_create_finish_result_dict();
+	if (result_dict == NULL) {
+		return;
+	}
+
+	/* 停止记录和分析，保存检测结论到缓存 */
+	state->is_finished = true;
+	detect_analysis_cache_store(result_dict);
+
+	PyObject_Print(result_dict, stdout, Py_PRINT_RAW);
+	fprintf(stdout, "\n");
+	fflush(stdout);
+
+	Py_DECREF(result_dict);
+}
+
+/**
+  * @description: 注册分析函数
+  * @param f 分析函数
+  * @param weight 分析函数给出检测结论时计入证据得分的权重
+  * @return void
+  */
+static void detect_analysis_register(analysis_func f, long weight) {
+	PyObject *item = Py_BuildValue("(Nl)", PyLong_FromVoidPtr(f), weight);
+
+	PyList_Append(detect_analysis_func_list, item);
+	Py_DECREF(item);
 }
 
 /**
@@ -60,25 +338,82 @@ void detect_analysis_main_proc() {
   * @return void
   */
 void detect_analysis_init() {
-	static bool has_init = false;
+	unsigned int index;
 
-	if (has_init) {
+	if (detect_analysis_func_list != NULL) {
 		return;
 	}
 
-	detect_analysis_func_list = PyList_New(0);
+	detect_state_get()->analysis_func_list = PyList_New(0);
+
+	/* 编译序列规则自动机 */
+	detect_state_get()->sequence_automaton = detect_analysis_sequence_compile();
 
 	/* 注册debug处理函数 */
 	if (detect_config_get_runtime_is_debug()) {	
-		PyList_Append(detect_analysis_func_list, PyLong_FromVoidPtr(detect_analysis_func_debug_proc));
+		detect_analysis_register(detect_analysis_func_debug_proc, 0);
 	}
 
 	/* 注册各分析函数 */
-	PyList_Append(detect_analysis_func_list, PyLong_FromVoidPtr(detect_analysis_func_general_proc));
-	PyList_Append(detect_analysis_func_list, PyLong_FromVoidPtr(detect_analysis_func_reverse_shell_proc));
-	PyList_Append(detect_analysis_func_list, PyLong_FromVoidPtr(detect_analysis_func_malicious_command_proc));
-	PyList_Append(detect_analysis_func_list, PyLong_FromVoidPtr(detect_analysis_func_illegal_ops_proc));
+	for (index = 0; index < sizeof(g_analysis_func_def)/sizeof(DETECT_ANALYSIS_FUNC_DEF); index++) {
+		detect_analysis_register(g_analysis_func_def[index].func, g_analysis_func_def[index].weight);
+	}
+}
+
+/**
+  * @description: 收集分析函数、分析策略和影响检测结论的运行配置，用于计算规则集的版本
+  * @param rules_list 规则列表
+  * @return void
+  */
+void detect_analysis_collect_rules(PyObject *rules_list) {
+	unsigned int index;
+
+	for (index = 0; index < sizeof(g_analysis_func_def)/sizeof(DETECT_ANALYSIS_FUNC_DEF); index++) {
+		detect_config_append_rule(rules_list, "analysis", NULL, NULL, NULL, g_analysis_func_def[index].name,
+								  NULL, g_analysis_func_def[index].weight);
+	}
+
+	detect_analysis_sequence_collect_rules(rules_list);
+	detect_analysis_func_malicious_command_collect_rules(rules_list);
+	detect_analysis_func_illegal_ops_collect_rules(rules_list);
+	detect_analysis_evidence_collect_rules(rules_list);
+	detect_analysis_decode_collect_rules(rules_list);
+
+	/* 检测器版本和解释器版本 */
+	detect_config_append_rule(rules_list, "version", PY_VERSION, NULL, NULL, DETECT_VERSION, NULL, 0);
 
-	has_init = true;
+	/* 运行配置 */
+	detect_config_append_rule(rules_list, "config", NULL, NULL, NULL, "jump_branch", NULL,
+							  detect_config_get_runtime_is_jump_branch());
+	detect_config_append_rule(rules_list, "config", NULL, NULL, NULL, "debug", NULL,
+							  detect_config_get_runtime_is_debug());
+	detect_config_append_rule(rules_list, "config", NULL, NULL, NULL, "prefilter", NULL,
+							  detect_config_get_runtime_is_prefilter());
+	detect_config_append_rule(rules_list, "config", NULL, NULL, NULL, "score_threshold", NULL,
+							  detect_config_get_runtime_score_threshold());
+	detect_config_append_rule(rules_list, "config", NULL, NULL, NULL, "second_pass_score", NULL,
+							  detect_config_get_runtime_second_pass_score());
+	detect_config_append_rule(rules_list, "config", NULL, NULL, NULL, "explore", NULL,
+							  detect_config_get_runtime_is_explore());
+	detect_config_append_rule(rules_list, "config", NULL, NULL, NULL, "static_decode", NULL,
+							  detect_config_get_runtime_is_static_decode());
+	detect_config_append_rule(rules_list, "config", NULL, NULL, NULL, "stage_scan", NULL,
+							  detect_config_get_runtime_is_stage_scan());
+	detect_config_append_rule(rules_list, "config", NULL, NULL, NULL, "inline_process", NULL,
+							  detect_config_get_runtime_is_inline_process());
+	detect_config_append_rule(rules_list, "config", NULL, NULL, NULL, "virtual_thread", NULL,
+							  detect_config_get_runtime_is_virtual_thread());
+	detect_config_append_rule(rules_list, "config", NULL, NULL, NULL, "virtual_io", NULL,
+							  detect_config_get_runtime_is_virtual_io());
+	detect_config_append_rule(rules_list, "config", NULL, NULL, NULL, "virtual_fs", NULL,
+							  detect_config_get_runtime_is_virtual_fs());
+	detect_config_append_rule(rules_list, "config", NULL, NULL, NULL, "scan_memory", NULL,
+							  detect_config_get_runtime_is_scan_memory());
+	detect_config_append_rule(rules_list, "config", NULL, NULL, NULL, "fingerprint", NULL,
+							  detect_config_get_runtime_is_fingerprint());
+	detect_config_append_rule(rules_list, "config", NULL, NULL, NULL, "detect_timeout", NULL,
+							  detect_config_get_runtime_timeout());
+	detect_config_append_rule(rules_list, "config", NULL, NULL, NULL, "memory_limit", NULL,
+							  detect_config_get_runtime_memory_limit());
 }
 
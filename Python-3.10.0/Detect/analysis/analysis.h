@@ -5,6 +5,10 @@
 
 extern void detect_analysis_init();
 extern void detect_analysis_main_proc();
+extern void detect_analysis_stop_sub_interpreter();
+extern PyObject* detect_analysis_create_finish_result_dict();
+extern void detect_analysis_finish_proc();
+extern void detect_analysis_collect_rules(PyObject *rules_list);
 
 #endif
 
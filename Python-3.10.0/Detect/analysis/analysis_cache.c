@@ -0,0 +1,672 @@
+/*
+ * @Description: 检测结论缓存。同一个脚本会被反复上传检测，以脚本内容和规则集的摘要作为key，
+ *               把检测结论保存在mmap映射的哈希文件中，命中时无需执行脚本直接给出结论。规则集的
+ *               摘要包括检测器版本、外部输入、威胁、自定义、库函数摘要配置、分析策略以及影响结论的运行配置，
+ *               规则更新后旧的缓存项自然失效。恶意结论同时以字节码指纹为key保存，同一家族的变形样本
+ *               即使内容不同也可以复用结论
+ */
+
+#include "Python.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "pycore_fileutils.h"
+#include "Detect/configs/config.h"
+#include "Detect/analysis/analysis.h"
+#include "Detect/analysis/analysis_common.h"
+#include "Detect/analysis/analysis_cache.h"
+#include "Detect/analysis/analysis_fingerprint.h"
+#include "Detect/analysis/analysis_prescan.h"
+#include "Detect/analysis/analysis_stage.h"
+#include "Detect/record/record_coverage.h"
+#include "Detect/utils/dict.h"
+
+/* 检测结论缓存，缓存文件为进程级资源，批量扫描时各子解释器共用 */
+typedef struct {
+	bool is_opened;                                   // 是否已经打开缓存文件
+	bool is_unavailable;                              // 缓存文件无法使用
+	int fd;                                           // 缓存文件描述符
+	size_t size;                                      // 映射的大小
+	DETECT_CACHE_HEADER_T *header;                    // 缓存文件头
+	DETECT_CACHE_SLOT_T *slots;                       // 缓存槽位
+	bool has_ruleset_digest;                          // 是否已经计算规则集摘要
+	unsigned char ruleset_digest[DETECT_CACHE_KEY_SIZE]; // 规则集摘要
+	bool has_key;                                     // 当前样本的key是否有效
+	unsigned char key[DETECT_CACHE_KEY_SIZE];         // 当前样本的key
+	bool has_fingerprint_key;                         // 当前样本的字节码指纹key是否有效
+	unsigned char fingerprint_key[DETECT_CACHE_KEY_SIZE]; // 当前样本的字节码指纹key
+} DETECT_ANALYSIS_CACHE_T;
+
+static DETECT_ANALYSIS_CACHE_T g_verdict_cache = {.fd = -1};
+
+/**
+ * @description: 对缓存文件加锁或解锁，被信号中断时重试
+ * @param fd 缓存文件描述符
+ * @param operation LOCK_SH、LOCK_EX或LOCK_UN
+ * @return bool 加锁失败时返回false，此时不能访问映射的内容
+ */
+static bool detect_analysis_cache_flock(int fd, int operation) {
+	int ret;
+
+	do {
+		ret = flock(fd, operation);
+	} while (ret != 0 && errno == EINTR);
+
+	return ret == 0;
+}
+
+/**
+ * @description: 打开并映射缓存文件，文件不存在或大小不符时重新初始化
+ * @return bool
+ */
+static bool detect_analysis_cache_open() {
+	const char *path = detect_config_get_runtime_verdict_cache();
+	size_t size = sizeof(DETECT_CACHE_HEADER_T) + sizeof(DETECT_CACHE_SLOT_T) * DETECT_CACHE_SLOT_COUNT;
+	struct stat st;
+	void *map;
+	int fd;
+
+	if (g_verdict_cache.is_opened) {
+		return true;
+	}
+
+	if (path == NULL || g_verdict_cache.is_unavailable) {
+		return false;
+	}
+
+	g_verdict_cache.is_unavailable = true;
+
+	fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		return false;
+	}
+
+	if (!detect_analysis_cache_flock(fd, LOCK_EX)) {
+		close(fd);
+		return false;
+	}
+	if (fstat(fd, &st) != 0 || ((size_t)st.st_size != size && ftruncate(fd, 0) != 0) ||
+		ftruncate(fd, size) != 0) {
+		detect_analysis_cache_flock(fd, LOCK_UN);
+		close(fd);
+		return false;
+	}
+
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		detect_analysis_cache_flock(fd, LOCK_UN);
+		close(fd);
+		return false;
+	}
+
+	g_verdict_cache.header = map;
+	g_verdict_cache.slots  = (DETECT_CACHE_SLOT_T *)((char *)map + sizeof(DETECT_CACHE_HEADER_T));
+
+	/* 新建的文件或者格式不同的文件，清空后重新初始化文件头 */
+	if (memcmp(g_verdict_cache.header->magic, DETECT_CACHE_MAGIC, sizeof(g_verdict_cache.header->magic)) != 0 ||
+		g_verdict_cache.header->slot_count != DETECT_CACHE_SLOT_COUNT) {
+		memset(map, 0, size);
+		memcpy(g_verdict_cache.header->magic, DETECT_CACHE_MAGIC, sizeof(g_verdict_cache.header->magic));
+		g_verdict_cache.header->slot_count = DETECT_CACHE_SLOT_COUNT;
+	}
+	detect_analysis_cache_flock(fd, LOCK_UN);
+
+	g_verdict_cache.fd             = fd;
+	g_verdict_cache.size           = size;
+	g_verdict_cache.is_opened      = true;
+	g_verdict_cache.is_unavailable = false;
+
+	return true;
+}
+
+/**
+ * @description: 计算blake2b摘要
+ * @param data bytes对象
+ * @param digest 摘要输出，长度为DETECT_CACHE_KEY_SIZE
+ * @return bool
+ */
+static bool detect_analysis_cache_blake2b(PyObject *data, unsigned char *digest) {
+	PyObject *module, *hasher = NULL, *result = NULL;
+	bool ret = false;
+
+	module = PyImport_ImportModule("_blake2");
+	if (module == NULL) {
+		goto end;
+	}
+
+	hasher = PyObject_CallMethod(module, "blake2b", "(O)", data);
+	Py_DECREF(module);
+	if (hasher == NULL) {
+		goto end;
+	}
+
+	result = PyObject_CallMethod(hasher, "digest", NULL);
+	if (result != NULL && PyBytes_Check(result) && PyBytes_GET_SIZE(result) >= DETECT_CACHE_KEY_SIZE) {
+		memcpy(digest, PyBytes_AS_STRING(result), DETECT_CACHE_KEY_SIZE);
+		ret = true;
+	}
+
+end:
+	Py_XDECREF(hasher);
+	Py_XDECREF(result);
+	PyErr_Clear();
+
+	return ret;
+}
+
+/**
+ * @description: 计算规则集摘要，进程内只计算一次
+ * @return bool
+ */
+static bool detect_analysis_cache_compute_ruleset_digest() {
+	PyObject *rules_list, *separator, *rules_str, *rules_bytes = NULL;
+	bool ret = false;
+
+	if (g_verdict_cache.has_ruleset_digest) {
+		return true;
+	}
+
+	rules_list = PyList_New(0);
+	if (rules_list == NULL) {
+		PyErr_Clear();
+		return false;
+	}
+
+	detect_config_collect_rules(rules_list);
+	detect_analysis_collect_rules(rules_list);
+
+	separator = PyUnicode_FromString("\n");
+	rules_str = separator != NULL ? PyUnicode_Join(separator, rules_list) : NULL;
+	if (rules_str != NULL) {
+		rules_bytes = PyUnicode_AsUTF8String(rules_str);
+	}
+
+	if (rules_bytes != NULL && detect_analysis_cache_blake2b(rules_bytes, g_verdict_cache.ruleset_digest)) {
+		g_verdict_cache.has_ruleset_digest = true;
+		ret = true;
+	}
+
+	Py_XDECREF(rules_bytes);
+	Py_XDECREF(rules_str);
+	Py_XDECREF(separator);
+	Py_DECREF(rules_list);
+	PyErr_Clear();
+
+	return ret;
+}
+
+/**
+ * @description: 计算样本的key，即blake2b(规则集摘要 + 脚本内容)
+ * @param source 脚本内容
+ * @param size 脚本内容的长度
+ * @return bool
+ */
+static bool detect_analysis_cache_compute_key(const char *source, Py_ssize_t size) {
+	PyObject *data;
+	bool ret = false;
+
+	g_verdict_cache.has_key = false;
+
+	if (!detect_analysis_cache_compute_ruleset_digest()) {
+		return false;
+	}
+
+	/* 规则集摘要在前，脚本内容在后 */
+	data = PyBytes_FromStringAndSize(NULL, DETECT_CACHE_KEY_SIZE + size);
+	if (data == NULL) {
+		PyErr_Clear();
+		return false;
+	}
+	memcpy(PyBytes_AS_STRING(data), g_verdict_cache.ruleset_digest, DETECT_CACHE_KEY_SIZE);
+	memcpy(PyBytes_AS_STRING(data) + DETECT_CACHE_KEY_SIZE, source, size);
+
+	if (detect_analysis_cache_blake2b(data, g_verdict_cache.key)) {
+		g_verdict_cache.has_key = true;
+		ret = true;
+	}
+
+	Py_DECREF(data);
+
+	return ret;
+}
+
+/**
+ * @description: 读取脚本内容
+ * @param filename 脚本路径
+ * @return PyObject* bytes对象，失败时返回NULL且不设置异常
+ */
+static PyObject* detect_analysis_cache_read_file(const wchar_t *filename) {
+	FILE *fp;
+	long size;
+	PyObject *data;
+
+	fp = _Py_wfopen(filename, L"rb");
+	if (fp == NULL) {
+		return NULL;
+	}
+
+	if (fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET) != 0) {
+		fclose(fp);
+		return NULL;
+	}
+
+	data = PyBytes_FromStringAndSize(NULL, size);
+	if (data != NULL && fread(PyBytes_AS_STRING(data), 1, size, fp) != (size_t)size) {
+		Py_CLEAR(data);
+	}
+
+	fclose(fp);
+	PyErr_Clear();
+
+	return data;
+}
+
+/**
+ * @description: 获取key的起始槽位
+ * @param key 缓存key
+ * @return uint32_t
+ */
+static uint32_t detect_analysis_cache_home_slot(const unsigned char *key) {
+	uint32_t hash;
+
+	memcpy(&hash, key, sizeof(hash));
+
+	return hash % DETECT_CACHE_SLOT_COUNT;
+}
+
+/**
+ * @description: 计算样本字节码指纹的key，即blake2b(规则集摘要 + 指纹标识 + 规范化字节流)
+ * @param filename 脚本路径，作为编译时的文件名
+ * @param source 以'\0'结尾的脚本内容
+ * @return bool
+ */
+static bool detect_analysis_cache_compute_fingerprint_key(const wchar_t *filename, const char *source) {
+	PyObject *code, *fingerprint, *data;
+	Py_ssize_t prefix_len = DETECT_CACHE_KEY_SIZE + sizeof(DETECT_CACHE_FINGERPRINT_TAG);
+	bool ret = false;
+
+	g_verdict_cache.has_fingerprint_key = false;
+
+	if (!detect_config_get_runtime_is_fingerprint() || !g_verdict_cache.has_ruleset_digest) {
+		return false;
+	}
+
+	code = detect_analysis_prescan_compile_source(filename, source);
+	if (code == NULL) {
+		return false;
+	}
+
+	fingerprint = detect_analysis_fingerprint(code);
+	Py_DECREF(code);
+	if (fingerprint == NULL) {
+		return false;
+	}
+
+	data = PyBytes_FromStringAndSize(NULL, prefix_len + PyBytes_GET_SIZE(fingerprint));
+	if (data != NULL) {
+		memcpy(PyBytes_AS_STRING(data), g_verdict_cache.ruleset_digest, DETECT_CACHE_KEY_SIZE);
+		memcpy(PyBytes_AS_STRING(data) + DETECT_CACHE_KEY_SIZE, DETECT_CACHE_FINGERPRINT_TAG,
+			   sizeof(DETECT_CACHE_FINGERPRINT_TAG));
+		memcpy(PyBytes_AS_STRING(data) + prefix_len, PyBytes_AS_STRING(fingerprint), PyBytes_GET_SIZE(fingerprint));
+
+		if (detect_analysis_cache_blake2b(data, g_verdict_cache.fingerprint_key)) {
+			g_verdict_cache.has_fingerprint_key = true;
+			ret = true;
+		}
+		Py_DECREF(data);
+	}
+
+	Py_DECREF(fingerprint);
+	PyErr_Clear();
+
+	return ret;
+}
+
+/**
+ * @description: 把槽位中的检测结论还原为检测结果字典，字段顺序与检测时生成的字典相同
+ * @param slot 缓存槽位，调用方需持有文件锁
+ * @return PyObject* 检测结论字典，不包括文件名；失败时返回NULL且不设置异常
+ */
+static PyObject* detect_analysis_cache_decode_slot(const DETECT_CACHE_SLOT_T *slot) {
+	PyObject *verdict_dict, *coverage_dict, *value;
+
+	verdict_dict = PyDict_New();
+	if (verdict_dict == NULL) {
+		PyErr_Clear();
+		return NULL;
+	}
+
+	dict_setitem_string_object(verdict_dict, MALICIOUS_STRING, slot->is_malicious ? Py_True : Py_False);
+	if (slot->fields & DETECT_CACHE_FIELD_DESC) {
+		value = PyUnicode_FromStringAndSize(slot->desc, strnlen(slot->desc, DETECT_CACHE_TEXT_SIZE - 1));
+		dict_setitem_string_object(verdict_dict, DESC_STRING, value);
+		Py_XDECREF(value);
+	}
+	if (slot->fields & DETECT_CACHE_FIELD_STAGE) {
+		value = PyUnicode_FromStringAndSize(slot->stage, strnlen(slot->stage, DETECT_CACHE_TEXT_SIZE - 1));
+		dict_setitem_string_object(verdict_dict, STAGE_STRING, value);
+		Py_XDECREF(value);
+	}
+	if (slot->fields & DETECT_CACHE_FIELD_SCORE) {
+		value = PyLong_FromLong(slot->score);
+		dict_setitem_string_object(verdict_dict, SCORE_STRING, value);
+		Py_XDECREF(value);
+		dict_setitem_string_object(verdict_dict, NEED_SECOND_PASS_STRING, slot->need_second_pass ? Py_True : Py_False);
+	}
+	if (slot->fields & DETECT_CACHE_FIELD_COVERAGE) {
+		coverage_dict = PyDict_New();
+		if (coverage_dict != NULL) {
+			value = PyLong_FromUnsignedLong(slot->executed);
+			dict_setitem_string_object(coverage_dict, EXECUTED_STRING, value);
+			Py_XDECREF(value);
+			value = PyLong_FromUnsignedLong(slot->total);
+			dict_setitem_string_object(coverage_dict, TOTAL_STRING, value);
+			Py_XDECREF(value);
+			dict_setitem_string_object(verdict_dict, COVERAGE_STRING, coverage_dict);
+			Py_DECREF(coverage_dict);
+		}
+	}
+
+	if (PyErr_Occurred()) {
+		PyErr_Clear();
+		Py_DECREF(verdict_dict);
+		return NULL;
+	}
+
+	return verdict_dict;
+}
+
+/**
+ * @description: 把字符串字段拷贝到槽位的定长字段中
+ * @param dest 槽位中的定长字段，长度为DETECT_CACHE_TEXT_SIZE
+ * @param value 字符串对象
+ * @return bool 不是字符串或者超过定长字段的长度时返回false
+ */
+static bool detect_analysis_cache_encode_text(char *dest, PyObject *value) {
+	const char *text;
+	Py_ssize_t size;
+
+	if (!PyUnicode_Check(value) || (text = PyUnicode_AsUTF8AndSize(value, &size)) == NULL ||
+		size >= DETECT_CACHE_TEXT_SIZE) {
+		PyErr_Clear();
+		return false;
+	}
+
+	memcpy(dest, text, size);
+	dest[size] = '\0';
+
+	return true;
+}
+
+/**
+ * @description: 把检测结果字典转换为槽位的固定布局，不包括key和写入序号
+ * @param result_dict 检测结果字典
+ * @param slot 输出的槽位内容
+ * @return bool 结果字典中的字段无法以固定布局表示时返回false，此时不保存该结论
+ */
+static bool detect_analysis_cache_encode_slot(PyObject *result_dict, DETECT_CACHE_SLOT_T *slot) {
+	PyObject *value, *coverage_dict, *executed, *total;
+
+	memset(slot, 0, sizeof(DETECT_CACHE_SLOT_T));
+
+	value = PyDict_GetItemString(result_dict, MALICIOUS_STRING);
+	if (value == NULL || !PyBool_Check(value)) {
+		return false;
+	}
+	slot->is_malicious = value == Py_True;
+
+	value = PyDict_GetItemString(result_dict, DESC_STRING);
+	if (value != NULL) {
+		if (!detect_analysis_cache_encode_text(slot->desc, value)) {
+			return false;
+		}
+		slot->fields |= DETECT_CACHE_FIELD_DESC;
+	}
+
+	value = PyDict_GetItemString(result_dict, STAGE_STRING);
+	if (value != NULL) {
+		if (!detect_analysis_cache_encode_text(slot->stage, value)) {
+			return false;
+		}
+		slot->fields |= DETECT_CACHE_FIELD_STAGE;
+	}
+
+	value = PyDict_GetItemString(result_dict, SCORE_STRING);
+	if (value != NULL) {
+		if (!PyLong_Check(value)) {
+			return false;
+		}
+		slot->score            = (int32_t)PyLong_AsLong(value);
+		slot->need_second_pass = PyDict_GetItemString(result_dict, NEED_SECOND_PASS_STRING) == Py_True;
+		slot->fields |= DETECT_CACHE_FIELD_SCORE;
+	}
+
+	coverage_dict = PyDict_GetItemString(result_dict, COVERAGE_STRING);
+	if (coverage_dict != NULL && PyDict_Check(coverage_dict)) {
+		executed = PyDict_GetItemString(coverage_dict, EXECUTED_STRING);
+		total    = PyDict_GetItemString(coverage_dict, TOTAL_STRING);
+		if (executed == NULL || total == NULL || !PyLong_Check(executed) || !PyLong_Check(total)) {
+			return false;
+		}
+		slot->executed = (uint32_t)PyLong_AsUnsignedLong(executed);
+		slot->total    = (uint32_t)PyLong_AsUnsignedLong(total);
+		slot->fields |= DETECT_CACHE_FIELD_COVERAGE;
+	}
+
+	if (PyErr_Occurred()) {
+		PyErr_Clear();
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @description: 读取key对应的槽位中的检测结论
+ * @param key 缓存key
+ * @return PyObject* 检测结论字典，不包括文件名；未命中时返回NULL
+ */
+static PyObject* detect_analysis_cache_read_slot(const unsigned char *key) {
+	DETECT_CACHE_SLOT_T *slot;
+	PyObject *verdict_dict = NULL;
+	uint32_t home, probe;
+
+	home = detect_analysis_cache_home_slot(key);
+
+	if (!detect_analysis_cache_flock(g_verdict_cache.fd, LOCK_SH)) {
+		return NULL;
+	}
+	for (probe = 0; probe < DETECT_CACHE_MAX_PROBE; probe++) {
+		slot = &g_verdict_cache.slots[(home + probe) % DETECT_CACHE_SLOT_COUNT];
+		if (slot->stamp == 0) {
+			break;
+		}
+
+		if (memcmp(slot->key, key, DETECT_CACHE_KEY_SIZE) == 0) {
+			verdict_dict = detect_analysis_cache_decode_slot(slot);
+			break;
+		}
+	}
+	detect_analysis_cache_flock(g_verdict_cache.fd, LOCK_UN);
+
+	return verdict_dict;
+}
+
+/**
+ * @description: 把检测结论写入key对应的槽位，优先使用相同key或者空的槽位。探测范围内都被占用时
+ *               淘汰其中最早写入的槽位，查找在遇到空槽位时才停止，所以覆盖已占用的槽位不会截断其他key的探测序列
+ * @param key 缓存key
+ * @param content 固定布局的检测结论，key和写入序号在写入时填充
+ * @return void
+ */
+static void detect_analysis_cache_write_slot(const unsigned char *key, const DETECT_CACHE_SLOT_T *content) {
+	DETECT_CACHE_SLOT_T *slot, *target = NULL;
+	uint32_t home, probe;
+
+	home = detect_analysis_cache_home_slot(key);
+
+	/* 无法加锁时放弃写入，不能在没有互斥的情况下修改共享的槽位 */
+	if (!detect_analysis_cache_flock(g_verdict_cache.fd, LOCK_EX)) {
+		return;
+	}
+
+	for (probe = 0; probe < DETECT_CACHE_MAX_PROBE; probe++) {
+		slot = &g_verdict_cache.slots[(home + probe) % DETECT_CACHE_SLOT_COUNT];
+		if (slot->stamp == 0 || memcmp(slot->key, key, DETECT_CACHE_KEY_SIZE) == 0) {
+			target = slot;
+			break;
+		}
+		if (target == NULL || slot->stamp < target->stamp) {
+			target = slot;
+		}
+	}
+
+	/* 写入序号回绕时跳过代表空槽位的0 */
+	if (++g_verdict_cache.header->stamp == 0) {
+		g_verdict_cache.header->stamp = 1;
+	}
+
+	memcpy(target, content, sizeof(DETECT_CACHE_SLOT_T));
+	memcpy(target->key, key, DETECT_CACHE_KEY_SIZE);
+	target->stamp = g_verdict_cache.header->stamp;
+
+	detect_analysis_cache_flock(g_verdict_cache.fd, LOCK_UN);
+}
+
+/**
+ * @description: 查找内存中脚本的缓存检测结论。先按脚本内容查找，未命中时再按字节码指纹查找同一家族的恶意结论
+ * @param filename 脚本路径，可以是压缩包成员的虚拟路径
+ * @param source 以'\0'结尾的脚本内容
+ * @param size 脚本内容的长度
+ * @return PyObject* 检测结果字典，文件名为当前脚本路径；未命中时返回NULL
+ */
+PyObject* detect_analysis_cache_lookup_source(const wchar_t *filename, const char *source, Py_ssize_t size) {
+	PyObject *verdict_dict, *result_dict, *filename_obj;
+	bool is_near_duplicate = false;
+
+	g_verdict_cache.has_key = false;
+	g_verdict_cache.has_fingerprint_key = false;
+
+	if (!detect_analysis_cache_open() || !detect_analysis_cache_compute_key(source, size)) {
+		return NULL;
+	}
+
+	verdict_dict = detect_analysis_cache_read_slot(g_verdict_cache.key);
+	if (verdict_dict == NULL && detect_analysis_cache_compute_fingerprint_key(filename, source)) {
+		verdict_dict = detect_analysis_cache_read_slot(g_verdict_cache.fingerprint_key);
+		is_near_duplicate = verdict_dict != NULL;
+	}
+
+	if (verdict_dict == NULL) {
+		return NULL;
+	}
+
+	/* 命中缓存的样本不再执行，也不再保存结论 */
+	g_verdict_cache.has_key = false;
+	g_verdict_cache.has_fingerprint_key = false;
+
+	/* 缓存中不保存文件名，以当前脚本路径作为第一项，保持与检测结果字典相同的顺序 */
+	result_dict  = PyDict_New();
+	filename_obj = PyUnicode_FromWideChar(filename, -1);
+	if (result_dict == NULL || filename_obj == NULL) {
+		Py_XDECREF(result_dict);
+		Py_XDECREF(filename_obj);
+		Py_DECREF(verdict_dict);
+		PyErr_Clear();
+		return NULL;
+	}
+
+	dict_setitem_string_object(result_dict, FILENAME_STRING, filename_obj);
+	PyDict_Update(result_dict, verdict_dict);
+	dict_setitem_string_object(result_dict, CACHED_STRING, Py_True);
+	if (is_near_duplicate) {
+		dict_setitem_string_object(result_dict, NEAR_DUPLICATE_STRING, Py_True);
+	}
+	Py_DECREF(filename_obj);
+	Py_DECREF(verdict_dict);
+	PyErr_Clear();
+
+	return result_dict;
+}
+
+/**
+ * @description: 查找样本的缓存检测结论
+ * @param filename 脚本路径
+ * @return PyObject* 检测结果字典，文件名为当前脚本路径；未命中时返回NULL
+ */
+PyObject* detect_analysis_cache_lookup(const wchar_t *filename) {
+	PyObject *data, *result_dict;
+
+	if (!detect_analysis_cache_open()) {
+		return NULL;
+	}
+
+	data = detect_analysis_cache_read_file(filename);
+	if (data == NULL) {
+		return NULL;
+	}
+
+	result_dict = detect_analysis_cache_lookup_source(filename, PyBytes_AS_STRING(data), PyBytes_GET_SIZE(data));
+	Py_DECREF(data);
+
+	return result_dict;
+}
+
+/**
+ * @description: 保存当前样本的检测结论，只有在之前查找过缓存时才会保存。恶意结论同时按字节码指纹保存，
+ *               供同一家族的变形样本复用
+ * @param result_dict 检测结果字典
+ * @return void
+ */
+void detect_analysis_cache_store(PyObject *result_dict) {
+	DETECT_CACHE_SLOT_T content;
+
+	if (!g_verdict_cache.is_opened || !g_verdict_cache.has_key || result_dict == NULL) {
+		return;
+	}
+
+	/* 每个样本只保存一次 */
+	g_verdict_cache.has_key = false;
+
+	/* 不保存文件名，同一个脚本可能以不同路径上传 */
+	if (!detect_analysis_cache_encode_slot(result_dict, &content)) {
+		g_verdict_cache.has_fingerprint_key = false;
+		return;
+	}
+
+	detect_analysis_cache_write_slot(g_verdict_cache.key, &content);
+
+	/* 恶意结论按字节码指纹保存，指纹key在查找未按内容命中时已经计算 */
+	if (g_verdict_cache.has_fingerprint_key && content.is_malicious) {
+		detect_analysis_cache_write_slot(g_verdict_cache.fingerprint_key, &content);
+	}
+	g_verdict_cache.has_fingerprint_key = false;
+}
+
+/**
+ * @description: 单文件检测模式下查找缓存，命中时直接输出检测结论
+ * @param filename 脚本路径
+ * @return bool 是否命中缓存
+ */
+bool detect_analysis_cache_main_proc(const wchar_t *filename) {
+	PyObject *result_dict = detect_analysis_cache_lookup(filename);
+
+	if (result_dict == NULL) {
+		return false;
+	}
+
+	/* 输出检测结果到标准输出 */
+	PyObject_Print(result_dict, stdout, Py_PRINT_RAW);
+	fprintf(stdout, "\n");
+	fflush(stdout);
+
+	Py_DECREF(result_dict);
+
+	return true;
+}
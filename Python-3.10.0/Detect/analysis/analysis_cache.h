@@ -0,0 +1,67 @@
+#ifndef DETECT_ANALYSIS_CACHE_H
+#define DETECT_ANALYSIS_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <wchar.h>
+#include "Python.h"
+
+/* 缓存文件的标识，槽位布局改变时需要修改，旧格式的文件会被重新初始化 */
+#define DETECT_CACHE_MAGIC        "DVCACHE2"
+
+/* 缓存文件的槽位数量 */
+#define DETECT_CACHE_SLOT_COUNT   8192
+
+/* 查找和插入时的最大探测次数 */
+#define DETECT_CACHE_MAX_PROBE    8
+
+/* 缓存key的长度，blake2b摘要 */
+#define DETECT_CACHE_KEY_SIZE     32
+
+/* 槽位中描述和阶段名的最大长度，包括结尾的'\0' */
+#define DETECT_CACHE_TEXT_SIZE    96
+
+/* 槽位中有效的可选字段 */
+#define DETECT_CACHE_FIELD_DESC        0x01 // 恶意描述
+#define DETECT_CACHE_FIELD_STAGE       0x02 // 得出结论的阶段
+#define DETECT_CACHE_FIELD_SCORE       0x04 // 证据得分和是否需要展平分支再检测
+#define DETECT_CACHE_FIELD_COVERAGE    0x08 // 主脚本的指令覆盖数量
+
+/* 字节码指纹key的标识，与内容key区分 */
+#define DETECT_CACHE_FINGERPRINT_TAG "fingerprint"
+
+/* 命中缓存时检测结果字典中的key */
+#define CACHED_STRING             "Cached"
+
+/* 按字节码指纹命中时检测结果字典中的key */
+#define NEAR_DUPLICATE_STRING     "NearDuplicate"
+
+/* 缓存文件头 */
+typedef struct {
+	char magic[8];
+	uint32_t slot_count;
+	uint32_t stamp;      // 最近一次写入的序号
+} DETECT_CACHE_HEADER_T;
+
+/* 缓存槽位，固定布局保存检测结论中影响判定的字段，不包括文件名、未覆盖范围和debug模式下的调试信息。
+   stamp为0代表空槽位 */
+typedef struct {
+	unsigned char key[DETECT_CACHE_KEY_SIZE];   // blake2b(规则集摘要 + 脚本内容)
+	uint32_t stamp;                             // 写入时的序号，探测范围内都被占用时淘汰序号最小的槽位
+	uint8_t fields;                             // 有效的可选字段，DETECT_CACHE_FIELD_*
+	uint8_t is_malicious;                       // 是否为恶意
+	uint8_t need_second_pass;                   // 是否需要展平分支再检测
+	uint8_t reserved;
+	int32_t score;                              // 证据得分
+	uint32_t executed;                          // 主脚本已执行的指令数量
+	uint32_t total;                             // 主脚本的指令总数
+	char desc[DETECT_CACHE_TEXT_SIZE];          // 恶意描述
+	char stage[DETECT_CACHE_TEXT_SIZE];         // 得出结论的阶段
+} DETECT_CACHE_SLOT_T;
+
+extern PyObject* detect_analysis_cache_lookup_source(const wchar_t *filename, const char *source, Py_ssize_t size);
+extern PyObject* detect_analysis_cache_lookup(const wchar_t *filename);
+extern void detect_analysis_cache_store(PyObject *result_dict);
+extern bool detect_analysis_cache_main_proc(const wchar_t *filename);
+
+#endif
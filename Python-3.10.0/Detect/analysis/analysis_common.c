@@ -12,14 +12,18 @@
 #include "Detect/configs/config.h"
 #include "Detect/object/object.h"
 #include "Detect/analysis/analysis_common.h"
+#include "Detect/analysis/analysis_stage.h"
 #include "Detect/utils/dict.h"
 #include "Detect/utils/re.h"
+#include "Detect/virtual/virtual_fs.h"
 
 /**
   * @description: 向结果字典添加调试信息，用于debug模式下
   * @return PyObject*
   */
 static void detect_analysis_result_dict_add_debug_info(PyObject *result_dict) {
+	PyObject *files, *paths;
+
 	/* 添加当前检测是否跳过了所有分支 */
 	if (detect_config_get_runtime_is_jump_branch()) {	
 		dict_setitem_string_object(result_dict, JUMP_BRANCH_STRING, Py_True);
@@ -27,6 +31,18 @@ static void detect_analysis_result_dict_add_debug_info(PyObject *result_dict) {
 		dict_setitem_string_object(result_dict, JUMP_BRANCH_STRING, Py_False);
 	}
 
+	/* 添加样本写入虚拟文件系统的文件路径 */
+	files = detect_virtual_fs_get_files();
+	if (files != NULL && PyDict_GET_SIZE(files) > 0) {
+		paths = PyDict_Keys(files);
+		if (paths != NULL && PyList_Sort(paths) == 0) {
+			dict_setitem_string_object(result_dict, VIRTUAL_FILES_STRING, paths);
+		}
+		Py_XDECREF(paths);
+		PyErr_Clear();
+	}
+	Py_XDECREF(files);
+
 	return;
 }
 
@@ -36,19 +52,24 @@ static void detect_analysis_result_dict_add_debug_info(PyObject *result_dict) {
   * @return PyObject*
   */
 PyObject* detect_analysis_create_detect_malicious_result_dict(const char *desc) {
-	wchar_t  *run_filename;
 	PyObject *run_filename_obj;
 	PyObject *is_webshell_obj;
+	PyObject *stage_name;
 	PyObject *result_dict = PyDict_New();
 
-	run_filename     = _Py_GetConfig()->run_filename;
-	run_filename_obj = PyUnicode_FromWideChar(run_filename, wcslen(run_filename));
+	/* 在嵌套阶段中得出的结论归属于样本本身，并记录所在的阶段 */
+	run_filename_obj = detect_analysis_stage_get_sample_filename();
+	stage_name       = detect_analysis_stage_get_current();
 
 	is_webshell_obj = Py_True;
 
 	dict_setitem_string_object(result_dict, FILENAME_STRING,  run_filename_obj);
 	dict_setitem_string_object(result_dict, MALICIOUS_STRING, is_webshell_obj);
+	Py_XDECREF(run_filename_obj);
 	dict_setitem_string_string(result_dict, DESC_STRING, desc);
+	if (stage_name != NULL) {
+		dict_setitem_string_object(result_dict, STAGE_STRING, stage_name);
+	}
 
 	if (detect_config_get_runtime_is_debug()) {
 		detect_analysis_result_dict_add_debug_info(result_dict);
@@ -63,18 +84,17 @@ PyObject* detect_analysis_create_detect_malicious_result_dict(const char *desc)
   * @return PyObject*
   */
 PyObject* detect_analysis_create_detect_ok_result_dict(const char *desc) {
-	wchar_t  *run_filename;
 	PyObject *run_filename_obj;
 	PyObject *is_webshell_obj;
 	PyObject *result_dict = PyDict_New();
 
-	run_filename     = _Py_GetConfig()->run_filename;
-	run_filename_obj = PyUnicode_FromWideChar(run_filename, wcslen(run_filename));
+	run_filename_obj = detect_analysis_stage_get_sample_filename();
 
 	is_webshell_obj = Py_False;
 
 	dict_setitem_string_object(result_dict, FILENAME_STRING,  run_filename_obj);
 	dict_setitem_string_object(result_dict, MALICIOUS_STRING, is_webshell_obj);
+	Py_XDECREF(run_filename_obj);
 
 	if (detect_config_get_runtime_is_debug()) {
 		detect_analysis_result_dict_add_debug_info(result_dict);
@@ -130,9 +150,11 @@ PyObject* detect_record_create_params_list(PyObject **stack_pointer, int opcode,
 		/* 关键字参数组成的字典 */
 		if (kwargs_dict && PyDict_CheckExact(kwargs_dict)) {
 			PyObject *d = PyDict_New();
-			_PyDict_MergeEx(d, kwargs_dict, 2);
-			kwargs_dict = d;
-			PyList_Append(args_list, kwargs_dict);
+			if (d != NULL && _PyDict_MergeEx(d, kwargs_dict, 2) == 0) {
+				PyList_Append(args_list, d);
+			}
+			Py_XDECREF(d);
+			PyErr_Clear();
 		}
 	}
 
@@ -266,6 +288,7 @@ static PyObject*const* detect_analysis_create_args_and_kwnames(PyObject *const *
      * because it simplifies the deallocation in the failing case.
      * It happens to also make the loop above slightly more efficient. */
     if (!keys_are_strings) {
+        detect_analysis_free_args_and_kwnames(stack, nargs, kwnames);
         return NULL;
     }
 
@@ -347,6 +370,11 @@ PyObject*const* detect_analysis_get_call_original_params(PyObject **stack_pointe
 			args_tuple = stack_pointer[-1];
 		}
 
+		/* 位置参数不是元组或者关键字参数不是字典时，原处理逻辑会先进行转换，这里不解析 */
+		if (!PyTuple_CheckExact(args_tuple) || (kwargs_dict != NULL && !PyDict_CheckExact(kwargs_dict))) {
+			return NULL;
+		}
+
 		*nargs = PyTuple_GET_SIZE(args_tuple);
 		if (kwargs_dict == NULL || PyDict_GET_SIZE(kwargs_dict) == 0) {
 			args = _PyTuple_ITEMS(args_tuple);
@@ -15,6 +15,11 @@ typedef PyObject*(*analysis_func)();
 #define FUNCTION_NAME_STRING "FunctionName"
 #define ARGUMENTS_STRING     "Arguments"
 #define JUMP_BRANCH_STRING   "IsJumpBranch"
+#define VIRTUAL_FILES_STRING "VirtualFiles"
+
+/* 未检测出恶意时检测结果字典中的key */
+#define SCORE_STRING            "Score"
+#define NEED_SECOND_PASS_STRING "NeedSecondPass"
 
 extern PyObject* detect_analysis_create_detect_malicious_result_dict(const char *desc);
 extern PyObject* detect_analysis_create_detect_ok_result_dict(const char *desc);
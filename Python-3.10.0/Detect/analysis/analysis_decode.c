@@ -0,0 +1,459 @@
+/*
+ * @Description: 字符串常量静态解码。执行前递归遍历code对象中的字符串和bytes常量，对疑似编码过的
+ *               载荷逐层尝试rot13、hex、base64和zlib解码，解码结果中含有恶意特征时
+ *               直接给出恶意结论，不需要等到动态执行时exec被调用
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include "Python.h"
+#include "Detect/configs/config.h"
+#include "Detect/analysis/analysis_common.h"
+#include "Detect/analysis/analysis_decode.h"
+
+/* 参与解码的字符串常量的最小长度 */
+#define DECODE_MIN_LENGTH     16
+/* 最大解码层数 */
+#define DECODE_MAX_DEPTH      4
+/* 单次解码结果的最大长度 */
+#define DECODE_MAX_OUTPUT     (4 * 1024 * 1024)
+/* 单个脚本所有解码结果的总长度上限 */
+#define DECODE_MAX_TOTAL      (16 * 1024 * 1024)
+/* 解码结果中可打印字符的最低占比(百分比)，低于该值时视为二进制数据，不进行特征匹配 */
+#define DECODE_PRINTABLE_RATE 90
+
+/* re.IGNORECASE */
+#define DECODE_RE_FLAGS       2
+
+/* 恶意特征，解码结果中不含快速过滤子串(忽略大小写)时不会调用正则匹配。正则不跨行匹配，
+   需要跨行的特征锚定在开头，避免长文本上的回溯 */
+typedef struct {
+	const char *anchor;   // 快速过滤子串，小写
+	const char *pattern;  // 正则表达式
+} DETECT_DECODE_INDICATOR_T;
+
+static const DETECT_DECODE_INDICATOR_T g_decode_indicators[] = {
+	{"/dev/", "sh.*/dev/(tcp|udp)/"},                          // 反弹shell命令
+	{"dup2",  "\\A(?=[\\s\\S]*\\bsocket\\b)(?=[\\s\\S]*\\bdup2\\b)"
+			  "(?=[\\s\\S]*(/bin/(ba)?sh|\\bpty\\b))"},               // python反弹shell
+	{"nc",    "\\bnc(at)?\\b.*\\s-[ec]\\s"},                       // nc反弹shell
+	{"curl",  "\\bcurl\\b[^|;]*\\|\\s*(ba)?sh\\b"},                 // 下载并执行
+	{"wget",  "\\bwget\\b[^|;]*\\|\\s*(ba)?sh\\b"},                 // 下载并执行
+	{"reg ",  "\\breg (add|delete)\\b"},                          // 修改注册表
+};
+
+/* 解码上下文 */
+typedef struct {
+	PyObject *binascii;       // binascii模块
+	PyObject *zlib;           // zlib模块，不存在时不进行zlib解码
+	PyObject *search_method;  // re.search，首次需要特征匹配时获取
+	Py_ssize_t budget;        // 剩余可解码的总长度
+	bool is_hit;              // 是否命中恶意特征
+} DETECT_DECODE_CTX_T;
+
+static void detect_analysis_decode_bytes(DETECT_DECODE_CTX_T *ctx, PyObject *data, int depth, bool is_rot13);
+static void detect_analysis_decode_const(DETECT_DECODE_CTX_T *ctx, PyObject *constant, int depth);
+
+/**
+ * @description: 判断数据是否主要由可打印字符组成
+ * @param data 数据
+ * @param size 数据长度
+ * @return bool
+ */
+static bool detect_analysis_decode_is_printable(const unsigned char *data, Py_ssize_t size) {
+	Py_ssize_t index, printable = 0;
+
+	for (index = 0; index < size; index++) {
+		if ((data[index] >= 0x20 && data[index] < 0x7f) || data[index] == '\t' ||
+			data[index] == '\r' || data[index] == '\n') {
+			printable++;
+		}
+	}
+
+	return size > 0 && printable * 100 >= size * DECODE_PRINTABLE_RATE;
+}
+
+/**
+ * @description: 判断数据中是否含有快速过滤子串，忽略大小写
+ * @param data 数据
+ * @param size 数据长度
+ * @param anchor 快速过滤子串，小写
+ * @return bool
+ */
+static bool detect_analysis_decode_has_anchor(const unsigned char *data, Py_ssize_t size, const char *anchor) {
+	Py_ssize_t offset, pos, length = strlen(anchor);
+
+	for (offset = 0; offset + length <= size; offset++) {
+		for (pos = 0; pos < length && Py_TOLOWER(data[offset + pos]) == anchor[pos]; pos++);
+		if (pos == length) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @description: 准备特征匹配的文本，首次匹配时获取re.search
+ * @param ctx 解码上下文
+ * @param data 解码结果
+ * @param size 解码结果长度
+ * @return PyObject* 文本对象，失败时返回NULL且不设置异常
+ */
+static PyObject* detect_analysis_decode_prepare_text(DETECT_DECODE_CTX_T *ctx, const unsigned char *data,
+													 Py_ssize_t size) {
+	PyObject *re_module, *text;
+
+	/* 预过滤阶段detect模块尚未初始化，不能使用detect状态中缓存的re模块 */
+	if (ctx->search_method == NULL) {
+		re_module = PyImport_ImportModule("re");
+		if (re_module == NULL) {
+			PyErr_Clear();
+			return NULL;
+		}
+		ctx->search_method = PyObject_GetAttrString(re_module, "search");
+		Py_DECREF(re_module);
+		if (ctx->search_method == NULL) {
+			PyErr_Clear();
+			return NULL;
+		}
+	}
+
+	/* latin-1解码不会失败，且保留了原始字节 */
+	text = PyUnicode_DecodeLatin1((const char *)data, size, NULL);
+	if (text == NULL) {
+		PyErr_Clear();
+	}
+
+	return text;
+}
+
+/**
+ * @description: 对解码结果进行恶意特征匹配
+ * @param ctx 解码上下文
+ * @param data 解码结果
+ * @param size 解码结果长度
+ * @return bool 是否命中恶意特征
+ */
+static bool detect_analysis_decode_match(DETECT_DECODE_CTX_T *ctx, const unsigned char *data, Py_ssize_t size) {
+	PyObject *text = NULL, *searches;
+	unsigned int index;
+	bool is_hit = false;
+
+	if (!detect_analysis_decode_is_printable(data, size)) {
+		return false;
+	}
+
+	for (index = 0; !is_hit && index < sizeof(g_decode_indicators)/sizeof(DETECT_DECODE_INDICATOR_T); index++) {
+		if (!detect_analysis_decode_has_anchor(data, size, g_decode_indicators[index].anchor)) {
+			continue;
+		}
+
+		if (text == NULL) {
+			text = detect_analysis_decode_prepare_text(ctx, data, size);
+			if (text == NULL) {
+				return false;
+			}
+		}
+
+		searches = PyObject_CallFunction(ctx->search_method, "sOi", g_decode_indicators[index].pattern, text,
+										 DECODE_RE_FLAGS);
+		is_hit = searches != NULL && searches != Py_None;
+		Py_XDECREF(searches);
+	}
+
+	Py_XDECREF(text);
+	PyErr_Clear();
+
+	return is_hit;
+}
+
+/**
+ * @description: 递归解码code对象中的常量，嵌套的code对象不增加解码层数
+ * @param ctx 解码上下文
+ * @param code code对象
+ * @param depth 当前解码层数
+ * @return void
+ */
+static void detect_analysis_decode_code_consts(DETECT_DECODE_CTX_T *ctx, PyCodeObject *code, int depth) {
+	Py_ssize_t index;
+
+	for (index = 0; !ctx->is_hit && index < PyTuple_GET_SIZE(code->co_consts); index++) {
+		detect_analysis_decode_const(ctx, PyTuple_GET_ITEM(code->co_consts, index), depth);
+	}
+}
+
+/**
+ * @description: 判断数据是否可能为hex编码，要求全部为十六进制字符且长度为偶数
+ * @param data 数据
+ * @param size 数据长度
+ * @return bool
+ */
+static bool detect_analysis_decode_is_hex(const unsigned char *data, Py_ssize_t size) {
+	Py_ssize_t index;
+
+	if (size < DECODE_MIN_LENGTH || size % 2 != 0) {
+		return false;
+	}
+
+	for (index = 0; index < size; index++) {
+		if (!Py_ISXDIGIT(data[index])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @description: 判断数据是否可能为base64编码，允许换行以及urlsafe字符，有效字符数需为4的倍数
+ * @param data 数据
+ * @param size 数据长度
+ * @param is_urlsafe 是否含有urlsafe字符
+ * @return bool
+ */
+static bool detect_analysis_decode_is_base64(const unsigned char *data, Py_ssize_t size, bool *is_urlsafe) {
+	Py_ssize_t index, count = 0;
+
+	*is_urlsafe = false;
+	if (size < DECODE_MIN_LENGTH) {
+		return false;
+	}
+
+	for (index = 0; index < size; index++) {
+		if (data[index] == '\r' || data[index] == '\n') {
+			continue;
+		}
+		if (data[index] == '-' || data[index] == '_') {
+			*is_urlsafe = true;
+		} else if (!Py_ISALNUM(data[index]) && data[index] != '+' && data[index] != '/' && data[index] != '=') {
+			return false;
+		}
+		count++;
+	}
+
+	return count >= DECODE_MIN_LENGTH && count % 4 == 0;
+}
+
+/**
+ * @description: 判断数据是否可能为zlib或gzip压缩数据
+ * @param data 数据
+ * @param size 数据长度
+ * @return bool
+ */
+static bool detect_analysis_decode_is_zlib(const unsigned char *data, Py_ssize_t size) {
+	if (size < 8) {
+		return false;
+	}
+
+	return ((data[0] & 0x0f) == 8 && ((data[0] << 8) | data[1]) % 31 == 0) ||
+		   (data[0] == 0x1f && data[1] == 0x8b);
+}
+
+/**
+ * @description: 调用解码函数，解码结果必须为bytes对象，并计入解码总长度
+ * @param ctx 解码上下文
+ * @param result 解码函数的返回值，引用被接管
+ * @return PyObject* 解码结果，失败或超出总长度上限时返回NULL
+ */
+static PyObject* detect_analysis_decode_take_result(DETECT_DECODE_CTX_T *ctx, PyObject *result) {
+	if (result == NULL) {
+		PyErr_Clear();
+		return NULL;
+	}
+
+	if (!PyBytes_Check(result) || PyBytes_GET_SIZE(result) == 0 || PyBytes_GET_SIZE(result) > ctx->budget) {
+		Py_DECREF(result);
+		return NULL;
+	}
+
+	ctx->budget -= PyBytes_GET_SIZE(result);
+
+	return result;
+}
+
+/**
+ * @description: 尝试对数据做一层解码，解码成功后继续递归解码
+ * @param ctx 解码上下文
+ * @param data 数据，bytes对象
+ * @param depth 当前解码层数
+ * @param is_rot13 数据是否为上一层rot13的结果，rot13两次即为原文，无需重复
+ * @return void
+ */
+static void detect_analysis_decode_bytes(DETECT_DECODE_CTX_T *ctx, PyObject *data, int depth, bool is_rot13) {
+	const unsigned char *buf = (const unsigned char *)PyBytes_AS_STRING(data);
+	Py_ssize_t size = PyBytes_GET_SIZE(data), index;
+	PyObject *decoded, *decompressor;
+	bool is_urlsafe;
+	char *translated;
+
+	if (ctx->is_hit || ctx->budget <= 0) {
+		return;
+	}
+
+	/* 只匹配解码后的数据，原文中的字符串在动态执行时检测 */
+	if (depth > 0 && detect_analysis_decode_match(ctx, buf, size)) {
+		ctx->is_hit = true;
+		return;
+	}
+
+	if (depth >= DECODE_MAX_DEPTH || size < DECODE_MIN_LENGTH) {
+		return;
+	}
+
+	/* rot13 */
+	if (!is_rot13 && detect_analysis_decode_is_printable(buf, size)) {
+		decoded = detect_analysis_decode_take_result(ctx, PyBytes_FromStringAndSize(NULL, size));
+		if (decoded != NULL) {
+			translated = PyBytes_AS_STRING(decoded);
+			for (index = 0; index < size; index++) {
+				if (Py_ISLOWER(buf[index])) {
+					translated[index] = (char)('a' + (buf[index] - 'a' + 13) % 26);
+				} else if (Py_ISUPPER(buf[index])) {
+					translated[index] = (char)('A' + (buf[index] - 'A' + 13) % 26);
+				} else {
+					translated[index] = (char)buf[index];
+				}
+			}
+			detect_analysis_decode_bytes(ctx, decoded, depth + 1, true);
+			Py_DECREF(decoded);
+		}
+	}
+
+	/* hex */
+	if (!ctx->is_hit && detect_analysis_decode_is_hex(buf, size)) {
+		decoded = detect_analysis_decode_take_result(ctx,
+			PyObject_CallMethod(ctx->binascii, "unhexlify", "O", data));
+		if (decoded != NULL) {
+			detect_analysis_decode_bytes(ctx, decoded, depth + 1, false);
+			Py_DECREF(decoded);
+		}
+	}
+
+	/* base64 */
+	if (!ctx->is_hit && detect_analysis_decode_is_base64(buf, size, &is_urlsafe)) {
+		if (is_urlsafe) {
+			decoded = PyBytes_FromStringAndSize((const char *)buf, size);
+			if (decoded != NULL) {
+				translated = PyBytes_AS_STRING(decoded);
+				for (index = 0; index < size; index++) {
+					translated[index] = translated[index] == '-' ? '+' :
+										translated[index] == '_' ? '/' : translated[index];
+				}
+				Py_SETREF(decoded, PyObject_CallMethod(ctx->binascii, "a2b_base64", "O", decoded));
+			}
+		} else {
+			decoded = PyObject_CallMethod(ctx->binascii, "a2b_base64", "O", data);
+		}
+		decoded = detect_analysis_decode_take_result(ctx, decoded);
+		if (decoded != NULL) {
+			detect_analysis_decode_bytes(ctx, decoded, depth + 1, false);
+			Py_DECREF(decoded);
+		}
+	}
+
+	/* zlib和gzip，限制解压后的长度 */
+	if (!ctx->is_hit && ctx->zlib != NULL && detect_analysis_decode_is_zlib(buf, size)) {
+		decompressor = PyObject_CallMethod(ctx->zlib, "decompressobj", "i", 32 + 15);
+		decoded = decompressor != NULL ?
+			PyObject_CallMethod(decompressor, "decompress", "On", data,
+								Py_MIN(ctx->budget, (Py_ssize_t)DECODE_MAX_OUTPUT)) : NULL;
+		Py_XDECREF(decompressor);
+		decoded = detect_analysis_decode_take_result(ctx, decoded);
+		if (decoded != NULL) {
+			detect_analysis_decode_bytes(ctx, decoded, depth + 1, false);
+			Py_DECREF(decoded);
+		}
+	}
+}
+
+/**
+ * @description: 解码常量，元组和frozenset需要递归处理
+ * @param ctx 解码上下文
+ * @param constant 常量对象
+ * @param depth 当前解码层数
+ * @return void
+ */
+static void detect_analysis_decode_const(DETECT_DECODE_CTX_T *ctx, PyObject *constant, int depth) {
+	PyObject *iter, *item, *data;
+
+	if (ctx->is_hit) {
+		return;
+	}
+
+	if (PyBytes_Check(constant)) {
+		detect_analysis_decode_bytes(ctx, constant, depth, false);
+	} else if (PyUnicode_Check(constant)) {
+		if (PyUnicode_GET_LENGTH(constant) < DECODE_MIN_LENGTH) {
+			return;
+		}
+		data = PyUnicode_AsUTF8String(constant);
+		if (data == NULL) {
+			PyErr_Clear();
+			return;
+		}
+		detect_analysis_decode_bytes(ctx, data, depth, false);
+		Py_DECREF(data);
+	} else if (PyCode_Check(constant)) {
+		detect_analysis_decode_code_consts(ctx, (PyCodeObject *)constant, depth);
+	} else if (PyTuple_Check(constant) || PyFrozenSet_Check(constant)) {
+		iter = PyObject_GetIter(constant);
+		if (iter == NULL) {
+			PyErr_Clear();
+			return;
+		}
+		while (!ctx->is_hit && (item = PyIter_Next(iter)) != NULL) {
+			detect_analysis_decode_const(ctx, item, depth);
+			Py_DECREF(item);
+		}
+		Py_DECREF(iter);
+	}
+}
+
+/**
+ * @description: 对已编译的脚本进行字符串常量静态解码
+ * @param code 脚本的code对象
+ * @return PyObject* 解码结果命中恶意特征时返回恶意的检测结果字典，否则返回NULL
+ */
+PyObject* detect_analysis_decode_code(PyObject *code) {
+	DETECT_DECODE_CTX_T ctx = {0};
+	PyObject *result_dict = NULL;
+
+	if (!detect_config_get_runtime_is_enable() || !detect_config_get_runtime_is_static_decode()) {
+		return NULL;
+	}
+
+	ctx.budget   = DECODE_MAX_TOTAL;
+	ctx.binascii = PyImport_ImportModule("binascii");
+	ctx.zlib     = PyImport_ImportModule("zlib");
+	PyErr_Clear();
+
+	if (ctx.binascii != NULL) {
+		detect_analysis_decode_code_consts(&ctx, (PyCodeObject *)code, 0);
+	}
+
+	if (ctx.is_hit) {
+		result_dict = detect_analysis_create_detect_malicious_result_dict("Encoded payload with malicious indicator");
+	}
+
+	Py_XDECREF(ctx.binascii);
+	Py_XDECREF(ctx.zlib);
+	Py_XDECREF(ctx.search_method);
+	PyErr_Clear();
+
+	return result_dict;
+}
+
+/**
+ * @description: 收集解码结果的恶意特征，用于计算规则集的版本
+ * @param rules_list 规则列表
+ * @return void
+ */
+void detect_analysis_decode_collect_rules(PyObject *rules_list) {
+	unsigned int index;
+
+	for (index = 0; index < sizeof(g_decode_indicators)/sizeof(DETECT_DECODE_INDICATOR_T); index++) {
+		detect_config_append_rule(rules_list, "decode_indicator", NULL, NULL, NULL,
+								  g_decode_indicators[index].pattern, NULL, 0);
+	}
+}
@@ -0,0 +1,9 @@
+#ifndef DETECT_ANALYSIS_DECODE_H
+#define DETECT_ANALYSIS_DECODE_H
+
+#include "Python.h"
+
+extern PyObject* detect_analysis_decode_code(PyObject *code);
+extern void detect_analysis_decode_collect_rules(PyObject *rules_list);
+
+#endif
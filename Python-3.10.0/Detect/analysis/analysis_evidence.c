@@ -0,0 +1,149 @@
+/*
+ * @Description: 跨线程的证据库。样本可能在一个线程中复制描述符、在另一个线程中执行命令，
+ *               各线程把观察到的事实写入解释器级的证据库，分析函数基于合并后的证据给出结论。
+ *               每个证据项首次出现时按权重计入得分，得分用于提前结束检测和判断是否需要展平分支再检测。
+ *               证据项只是弱证据，其得分总和计入总分时截断在阈值以下，必须有分析函数给出结论才能达到阈值
+ */
+
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "Python.h"
+#include "Detect/analysis/analysis_evidence.h"
+#include "Detect/configs/config.h"
+#include "Detect/detect_state.h"
+
+/* 各证据项首次出现时计入得分的权重 */
+static const long g_evidence_weight[DETECT_EVIDENCE_MAX] = {
+	[DETECT_EVIDENCE_DUP_0]              = 20,
+	[DETECT_EVIDENCE_DUP_1]              = 20,
+	[DETECT_EVIDENCE_DUP_TAINT_COUNT]    = 20,
+	[DETECT_EVIDENCE_COMMAND_CONTAIN_SH] = 10,
+	[DETECT_EVIDENCE_COMMAND_MALICIOUS]  = 50,
+	[DETECT_EVIDENCE_THREAT_MODULE]      = 5,
+	[DETECT_EVIDENCE_TAINT_INPUT]        = 10,
+	[DETECT_EVIDENCE_THREAT_CALL]        = 10,
+};
+
+/**
+ * @description: 获取当前解释器的证据库
+ * @return DETECT_ANALYSIS_EVIDENCE_T*
+ */
+static DETECT_ANALYSIS_EVIDENCE_T* detect_analysis_evidence_get_store() {
+	DETECT_STATE_T *state = detect_state_get();
+
+	if (state == NULL) {
+		return NULL;
+	}
+
+	return &state->evidence;
+}
+
+/**
+ * @description: 设置布尔类的证据项
+ * @param id 证据项
+ * @return void
+ */
+void detect_analysis_evidence_set(DETECT_EVIDENCE_E id) {
+	DETECT_ANALYSIS_EVIDENCE_T *store = detect_analysis_evidence_get_store();
+
+	if (store == NULL) {
+		return;
+	}
+
+	if (atomic_exchange_explicit(&store->items[id], 1, memory_order_acq_rel) == 0) {
+		atomic_fetch_add_explicit(&store->evidence_score, g_evidence_weight[id], memory_order_acq_rel);
+	}
+}
+
+/**
+ * @description: 累加计数类的证据项
+ * @param id 证据项
+ * @param value 累加值
+ * @return void
+ */
+void detect_analysis_evidence_add(DETECT_EVIDENCE_E id, long value) {
+	DETECT_ANALYSIS_EVIDENCE_T *store = detect_analysis_evidence_get_store();
+
+	if (store == NULL) {
+		return;
+	}
+
+	if (atomic_fetch_add_explicit(&store->items[id], value, memory_order_acq_rel) == 0 && value > 0) {
+		atomic_fetch_add_explicit(&store->evidence_score, g_evidence_weight[id], memory_order_acq_rel);
+	}
+}
+
+/**
+ * @description: 获取证据项的值
+ * @param id 证据项
+ * @return long
+ */
+long detect_analysis_evidence_get(DETECT_EVIDENCE_E id) {
+	DETECT_ANALYSIS_EVIDENCE_T *store = detect_analysis_evidence_get_store();
+
+	if (store == NULL) {
+		return 0;
+	}
+
+	return atomic_load_explicit(&store->items[id], memory_order_acquire);
+}
+
+/**
+ * @description: 判断布尔类的证据项是否已设置
+ * @param id 证据项
+ * @return bool
+ */
+bool detect_analysis_evidence_is_set(DETECT_EVIDENCE_E id) {
+	return detect_analysis_evidence_get(id) != 0;
+}
+
+/**
+ * @description: 累加得分，用于分析函数给出的加权结论
+ * @param weight 权重
+ * @return long 累加后的得分
+ */
+long detect_analysis_evidence_add_score(long weight) {
+	DETECT_ANALYSIS_EVIDENCE_T *store = detect_analysis_evidence_get_store();
+
+	if (store == NULL) {
+		return 0;
+	}
+
+	atomic_fetch_add_explicit(&store->score, weight, memory_order_acq_rel);
+
+	return detect_analysis_evidence_get_score();
+}
+
+/**
+ * @description: 获取当前得分，证据项的得分截断在阈值以下
+ * @return long
+ */
+long detect_analysis_evidence_get_score() {
+	DETECT_ANALYSIS_EVIDENCE_T *store = detect_analysis_evidence_get_store();
+	long evidence_score, evidence_cap;
+
+	if (store == NULL) {
+		return 0;
+	}
+
+	evidence_score = atomic_load_explicit(&store->evidence_score, memory_order_acquire);
+	evidence_cap   = detect_config_get_runtime_score_threshold() - 1;
+	if (evidence_score > evidence_cap) {
+		evidence_score = evidence_cap > 0 ? evidence_cap : 0;
+	}
+
+	return atomic_load_explicit(&store->score, memory_order_acquire) + evidence_score;
+}
+
+/**
+ * @description: 收集证据项的权重，用于计算规则集的版本
+ * @param rules_list 规则列表
+ * @return void
+ */
+void detect_analysis_evidence_collect_rules(PyObject *rules_list) {
+	int id;
+
+	for (id = 0; id < DETECT_EVIDENCE_MAX; id++) {
+		detect_config_append_rule(rules_list, "evidence", NULL, NULL, NULL, NULL, NULL, g_evidence_weight[id]);
+	}
+}
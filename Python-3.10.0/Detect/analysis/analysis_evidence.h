@@ -0,0 +1,36 @@
+#ifndef DETECT_ANALYSIS_EVIDENCE_H
+#define DETECT_ANALYSIS_EVIDENCE_H
+
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "Python.h"
+
+/* 证据项，由各分析函数在任意线程中写入，分析时合并判断 */
+typedef enum {
+	DETECT_EVIDENCE_DUP_0,               // 是否复制了描述符0
+	DETECT_EVIDENCE_DUP_1,               // 是否复制了描述符1
+	DETECT_EVIDENCE_DUP_TAINT_COUNT,     // fd2为外部输入时复制的次数
+	DETECT_EVIDENCE_COMMAND_CONTAIN_SH,  // 执行的命令是否包含sh
+	DETECT_EVIDENCE_COMMAND_MALICIOUS,   // 命令本身是否就是恶意的
+	DETECT_EVIDENCE_THREAT_MODULE,       // 是否导入了包含威胁调用的模块
+	DETECT_EVIDENCE_TAINT_INPUT,         // 是否调用了外部输入
+	DETECT_EVIDENCE_THREAT_CALL,         // 是否调用了威胁对象
+	DETECT_EVIDENCE_MAX
+} DETECT_EVIDENCE_E;
+
+/* 证据库，每一项都是原子变量，多线程写入时无需加锁 */
+typedef struct {
+	atomic_long items[DETECT_EVIDENCE_MAX];
+	atomic_long evidence_score;          // 证据项的加权得分，计入总分时不超过阈值
+	atomic_long score;                   // 分析结论的加权得分
+} DETECT_ANALYSIS_EVIDENCE_T;
+
+extern void detect_analysis_evidence_set(DETECT_EVIDENCE_E id);
+extern void detect_analysis_evidence_add(DETECT_EVIDENCE_E id, long value);
+extern long detect_analysis_evidence_get(DETECT_EVIDENCE_E id);
+extern bool detect_analysis_evidence_is_set(DETECT_EVIDENCE_E id);
+extern long detect_analysis_evidence_add_score(long weight);
+extern long detect_analysis_evidence_get_score();
+extern void detect_analysis_evidence_collect_rules(PyObject *rules_list);
+
+#endif
@@ -0,0 +1,331 @@
+/*
+ * @Description: 未调用函数探索。很多样本的payload定义在只有特定条件下才会调用的函数中，或者作为
+ *               从未触发的回调，主脚本执行结束后以taint对象作为全部参数调用这些函数，在同一次执行
+ *               中覆盖死代码中的payload
+ */
+
+#include <stdbool.h>
+#include "Python.h"
+#include "pycore_interp.h"
+#include "frameobject.h"
+#include "Detect/configs/config.h"
+#include "Detect/analysis/analysis_explore.h"
+#include "Detect/detect_state.h"
+
+/* 探索函数的最大数量 */
+#define DETECT_EXPLORE_MAX_FUNCS 256
+
+/* 生成器和协程的最大恢复执行次数 */
+#define DETECT_EXPLORE_MAX_RESUME 64
+
+/* 作为参数传入的taint对象对应的外部输入配置 */
+#define DETECT_EXPLORE_TAINT_KEY "sys-argv"
+
+/* 函数的调用方式 */
+typedef enum {
+	DETECT_EXPLORE_KIND_FUNC = 0,     // 模块级函数
+	DETECT_EXPLORE_KIND_METHOD,       // 实例方法，第一个参数为类的实例
+	DETECT_EXPLORE_KIND_CLASSMETHOD,  // 类方法，第一个参数为类
+	DETECT_EXPLORE_KIND_STATICMETHOD, // 静态方法
+} DETECT_EXPLORE_KIND_E;
+
+/**
+ * @description: 获取作为参数传入的taint对象，优先使用sys.argv的hook对象
+ * @return PyObject* 借用引用，不存在时返回NULL
+ */
+static PyObject* detect_analysis_explore_get_taint_object() {
+	PyObject *config_dict, *key, *value;
+	Py_ssize_t pos = 0;
+
+	config_dict = PyDict_GetItemString(g_taint_input_var_dict, DETECT_EXPLORE_TAINT_KEY);
+	if (config_dict != NULL) {
+		return PyDict_GetItemString(config_dict, HOOK_OBJECT_STRING);
+	}
+
+	/* 配置表中没有sys.argv时使用任意一个外部输入函数的hook对象 */
+	if (PyDict_Next(g_taint_input_func_dict, &pos, &key, &value)) {
+		return PyDict_GetItemString(value, HOOK_OBJECT_STRING);
+	}
+
+	return NULL;
+}
+
+/**
+ * @description: 判断函数是否为主脚本中定义且从未被调用过的函数
+ * @param func 函数对象
+ * @param run_filename 主脚本路径
+ * @return bool
+ */
+static bool detect_analysis_explore_is_uncalled(PyObject *func, PyObject *run_filename) {
+	DETECT_STATE_T *state = detect_state_get();
+	PyCodeObject *code;
+
+	if (!PyFunction_Check(func)) {
+		return false;
+	}
+
+	code = (PyCodeObject *)PyFunction_GET_CODE(func);
+	if (PyUnicode_Compare(code->co_filename, run_filename) != 0) {
+		PyErr_Clear();
+		return false;
+	}
+
+	return state->entered_code_set == NULL || PySet_Contains(state->entered_code_set, (PyObject *)code) == 0;
+}
+
+/**
+ * @description: 添加待探索的函数
+ * @param candidates 待探索函数列表，每一项为(函数, 类, 调用方式)元组
+ * @param func 函数对象
+ * @param cls 函数所属的类，模块级函数为None
+ * @param kind 调用方式
+ * @param run_filename 主脚本路径
+ * @return void
+ */
+static void detect_analysis_explore_add_candidate(PyObject *candidates, PyObject *func, PyObject *cls,
+												  DETECT_EXPLORE_KIND_E kind, PyObject *run_filename) {
+	PyObject *item;
+
+	if (PyList_GET_SIZE(candidates) >= DETECT_EXPLORE_MAX_FUNCS ||
+		!detect_analysis_explore_is_uncalled(func, run_filename)) {
+		return;
+	}
+
+	item = Py_BuildValue("(OOi)", func, cls, kind);
+	if (item != NULL) {
+		PyList_Append(candidates, item);
+		Py_DECREF(item);
+	}
+}
+
+/**
+ * @description: 收集类中定义的方法，静态方法和类方法取出其中的函数对象
+ * @param candidates 待探索函数列表
+ * @param cls 类对象
+ * @param run_filename 主脚本路径
+ * @return void
+ */
+static void detect_analysis_explore_collect_class(PyObject *candidates, PyObject *cls, PyObject *run_filename) {
+	PyObject *cls_dict = ((PyTypeObject *)cls)->tp_dict;
+	PyObject *key, *value, *func;
+	Py_ssize_t pos = 0;
+
+	if (cls_dict == NULL) {
+		return;
+	}
+
+	while (PyDict_Next(cls_dict, &pos, &key, &value)) {
+		if (PyFunction_Check(value)) {
+			detect_analysis_explore_add_candidate(candidates, value, cls, DETECT_EXPLORE_KIND_METHOD, run_filename);
+		} else if (Py_IS_TYPE(value, &PyStaticMethod_Type) || Py_IS_TYPE(value, &PyClassMethod_Type)) {
+			func = PyObject_GetAttrString(value, "__func__");
+			if (func == NULL) {
+				PyErr_Clear();
+				continue;
+			}
+			detect_analysis_explore_add_candidate(candidates, func, cls,
+												  Py_IS_TYPE(value, &PyStaticMethod_Type) ?
+												  DETECT_EXPLORE_KIND_STATICMETHOD : DETECT_EXPLORE_KIND_CLASSMETHOD,
+												  run_filename);
+			Py_DECREF(func);
+		}
+	}
+}
+
+/**
+ * @description: 遍历__main__模块的全局变量和其中类的字典，收集主脚本定义且从未被调用过的函数和方法
+ * @param run_filename 主脚本路径
+ * @return PyObject* 待探索函数列表，每一项为(函数, 类, 调用方式)元组
+ */
+static PyObject* detect_analysis_explore_collect(PyObject *run_filename) {
+	PyObject *main_module, *globals, *candidates;
+	PyObject *key, *value;
+	Py_ssize_t pos = 0;
+
+	main_module = PyImport_AddModule("__main__");
+	candidates  = PyList_New(0);
+	if (main_module == NULL || candidates == NULL) {
+		Py_XDECREF(candidates);
+		return NULL;
+	}
+
+	globals = PyModule_GetDict(main_module);
+	while (PyDict_Next(globals, &pos, &key, &value)) {
+		if (PyFunction_Check(value)) {
+			detect_analysis_explore_add_candidate(candidates, value, Py_None, DETECT_EXPLORE_KIND_FUNC, run_filename);
+		} else if (PyType_Check(value) && !(((PyTypeObject *)value)->tp_flags & Py_TPFLAGS_IMMUTABLETYPE)) {
+			detect_analysis_explore_collect_class(candidates, value, run_filename);
+		}
+	}
+
+	return candidates;
+}
+
+/**
+ * @description: 创建类的实例，作为实例方法的self参数，不调用__init__
+ * @param cls 类对象
+ * @param taint_object taint对象，无法创建实例时作为self参数
+ * @return PyObject* 新引用
+ */
+static PyObject* detect_analysis_explore_create_self(PyObject *cls, PyObject *taint_object) {
+	PyTypeObject *type = (PyTypeObject *)cls;
+	PyObject *args, *self = NULL;
+
+	args = PyTuple_New(0);
+	if (args != NULL && type->tp_new != NULL) {
+		self = type->tp_new(type, args, NULL);
+	}
+	Py_XDECREF(args);
+
+	if (self == NULL) {
+		PyErr_Clear();
+		Py_INCREF(taint_object);
+		self = taint_object;
+	}
+
+	return self;
+}
+
+/**
+ * @description: 驱动生成器、协程和异步生成器执行，函数体在恢复执行时才会运行
+ * @param result 函数调用的返回值
+ * @return void
+ */
+static void detect_analysis_explore_drive(PyObject *result) {
+	DETECT_STATE_T *state = detect_state_get();
+	PyObject *awaitable, *ret;
+	int count;
+
+	if (PyAsyncGen_CheckExact(result)) {
+		for (count = 0; count < DETECT_EXPLORE_MAX_RESUME && !state->is_finished; count++) {
+			awaitable = PyObject_CallMethod(result, "__anext__", NULL);
+			if (awaitable == NULL) {
+				break;
+			}
+			detect_analysis_explore_drive(awaitable);
+			Py_DECREF(awaitable);
+			if (PyErr_Occurred()) {
+				break;
+			}
+		}
+		PyErr_Clear();
+		return;
+	}
+
+	/* 异步生成器的__anext__返回的awaitable同样通过send恢复执行 */
+	if (!PyGen_Check(result) && !PyCoro_CheckExact(result) && !Py_IS_TYPE(result, &_PyAsyncGenASend_Type)) {
+		return;
+	}
+
+	for (count = 0; count < DETECT_EXPLORE_MAX_RESUME && !state->is_finished; count++) {
+		ret = PyObject_CallMethod(result, "send", "O", Py_None);
+		if (ret == NULL) {
+			break;
+		}
+		Py_DECREF(ret);
+	}
+}
+
+/**
+ * @description: 以taint对象作为全部参数调用一个待探索的函数
+ * @param item (函数, 类, 调用方式)元组
+ * @param taint_object taint对象
+ * @return void
+ */
+static void detect_analysis_explore_call(PyObject *item, PyObject *taint_object) {
+	PyObject *func = PyTuple_GET_ITEM(item, 0);
+	PyObject *cls  = PyTuple_GET_ITEM(item, 1);
+	DETECT_EXPLORE_KIND_E kind = PyLong_AsLong(PyTuple_GET_ITEM(item, 2));
+	PyCodeObject *code = (PyCodeObject *)PyFunction_GET_CODE(func);
+	PyObject *args, *kwargs, *arg, *result;
+	Py_ssize_t index;
+
+	args   = PyTuple_New(code->co_argcount);
+	kwargs = PyDict_New();
+	if (args == NULL || kwargs == NULL) {
+		Py_XDECREF(args);
+		Py_XDECREF(kwargs);
+		return;
+	}
+
+	for (index = 0; index < code->co_argcount; index++) {
+		if (index == 0 && kind == DETECT_EXPLORE_KIND_METHOD) {
+			arg = detect_analysis_explore_create_self(cls, taint_object);
+		} else if (index == 0 && kind == DETECT_EXPLORE_KIND_CLASSMETHOD) {
+			Py_INCREF(cls);
+			arg = cls;
+		} else {
+			Py_INCREF(taint_object);
+			arg = taint_object;
+		}
+		PyTuple_SET_ITEM(args, index, arg);
+	}
+
+	/* 仅限关键字参数位于位置参数之后 */
+	for (index = code->co_argcount; index < code->co_argcount + code->co_kwonlyargcount; index++) {
+		PyDict_SetItem(kwargs, PyTuple_GET_ITEM(code->co_varnames, index), taint_object);
+	}
+
+	/* 样本抛出的异常以及SystemExit只代表该函数执行结束 */
+	result = PyObject_Call(func, args, kwargs);
+	if (result != NULL) {
+		detect_analysis_explore_drive(result);
+		Py_DECREF(result);
+	}
+	PyErr_Clear();
+
+	Py_DECREF(args);
+	Py_DECREF(kwargs);
+}
+
+/**
+ * @description: 未调用函数探索处理函数，主脚本执行结束后调用。被探索的函数与主脚本在同一套hook
+ *               和分析函数下执行，探索过程中调用到的其他函数会被记录为已调用，不再重复探索
+ * @return void
+ */
+void detect_analysis_explore_proc() {
+	DETECT_STATE_T *state = detect_state_get();
+	PyObject *run_filename, *candidates, *item, *taint_object;
+	PyObject *exc_type, *exc_value, *exc_tb;
+	Py_ssize_t index;
+
+	if (!detect_config_get_runtime_is_enable() || !detect_config_get_runtime_is_explore()) {
+		return;
+	}
+
+	if (state == NULL || !state->has_init || state->is_finished || _Py_GetConfig()->run_filename == NULL) {
+		return;
+	}
+
+	taint_object = detect_analysis_explore_get_taint_object();
+	if (taint_object == NULL) {
+		return;
+	}
+
+	/* 主脚本以异常结束时保留该异常 */
+	PyErr_Fetch(&exc_type, &exc_value, &exc_tb);
+
+	run_filename = PyUnicode_FromWideChar(_Py_GetConfig()->run_filename, -1);
+	candidates = run_filename != NULL ? detect_analysis_explore_collect(run_filename) : NULL;
+
+	for (index = 0; candidates != NULL && index < PyList_GET_SIZE(candidates); index++) {
+		/* 已经得出检测结论 */
+		if (state->is_finished) {
+			break;
+		}
+
+		/* 之前探索的函数中已经调用过 */
+		item = PyList_GET_ITEM(candidates, index);
+		if (!detect_analysis_explore_is_uncalled(PyTuple_GET_ITEM(item, 0), run_filename)) {
+			continue;
+		}
+
+		detect_analysis_explore_call(item, taint_object);
+	}
+
+	Py_XDECREF(candidates);
+	Py_XDECREF(run_filename);
+	PyErr_Clear();
+
+	PyErr_Restore(exc_type, exc_value, exc_tb);
+}
@@ -0,0 +1,8 @@
+#ifndef DETECT_ANALYSIS_EXPLORE_H
+#define DETECT_ANALYSIS_EXPLORE_H
+
+#include "Python.h"
+
+extern void detect_analysis_explore_proc();
+
+#endif
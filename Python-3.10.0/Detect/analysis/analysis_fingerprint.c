@@ -0,0 +1,432 @@
+/*
+ * @Description: 字节码指纹。同一家族的恶意脚本经常只做简单变形后重新上传，例如重命名变量、调整导入顺序、
+ *               修改IP等常量。编译脚本后把所有code对象规范化为一个字节流：保留opcode结构、属性名、
+ *               内置函数名、导入的模块名、所有常量的类型和长度量级以及字符串常量的特征类别，忽略变量名、
+ *               常量的具体值和导入语句的顺序，以该字节流作为指纹。常量的特征类别区分了结构相同但执行命令
+ *               不同的脚本，指令过少的脚本结构区分度不够，不计算指纹
+ */
+
+#include <stdbool.h>
+#include "Python.h"
+#include "opcode.h"
+#include "Detect/analysis/analysis_fingerprint.h"
+
+/* 规范化字节流中的分隔符 */
+#define FINGERPRINT_CODE_BEGIN  '{'
+#define FINGERPRINT_CODE_END    '}'
+#define FINGERPRINT_NAME_BEGIN  '<'
+#define FINGERPRINT_NAME_END    '>'
+#define FINGERPRINT_CONST_BEGIN '['
+#define FINGERPRINT_CONST_END   ']'
+
+/* 计算指纹的最少指令数量 */
+#define FINGERPRINT_MIN_INSTRUCTIONS 32
+
+/* 字符串常量的特征类别，类别相同的常量可以互相替换，例如不同的回连地址 */
+typedef struct {
+	const char *pattern; // 常量中包括的子串
+	char category;       // 类别在字节流中的表示
+} DETECT_FINGERPRINT_CONST_CATEGORY_T;
+
+static const DETECT_FINGERPRINT_CONST_CATEGORY_T g_fingerprint_const_categories[] = {
+	{"/dev/tcp/",   't'},
+	{"/dev/udp/",   't'},
+	{"/bin/sh",     's'},
+	{"/bin/bash",   's'},
+	{"sh -i",       's'},
+	{"cmd.exe",     's'},
+	{"powershell",  's'},
+	{"://",         'u'},
+	{"curl ",       'd'},
+	{"wget ",       'd'},
+	{"chmod ",      'x'},
+	{"base64",      'b'},
+	{"crontab",     'p'},
+	{".ssh",        'p'},
+	{"/etc/passwd", 'p'},
+	{"/etc/shadow", 'p'},
+};
+
+/* 指纹计算的上下文 */
+typedef struct {
+	PyObject *stream;        // 规范化的字节流，bytearray对象
+	PyObject *imports;       // 导入的模块名和导入的名字集合，最后排序后加入字节流
+	PyObject *builtins;      // 内置名字的字典，内置名字不属于可以随意重命名的变量
+	Py_ssize_t instructions; // 所有code对象的指令数量
+} DETECT_FINGERPRINT_CTX_T;
+
+/**
+ * @description: 向字节流追加一个opcode
+ * @param ctx 指纹上下文
+ * @param opcode
+ * @return bool
+ */
+static bool detect_analysis_fingerprint_append_opcode(DETECT_FINGERPRINT_CTX_T *ctx, int opcode) {
+	char byte = (char)opcode;
+	Py_ssize_t size = PyByteArray_GET_SIZE(ctx->stream);
+
+	if (PyByteArray_Resize(ctx->stream, size + 1) < 0) {
+		return false;
+	}
+	PyByteArray_AS_STRING(ctx->stream)[size] = byte;
+
+	return true;
+}
+
+/**
+ * @description: 向字节流追加一个名字
+ * @param ctx 指纹上下文
+ * @param name 名字对象
+ * @return bool
+ */
+static bool detect_analysis_fingerprint_append_name(DETECT_FINGERPRINT_CTX_T *ctx, PyObject *name) {
+	const char *utf8;
+	Py_ssize_t len, size;
+
+	utf8 = PyUnicode_AsUTF8AndSize(name, &len);
+	if (utf8 == NULL) {
+		return false;
+	}
+
+	size = PyByteArray_GET_SIZE(ctx->stream);
+	if (PyByteArray_Resize(ctx->stream, size + len + 2) < 0) {
+		return false;
+	}
+
+	PyByteArray_AS_STRING(ctx->stream)[size] = FINGERPRINT_NAME_BEGIN;
+	memcpy(PyByteArray_AS_STRING(ctx->stream) + size + 1, utf8, len);
+	PyByteArray_AS_STRING(ctx->stream)[size + len + 1] = FINGERPRINT_NAME_END;
+
+	return true;
+}
+
+/**
+ * @description: 判断字符串中是否包括IPv4地址，例如回连地址，回环地址不算
+ * @param str 字符串
+ * @param len 字符串长度
+ * @return bool
+ */
+static bool detect_analysis_fingerprint_has_ipv4(const char *str, Py_ssize_t len) {
+	Py_ssize_t index;
+	int parts, digits;
+
+	for (index = 0; index < len; index++) {
+		if (!Py_ISDIGIT(str[index]) || (index > 0 && (Py_ISDIGIT(str[index - 1]) || str[index - 1] == '.'))) {
+			continue;
+		}
+		if (len - index >= 4 && strncmp(str + index, "127.", 4) == 0) {
+			continue;
+		}
+
+		/* 从数字开头匹配四段以'.'分隔的数字 */
+		parts = 0;
+		digits = 0;
+		for (Py_ssize_t cur = index; cur < len; cur++) {
+			if (Py_ISDIGIT(str[cur]) && digits < 3) {
+				digits++;
+			} else if (str[cur] == '.' && digits > 0 && parts < 3) {
+				parts++;
+				digits = 0;
+			} else {
+				break;
+			}
+		}
+		if (parts == 3 && digits > 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @description: 获取常量类型在字节流中的表示
+ * @param constant 常量对象
+ * @return char
+ */
+static char detect_analysis_fingerprint_const_kind(PyObject *constant) {
+	if (PyUnicode_Check(constant)) {
+		return 'S';
+	} else if (PyBytes_Check(constant)) {
+		return 'B';
+	} else if (PyTuple_Check(constant)) {
+		return 'T';
+	} else if (PyFrozenSet_Check(constant)) {
+		return 'F';
+	} else if (PyBool_Check(constant)) {
+		return 'Z';
+	} else if (PyLong_Check(constant)) {
+		return 'I';
+	} else if (PyFloat_Check(constant)) {
+		return 'R';
+	} else if (PyComplex_Check(constant)) {
+		return 'J';
+	} else if (PyCode_Check(constant)) {
+		return 'C';
+	} else if (constant == Py_None) {
+		return 'N';
+	} else if (constant == Py_Ellipsis) {
+		return 'E';
+	}
+
+	return '?';
+}
+
+/**
+ * @description: 获取长度的量级，即长度的二进制位数。回连地址等同类常量替换后长度通常在同一量级内
+ * @param len 长度
+ * @return char
+ */
+static char detect_analysis_fingerprint_len_class(Py_ssize_t len) {
+	char bits = 0;
+
+	while (len > 0) {
+		bits++;
+		len >>= 1;
+	}
+
+	return bits;
+}
+
+/**
+ * @description: 向字节流追加常量的类型、长度量级和字符串常量的特征类别，常量的具体值不进入字节流。
+ *               元组和frozenset记录元素数量的量级后递归追加每个元素
+ * @param ctx 指纹上下文
+ * @param constant 常量对象
+ * @return bool
+ */
+static bool detect_analysis_fingerprint_append_const(DETECT_FINGERPRINT_CTX_T *ctx, PyObject *constant) {
+	char header[sizeof(g_fingerprint_const_categories) / sizeof(g_fingerprint_const_categories[0]) + 4];
+	const char *str = NULL;
+	Py_ssize_t len = 0, size, count = 0, index;
+	size_t category;
+	bool is_container;
+
+	if (PyUnicode_Check(constant)) {
+		str = PyUnicode_AsUTF8AndSize(constant, &len);
+		if (str == NULL) {
+			return false;
+		}
+	} else if (PyBytes_Check(constant)) {
+		str = PyBytes_AS_STRING(constant);
+		len = PyBytes_GET_SIZE(constant);
+	}
+	is_container = PyTuple_Check(constant) || PyFrozenSet_Check(constant);
+
+	header[count++] = FINGERPRINT_CONST_BEGIN;
+	header[count++] = detect_analysis_fingerprint_const_kind(constant);
+	if (str != NULL) {
+		header[count++] = detect_analysis_fingerprint_len_class(len);
+
+		/* 常量中可能有'\0'，按长度查找特征，同一类别只记录一次 */
+		for (category = 0; category < sizeof(g_fingerprint_const_categories) / sizeof(g_fingerprint_const_categories[0]); category++) {
+			if (memchr(header + 3, g_fingerprint_const_categories[category].category, count - 3) == NULL &&
+				memmem(str, len, g_fingerprint_const_categories[category].pattern,
+					   strlen(g_fingerprint_const_categories[category].pattern)) != NULL) {
+				header[count++] = g_fingerprint_const_categories[category].category;
+			}
+		}
+		if (detect_analysis_fingerprint_has_ipv4(str, len)) {
+			header[count++] = 'i';
+		}
+	} else if (is_container) {
+		header[count++] = detect_analysis_fingerprint_len_class(PyObject_Size(constant));
+	}
+
+	size = PyByteArray_GET_SIZE(ctx->stream);
+	if (PyByteArray_Resize(ctx->stream, size + count) < 0) {
+		return false;
+	}
+	for (index = 0; index < count; index++) {
+		PyByteArray_AS_STRING(ctx->stream)[size + index] = header[index];
+	}
+
+	/* 常量列表，例如subprocess的命令行参数 */
+	if (is_container) {
+		PyObject *iter = PyObject_GetIter(constant), *item;
+		bool ret = iter != NULL;
+
+		while (ret && (item = PyIter_Next(iter)) != NULL) {
+			ret = detect_analysis_fingerprint_append_const(ctx, item);
+			Py_DECREF(item);
+		}
+		Py_XDECREF(iter);
+		if (!ret || PyErr_Occurred()) {
+			return false;
+		}
+	}
+
+	return detect_analysis_fingerprint_append_opcode(ctx, FINGERPRINT_CONST_END);
+}
+
+/**
+ * @description: 判断是否为导入语句中保存导入结果的opcode
+ * @param opcode
+ * @return bool
+ */
+static bool detect_analysis_fingerprint_is_import_store(int opcode) {
+	return opcode == STORE_NAME || opcode == STORE_GLOBAL || opcode == STORE_FAST ||
+		   opcode == STORE_DEREF || opcode == POP_TOP || opcode == IMPORT_FROM || opcode == IMPORT_STAR;
+}
+
+static bool detect_analysis_fingerprint_code(DETECT_FINGERPRINT_CTX_T *ctx, PyCodeObject *code);
+
+/**
+ * @description: 规范化常量表，常量的特征类别已在LOAD_CONST处追加，这里只递归处理嵌套的code对象
+ * @param ctx 指纹上下文
+ * @param constant 常量对象
+ * @return bool
+ */
+static bool detect_analysis_fingerprint_const(DETECT_FINGERPRINT_CTX_T *ctx, PyObject *constant) {
+	if (PyCode_Check(constant)) {
+		return detect_analysis_fingerprint_code(ctx, (PyCodeObject *)constant);
+	}
+
+	return true;
+}
+
+/**
+ * @description: 规范化code对象
+ * @param ctx 指纹上下文
+ * @param code code对象
+ * @return bool
+ */
+static bool detect_analysis_fingerprint_code(DETECT_FINGERPRINT_CTX_T *ctx, PyCodeObject *code) {
+	const _Py_CODEUNIT *instrs = (const _Py_CODEUNIT *)PyBytes_AS_STRING(code->co_code);
+	Py_ssize_t count = PyBytes_GET_SIZE(code->co_code) / sizeof(_Py_CODEUNIT);
+	Py_ssize_t index, stream_size;
+	PyObject *name;
+	int opcode, oparg, ext_arg = 0;
+	bool in_import = false;
+
+	if (!detect_analysis_fingerprint_append_opcode(ctx, FINGERPRINT_CODE_BEGIN)) {
+		return false;
+	}
+
+	for (index = 0; index < count; index++) {
+		opcode  = _Py_OPCODE(instrs[index]);
+		oparg   = _Py_OPARG(instrs[index]) | ext_arg;
+		ext_arg = opcode == EXTENDED_ARG ? oparg << 8 : 0;
+		if (opcode == EXTENDED_ARG) {
+			continue;
+		}
+
+		/* 导入语句：模块名加入导入集合，导入语句本身不进入字节流，使指纹不受导入顺序影响 */
+		if (opcode == IMPORT_NAME || opcode == IMPORT_FROM) {
+			if (oparg < PyTuple_GET_SIZE(code->co_names) &&
+				PySet_Add(ctx->imports, PyTuple_GET_ITEM(code->co_names, oparg)) < 0) {
+				return false;
+			}
+
+			/* 去掉IMPORT_NAME之前压入level和fromlist的两个LOAD_CONST */
+			if (opcode == IMPORT_NAME) {
+				stream_size = PyByteArray_GET_SIZE(ctx->stream);
+				if (stream_size >= 2 &&
+					PyByteArray_AS_STRING(ctx->stream)[stream_size - 1] == (char)LOAD_CONST &&
+					PyByteArray_AS_STRING(ctx->stream)[stream_size - 2] == (char)LOAD_CONST &&
+					PyByteArray_Resize(ctx->stream, stream_size - 2) < 0) {
+					return false;
+				}
+			}
+
+			in_import = true;
+			continue;
+		}
+
+		/* 导入结果的保存同样不进入字节流 */
+		if (in_import && detect_analysis_fingerprint_is_import_store(opcode)) {
+			continue;
+		}
+		in_import = false;
+
+		if (!detect_analysis_fingerprint_append_opcode(ctx, opcode)) {
+			return false;
+		}
+		ctx->instructions++;
+
+		switch (opcode) {
+		case LOAD_CONST:
+			/* 常量值忽略，只保留类型、长度量级和特征类别。导入语句的fromlist是名字，随导入语句一起去掉；
+			   MAKE_FUNCTION之前的函数限定名和之后传给__build_class__的类名与变量名一样可以随意重命名，同样去掉 */
+			if (oparg < PyTuple_GET_SIZE(code->co_consts) &&
+				(index + 1 >= count || (_Py_OPCODE(instrs[index + 1]) != IMPORT_NAME &&
+										_Py_OPCODE(instrs[index + 1]) != MAKE_FUNCTION)) &&
+				(index == 0 || _Py_OPCODE(instrs[index - 1]) != MAKE_FUNCTION) &&
+				!detect_analysis_fingerprint_append_const(ctx, PyTuple_GET_ITEM(code->co_consts, oparg))) {
+				return false;
+			}
+			break;
+		case LOAD_ATTR:
+		case LOAD_METHOD:
+		case STORE_ATTR:
+		case DELETE_ATTR:
+			/* 属性名决定了调用的对象，保留 */
+			if (oparg < PyTuple_GET_SIZE(code->co_names) &&
+				!detect_analysis_fingerprint_append_name(ctx, PyTuple_GET_ITEM(code->co_names, oparg))) {
+				return false;
+			}
+			break;
+		case LOAD_NAME:
+		case LOAD_GLOBAL:
+			/* 只保留内置名字，其他全局变量名可以随意重命名 */
+			if (oparg < PyTuple_GET_SIZE(code->co_names)) {
+				name = PyTuple_GET_ITEM(code->co_names, oparg);
+				if (PyDict_GetItemWithError(ctx->builtins, name) != NULL &&
+					!detect_analysis_fingerprint_append_name(ctx, name)) {
+					return false;
+				}
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	/* 嵌套的函数和类的code对象 */
+	for (index = 0; index < PyTuple_GET_SIZE(code->co_consts); index++) {
+		if (!detect_analysis_fingerprint_const(ctx, PyTuple_GET_ITEM(code->co_consts, index))) {
+			return false;
+		}
+	}
+
+	return detect_analysis_fingerprint_append_opcode(ctx, FINGERPRINT_CODE_END);
+}
+
+/**
+ * @description: 计算脚本的字节码指纹
+ * @param code 脚本编译后的code对象
+ * @return PyObject* 规范化的字节流，bytes对象；失败或者指令过少时返回NULL且不设置异常
+ */
+PyObject* detect_analysis_fingerprint(PyObject *code) {
+	DETECT_FINGERPRINT_CTX_T ctx = {0};
+	PyObject *sorted_imports = NULL, *fingerprint = NULL;
+	Py_ssize_t index;
+	bool is_ok;
+
+	ctx.stream   = PyByteArray_FromStringAndSize(NULL, 0);
+	ctx.imports  = PySet_New(NULL);
+	ctx.builtins = PyEval_GetBuiltins();
+	is_ok = ctx.stream != NULL && ctx.imports != NULL && ctx.builtins != NULL &&
+			detect_analysis_fingerprint_code(&ctx, (PyCodeObject *)code) &&
+			ctx.instructions >= FINGERPRINT_MIN_INSTRUCTIONS;
+
+	/* 导入集合排序后追加到字节流 */
+	if (is_ok) {
+		sorted_imports = PySequence_List(ctx.imports);
+		is_ok = sorted_imports != NULL && PyList_Sort(sorted_imports) == 0;
+	}
+	for (index = 0; is_ok && index < PyList_GET_SIZE(sorted_imports); index++) {
+		is_ok = detect_analysis_fingerprint_append_name(&ctx, PyList_GET_ITEM(sorted_imports, index));
+	}
+
+	if (is_ok) {
+		fingerprint = PyBytes_FromStringAndSize(PyByteArray_AS_STRING(ctx.stream), PyByteArray_GET_SIZE(ctx.stream));
+	}
+
+	Py_XDECREF(sorted_imports);
+	Py_XDECREF(ctx.stream);
+	Py_XDECREF(ctx.imports);
+	PyErr_Clear();
+
+	return fingerprint;
+}
@@ -0,0 +1,8 @@
+#ifndef DETECT_ANALYSIS_FINGERPRINT_H
+#define DETECT_ANALYSIS_FINGERPRINT_H
+
+#include "Python.h"
+
+extern PyObject* detect_analysis_fingerprint(PyObject *code);
+
+#endif
@@ -70,7 +70,7 @@ static void detect_analysis_object_print(PyObject *op, FILE *fp, int flags) {
   * @return PyObject*
   */
 PyObject* detect_analysis_func_debug_proc() {
-	DETECT_RECORD_INFO_T *detect_record_info;
+	const DETECT_RECORD_INFO_T *detect_record_info;
 	PyObject *param_list;
 	DETECT_OBJECT_TYPE hook_obj_type;
 	DETECT_CONFIG_OBJ_TYPE config_obj_type;
@@ -12,6 +12,7 @@
 #include "Detect/record/record.h"
 #include "Detect/object/object.h"
 #include "Detect/analysis/analysis_common.h"
+#include "Detect/analysis/analysis_evidence.h"
 #include "Detect/utils/list.h"
 
 /**
@@ -19,9 +20,10 @@
   * @return PyObject*
   */
 PyObject* detect_analysis_func_general_proc() {
-	DETECT_RECORD_INFO_T *detect_record_info;
-	PyObject *param_list;
+	const DETECT_RECORD_INFO_T *detect_record_info;
+	PyObject *param_list, *item;
 	DETECT_OBJECT_TYPE hook_obj_type;
+	Py_ssize_t index;
 	PyObject **stack_pointer;
 	int opcode, oparg;
 	bool is_malicious = false;
@@ -35,12 +37,17 @@ PyObject* detect_analysis_func_general_proc() {
 	oparg         = detect_record_info->cur_call_info.oparg;
 	stack_pointer = detect_record_info->cur_call_info.stack_pointer;
 
-	/* 判断当前调用项是否为威胁对象调用 */
+	/* 判断当前调用项是否为威胁对象调用，外部输入的调用作为弱证据记录 */
 	hook_obj_type = detect_record_info->cur_call_info.callable_info.hook_object_type;
+	if (hook_obj_type == DETECT_OBJECT_TYPE_TAINT) {
+		detect_analysis_evidence_set(DETECT_EVIDENCE_TAINT_INPUT);
+	}
 	if (hook_obj_type != DETECT_OBJECT_TYPE_THREAT) {
 		return NULL;
 	}
 
+	detect_analysis_evidence_set(DETECT_EVIDENCE_THREAT_CALL);
+
 	/* 创建参数list，检查参数是否为外部输入，不同的opcode检查策略不同 */
 	param_list = detect_record_create_params_list(stack_pointer, opcode, oparg);
 	switch (opcode) {
@@ -62,16 +69,14 @@ PyObject* detect_analysis_func_general_proc() {
 		}
 		break;
 	case CALL_FUNCTION_EX:
-		/* 检查位置参数元组 */
-		if (detect_analysis_check_tuple_taint(PyList_GetItem(param_list, 1))) {
-			is_malicious = true;
-			break;
-		}
-
-		/* 检查关键字参数字典 */
-		if (PyList_Size(param_list) == 2 && 
-			detect_analysis_check_dict_taint(PyList_GetItem(param_list, 2))) {
-			is_malicious = true;
+		/* 参数list中依次为位置参数元组和关键字参数字典，不是精确元组的位置参数不会加入list */
+		for (index = 0; index < PyList_GET_SIZE(param_list); index++) {
+			item = PyList_GET_ITEM(param_list, index);
+			if ((PyTuple_CheckExact(item) && detect_analysis_check_tuple_taint(item)) ||
+				(PyDict_CheckExact(item) && detect_analysis_check_dict_taint(item))) {
+				is_malicious = true;
+				break;
+			}
 		}
 		break;
 	default:
@@ -29,8 +29,8 @@ DETECT_ANALYSIS_ILLEGAL_OPS_T g_illegal_ops_def[] = {
    * @return PyObject*
    */
 PyObject* detect_analysis_func_illegal_ops_proc() {
-	DETECT_RECORD_INFO_T *detect_record_info;
-	DETECT_RECORD_CALLABLE_INFO_T *callable_info;
+	const DETECT_RECORD_INFO_T *detect_record_info;
+	const DETECT_RECORD_CALLABLE_INFO_T *callable_info;
 	PyObject *callable_name = NULL;
 	int index;
 	bool is_malicious = false;
@@ -71,3 +71,32 @@ PyObject* detect_analysis_func_illegal_ops_proc() {
 	return NULL;
  }
 
+/**
+  * @description: 收集非法操作列表中可调用对象的名字，用于静态预过滤
+  * @param names_set 名字集合
+  * @return void
+  */
+void detect_analysis_func_illegal_ops_collect_names(PyObject *names_set) {
+	PyObject *name;
+	int index;
+
+	for (index = 0; index < sizeof(g_illegal_ops_def)/sizeof(DETECT_ANALYSIS_ILLEGAL_OPS_T); index++) {
+		name = PyUnicode_FromString(g_illegal_ops_def[index].callable_name);
+		PySet_Add(names_set, name);
+		Py_DECREF(name);
+	}
+}
+
+/**
+  * @description: 收集非法操作列表，用于计算规则集的版本
+  * @param rules_list 规则列表
+  * @return void
+  */
+void detect_analysis_func_illegal_ops_collect_rules(PyObject *rules_list) {
+	int index;
+
+	for (index = 0; index < sizeof(g_illegal_ops_def)/sizeof(DETECT_ANALYSIS_ILLEGAL_OPS_T); index++) {
+		detect_config_append_rule(rules_list, "illegal_ops", g_illegal_ops_def[index].module_name, NULL, NULL,
+								  g_illegal_ops_def[index].callable_name, NULL, 0);
+	}
+}
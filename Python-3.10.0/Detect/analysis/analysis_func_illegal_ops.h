@@ -8,6 +8,8 @@ typedef struct {
 } DETECT_ANALYSIS_ILLEGAL_OPS_T;
 
 extern PyObject* detect_analysis_func_illegal_ops_proc();
+extern void detect_analysis_func_illegal_ops_collect_names(PyObject *names_set);
+extern void detect_analysis_func_illegal_ops_collect_rules(PyObject *rules_list);
 
 #endif
 
@@ -15,12 +15,14 @@
 #include "Detect/utils/list.h"
 #include "Detect/utils/re.h"
 #include "Detect/utils/str.h"
+#include "Detect/detect_state.h"
 
 const char *g_malicious_commands_str[] = {
 	"reg add", "reg delete", "pyinstaller"
 };
 
-PyObject *g_malicious_commands_list;
+/* 恶意命令列表保存在解释器级的detect状态中 */
+#define g_malicious_commands_list (detect_state_get_or_default()->malicious_commands_list)
 
 /**
   * @description: 恶意命令执行分析初始化
@@ -33,7 +35,7 @@ void detect_analysis_func_malicious_command_init() {
 		return;
 	}
 
-	g_malicious_commands_list = PyList_New(0);
+	detect_state_get()->malicious_commands_list = PyList_New(0);
 	for (index = 0; index < sizeof(g_malicious_commands_str)/sizeof(const char*); index++) {
 		PyList_Append(g_malicious_commands_list, PyUnicode_FromString(g_malicious_commands_str[index]));
 	}
@@ -83,7 +85,7 @@ static bool malicious_command_check_executed_command_by_list(PyObject *list_obj)
   * @description: 检查当前调用参数是否存在恶意命令
   * @return PyObject*
   */
-static bool malicious_command_check_executed_command(DETECT_RECORD_CALL_INFO_T *call_info) {
+static bool malicious_command_check_executed_command(const DETECT_RECORD_CALL_INFO_T *call_info) {
 	PyObject *const *args; Py_ssize_t nargs; PyObject *kwnames; bool need_free = false;
 	int opcode, oparg;
 	PyObject **statck_pointer;
@@ -95,6 +97,9 @@ static bool malicious_command_check_executed_command(DETECT_RECORD_CALL_INFO_T *
 	statck_pointer = call_info->stack_pointer;
 
 	args = detect_analysis_get_call_original_params(statck_pointer, opcode, oparg, &nargs, &kwnames, &need_free);
+	if (args == NULL) {
+		return false;
+	}
 
 	/* 计算所有参数的数量 */
 	param_count = nargs;
@@ -125,7 +130,7 @@ static bool malicious_command_check_executed_command(DETECT_RECORD_CALL_INFO_T *
   * @return PyObject*
   */
 PyObject* detect_analysis_func_malicious_command_proc() {
-	DETECT_RECORD_INFO_T *detect_record_info;
+	const DETECT_RECORD_INFO_T *detect_record_info;
 	DETECT_OBJECT_TYPE hook_obj_type;
 	DETECT_THREAT_TYPE_E threat_type;
 	bool is_malicious = false;
@@ -157,3 +162,17 @@ PyObject* detect_analysis_func_malicious_command_proc() {
 }
 
 
+
+/**
+  * @description: 收集恶意命令列表，用于计算规则集的版本
+  * @param rules_list 规则列表
+  * @return void
+  */
+void detect_analysis_func_malicious_command_collect_rules(PyObject *rules_list) {
+	int index;
+
+	for (index = 0; index < sizeof(g_malicious_commands_str)/sizeof(const char*); index++) {
+		detect_config_append_rule(rules_list, "malicious_command", NULL, NULL, NULL,
+								  g_malicious_commands_str[index], NULL, 0);
+	}
+}
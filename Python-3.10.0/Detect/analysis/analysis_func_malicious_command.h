@@ -2,6 +2,7 @@
 #define DETECT_ANALYSIS_FUNC_MALICIOUS_COMMAND_H
 
 extern PyObject* detect_analysis_func_malicious_command_proc();
+extern void detect_analysis_func_malicious_command_collect_rules(PyObject *rules_list);
 
 #endif
 
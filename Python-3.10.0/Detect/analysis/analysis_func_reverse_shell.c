@@ -15,22 +15,19 @@
 #include "Detect/utils/list.h"
 #include "Detect/utils/re.h"
 #include "Detect/utils/str.h"
+#include "Detect/analysis/analysis_sequence.h"
+#include "Detect/analysis/analysis_func_reverse_shell.h"
 
-static bool g_dup_0           = false; // 是否复制了描述符0 
-static bool g_dup_1           = false; // 是否复制了描述符1
-static int  g_dup_taint_count = 0;     // fd2为外部输入时复制的次数
-
-static bool g_command_contain_sh = false; // 执行的命令是否包含sh
-static bool g_command_malicious  = false; // 命令本身是否就是恶意的
 	
 /**
   * @description: 检查os.dup2的参数是否符合反弹的特征
-  * @return bool
+  * @return DETECT_SEQ_SYMBOL_E
   */
-static void reverse_shell_check_os_dup2_params(DETECT_RECORD_CALL_INFO_T *call_info) {
-	PyObject *const *args; Py_ssize_t nargs; PyObject *kwnames; bool need_free = false;
+static DETECT_SEQ_SYMBOL_E reverse_shell_check_os_dup2_params(const DETECT_RECORD_CALL_INFO_T *call_info) {
+	PyObject *const *original_args, *const *args; Py_ssize_t nargs; PyObject *kwnames; bool need_free = false;
 	int opcode, oparg;
 	PyObject **statck_pointer;
+	DETECT_SEQ_SYMBOL_E symbol = DETECT_SEQ_SYMBOL_NONE;
 
 	/* os.dup2参数校验相关参数 */
 	static const char * const _keywords[] = {"fd", "fd2", "inheritable", NULL};
@@ -42,73 +39,79 @@ static void reverse_shell_check_os_dup2_params(DETECT_RECORD_CALL_INFO_T *call_i
 	oparg          = call_info->oparg;
 	statck_pointer = call_info->stack_pointer;
 
-	args = detect_analysis_get_call_original_params(statck_pointer, opcode, oparg, &nargs, &kwnames, &need_free);
-	if (args == NULL) {
-		return;
+	original_args = detect_analysis_get_call_original_params(statck_pointer, opcode, oparg, &nargs, &kwnames, &need_free);
+	if (original_args == NULL) {
+		return DETECT_SEQ_SYMBOL_NONE;
 	}
 
-    args = _PyArg_UnpackKeywords(args, nargs, NULL, kwnames, &_parser, 2, 3, 0, argsbuf);
+    args = _PyArg_UnpackKeywords(original_args, nargs, NULL, kwnames, &_parser, 2, 3, 0, argsbuf);
     if (args == NULL) {
-		return;
+		PyErr_Clear();
+		goto end;
 	}
 
 	/* fd不是外部输入 */
 	if (!detect_object_object_is_taint(args[0])) {
-		return;
+		goto end;
 	}
 
 	/* fd2不是外部输入*/
 	if (!detect_object_object_is_taint(args[1])) {
 		/* fd2不是整数 */
 		if (!PyLong_Check(args[1])) {
-			return;
+			goto end;
 		}
 
 		/* fd2 */
 		fd2 = _PyLong_AsInt(args[1]);
 		if (fd2 == 0) {
-			g_dup_0 = true;
+			symbol = DETECT_SEQ_SYMBOL_DUP_TAINT_0;
 		} else if (fd2 == 1) {
-			g_dup_1 = true;
+			symbol = DETECT_SEQ_SYMBOL_DUP_TAINT_1;
 		}
 	} else {
-		g_dup_taint_count++;
+		symbol = DETECT_SEQ_SYMBOL_DUP_TAINT_TAINT;
 	}
-	
+
+end:
 	if (need_free) {
-		detect_analysis_free_args_and_kwnames(args, nargs, kwnames);
+		detect_analysis_free_args_and_kwnames(original_args, nargs, kwnames);
 	}
 
-	return;
+	return symbol;
 }
 
 /**
   * @description: 检查unicode对象中所包含的参数是否符合反弹命令的特点
-  * @return PyObject*
+  * @return DETECT_SEQ_SYMBOL_E
   */
-static void reverse_shell_check_executed_command_by_unicode(PyObject *unicode_obj) {
+static DETECT_SEQ_SYMBOL_E reverse_shell_check_executed_command_by_unicode(PyObject *unicode_obj) {
 	PyObject *searches;
 
-	/* 匹配sh */
-	searches = detect_analysis_re_search("sh", unicode_obj, 0);
+	/* 匹配sh -i   /dev/tcp/xxx */
+	searches = detect_analysis_re_search("sh.*/dev/tcp/.*", unicode_obj, 0);
 	if (searches && searches != Py_None) {
-		g_command_contain_sh = true;
 		Py_DECREF(searches);
+		return DETECT_SEQ_SYMBOL_EXEC_SH_DEVTCP;
 	}
+	Py_XDECREF(searches);
 
-	/* 匹配sh -i   /dev/tcp/xxx */
-	searches = detect_analysis_re_search("sh.*/dev/tcp/.*", unicode_obj, 0);
+	/* 匹配sh */
+	searches = detect_analysis_re_search("sh", unicode_obj, 0);
 	if (searches && searches != Py_None) {
-		g_command_malicious = true;
 		Py_DECREF(searches);
+		return DETECT_SEQ_SYMBOL_EXEC_SH;
 	}
+	Py_XDECREF(searches);
+
+	return DETECT_SEQ_SYMBOL_NONE;
 }
 
 /**
   * @description: 检查list中所包含的参数是否符合反弹命令的特点
-  * @return PyObject*
+  * @return DETECT_SEQ_SYMBOL_E
   */
-static void reverse_shell_check_executed_command_by_list(PyObject *list_obj) {
+static DETECT_SEQ_SYMBOL_E reverse_shell_check_executed_command_by_list(PyObject *list_obj) {
 	int index;
 	PyObject *searches, *item;
 	bool contain_sh = false, contain_devtcp = false;
@@ -132,36 +135,36 @@ static void reverse_shell_check_executed_command_by_list(PyObject *list_obj) {
 		if (searches != NULL) {
 			contain_devtcp = true;
 			Py_DECREF(searches);
-			return;
+			return DETECT_SEQ_SYMBOL_NONE;
 		}
 	}
 
 	if (contain_sh) {
-		g_command_contain_sh = true;
-
-		if (contain_devtcp) {
-			g_command_malicious = true;
-		}
+		return contain_devtcp ? DETECT_SEQ_SYMBOL_EXEC_SH_DEVTCP : DETECT_SEQ_SYMBOL_EXEC_SH;
 	}
 
-	return;
+	return DETECT_SEQ_SYMBOL_NONE;
 }
 
 /**
-  * @description: 检查当前调用是否符合反弹命令的特点
-  * @return PyObject*
+  * @description: 检查当前调用是否符合反弹命令的特点，多个参数中取特征最强的符号
+  * @return DETECT_SEQ_SYMBOL_E
   */
-static void reverse_shell_check_executed_command(DETECT_RECORD_CALL_INFO_T *call_info) {
+static DETECT_SEQ_SYMBOL_E reverse_shell_check_executed_command(const DETECT_RECORD_CALL_INFO_T *call_info) {
 	PyObject *const *args; Py_ssize_t nargs; PyObject *kwnames; bool need_free = false;
 	int opcode, oparg;
 	PyObject **statck_pointer;
 	int param_count, index;
+	DETECT_SEQ_SYMBOL_E symbol = DETECT_SEQ_SYMBOL_NONE, param_symbol;
 
 	opcode         = call_info->opcode;
 	oparg          = call_info->oparg;
 	statck_pointer = call_info->stack_pointer;
 
 	args = detect_analysis_get_call_original_params(statck_pointer, opcode, oparg, &nargs, &kwnames, &need_free);
+	if (args == NULL) {
+		return DETECT_SEQ_SYMBOL_NONE;
+	}
 
 	/* 计算所有参数的数量 */
 	param_count = nargs;
@@ -171,10 +174,16 @@ static void reverse_shell_check_executed_command(DETECT_RECORD_CALL_INFO_T *call
 
 	/* 遍历所有参数进行检查 */
 	for (index = 0; index < param_count; index++) {
+		param_symbol = DETECT_SEQ_SYMBOL_NONE;
 		if (PyUnicode_Check(args[index])) {
-			reverse_shell_check_executed_command_by_unicode(args[index]);
+			param_symbol = reverse_shell_check_executed_command_by_unicode(args[index]);
 		} else if (PyList_Check(args[index])) {
-			reverse_shell_check_executed_command_by_list(args[index]);
+			param_symbol = reverse_shell_check_executed_command_by_list(args[index]);
+		}
+
+		if (param_symbol == DETECT_SEQ_SYMBOL_EXEC_SH_DEVTCP || 
+			(param_symbol == DETECT_SEQ_SYMBOL_EXEC_SH && symbol == DETECT_SEQ_SYMBOL_NONE)) {
+			symbol = param_symbol;
 		}
 	}
 
@@ -182,70 +191,36 @@ static void reverse_shell_check_executed_command(DETECT_RECORD_CALL_INFO_T *call
 		detect_analysis_free_args_and_kwnames(args, nargs, kwnames);
 	}
 
-	return;
+	return symbol;
 }
 
 /**
-  * @description: 反弹恶意脚本分析函数，检测策略如下：
-  *               	1、定位命令执行类的可调用对象；
-  *                 2、判断参数是否为bash -i；
-  *                 3、第二步ok则遍历执行流是否有os.dup2(taint_obj, [0,1,2])；
-  *                 4、上述三个条件都符合则可以输出告警；
-  * @return PyObject*
+  * @description: 反弹恶意脚本的调用归类函数，将调用事件归类为序列规则的符号，检测策略如下：
+  *               	1、os.dup2(taint_obj, [0,1,taint_obj])归类为描述符复制符号；
+  *                 2、命令执行类的可调用对象的参数包含sh归类为执行shell符号；
+  *                 3、描述符复制之后执行shell的顺序由序列规则判断；
+  * @param call_info 当前调用信息
+  * @return DETECT_SEQ_SYMBOL_E
   */
-PyObject* detect_analysis_func_reverse_shell_proc() {
-	DETECT_RECORD_INFO_T *detect_record_info;
+DETECT_SEQ_SYMBOL_E detect_analysis_func_reverse_shell_classify(const DETECT_RECORD_CALL_INFO_T *call_info) {
 	DETECT_OBJECT_TYPE hook_obj_type;
 	DETECT_THREAT_TYPE_E threat_type;
-	bool is_malicious = false;
-
-	detect_record_info = detect_record_get_record_info();
-	if (!detect_record_info->cur_call_info.is_avaliable) {
-		return NULL;
-	}
 
 	/* 检查os.dup2的参数是否符合反弹特征 */
-	/* 首先判断是否为os.dup2调用 */
-	if (str_compare_unicode_object_with_string(detect_record_info->cur_call_info.callable_info.module_name, "os") &&
-		str_compare_unicode_object_with_string(detect_record_info->cur_call_info.callable_info.func_name, "dup2")) {
+	if (str_compare_unicode_object_with_string(call_info->callable_info.module_name, "os") &&
+		str_compare_unicode_object_with_string(call_info->callable_info.func_name, "dup2")) {
 
-		reverse_shell_check_os_dup2_params(&detect_record_info->cur_call_info);
-		return NULL;
+		return reverse_shell_check_os_dup2_params(call_info);
 	}
 
 	/* 判断当前调用项是否为威胁且命令执行对象调用 */
-	hook_obj_type = detect_record_info->cur_call_info.callable_info.hook_object_type;
-	threat_type   = detect_record_info->cur_call_info.callable_info.threat_type;
+	hook_obj_type = call_info->callable_info.hook_object_type;
+	threat_type   = call_info->callable_info.threat_type;
 	if (hook_obj_type != DETECT_OBJECT_TYPE_THREAT || 
 		threat_type != DETECT_THREAT_TYPE_COMMAND_EXEC) {
-		return NULL;
+		return DETECT_SEQ_SYMBOL_NONE;
 	}
 
 	/* 检查命令执行函数的参数是否符合反弹特征 */
-	reverse_shell_check_executed_command(&detect_record_info->cur_call_info);
-
-	/* 判断脚本是否为反弹shell */
-	if (g_command_contain_sh) {
-		if (g_dup_taint_count >= 2) {
-			is_malicious = true;
-		} else if (g_dup_taint_count == 1) {
-			if (g_dup_0 || g_dup_1) {
-				is_malicious = true;
-			}
-		} else if (g_dup_taint_count == 0) {
-			if (g_dup_0 && g_dup_1) {
-				is_malicious = true;
-			}
-		}
-	}
-	if (g_command_malicious) {
-		is_malicious = true;
-	}
-
-	if (is_malicious) {
-		return detect_analysis_create_detect_malicious_result_dict("Rverse shell");
-	}
-	
-	return NULL;
+	return reverse_shell_check_executed_command(call_info);
 }
-
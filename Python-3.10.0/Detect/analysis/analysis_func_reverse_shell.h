@@ -1,8 +1,10 @@
 #ifndef DETECT_ANALYSIS_FUNC_REVERSE_SHELL_H
 #define DETECT_ANALYSIS_FUNC_REVERSE_SHELL_H
 
-extern PyObject* detect_analysis_func_reverse_shell_proc();
+#include "Detect/record/record.h"
+#include "Detect/analysis/analysis_sequence.h"
 
-#endif
+extern DETECT_SEQ_SYMBOL_E detect_analysis_func_reverse_shell_classify(const DETECT_RECORD_CALL_INFO_T *call_info);
 
+#endif
 
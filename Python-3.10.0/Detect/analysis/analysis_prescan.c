@@ -0,0 +1,505 @@
+/*
+ * @Description: 静态预过滤。执行前编译主脚本并遍历其中所有的code对象，收集引用的名字、导入的
+ *               模块和字符串常量。如果脚本不可能到达任何威胁调用，则不再执行脚本，直接给出正常结论。
+ *               预过滤之前先静态解码字符串常量，编码过的载荷中含有恶意特征时直接给出恶意结论
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "Python.h"
+#include "pycore_interp.h"
+#include "pycore_pystate.h"
+#include "pycore_fileutils.h"
+#include "opcode.h"
+#include "Detect/configs/config.h"
+#include "Detect/analysis/analysis_common.h"
+#include "Detect/analysis/analysis_func_illegal_ops.h"
+#include "Detect/analysis/analysis_prescan.h"
+#include "Detect/analysis/analysis_cache.h"
+#include "Detect/analysis/analysis_decode.h"
+
+/* 模拟getattr参数求值时允许的最大栈深度 */
+#define PRESCAN_MAX_STACK_DEPTH 64
+
+/* 动态分派相关的名字，出现这些名字时无法静态确定最终调用的对象 */
+static const char *g_prescan_dynamic_names[] = {
+	"__import__", "builtins", "exec", "eval", "compile", "marshal", "importlib", "runpy",
+	"globals", "locals", "vars", "setattr", "__dict__", "__getattribute__",
+	"__builtins__", "__subclasses__", "__globals__", "__code__", "pickle",
+	"ctypes", "attrgetter", "methodcaller", "getmembers",
+};
+
+/* 静态预过滤的上下文 */
+typedef struct {
+	PyObject *threat_names;   // 威胁调用、外部输入、自定义处理和非法操作的名字集合
+	PyObject *dynamic_names;  // 动态分派相关的名字集合
+	PyObject *stdlib_names;   // 标准库模块名集合，即sys.stdlib_module_names
+	PyObject *dot;            // 拆分带'.'名字时使用的分隔符
+} DETECT_PRESCAN_CTX_T;
+
+/**
+ * @description: 检查名字是否可能到达威胁调用，带'.'的名字(如导入的模块名)按每一段检查
+ * @param ctx 预过滤上下文
+ * @param name 名字对象
+ * @return bool true --- 安全，false --- 可能到达威胁调用
+ */
+static bool detect_analysis_prescan_check_name(DETECT_PRESCAN_CTX_T *ctx, PyObject *name) {
+	PyObject *parts, *part;
+	Py_ssize_t index;
+	bool is_safe = true;
+
+	parts = PyUnicode_Split(name, ctx->dot, -1);
+	if (parts == NULL) {
+		PyErr_Clear();
+		return false;
+	}
+
+	for (index = 0; index < PyList_GET_SIZE(parts); index++) {
+		part = PyList_GET_ITEM(parts, index);
+		if (PySet_Contains(ctx->threat_names, part) || PySet_Contains(ctx->dynamic_names, part)) {
+			is_safe = false;
+			break;
+		}
+	}
+
+	Py_DECREF(parts);
+
+	return is_safe;
+}
+
+/**
+ * @description: 检查常量，字符串常量可能作为getattr等调用的属性名，元组和frozenset需要递归检查
+ * @param ctx 预过滤上下文
+ * @param constant 常量对象
+ * @return bool true --- 安全，false --- 可能到达威胁调用
+ */
+static bool detect_analysis_prescan_check_const(DETECT_PRESCAN_CTX_T *ctx, PyObject *constant);
+static bool detect_analysis_prescan_check_code(DETECT_PRESCAN_CTX_T *ctx, PyCodeObject *code);
+
+static bool detect_analysis_prescan_check_const(DETECT_PRESCAN_CTX_T *ctx, PyObject *constant) {
+	PyObject *iter, *item;
+	bool is_safe = true;
+
+	if (PyUnicode_Check(constant)) {
+		return detect_analysis_prescan_check_name(ctx, constant);
+	}
+
+	if (PyCode_Check(constant)) {
+		return detect_analysis_prescan_check_code(ctx, (PyCodeObject *)constant);
+	}
+
+	if (!PyTuple_Check(constant) && !PyFrozenSet_Check(constant)) {
+		return true;
+	}
+
+	iter = PyObject_GetIter(constant);
+	if (iter == NULL) {
+		PyErr_Clear();
+		return false;
+	}
+
+	while (is_safe && (item = PyIter_Next(iter)) != NULL) {
+		is_safe = detect_analysis_prescan_check_const(ctx, item);
+		Py_DECREF(item);
+	}
+
+	Py_DECREF(iter);
+
+	return is_safe;
+}
+
+/**
+ * @description: 检查导入的模块，只允许导入标准库模块，本地模块和第三方模块中的代码无法在此处静态检查
+ * @param ctx 预过滤上下文
+ * @param module_name 模块名
+ * @param level 相对导入的层级
+ * @return bool true --- 安全，false --- 可能到达威胁调用
+ */
+static bool detect_analysis_prescan_check_import(DETECT_PRESCAN_CTX_T *ctx, PyObject *module_name, PyObject *level) {
+	PyObject *top_name;
+	Py_ssize_t dot;
+	int contains;
+
+	/* 相对导入 */
+	if (!PyLong_Check(level) || PyLong_AsLong(level) != 0) {
+		return false;
+	}
+
+	dot = PyUnicode_FindChar(module_name, '.', 0, PyUnicode_GET_LENGTH(module_name), 1);
+	if (dot < 0) {
+		top_name = module_name;
+		Py_INCREF(top_name);
+	} else {
+		top_name = PyUnicode_Substring(module_name, 0, dot);
+		if (top_name == NULL) {
+			PyErr_Clear();
+			return false;
+		}
+	}
+
+	contains = PySet_Contains(ctx->stdlib_names, top_name);
+	Py_DECREF(top_name);
+
+	return contains == 1;
+}
+
+/**
+ * @description: 模拟getattr调用参数的求值过程，判断属性名参数是否为字符串常量。
+ *               无法确定的情况(跳转、栈操作改动了getattr本身等)一律视为动态分派
+ * @param code code对象
+ * @param instrs 指令序列
+ * @param count 指令数量
+ * @param start 加载getattr的指令位置
+ * @return bool true --- 属性名为字符串常量
+ */
+static bool detect_analysis_prescan_is_const_getattr(PyCodeObject *code, const _Py_CODEUNIT *instrs,
+													 Py_ssize_t count, Py_ssize_t start) {
+	bool slot_is_const[PRESCAN_MAX_STACK_DEPTH] = {false};
+	int depth = 1; // 栈中只有getattr本身
+	int oparg = 0;
+	Py_ssize_t index;
+
+	for (index = start + 1; index < count; index++) {
+		int opcode = _Py_OPCODE(instrs[index]);
+		int effect, pops, slot;
+
+		oparg |= _Py_OPARG(instrs[index]);
+		if (opcode == EXTENDED_ARG) {
+			oparg <<= 8;
+			continue;
+		}
+
+		switch (opcode) {
+		/* 找到getattr的调用 */
+		case CALL_FUNCTION:
+			if (oparg + 1 == depth) {
+				return oparg >= 2 && slot_is_const[2];
+			}
+			pops = oparg + 1;
+			break;
+		case LOAD_CONST:
+		case LOAD_NAME:
+		case LOAD_GLOBAL:
+		case LOAD_FAST:
+		case LOAD_DEREF:
+		case LOAD_CLASSDEREF:
+		case LOAD_CLOSURE:
+			pops = 0;
+			break;
+		case ROT_TWO:
+		case DUP_TOP_TWO:
+			pops = 2;
+			break;
+		case ROT_THREE:
+			pops = 3;
+			break;
+		case ROT_FOUR:
+			pops = 4;
+			break;
+		case ROT_N:
+			pops = oparg;
+			break;
+		case CALL_METHOD:
+		case CALL_FUNCTION_KW:
+			pops = oparg + 2;
+			break;
+		default:
+			/* 带跳转的指令无法线性模拟 */
+			if (opcode >= HAVE_ARGUMENT && (opcode == JUMP_FORWARD || opcode == JUMP_ABSOLUTE ||
+				opcode == POP_JUMP_IF_FALSE || opcode == POP_JUMP_IF_TRUE ||
+				opcode == JUMP_IF_FALSE_OR_POP || opcode == JUMP_IF_TRUE_OR_POP ||
+				opcode == JUMP_IF_NOT_EXC_MATCH || opcode == FOR_ITER ||
+				opcode == SETUP_FINALLY || opcode == SETUP_WITH || opcode == SETUP_ASYNC_WITH)) {
+				return false;
+			}
+			effect = PyCompile_OpcodeStackEffect(opcode, opcode >= HAVE_ARGUMENT ? oparg : 0);
+			if (effect == PY_INVALID_STACK_EFFECT) {
+				return false;
+			}
+			/* 近似认为指令只压入一个结果 */
+			pops = effect <= 0 ? 1 - effect : 1;
+			break;
+		}
+
+		effect = PyCompile_OpcodeStackEffect(opcode, opcode >= HAVE_ARGUMENT ? oparg : 0);
+
+		/* 指令改动了getattr本身 */
+		if (pops >= depth || effect == PY_INVALID_STACK_EFFECT ||
+			depth + effect >= PRESCAN_MAX_STACK_DEPTH) {
+			return false;
+		}
+
+		/* 被改动或新压入的栈槽都视为非常量 */
+		for (slot = depth - pops; slot < depth + effect; slot++) {
+			slot_is_const[slot] = false;
+		}
+		depth += effect;
+
+		/* 常量下标同样需要合并EXTENDED_ARG前缀 */
+		if (opcode == LOAD_CONST) {
+			slot_is_const[depth - 1] = PyUnicode_Check(PyTuple_GET_ITEM(code->co_consts, oparg));
+		}
+		oparg = 0;
+	}
+
+	return false;
+}
+
+/**
+ * @description: 检查code对象，包括名字、常量(递归检查嵌套的code对象)以及导入和getattr指令
+ * @param ctx 预过滤上下文
+ * @param code code对象
+ * @return bool true --- 安全，false --- 可能到达威胁调用
+ */
+static bool detect_analysis_prescan_check_code(DETECT_PRESCAN_CTX_T *ctx, PyCodeObject *code) {
+	const _Py_CODEUNIT *instrs;
+	Py_ssize_t index, count;
+	int oparg = 0;
+	int prev_opcode[2] = {0, 0}, prev_oparg[2] = {0, 0}; // 前两条指令，参数已合并EXTENDED_ARG前缀
+	PyObject *name;
+
+	/* 名字，包括全局变量名、属性名和导入的模块名 */
+	for (index = 0; index < PyTuple_GET_SIZE(code->co_names); index++) {
+		if (!detect_analysis_prescan_check_name(ctx, PyTuple_GET_ITEM(code->co_names, index))) {
+			return false;
+		}
+	}
+
+	/* 常量 */
+	for (index = 0; index < PyTuple_GET_SIZE(code->co_consts); index++) {
+		if (!detect_analysis_prescan_check_const(ctx, PyTuple_GET_ITEM(code->co_consts, index))) {
+			return false;
+		}
+	}
+
+	/* 指令 */
+	instrs = (const _Py_CODEUNIT *)PyBytes_AS_STRING(code->co_code);
+	count  = PyBytes_GET_SIZE(code->co_code) / sizeof(_Py_CODEUNIT);
+	for (index = 0; index < count; index++) {
+		int opcode = _Py_OPCODE(instrs[index]);
+
+		oparg |= _Py_OPARG(instrs[index]);
+		if (opcode == EXTENDED_ARG) {
+			oparg <<= 8;
+			continue;
+		}
+
+		switch (opcode) {
+		case IMPORT_NAME:
+			/* 导入指令固定为LOAD_CONST level, LOAD_CONST fromlist, IMPORT_NAME，常量较多时各条指令
+			   前面还有EXTENDED_ARG前缀，所以level取自前两条完整指令中的第一条 */
+			if (prev_opcode[0] != LOAD_CONST ||
+				!detect_analysis_prescan_check_import(ctx, PyTuple_GET_ITEM(code->co_names, oparg),
+					PyTuple_GET_ITEM(code->co_consts, prev_oparg[0]))) {
+				return false;
+			}
+			break;
+		case LOAD_NAME:
+		case LOAD_GLOBAL:
+			name = PyTuple_GET_ITEM(code->co_names, oparg);
+			if (_PyUnicode_EqualToASCIIString(name, "getattr") &&
+				!detect_analysis_prescan_is_const_getattr(code, instrs, count, index)) {
+				return false;
+			}
+			break;
+		/* 以其他方式引用getattr时无法确定调用的是内置函数，例如from builtins import getattr as g、
+		   x.getattr、getattr = ...，一律视为动态分派 */
+		case STORE_NAME:
+		case DELETE_NAME:
+		case STORE_GLOBAL:
+		case DELETE_GLOBAL:
+		case LOAD_ATTR:
+		case STORE_ATTR:
+		case DELETE_ATTR:
+		case LOAD_METHOD:
+		case IMPORT_FROM:
+			if (_PyUnicode_EqualToASCIIString(PyTuple_GET_ITEM(code->co_names, oparg), "getattr")) {
+				return false;
+			}
+			break;
+		default:
+			break;
+		}
+
+		prev_opcode[0] = prev_opcode[1];
+		prev_oparg[0]  = prev_oparg[1];
+		prev_opcode[1] = opcode;
+		prev_oparg[1]  = oparg;
+		oparg = 0;
+	}
+
+	return true;
+}
+
+/**
+ * @description: 编译内存中的脚本源码，只编译不执行
+ * @param filename 脚本路径，作为code对象的co_filename
+ * @param source 以'\0'结尾的脚本源码
+ * @return PyObject* code对象，失败时返回NULL且不设置异常
+ */
+PyObject* detect_analysis_prescan_compile_source(const wchar_t *filename, const char *source) {
+	PyObject *filename_obj, *code = NULL;
+	PyCompilerFlags cf = _PyCompilerFlags_INIT;
+
+	filename_obj = PyUnicode_FromWideChar(filename, -1);
+	if (filename_obj != NULL) {
+		code = Py_CompileStringObject(source, filename_obj, Py_file_input, &cf, -1);
+		Py_DECREF(filename_obj);
+	}
+	PyErr_Clear();
+
+	return code;
+}
+
+/**
+ * @description: 读取并编译脚本，只编译不执行
+ * @param filename 脚本路径
+ * @return PyObject* code对象，失败时返回NULL且不设置异常
+ */
+PyObject* detect_analysis_prescan_compile(const wchar_t *filename) {
+	FILE *fp;
+	long size;
+	char *source;
+	PyObject *code = NULL;
+
+	fp = _Py_wfopen(filename, L"rb");
+	if (fp == NULL) {
+		return NULL;
+	}
+
+	if (fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET) != 0) {
+		fclose(fp);
+		return NULL;
+	}
+
+	source = PyMem_RawMalloc(size + 1);
+	if (source == NULL) {
+		fclose(fp);
+		return NULL;
+	}
+
+	if (fread(source, 1, size, fp) == (size_t)size) {
+		source[size] = '\0';
+		code = detect_analysis_prescan_compile_source(filename, source);
+	}
+
+	PyMem_RawFree(source);
+	fclose(fp);
+
+	return code;
+}
+
+/**
+ * @description: 初始化预过滤上下文
+ * @param ctx 预过滤上下文
+ * @return bool
+ */
+static bool detect_analysis_prescan_ctx_init(DETECT_PRESCAN_CTX_T *ctx) {
+	PyObject *name;
+	unsigned int index;
+
+	ctx->stdlib_names  = PySys_GetObject("stdlib_module_names");
+	ctx->threat_names  = PySet_New(NULL);
+	ctx->dynamic_names = PySet_New(NULL);
+	ctx->dot           = _PyUnicode_FromASCII(".", 1);
+	if (ctx->stdlib_names == NULL || ctx->threat_names == NULL || ctx->dynamic_names == NULL ||
+		ctx->dot == NULL) {
+		return false;
+	}
+
+	detect_config_threat_def_collect_names(ctx->threat_names);
+	detect_config_taint_input_def_collect_names(ctx->threat_names);
+	detect_config_custom_def_collect_names(ctx->threat_names);
+	detect_analysis_func_illegal_ops_collect_names(ctx->threat_names);
+
+	for (index = 0; index < sizeof(g_prescan_dynamic_names)/sizeof(const char*); index++) {
+		name = PyUnicode_FromString(g_prescan_dynamic_names[index]);
+		PySet_Add(ctx->dynamic_names, name);
+		Py_DECREF(name);
+	}
+
+	return true;
+}
+
+/**
+ * @description: 对已编译的脚本进行静态预过滤
+ * @param code 脚本的code对象
+ * @return PyObject* 解码出恶意载荷时返回恶意的检测结果字典，不可能到达威胁调用时返回正常的检测结果字典，
+ *                   否则返回NULL，需要动态执行检测
+ */
+PyObject* detect_analysis_prescan_code(PyObject *code) {
+	DETECT_PRESCAN_CTX_T ctx = {0};
+	PyObject *result_dict;
+
+	if (!detect_config_get_runtime_is_enable()) {
+		return NULL;
+	}
+
+	/* 静态解码字符串常量 */
+	result_dict = detect_analysis_decode_code(code);
+	if (result_dict != NULL || !detect_config_get_runtime_is_prefilter()) {
+		return result_dict;
+	}
+
+	if (detect_analysis_prescan_ctx_init(&ctx) &&
+		detect_analysis_prescan_check_code(&ctx, (PyCodeObject *)code)) {
+		result_dict = detect_analysis_create_detect_ok_result_dict("Static pre-filter");
+	}
+
+	Py_XDECREF(ctx.threat_names);
+	Py_XDECREF(ctx.dynamic_names);
+	Py_XDECREF(ctx.dot);
+	PyErr_Clear();
+
+	return result_dict;
+}
+
+/**
+ * @description: 对脚本进行静态预过滤
+ * @param filename 脚本路径
+ * @return PyObject* 已给出结论时返回检测结果字典，否则返回NULL，需要动态执行检测
+ */
+PyObject* detect_analysis_prescan(const wchar_t *filename) {
+	PyObject *code;
+	PyObject *result_dict;
+
+	if (!detect_config_get_runtime_is_enable() ||
+		(!detect_config_get_runtime_is_prefilter() && !detect_config_get_runtime_is_static_decode())) {
+		return NULL;
+	}
+
+	code = detect_analysis_prescan_compile(filename);
+	if (code == NULL) {
+		return NULL;
+	}
+
+	result_dict = detect_analysis_prescan_code(code);
+	Py_DECREF(code);
+
+	return result_dict;
+}
+
+/**
+ * @description: 静态预过滤处理函数，给出结论时输出检测结果
+ * @param filename 脚本路径
+ * @return bool true --- 已给出检测结论，无需动态执行
+ */
+bool detect_analysis_prescan_main_proc(const wchar_t *filename) {
+	PyObject *result_dict = detect_analysis_prescan(filename);
+
+	if (result_dict == NULL) {
+		return false;
+	}
+
+	/* 保存检测结论到缓存 */
+	detect_analysis_cache_store(result_dict);
+
+	/* 输出检测结果到标准输出 */
+	PyObject_Print(result_dict, stdout, Py_PRINT_RAW);
+	fprintf(stdout, "\n");
+	fflush(stdout);
+
+	Py_DECREF(result_dict);
+
+	return true;
+}
@@ -0,0 +1,14 @@
+#ifndef DETECT_ANALYSIS_PRESCAN_H
+#define DETECT_ANALYSIS_PRESCAN_H
+
+#include <stdbool.h>
+#include <wchar.h>
+#include "Python.h"
+
+extern PyObject* detect_analysis_prescan_compile_source(const wchar_t *filename, const char *source);
+extern PyObject* detect_analysis_prescan_compile(const wchar_t *filename);
+extern PyObject* detect_analysis_prescan_code(PyObject *code);
+extern PyObject* detect_analysis_prescan(const wchar_t *filename);
+extern bool detect_analysis_prescan_main_proc(const wchar_t *filename);
+
+#endif
@@ -0,0 +1,320 @@
+/*
+ * @Description: 序列规则引擎。多步骤的恶意行为以声明式的序列规则描述，初始化时编译成确定性自动机，
+ *               每个调用事件被归类为符号后只需查一次状态转移表，规则数量不影响单个事件的处理开销
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "Python.h"
+#include "pycore_interp.h"
+#include "pycore_pystate.h"
+#include "Detect/record/record.h"
+#include "Detect/analysis/analysis_common.h"
+#include "Detect/analysis/analysis_evidence.h"
+#include "Detect/analysis/analysis_sequence.h"
+#include "Detect/analysis/analysis_func_reverse_shell.h"
+#include "Detect/detect_state.h"
+
+/* 符号简写，便于书写规则 */
+#define DUP_TAINT_0       DETECT_SEQ_SYMBOL_DUP_TAINT_0
+#define DUP_TAINT_1       DETECT_SEQ_SYMBOL_DUP_TAINT_1
+#define DUP_TAINT_TAINT   DETECT_SEQ_SYMBOL_DUP_TAINT_TAINT
+#define EXEC_SH           DETECT_SEQ_SYMBOL_EXEC_SH
+#define EXEC_SH_DEVTCP    DETECT_SEQ_SYMBOL_EXEC_SH_DEVTCP
+
+/* 序列规则定义 */
+static DETECT_SEQ_RULE_DEF g_sequence_rule_def[] = {
+	/* 反弹shell：外部输入的描述符被复制到标准输入和标准输出后执行shell */
+	{"Reverse shell", {{DUP_TAINT_0, DUP_TAINT_1}, {EXEC_SH}}},
+	{"Reverse shell", {{DUP_TAINT_TAINT, DUP_TAINT_TAINT}, {EXEC_SH}}},
+	{"Reverse shell", {{DUP_TAINT_TAINT, DUP_TAINT_0}, {EXEC_SH}}},
+	{"Reverse shell", {{DUP_TAINT_TAINT, DUP_TAINT_1}, {EXEC_SH}}},
+	/* 反弹shell：命令本身通过/dev/tcp反弹 */
+	{"Reverse shell", {{EXEC_SH_DEVTCP}}},
+};
+
+#define SEQUENCE_RULE_COUNT (sizeof(g_sequence_rule_def)/sizeof(DETECT_SEQ_RULE_DEF))
+
+/* 符号对应的证据项，命中的符号同时写入证据库 */
+static const int g_sequence_symbol_evidence[DETECT_SEQ_SYMBOL_MAX] = {
+	[DETECT_SEQ_SYMBOL_NONE]            = -1,
+	[DETECT_SEQ_SYMBOL_DUP_TAINT_0]     = DETECT_EVIDENCE_DUP_0,
+	[DETECT_SEQ_SYMBOL_DUP_TAINT_1]     = DETECT_EVIDENCE_DUP_1,
+	[DETECT_SEQ_SYMBOL_DUP_TAINT_TAINT] = DETECT_EVIDENCE_DUP_TAINT_COUNT,
+	[DETECT_SEQ_SYMBOL_EXEC_SH]         = DETECT_EVIDENCE_COMMAND_CONTAIN_SH,
+	[DETECT_SEQ_SYMBOL_EXEC_SH_DEVTCP]  = DETECT_EVIDENCE_COMMAND_MALICIOUS,
+};
+
+/* 单条规则的匹配进度，编译时使用 */
+typedef struct {
+	unsigned char step; // 当前所在步骤，等于步骤数时代表规则已命中
+	unsigned char mask; // 当前步骤中已出现的符号槽位
+} DETECT_SEQ_PROGRESS_T;
+
+/**
+ * @description: 获取规则的步骤数
+ * @param rule 规则
+ * @return int
+ */
+static int detect_analysis_sequence_rule_steps(DETECT_SEQ_RULE_DEF *rule) {
+	int step;
+
+	for (step = 0; step < DETECT_SEQ_MAX_STEPS; step++) {
+		if (rule->steps[step][0] == DETECT_SEQ_SYMBOL_NONE) {
+			break;
+		}
+	}
+
+	return step;
+}
+
+/**
+ * @description: 获取规则中某个步骤全部符号槽位的掩码
+ * @param rule 规则
+ * @param step 步骤
+ * @return unsigned char
+ */
+static unsigned char detect_analysis_sequence_step_full_mask(DETECT_SEQ_RULE_DEF *rule, int step) {
+	unsigned char mask = 0;
+	int slot;
+
+	for (slot = 0; slot < DETECT_SEQ_MAX_STEP_SYMBOLS; slot++) {
+		if (rule->steps[step][slot] == DETECT_SEQ_SYMBOL_NONE) {
+			break;
+		}
+		mask |= 1 << slot;
+	}
+
+	return mask;
+}
+
+/**
+ * @description: 计算单条规则在输入符号后的匹配进度，不相关的符号不影响进度
+ * @param rule 规则
+ * @param progress 当前进度
+ * @param symbol 输入符号
+ * @return DETECT_SEQ_PROGRESS_T 新的进度
+ */
+static DETECT_SEQ_PROGRESS_T detect_analysis_sequence_rule_step(DETECT_SEQ_RULE_DEF *rule,
+																DETECT_SEQ_PROGRESS_T progress,
+																DETECT_SEQ_SYMBOL_E symbol) {
+	int slot;
+
+	/* 规则已命中 */
+	if (progress.step >= detect_analysis_sequence_rule_steps(rule)) {
+		return progress;
+	}
+
+	/* 填充当前步骤中第一个未出现的同名符号槽位 */
+	for (slot = 0; slot < DETECT_SEQ_MAX_STEP_SYMBOLS; slot++) {
+		if (rule->steps[progress.step][slot] == symbol && !(progress.mask & (1 << slot))) {
+			progress.mask |= 1 << slot;
+			break;
+		}
+	}
+
+	/* 当前步骤的符号全部出现，进入下一个步骤 */
+	if (progress.mask == detect_analysis_sequence_step_full_mask(rule, progress.step)) {
+		progress.step++;
+		progress.mask = 0;
+	}
+
+	return progress;
+}
+
+/**
+ * @description: 释放自动机
+ * @param automaton 自动机
+ * @return void
+ */
+void detect_analysis_sequence_free(DETECT_SEQ_AUTOMATON_T *automaton) {
+	if (automaton == NULL) {
+		return;
+	}
+
+	PyMem_RawFree(automaton->transitions);
+	PyMem_RawFree(automaton->accept_rules);
+	PyMem_RawFree(automaton);
+}
+
+/**
+ * @description: 将序列规则编译为确定性自动机。自动机的状态是所有规则匹配进度的组合，
+ *               从初始状态开始按广度优先遍历所有可达状态并构建状态转移表
+ * @return DETECT_SEQ_AUTOMATON_T* 自动机，失败时返回NULL
+ */
+DETECT_SEQ_AUTOMATON_T* detect_analysis_sequence_compile() {
+	DETECT_SEQ_AUTOMATON_T *automaton;
+	DETECT_SEQ_PROGRESS_T *states; // 所有状态的规则进度，states[state * SEQUENCE_RULE_COUNT + rule]
+	DETECT_SEQ_PROGRESS_T next[SEQUENCE_RULE_COUNT];
+	PyObject *state_ids;           // 规则进度组合到状态编号的映射
+	PyObject *key, *id;
+	int state, symbol, rule, next_state;
+	size_t progress_size = sizeof(DETECT_SEQ_PROGRESS_T) * SEQUENCE_RULE_COUNT;
+
+	automaton = PyMem_RawCalloc(1, sizeof(DETECT_SEQ_AUTOMATON_T));
+	states    = PyMem_RawCalloc(DETECT_SEQ_MAX_STATES, progress_size);
+	state_ids = PyDict_New();
+	if (automaton == NULL || states == NULL || state_ids == NULL) {
+		goto error;
+	}
+
+	automaton->transitions  = PyMem_RawMalloc(sizeof(int) * DETECT_SEQ_MAX_STATES * DETECT_SEQ_SYMBOL_MAX);
+	automaton->accept_rules = PyMem_RawMalloc(sizeof(int) * DETECT_SEQ_MAX_STATES);
+	if (automaton->transitions == NULL || automaton->accept_rules == NULL) {
+		goto error;
+	}
+
+	/* 初始状态，所有规则都没有进度 */
+	key = PyBytes_FromStringAndSize((const char *)states, progress_size);
+	id  = PyLong_FromLong(0);
+	PyDict_SetItem(state_ids, key, id);
+	Py_DECREF(key);
+	Py_DECREF(id);
+	automaton->state_count = 1;
+
+	for (state = 0; state < automaton->state_count; state++) {
+		DETECT_SEQ_PROGRESS_T *cur = &states[state * SEQUENCE_RULE_COUNT];
+
+		/* 第一个已命中的规则 */
+		automaton->accept_rules[state] = -1;
+		for (rule = 0; rule < (int)SEQUENCE_RULE_COUNT; rule++) {
+			if (cur[rule].step >= detect_analysis_sequence_rule_steps(&g_sequence_rule_def[rule])) {
+				automaton->accept_rules[state] = rule;
+				break;
+			}
+		}
+
+		for (symbol = 0; symbol < DETECT_SEQ_SYMBOL_MAX; symbol++) {
+			/* 空符号不是事件，保持当前状态 */
+			if (symbol == DETECT_SEQ_SYMBOL_NONE) {
+				automaton->transitions[state * DETECT_SEQ_SYMBOL_MAX + symbol] = state;
+				continue;
+			}
+
+			for (rule = 0; rule < (int)SEQUENCE_RULE_COUNT; rule++) {
+				next[rule] = detect_analysis_sequence_rule_step(&g_sequence_rule_def[rule], cur[rule], symbol);
+			}
+
+			/* 查找或者新建状态 */
+			key = PyBytes_FromStringAndSize((const char *)next, progress_size);
+			if (key == NULL) {
+				goto error;
+			}
+			id = PyDict_GetItemWithError(state_ids, key);
+			if (id != NULL) {
+				next_state = PyLong_AsLong(id);
+			} else {
+				if (automaton->state_count >= DETECT_SEQ_MAX_STATES) {
+					Py_DECREF(key);
+					goto error;
+				}
+				next_state = automaton->state_count++;
+				memcpy(&states[next_state * SEQUENCE_RULE_COUNT], next, progress_size);
+				id = PyLong_FromLong(next_state);
+				PyDict_SetItem(state_ids, key, id);
+				Py_DECREF(id);
+			}
+			Py_DECREF(key);
+
+			automaton->transitions[state * DETECT_SEQ_SYMBOL_MAX + symbol] = next_state;
+		}
+	}
+
+	PyMem_RawFree(states);
+	Py_DECREF(state_ids);
+
+	return automaton;
+
+error:
+	PyErr_Clear();
+	PyMem_RawFree(states);
+	Py_XDECREF(state_ids);
+	detect_analysis_sequence_free(automaton);
+
+	return NULL;
+}
+
+/**
+ * @description: 推进自动机，多个线程的调用事件共用一个自动机状态
+ * @param automaton 自动机
+ * @param cur_state 自动机当前状态
+ * @param symbol 输入符号
+ * @param prev_state 推进前的状态
+ * @return int 推进后的状态
+ */
+static int detect_analysis_sequence_advance(DETECT_SEQ_AUTOMATON_T *automaton, atomic_int *cur_state,
+											DETECT_SEQ_SYMBOL_E symbol, int *prev_state) {
+	int state = atomic_load_explicit(cur_state, memory_order_acquire);
+	int next_state;
+
+	do {
+		next_state = automaton->transitions[state * DETECT_SEQ_SYMBOL_MAX + symbol];
+		if (next_state == state) {
+			break;
+		}
+	} while (!atomic_compare_exchange_weak_explicit(cur_state, &state, next_state,
+													memory_order_acq_rel, memory_order_acquire));
+
+	*prev_state = state;
+	return next_state;
+}
+
+/**
+ * @description: 序列规则分析函数，将当前调用归类为符号后推进自动机，命中规则时输出检测结论
+ * @return PyObject*
+ */
+PyObject* detect_analysis_func_sequence_proc() {
+	DETECT_STATE_T *state = detect_state_get();
+	const DETECT_RECORD_INFO_T *detect_record_info;
+	DETECT_SEQ_SYMBOL_E symbol;
+	int prev_state, next_state, rule;
+
+	detect_record_info = detect_record_get_record_info();
+	if (!detect_record_info->cur_call_info.is_avaliable || state->sequence_automaton == NULL) {
+		return NULL;
+	}
+
+	/* 将调用事件归类为符号 */
+	symbol = detect_analysis_func_reverse_shell_classify(&detect_record_info->cur_call_info);
+	if (symbol == DETECT_SEQ_SYMBOL_NONE) {
+		return NULL;
+	}
+
+	detect_analysis_evidence_add(g_sequence_symbol_evidence[symbol], 1);
+
+	/* 推进自动机，接受状态之后的事件仍然停留在接受状态，只在首次进入接受状态时给出结论 */
+	next_state = detect_analysis_sequence_advance(state->sequence_automaton, &state->sequence_state, symbol,
+												  &prev_state);
+	rule = state->sequence_automaton->accept_rules[next_state];
+	if (rule >= 0 && state->sequence_automaton->accept_rules[prev_state] < 0) {
+		return detect_analysis_create_detect_malicious_result_dict(g_sequence_rule_def[rule].desc);
+	}
+
+	return NULL;
+}
+
+/**
+ * @description: 收集序列规则，用于计算规则集的版本
+ * @param rules_list 规则列表
+ * @return void
+ */
+void detect_analysis_sequence_collect_rules(PyObject *rules_list) {
+	int symbols[MAX_POS] = {0};
+	int rule, step, slot;
+
+	for (rule = 0; rule < (int)SEQUENCE_RULE_COUNT; rule++) {
+		for (step = 0; step < DETECT_SEQ_MAX_STEPS; step++) {
+			for (slot = 0; slot < DETECT_SEQ_MAX_STEP_SYMBOLS; slot++) {
+				symbols[slot] = g_sequence_rule_def[rule].steps[step][slot];
+			}
+			detect_config_append_rule(rules_list, "sequence", NULL, NULL, NULL, g_sequence_rule_def[rule].desc,
+									  symbols, rule);
+		}
+	}
+
+	for (slot = 0; slot < DETECT_SEQ_SYMBOL_MAX; slot++) {
+		detect_config_append_rule(rules_list, "sequence_evidence", NULL, NULL, NULL, NULL, NULL,
+								  g_sequence_symbol_evidence[slot]);
+	}
+}
@@ -0,0 +1,45 @@
+#ifndef DETECT_ANALYSIS_SEQUENCE_H
+#define DETECT_ANALYSIS_SEQUENCE_H
+
+#include <stdbool.h>
+#include "Python.h"
+
+/* 规则的最大步骤数 */
+#define DETECT_SEQ_MAX_STEPS 4
+
+/* 每个步骤中的最大符号数 */
+#define DETECT_SEQ_MAX_STEP_SYMBOLS 4
+
+/* 自动机的最大状态数 */
+#define DETECT_SEQ_MAX_STATES 4096
+
+/* 调用事件被归类后的符号，作为序列规则自动机的输入 */
+typedef enum {
+	DETECT_SEQ_SYMBOL_NONE = 0,          // 与任何规则无关的调用
+	DETECT_SEQ_SYMBOL_DUP_TAINT_0,       // os.dup2(taint, 0)
+	DETECT_SEQ_SYMBOL_DUP_TAINT_1,       // os.dup2(taint, 1)
+	DETECT_SEQ_SYMBOL_DUP_TAINT_TAINT,   // os.dup2(taint, taint)
+	DETECT_SEQ_SYMBOL_EXEC_SH,           // 执行的命令包含sh
+	DETECT_SEQ_SYMBOL_EXEC_SH_DEVTCP,    // 执行的命令包含sh且通过/dev/tcp反弹
+	DETECT_SEQ_SYMBOL_MAX
+} DETECT_SEQ_SYMBOL_E;
+
+/* 序列规则定义，步骤按顺序命中，同一步骤内的符号不分先后，重复的符号代表需要出现多次 */
+typedef struct {
+	const char *desc;                                                          // 命中规则时检测结论的描述
+	DETECT_SEQ_SYMBOL_E steps[DETECT_SEQ_MAX_STEPS][DETECT_SEQ_MAX_STEP_SYMBOLS]; // 以DETECT_SEQ_SYMBOL_NONE结束
+} DETECT_SEQ_RULE_DEF;
+
+/* 由序列规则编译出的确定性自动机 */
+typedef struct {
+	int state_count;   // 状态数量，状态0为初始状态
+	int *transitions;  // 状态转移表，transitions[state * DETECT_SEQ_SYMBOL_MAX + symbol]
+	int *accept_rules; // 各状态命中的规则下标，-1代表未命中
+} DETECT_SEQ_AUTOMATON_T;
+
+extern DETECT_SEQ_AUTOMATON_T* detect_analysis_sequence_compile();
+extern void detect_analysis_sequence_free(DETECT_SEQ_AUTOMATON_T *automaton);
+extern PyObject* detect_analysis_func_sequence_proc();
+extern void detect_analysis_sequence_collect_rules(PyObject *rules_list);
+
+#endif
@@ -0,0 +1,666 @@
+/*
+ * @Description: 二阶段载荷的进程内递归检测。样本通过exec/eval执行的代码字符串、通过subprocess或os.system
+ *               执行的"python -c ..."和"python xxx.py"命令行被提取为独立的阶段，在当前解释器的嵌套检测上下文中
+ *               执行：阶段拥有自己的run_filename，与父脚本共享证据库，不需要启动新的解释器
+ */
+
+#include "Python.h"
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "pycore_interp.h"
+#include "pycore_pystate.h"
+#include "Detect/configs/config.h"
+#include "Detect/analysis/analysis_stage.h"
+#include "Detect/virtual/virtual_fs.h"
+#include "Detect/utils/dict.h"
+#include "Detect/detect_state.h"
+#include "Detect/detect_profile.h"
+
+/* 阶段的最大嵌套深度 */
+#define DETECT_STAGE_MAX_DEPTH 4
+
+/* 单个样本最多展开的阶段数量，防止样本在循环中反复执行同一段载荷 */
+#define DETECT_STAGE_MAX_COUNT 32
+
+/* 从磁盘或虚拟文件系统读取阶段脚本的最大长度 */
+#define DETECT_STAGE_MAX_SOURCE (4 * 1024 * 1024)
+
+/* 嵌套在shell命令中的python命令行，例如"sh -c \"python3 -c '...'\""，最多展开的层数 */
+#define DETECT_STAGE_MAX_SHELL_DEPTH 2
+
+/**
+ * @description: 判断当前是否允许进入新的阶段
+ * @return bool
+ */
+static bool detect_analysis_stage_can_enter() {
+	DETECT_STATE_T *state = detect_state_get();
+
+	if (state == NULL || !state->has_init || state->is_finished ||
+		!detect_config_get_runtime_is_stage_scan()) {
+		return false;
+	}
+
+	return (state->stage_stack == NULL || PyList_GET_SIZE(state->stage_stack) < DETECT_STAGE_MAX_DEPTH) &&
+		   state->stage_count < DETECT_STAGE_MAX_COUNT;
+}
+
+/**
+ * @description: 进入嵌套检测上下文，将解释器的run_filename切换为阶段名
+ * @param stage_name 阶段名
+ * @param saved_run_filename 保存父上下文的run_filename，退出时恢复
+ * @return int 0 --- 成功，-1 --- 失败
+ */
+static int detect_analysis_stage_enter(PyObject *stage_name, wchar_t **saved_run_filename) {
+	DETECT_STATE_T *state = detect_state_get();
+	PyConfig *config = (PyConfig *)_Py_GetConfig();
+	wchar_t *name, *run_filename;
+
+	if (state->stage_stack == NULL) {
+		state->stage_stack = PyList_New(0);
+		if (state->stage_stack == NULL) {
+			PyErr_Clear();
+			return -1;
+		}
+	}
+
+	name = PyUnicode_AsWideCharString(stage_name, NULL);
+	run_filename = name != NULL ? _PyMem_RawWcsdup(name) : NULL;
+	PyMem_Free(name);
+	if (run_filename == NULL || PyList_Append(state->stage_stack, stage_name) < 0) {
+		PyMem_RawFree(run_filename);
+		PyErr_Clear();
+		return -1;
+	}
+
+	/* 最外层阶段记录样本本身的路径，阶段中得出的检测结论仍然归属于样本 */
+	if (PyList_GET_SIZE(state->stage_stack) == 1 && config->run_filename != NULL) {
+		Py_XSETREF(state->stage_sample_filename, PyUnicode_FromWideChar(config->run_filename, -1));
+	}
+
+	state->stage_count++;
+	*saved_run_filename = config->run_filename;
+	config->run_filename = run_filename;
+
+	return 0;
+}
+
+/**
+ * @description: 退出嵌套检测上下文，恢复父上下文的run_filename
+ * @param saved_run_filename 进入时保存的run_filename
+ * @return void
+ */
+static void detect_analysis_stage_leave(wchar_t *saved_run_filename) {
+	DETECT_STATE_T *state = detect_state_get();
+	PyConfig *config = (PyConfig *)_Py_GetConfig();
+
+	PyMem_RawFree(config->run_filename);
+	config->run_filename = saved_run_filename;
+
+	PyList_SetSlice(state->stage_stack, PyList_GET_SIZE(state->stage_stack) - 1,
+					PyList_GET_SIZE(state->stage_stack), NULL);
+	if (PyList_GET_SIZE(state->stage_stack) == 0) {
+		Py_CLEAR(state->stage_sample_filename);
+	}
+}
+
+/**
+ * @description: 为代码字符串和-c命令行生成阶段名
+ * @return PyObject* 新引用
+ */
+static PyObject* detect_analysis_stage_new_name() {
+	return PyUnicode_FromFormat("<stage-%d>", detect_state_get_or_default()->stage_count + 1);
+}
+
+/**
+ * @description: 编译阶段源码，源码可以是str或bytes
+ * @param source 源码
+ * @param stage_name 阶段名，作为code对象的co_filename
+ * @param start 编译模式，Py_file_input或Py_eval_input
+ * @return PyObject* code对象，编译失败或源码包含空字符时返回NULL并保留异常
+ */
+static PyObject* detect_analysis_stage_compile(PyObject *source, PyObject *stage_name, int start) {
+	PyCompilerFlags cf = _PyCompilerFlags_INIT;
+	const char *str;
+	Py_ssize_t size;
+
+	if (PyUnicode_Check(source)) {
+		str = PyUnicode_AsUTF8AndSize(source, &size);
+		cf.cf_flags |= PyCF_IGNORE_COOKIE;
+	} else if (PyBytes_Check(source)) {
+		str  = PyBytes_AS_STRING(source);
+		size = PyBytes_GET_SIZE(source);
+	} else {
+		PyErr_SetString(PyExc_TypeError, "stage source must be str or bytes");
+		return NULL;
+	}
+
+	if (str == NULL) {
+		return NULL;
+	}
+
+	/* 源码按C字符串编译，包含空字符时会被截断，与exec/eval相同直接拒绝 */
+	if (strlen(str) != (size_t)size) {
+		PyErr_SetString(PyExc_ValueError, "source code string cannot contain null bytes");
+		return NULL;
+	}
+
+	/* 与eval相同，忽略表达式前的空白 */
+	if (start == Py_eval_input) {
+		while (*str == ' ' || *str == '\t') {
+			str++;
+		}
+	}
+
+	/* 继承调用方的__future__编译选项，与exec/eval保持一致 */
+	PyEval_MergeCompilerFlags(&cf);
+
+	return Py_CompileStringObject(str, stage_name, start, &cf, -1);
+}
+
+/**
+ * @description: 在嵌套检测上下文中以新的__main__命名空间执行阶段。阶段自身抛出的异常和SystemExit
+ *               只代表阶段执行结束，与子进程退出一致，不影响父脚本继续执行
+ * @param source 阶段源码或code对象
+ * @param stage_name 阶段名
+ * @param is_file 阶段是否来自脚本文件
+ * @return void
+ */
+static void detect_analysis_stage_run(PyObject *source, PyObject *stage_name, bool is_file) {
+	PyObject *exc_type, *exc_value, *exc_tb;
+	PyObject *code, *globals, *result;
+	wchar_t *saved_run_filename;
+	int profile_depth;
+
+	PyErr_Fetch(&exc_type, &exc_value, &exc_tb);
+
+	if (detect_analysis_stage_enter(stage_name, &saved_run_filename) < 0) {
+		PyErr_Restore(exc_type, exc_value, exc_tb);
+		return;
+	}
+
+	if (PyCode_Check(source)) {
+		Py_INCREF(source);
+		code = source;
+	} else {
+		code = detect_analysis_stage_compile(source, stage_name, Py_file_input);
+	}
+
+	globals = PyDict_New();
+	if (code != NULL && globals != NULL &&
+		dict_setitem_string_string(globals, "__name__", "__main__") == 0 &&
+		PyDict_SetItemString(globals, "__builtins__", PyEval_GetBuiltins()) == 0 &&
+		(!is_file || PyDict_SetItemString(globals, "__file__", stage_name) == 0)) {
+		/* 二阶段载荷在威胁调用的hook中执行，采样时与主脚本一样计入样本代码 */
+		DETECT_PROFILE_SUSPEND(profile_depth);
+		result = PyEval_EvalCode(code, globals, globals);
+		DETECT_PROFILE_RESUME(profile_depth);
+		Py_XDECREF(result);
+	}
+
+	Py_XDECREF(globals);
+	Py_XDECREF(code);
+	PyErr_Clear();
+
+	detect_analysis_stage_leave(saved_run_filename);
+
+	PyErr_Restore(exc_type, exc_value, exc_tb);
+}
+
+/**
+ * @description: 判断命令行参数是否为python解释器，例如python、python3、/usr/bin/python3.10或sys.executable
+ * @param token 命令行参数
+ * @return bool
+ */
+static bool detect_analysis_stage_is_interpreter(PyObject *token) {
+	PyObject *executable;
+	Py_ssize_t length, start, index;
+	Py_UCS4 ch;
+
+	executable = PySys_GetObject("executable");
+	if (executable != NULL && PyUnicode_Check(executable) && PyUnicode_Compare(token, executable) == 0) {
+		return true;
+	}
+	PyErr_Clear();
+
+	/* 只比较basename */
+	length = PyUnicode_GET_LENGTH(token);
+	start  = PyUnicode_FindChar(token, '/', 0, length, -1) + 1;
+	if (start < 0 || length - start < 6) {
+		PyErr_Clear();
+		return false;
+	}
+	for (index = 0; index < 6; index++) {
+		if (PyUnicode_READ_CHAR(token, start + index) != (Py_UCS4)"python"[index]) {
+			return false;
+		}
+	}
+
+	/* 版本号和pythonw等后缀 */
+	for (index = start + 6; index < length; index++) {
+		ch = PyUnicode_READ_CHAR(token, index);
+		if (!(ch >= '0' && ch <= '9') && ch != '.' &&
+			!(index == length - 1 && (ch == 'w' || ch == 'm'))) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @description: 将命令转换为参数列表。字符串形式的命令按shell规则拆分，拆分过程中暂时关闭detect模块
+ * @param command 命令，可以是str、bytes、list或tuple
+ * @return PyObject* 只包含str的参数列表，新引用；无法转换时返回NULL
+ */
+static PyObject* detect_analysis_stage_split_command(PyObject *command) {
+	PyObject *argv = NULL, *item, *token, *shlex_module;
+	Py_ssize_t index;
+
+	if (PyBytes_Check(command)) {
+		token = PyUnicode_DecodeFSDefaultAndSize(PyBytes_AS_STRING(command), PyBytes_GET_SIZE(command));
+		argv  = token != NULL ? detect_analysis_stage_split_command(token) : NULL;
+		Py_XDECREF(token);
+		PyErr_Clear();
+		return argv;
+	}
+
+	if (PyUnicode_Check(command)) {
+		detect_config_set_runtime_is_enable(false);
+		shlex_module = PyImport_ImportModule("shlex");
+		argv = shlex_module != NULL ? PyObject_CallMethod(shlex_module, "split", "O", command) : NULL;
+		Py_XDECREF(shlex_module);
+		detect_config_set_runtime_is_enable(true);
+
+		/* 引号不配对等情况下按空白拆分 */
+		if (argv == NULL || !PyList_Check(argv)) {
+			PyErr_Clear();
+			Py_XDECREF(argv);
+			argv = PyUnicode_Split(command, NULL, -1);
+		}
+		PyErr_Clear();
+		return argv;
+	}
+
+	if (!PyList_Check(command) && !PyTuple_Check(command)) {
+		return NULL;
+	}
+
+	argv = PyList_New(0);
+	for (index = 0; argv != NULL && index < PySequence_Fast_GET_SIZE(command); index++) {
+		item = PySequence_Fast_GET_ITEM(command, index);
+		if (PyUnicode_Check(item)) {
+			Py_INCREF(item);
+			token = item;
+		} else if (PyBytes_Check(item)) {
+			token = PyUnicode_DecodeFSDefaultAndSize(PyBytes_AS_STRING(item), PyBytes_GET_SIZE(item));
+		} else {
+			break;
+		}
+
+		if (token == NULL || PyList_Append(argv, token) < 0) {
+			Py_XDECREF(token);
+			Py_CLEAR(argv);
+			break;
+		}
+		Py_DECREF(token);
+	}
+	PyErr_Clear();
+
+	return argv;
+}
+
+/**
+ * @description: 读取阶段脚本，样本写入虚拟文件系统的脚本从覆盖层中读取
+ * @param path 脚本路径
+ * @return PyObject* 脚本内容，新引用；无法读取时返回NULL
+ */
+static PyObject* detect_analysis_stage_read_file(PyObject *path) {
+	PyObject *path_bytes, *data = NULL;
+	Py_ssize_t size = 0, capacity = 4096;
+	ssize_t n;
+	int fd;
+
+	path_bytes = PyUnicode_EncodeFSDefault(path);
+	if (path_bytes == NULL) {
+		PyErr_Clear();
+		return NULL;
+	}
+
+	fd = detect_virtual_fs_open(PyBytes_AS_STRING(path_bytes), AT_FDCWD, O_RDONLY | O_CLOEXEC, 0);
+	if (fd == DETECT_VIRTUAL_FS_NOT_HANDLED) {
+		fd = open(PyBytes_AS_STRING(path_bytes), O_RDONLY | O_CLOEXEC);
+	}
+	Py_DECREF(path_bytes);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	data = PyBytes_FromStringAndSize(NULL, capacity);
+	while (data != NULL) {
+		n = read(fd, PyBytes_AS_STRING(data) + size, capacity - size);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			if (n < 0 || _PyBytes_Resize(&data, size) < 0) {
+				Py_CLEAR(data);
+			}
+			break;
+		}
+
+		size += n;
+		if (size == capacity) {
+			if (capacity >= DETECT_STAGE_MAX_SOURCE) {
+				Py_CLEAR(data);
+				break;
+			}
+			capacity *= 2;
+			if (_PyBytes_Resize(&data, capacity) < 0) {
+				data = NULL;
+			}
+		}
+	}
+
+	close(fd);
+	PyErr_Clear();
+
+	return data;
+}
+
+/**
+ * @description: 解析python解释器之后的命令行选项，提取-c的代码或者脚本路径。-m和从标准输入读取的方式不处理
+ * @param argv 参数列表
+ * @param start 解释器之后第一个参数的位置
+ * @param source 提取到的代码，新引用
+ * @param script 提取到的脚本路径，新引用
+ * @return bool 是否提取到阶段
+ */
+static bool detect_analysis_stage_parse_options(PyObject *argv, Py_ssize_t start,
+												PyObject **source, PyObject **script) {
+	Py_ssize_t argc = PyList_GET_SIZE(argv), index, pos, length;
+	PyObject *token, *value;
+	Py_UCS4 ch;
+
+	for (index = start; index < argc; index++) {
+		token  = PyList_GET_ITEM(argv, index);
+		length = PyUnicode_GET_LENGTH(token);
+
+		/* 非选项参数即为脚本路径，"--"之后的参数同样是脚本路径 */
+		if (length < 2 || PyUnicode_READ_CHAR(token, 0) != '-') {
+			break;
+		}
+		if (PyUnicode_READ_CHAR(token, 1) == '-') {
+			if (length == 2) {
+				index++;
+				break;
+			}
+			if (_PyUnicode_EqualToASCIIString(token, "--check-hash-based-pycs")) {
+				index++;
+			}
+			continue;
+		}
+
+		/* 短选项可以合并，例如"-Sc" */
+		for (pos = 1; pos < length; pos++) {
+			ch = PyUnicode_READ_CHAR(token, pos);
+			if (ch == 'c') {
+				value = pos + 1 < length ? PyUnicode_Substring(token, pos + 1, length) :
+						index + 1 < argc ? Py_NewRef(PyList_GET_ITEM(argv, index + 1)) : NULL;
+				*source = value;
+				return value != NULL;
+			} else if (ch == 'm') {
+				return false;
+			} else if (ch == 'W' || ch == 'X') {
+				if (pos + 1 == length) {
+					index++;
+				}
+				break;
+			}
+		}
+	}
+
+	if (index >= argc || _PyUnicode_EqualToASCIIString(PyList_GET_ITEM(argv, index), "-")) {
+		return false;
+	}
+
+	*script = Py_NewRef(PyList_GET_ITEM(argv, index));
+	return true;
+}
+
+/**
+ * @description: 从命令中提取python阶段，支持直接调用解释器以及包裹在shell -c中的解释器命令行
+ * @param command 命令
+ * @param depth shell嵌套层数
+ * @param source 提取到的代码，新引用
+ * @param script 提取到的脚本路径，新引用
+ * @return bool 是否提取到阶段
+ */
+static bool detect_analysis_stage_extract(PyObject *command, int depth, PyObject **source, PyObject **script) {
+	PyObject *argv, *token;
+	Py_ssize_t index;
+	bool found = false;
+
+	argv = detect_analysis_stage_split_command(command);
+	if (argv == NULL) {
+		return false;
+	}
+
+	for (index = 0; index < PyList_GET_SIZE(argv) && !found; index++) {
+		if (detect_analysis_stage_is_interpreter(PyList_GET_ITEM(argv, index))) {
+			found = detect_analysis_stage_parse_options(argv, index + 1, source, script);
+			break;
+		}
+	}
+
+	/* 参数中包含空白时可能是传给shell的命令行 */
+	for (index = 0; index < PyList_GET_SIZE(argv) && !found && depth < DETECT_STAGE_MAX_SHELL_DEPTH; index++) {
+		token = PyList_GET_ITEM(argv, index);
+		if (PyUnicode_FindChar(token, ' ', 0, PyUnicode_GET_LENGTH(token), 1) >= 0) {
+			found = detect_analysis_stage_extract(token, depth + 1, source, script);
+		}
+	}
+
+	Py_DECREF(argv);
+
+	return found;
+}
+
+/**
+ * @description: 执行从命令行中提取出的阶段
+ * @param source -c的代码，为NULL时执行脚本
+ * @param script 脚本路径
+ * @return void
+ */
+static void detect_analysis_stage_run_extracted(PyObject *source, PyObject *script) {
+	PyObject *stage_name = NULL, *data = NULL;
+	wchar_t *path, *abspath = NULL;
+
+	if (source != NULL) {
+		stage_name = detect_analysis_stage_new_name();
+		if (stage_name != NULL) {
+			detect_analysis_stage_run(source, stage_name, false);
+		}
+		Py_XDECREF(stage_name);
+		PyErr_Clear();
+		return;
+	}
+
+	data = detect_analysis_stage_read_file(script);
+	if (data == NULL) {
+		return;
+	}
+
+	/* 脚本阶段以绝对路径作为阶段名 */
+	path = PyUnicode_AsWideCharString(script, NULL);
+	if (path != NULL && _Py_abspath(path, &abspath) == 0 && abspath != NULL) {
+		stage_name = PyUnicode_FromWideChar(abspath, -1);
+	}
+	PyMem_Free(path);
+	PyMem_RawFree(abspath);
+
+	if (stage_name != NULL) {
+		detect_analysis_stage_run(data, stage_name, true);
+	}
+
+	Py_XDECREF(stage_name);
+	Py_DECREF(data);
+	PyErr_Clear();
+}
+
+/**
+ * @description: 命令执行类威胁的阶段处理。命令为python解释器命令行时，提取其中的代码或脚本作为阶段执行
+ * @param args 位置参数
+ * @param kwargs 关键字参数
+ * @return void
+ */
+void detect_analysis_stage_command_proc(PyObject *args, PyObject *kwargs) {
+	PyObject *source = NULL, *script = NULL, *value;
+	Py_ssize_t index, pos = 0;
+	bool found = false;
+
+	if (!detect_analysis_stage_can_enter()) {
+		return;
+	}
+
+	/* 命令所在的参数位置因函数而异，例如os.system(cmd)、os.execv(path, args)、os.spawnv(mode, path, args) */
+	for (index = 0; args != NULL && index < PyTuple_GET_SIZE(args) && !found; index++) {
+		found = detect_analysis_stage_extract(PyTuple_GET_ITEM(args, index), 0, &source, &script);
+	}
+	while (kwargs != NULL && !found && PyDict_Next(kwargs, &pos, NULL, &value)) {
+		found = detect_analysis_stage_extract(value, 0, &source, &script);
+	}
+
+	if (found) {
+		detect_analysis_stage_run_extracted(source, script);
+	}
+
+	Py_XDECREF(source);
+	Py_XDECREF(script);
+}
+
+/**
+ * @description: 不执行原逻辑的代码执行类威胁的阶段处理，例如code.InteractiveConsole.runcode、
+ *               _xxsubinterpreters.run_string，第一个代码字符串或code对象参数作为阶段执行。
+ *               InteractiveConsole.push传入的是单行输入，不作为阶段处理
+ * @param args 位置参数
+ * @param kwargs 关键字参数
+ * @return void
+ */
+void detect_analysis_stage_source_proc(PyObject *args, PyObject *kwargs) {
+	PyObject *source = NULL, *stage_name, *item;
+	Py_ssize_t index;
+
+	if (!detect_analysis_stage_can_enter()) {
+		return;
+	}
+
+	/* 代码所在的参数位置因函数而异，例如runcode(code)、run_string(id, script) */
+	for (index = 0; args != NULL && index < PyTuple_GET_SIZE(args) && source == NULL; index++) {
+		item = PyTuple_GET_ITEM(args, index);
+		if (PyUnicode_Check(item) || PyBytes_Check(item) || PyCode_Check(item)) {
+			source = item;
+		}
+	}
+	if (source == NULL && kwargs != NULL) {
+		source = PyDict_GetItemString(kwargs, "source");
+		source = source != NULL ? source : PyDict_GetItemString(kwargs, "code");
+		source = source != NULL ? source : PyDict_GetItemString(kwargs, "script");
+	}
+
+	if (source == NULL || !(PyUnicode_Check(source) || PyBytes_Check(source) || PyCode_Check(source))) {
+		return;
+	}
+
+	/* code对象保留自身的co_filename，阶段名仍然单独分配 */
+	stage_name = detect_analysis_stage_new_name();
+	if (stage_name != NULL) {
+		detect_analysis_stage_run(source, stage_name, false);
+	}
+	Py_XDECREF(stage_name);
+	PyErr_Clear();
+}
+
+/**
+ * @description: exec/eval的阶段处理。代码字符串先以阶段名编译为code对象，再在嵌套检测上下文中调用原函数，
+ *               执行时仍然使用调用方的命名空间
+ * @param func 原exec/eval函数
+ * @param args 位置参数
+ * @param kwargs 关键字参数
+ * @param mode 编译模式，"exec"或"eval"
+ * @return PyObject* 原函数的返回值，发生异常时返回NULL
+ */
+PyObject* detect_analysis_stage_code_exec_proc(PyObject *func, PyObject *args, PyObject *kwargs,
+											   const char *mode) {
+	PyObject *stage_name, *code, *new_args, *result;
+	wchar_t *saved_run_filename;
+	Py_ssize_t index;
+
+	if (!detect_analysis_stage_can_enter() || PyTuple_GET_SIZE(args) == 0 ||
+		!(PyUnicode_Check(PyTuple_GET_ITEM(args, 0)) || PyBytes_Check(PyTuple_GET_ITEM(args, 0)))) {
+		return PyObject_Call(func, args, kwargs);
+	}
+
+	stage_name = detect_analysis_stage_new_name();
+	code = stage_name != NULL ?
+		   detect_analysis_stage_compile(PyTuple_GET_ITEM(args, 0), stage_name,
+										 strcmp(mode, "eval") ? Py_file_input : Py_eval_input) : NULL;
+	new_args = code != NULL ? PyTuple_New(PyTuple_GET_SIZE(args)) : NULL;
+
+	/* 编译失败时按原逻辑执行，由原函数抛出SyntaxError */
+	if (new_args == NULL) {
+		Py_XDECREF(stage_name);
+		Py_XDECREF(code);
+		PyErr_Clear();
+		return PyObject_Call(func, args, kwargs);
+	}
+
+	PyTuple_SET_ITEM(new_args, 0, code);
+	for (index = 1; index < PyTuple_GET_SIZE(args); index++) {
+		PyTuple_SET_ITEM(new_args, index, Py_NewRef(PyTuple_GET_ITEM(args, index)));
+	}
+
+	if (detect_analysis_stage_enter(stage_name, &saved_run_filename) < 0) {
+		result = PyObject_Call(func, args, kwargs);
+	} else {
+		result = PyObject_Call(func, new_args, kwargs);
+		detect_analysis_stage_leave(saved_run_filename);
+	}
+
+	Py_DECREF(new_args);
+	Py_DECREF(stage_name);
+
+	return result;
+}
+
+/**
+ * @description: 获取样本本身的路径，阶段中得出的检测结论以此作为文件名
+ * @return PyObject* 新引用
+ */
+PyObject* detect_analysis_stage_get_sample_filename() {
+	DETECT_STATE_T *state = detect_state_get();
+	wchar_t *run_filename;
+
+	if (state != NULL && state->stage_sample_filename != NULL) {
+		Py_INCREF(state->stage_sample_filename);
+		return state->stage_sample_filename;
+	}
+
+	run_filename = _Py_GetConfig()->run_filename;
+	return PyUnicode_FromWideChar(run_filename, wcslen(run_filename));
+}
+
+/**
+ * @description: 获取当前正在执行的阶段名，不在阶段中时返回NULL
+ * @return PyObject* 借用引用
+ */
+PyObject* detect_analysis_stage_get_current() {
+	DETECT_STATE_T *state = detect_state_get();
+
+	if (state == NULL || state->stage_stack == NULL || PyList_GET_SIZE(state->stage_stack) == 0) {
+		return NULL;
+	}
+
+	return PyList_GET_ITEM(state->stage_stack, PyList_GET_SIZE(state->stage_stack) - 1);
+}
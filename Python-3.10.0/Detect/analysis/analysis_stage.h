@@ -0,0 +1,17 @@
+#ifndef DETECT_ANALYSIS_STAGE_H
+#define DETECT_ANALYSIS_STAGE_H
+
+#include <stdbool.h>
+#include "Python.h"
+
+/* 检测结果字典中嵌套阶段的key */
+#define STAGE_STRING "Stage"
+
+extern void detect_analysis_stage_command_proc(PyObject *args, PyObject *kwargs);
+extern void detect_analysis_stage_source_proc(PyObject *args, PyObject *kwargs);
+extern PyObject* detect_analysis_stage_code_exec_proc(PyObject *func, PyObject *args, PyObject *kwargs,
+													  const char *mode);
+extern PyObject* detect_analysis_stage_get_sample_filename(void);
+extern PyObject* detect_analysis_stage_get_current(void);
+
+#endif
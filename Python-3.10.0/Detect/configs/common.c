@@ -2,9 +2,11 @@
  * @Description: 通用配置处理函数
  */
 
+#include <stdio.h>
 #include "Python.h"
 #include "pycore_interp.h"
 #include "pycore_pystate.h"
+#include "Detect/configs/common.h"
 
  /**
   * @description: 根据参数position数组构建对应的list
@@ -26,3 +28,38 @@
 	 return list_tmp;
  }
 
+
+/**
+ * @description: 将一条配置项格式化为字符串加入规则列表，规则列表用于计算规则集的版本
+ * @param rules_list 规则列表
+ * @param kind 配置项的种类
+ * @param module_name 模块名
+ * @param class_name 类名
+ * @param method_name 方法名
+ * @param name 函数名或变量名
+ * @param pos 参数位置，以0结束，可以为NULL
+ * @param extra 配置项的其他数值属性
+ * @return void
+ */
+void detect_config_append_rule(PyObject *rules_list, const char *kind, const char *module_name,
+							   const char *class_name, const char *method_name, const char *name,
+							   const int *pos, int extra) {
+	char pos_str[MAX_POS * 12 + 1] = {0};
+	size_t offset = 0;
+	PyObject *rule;
+	int index;
+
+	for (index = 0; pos != NULL && index < MAX_POS && pos[index] != 0; index++) {
+		offset += snprintf(pos_str + offset, sizeof(pos_str) - offset, "%d,", pos[index]);
+	}
+
+	rule = PyUnicode_FromFormat("%s|%s|%s|%s|%s|%s|%d", kind,
+								module_name ? module_name : "", class_name ? class_name : "",
+								method_name ? method_name : "", name ? name : "", pos_str, extra);
+	if (rule == NULL) {
+		return;
+	}
+
+	PyList_Append(rules_list, rule);
+	Py_DECREF(rule);
+}
@@ -39,6 +39,9 @@ typedef enum {
 #define SEARCH_KEY_STRING          "search_key"      // 用于在配置字典或其他字典中快速搜索
 
 extern PyObject *detect_config_create_pos_list(int *taint_pos, int len);
+extern void detect_config_append_rule(PyObject *rules_list, const char *kind, const char *module_name,
+									  const char *class_name, const char *method_name, const char *name,
+									  const int *pos, int extra);
 
 #endif
 
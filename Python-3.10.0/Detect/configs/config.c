@@ -5,15 +5,31 @@
 #include <stdlib.h>
 #include "Detect/configs/config.h"
 #include "Detect/utils/str.h"
+#include "Detect/detect_state.h"
+#include "Detect/detect_context.h"
 
 /* 运行时检测配置 */
 static DETECT_RUNTIME_CONFIG g_detect_runtime_config = {
 	.is_enable = true,
 	.is_jump_branch = false,
+	.is_virtual_io = true,
+	.is_virtual_fs = true,
+	.is_batch = false,
+	.is_prefilter = true,
 	.detect_timeout = 10,
 	.memory_limit = 500,
-	.run_mode = RUN_MODE_DEBUG,
-	.run_state = RUN_STATE_INITIALIZING
+	.score_threshold = 100,
+	.second_pass_score = 5,
+	.verdict_cache = NULL,
+	.profile = NULL,
+	.is_fingerprint = true,
+	.is_explore = true,
+	.is_static_decode = true,
+	.is_stage_scan = true,
+	.is_inline_process = true,
+	.is_virtual_thread = true,
+	.is_scan_memory = true,
+	.run_mode = RUN_MODE_DEBUG
 };
 
 /**
@@ -21,15 +37,31 @@ static DETECT_RUNTIME_CONFIG g_detect_runtime_config = {
  * @return bool true --- 开启，false --- 关闭
  */
 bool detect_config_get_runtime_is_enable() {
-	return g_detect_runtime_config.is_enable;
+	PyThreadState *tstate;
+	DETECT_CONTEXT_T *context;
+
+	if (!g_detect_runtime_config.is_enable) {
+		return false;
+	}
+
+	/* 线程上下文未创建时，当前线程不可能临时关闭过detect模块 */
+	tstate = _PyThreadState_GET();
+	context = tstate != NULL ? tstate->detect_context : NULL;
+
+	return context == NULL || !context->is_disabled;
 }
 
 /**
- * @description: 设置detect模块开关状态
+ * @description: 临时关闭或恢复当前线程的detect模块，不影响其他线程。
+ *               命令行的enable选项只在配置解析阶段设置
  * @return void
  */
 void detect_config_set_runtime_is_enable(bool is_enable) {
-	g_detect_runtime_config.is_enable = is_enable;
+	DETECT_CONTEXT_T *context = detect_context_get();
+
+	if (context != NULL) {
+		context->is_disabled = !is_enable;
+	}
 }
 
 /**
@@ -40,6 +72,38 @@ bool detect_config_get_runtime_is_jump_branch() {
 	return g_detect_runtime_config.is_jump_branch;
 }
 
+/**
+ * @description: 获取detect模块是否开启虚拟I/O
+ * @return bool
+ */
+bool detect_config_get_runtime_is_virtual_io() {
+	return g_detect_runtime_config.is_virtual_io;
+}
+
+/**
+ * @description: 获取detect模块是否开启虚拟文件系统
+ * @return bool
+ */
+bool detect_config_get_runtime_is_virtual_fs() {
+	return g_detect_runtime_config.is_virtual_fs;
+}
+
+/**
+ * @description: 获取detect模块是否为批量扫描模式
+ * @return bool
+ */
+bool detect_config_get_runtime_is_batch() {
+	return g_detect_runtime_config.is_batch;
+}
+
+/**
+ * @description: 获取detect模块是否开启静态预过滤
+ * @return bool
+ */
+bool detect_config_get_runtime_is_prefilter() {
+	return g_detect_runtime_config.is_prefilter;
+}
+
 /**
  * @description: 获取detect模块是否运行在debug模式
  * @return bool
@@ -53,7 +117,23 @@ bool detect_config_get_runtime_is_debug() {
  * @return void
  */
 void detect_config_set_runtime_state(DETECT_RUN_STATE run_state) {
-	g_detect_runtime_config.run_state = run_state;
+	DETECT_STATE_T *state = detect_state_get();
+	DETECT_CONTEXT_T *context;
+
+	/* 未初始化detect模块的解释器不做处理 */
+	if (state == NULL) {
+		return;
+	}
+
+	/* 分析状态只属于正在执行分析的线程，其他线程仍然处于记录状态 */
+	context = detect_context_get();
+	if (context != NULL) {
+		context->is_analysing = (run_state == RUN_STATE_ANALYSING);
+	}
+
+	if (run_state != RUN_STATE_ANALYSING) {
+		state->run_state = run_state;
+	}
 }
 
 /**
@@ -61,7 +141,22 @@ void detect_config_set_runtime_state(DETECT_RUN_STATE run_state) {
  * @return DETECT_RUN_STATE
  */
 DETECT_RUN_STATE detect_config_get_runtime_state() {
-	return g_detect_runtime_config.run_state;
+	DETECT_STATE_T *state = detect_state_get();
+
+	PyThreadState *tstate;
+	DETECT_CONTEXT_T *context;
+
+	if (state == NULL) {
+		return RUN_STATE_INITIALIZING;
+	}
+
+	tstate = _PyThreadState_GET();
+	context = tstate->detect_context;
+	if (context != NULL && context->is_analysing) {
+		return RUN_STATE_ANALYSING;
+	}
+
+	return state->run_state;
 }
 
 /**
@@ -72,6 +167,102 @@ int detect_config_get_runtime_timeout() {
 	return g_detect_runtime_config.detect_timeout;
 }
 
+/**
+ * @description: 获取检测内存限制
+ * @return int
+ */
+int detect_config_get_runtime_memory_limit() {
+	return g_detect_runtime_config.memory_limit;
+}
+
+/**
+ * @description: 获取立即给出恶意结论的证据得分阈值
+ * @return int
+ */
+int detect_config_get_runtime_score_threshold() {
+	return g_detect_runtime_config.score_threshold;
+}
+
+/**
+ * @description: 获取需要展平分支再检测的证据得分
+ * @return int
+ */
+int detect_config_get_runtime_second_pass_score() {
+	return g_detect_runtime_config.second_pass_score;
+}
+
+/**
+ * @description: 获取检测结论缓存文件的路径，未配置时为NULL
+ * @return const char*
+ */
+const char* detect_config_get_runtime_verdict_cache() {
+	return g_detect_runtime_config.verdict_cache;
+}
+
+/**
+ * @description: 获取采样profiler的输出文件路径，未配置时为NULL
+ * @return const char*
+ */
+const char* detect_config_get_runtime_profile() {
+	return g_detect_runtime_config.profile;
+}
+
+/**
+ * @description: 获取是否按字节码指纹复用同一家族样本的检测结论
+ * @return bool
+ */
+bool detect_config_get_runtime_is_fingerprint() {
+	return g_detect_runtime_config.is_fingerprint;
+}
+
+/**
+ * @description: 获取主脚本执行结束后是否探索未被调用过的函数
+ * @return bool
+ */
+bool detect_config_get_runtime_is_explore() {
+	return g_detect_runtime_config.is_explore;
+}
+
+/**
+ * @description: 获取执行前是否静态解码字符串常量并匹配恶意特征
+ * @return bool
+ */
+bool detect_config_get_runtime_is_static_decode() {
+	return g_detect_runtime_config.is_static_decode;
+}
+
+/**
+ * @description: 获取是否在进程内递归检测二阶段载荷
+ * @return bool
+ */
+bool detect_config_get_runtime_is_stage_scan() {
+	return g_detect_runtime_config.is_stage_scan;
+}
+
+/**
+ * @description: 获取是否内联执行multiprocessing的子进程和进程池任务
+ * @return bool
+ */
+bool detect_config_get_runtime_is_inline_process() {
+	return g_detect_runtime_config.is_inline_process;
+}
+
+/**
+ * @description: 获取是否以确定性的协作调度在主线程上执行threading的线程
+ * @return bool
+ */
+bool detect_config_get_runtime_is_virtual_thread() {
+	return g_detect_runtime_config.is_virtual_thread;
+}
+
+/**
+ * @description: 获取是否使用扫描内存模式
+ * @return bool
+ */
+bool detect_config_get_runtime_is_scan_memory() {
+	return g_detect_runtime_config.is_scan_memory;
+}
+
 /**
  * @description: 解析命令行选项-D传入的参数中的key-value
  * @param args -D选项的参数
@@ -81,12 +272,44 @@ static void detect_config_parse_cli_args_key_value(const char *key, const char *
 		g_detect_runtime_config.is_enable = !strcmp(value, "true") ? true : false;
 	} else if (!strcmp(key, "jump_branch")) {
 		g_detect_runtime_config.is_jump_branch = !strcmp(value, "true") ? true : false;
+	} else if (!strcmp(key, "virtual_io")) {
+		g_detect_runtime_config.is_virtual_io = !strcmp(value, "true") ? true : false;
+	} else if (!strcmp(key, "virtual_fs")) {
+		g_detect_runtime_config.is_virtual_fs = !strcmp(value, "true") ? true : false;
+	} else if (!strcmp(key, "batch")) {
+		g_detect_runtime_config.is_batch = !strcmp(value, "true") ? true : false;
+	} else if (!strcmp(key, "prefilter")) {
+		g_detect_runtime_config.is_prefilter = !strcmp(value, "true") ? true : false;
 	} else if (!strcmp(key, "run_mode")) {
 		g_detect_runtime_config.run_mode = !strcmp(value, "debug") ? RUN_MODE_DEBUG : RUN_MODE_RELEASE;
 	} else if (!strcmp(key, "detect_timeout")) {
 		g_detect_runtime_config.detect_timeout = atoi(value);
 	} else if (!strcmp(key, "memory_limit")) {
 		g_detect_runtime_config.memory_limit = atoi(value);
+	} else if (!strcmp(key, "score_threshold")) {
+		g_detect_runtime_config.score_threshold = atoi(value);
+	} else if (!strcmp(key, "second_pass_score")) {
+		g_detect_runtime_config.second_pass_score = atoi(value);
+	} else if (!strcmp(key, "fingerprint")) {
+		g_detect_runtime_config.is_fingerprint = !strcmp(value, "true") ? true : false;
+	} else if (!strcmp(key, "explore")) {
+		g_detect_runtime_config.is_explore = !strcmp(value, "true") ? true : false;
+	} else if (!strcmp(key, "static_decode")) {
+		g_detect_runtime_config.is_static_decode = !strcmp(value, "true") ? true : false;
+	} else if (!strcmp(key, "stage_scan")) {
+		g_detect_runtime_config.is_stage_scan = !strcmp(value, "true") ? true : false;
+	} else if (!strcmp(key, "inline_process")) {
+		g_detect_runtime_config.is_inline_process = !strcmp(value, "true") ? true : false;
+	} else if (!strcmp(key, "virtual_thread")) {
+		g_detect_runtime_config.is_virtual_thread = !strcmp(value, "true") ? true : false;
+	} else if (!strcmp(key, "scan_memory")) {
+		g_detect_runtime_config.is_scan_memory = !strcmp(value, "true") ? true : false;
+	} else if (!strcmp(key, "verdict_cache")) {
+		PyMem_RawFree(g_detect_runtime_config.verdict_cache);
+		g_detect_runtime_config.verdict_cache = _PyMem_RawStrdup(value);
+	} else if (!strcmp(key, "profile")) {
+		PyMem_RawFree(g_detect_runtime_config.profile);
+		g_detect_runtime_config.profile = _PyMem_RawStrdup(value);
 	} else {
 		/* 未知参数 */
 	}
@@ -136,6 +359,18 @@ void detect_config_parse_cli_args(const wchar_t *args) {
 	return;
 }
 
+/**
+ * @description: 收集外部输入、威胁、自定义和库函数摘要的全部配置项，用于计算规则集的版本
+ * @param rules_list 规则列表
+ * @return void
+ */
+void detect_config_collect_rules(PyObject *rules_list) {
+	detect_config_taint_input_def_collect_rules(rules_list);
+	detect_config_threat_def_collect_rules(rules_list);
+	detect_config_custom_def_collect_rules(rules_list);
+	detect_config_summary_def_collect_rules(rules_list);
+}
+
 /**
  * @description: 配置初始化
  */
@@ -149,5 +384,8 @@ void detect_config_init() {
 	/* 初始化自定义配置 */
 	detect_config_custom_def_init();
 
+	/* 初始化库函数摘要配置 */
+	detect_config_summary_def_init();
+
 	return;
 }
@@ -6,6 +6,10 @@
 #include "Detect/configs/custom_def.h"
 #include "Detect/configs/taint_input_def.h"
 #include "Detect/configs/threat_def.h"
+#include "Detect/configs/summary_def.h"
+
+/* 检测器版本，检测逻辑改变了同一脚本的结论时递增，使旧版本写入的结论缓存失效 */
+#define DETECT_VERSION "1.1.1"
 
 /* 检测模式 --- release or debug */
 typedef enum {
@@ -24,21 +28,52 @@ typedef enum {
 typedef struct {
 	bool is_enable;      // 是否开启detect检测模块
 	bool is_jump_branch; // 是否将分支展平
+	bool is_virtual_io;  // 是否开启虚拟时钟和虚拟I/O
+	bool is_virtual_fs;  // 是否开启虚拟文件系统，文件写入只作用于内存中的覆盖层
+	bool is_batch;       // 是否为批量扫描模式，此时执行的文件为样本路径清单
+	bool is_prefilter;   // 是否开启静态预过滤，不可能到达威胁调用的脚本直接给出正常结论
 	int detect_timeout;  // 检测超时
 	int memory_limit;    // 检测内存限制
+	int score_threshold;   // 证据得分达到该阈值时立即给出恶意结论并结束检测
+	int second_pass_score; // 证据得分达到该值时才需要展平分支再检测一次
+	char *verdict_cache;   // 检测结论缓存文件的路径，为NULL时不使用缓存
+	char *profile;         // 采样profiler输出folded stack的文件路径，为NULL时不开启采样
+	bool is_fingerprint;   // 是否按字节码指纹复用同一家族样本的恶意结论
+	bool is_explore;       // 主脚本执行结束后是否以taint参数调用从未被调用过的函数
+	bool is_static_decode; // 执行前是否解码字符串常量，解码结果含有恶意特征时直接给出恶意结论
+	bool is_stage_scan;    // 是否在进程内递归检测exec字符串和python命令行等二阶段载荷
+	bool is_inline_process; // 是否在当前解释器中内联执行multiprocessing的子进程和进程池任务
+	bool is_virtual_thread; // 是否以确定性的协作调度在主线程上执行threading的线程，不创建真实的线程
+	bool is_scan_memory;   // 是否使用扫描内存模式：小块分配来自bump arena，放宽分代回收，输出结论后直接退出
 	DETECT_RUN_MODE run_mode;   // 运行模式 --- release or debug
-	DETECT_RUN_STATE run_state; // 运行状态
 } DETECT_RUNTIME_CONFIG;
 
 extern void detect_config_set_runtime_is_enable(bool is_enable);
 extern bool detect_config_get_runtime_is_enable();
 extern bool detect_config_get_runtime_is_jump_branch();
+extern bool detect_config_get_runtime_is_virtual_io();
+extern bool detect_config_get_runtime_is_virtual_fs();
+extern bool detect_config_get_runtime_is_batch();
+extern bool detect_config_get_runtime_is_prefilter();
 extern bool detect_config_get_runtime_is_debug();
 extern DETECT_RUN_STATE detect_config_get_runtime_state();
 extern void detect_config_set_runtime_state(DETECT_RUN_STATE run_state);
 extern int detect_config_get_runtime_timeout();
+extern int detect_config_get_runtime_memory_limit();
+extern int detect_config_get_runtime_score_threshold();
+extern int detect_config_get_runtime_second_pass_score();
+extern const char* detect_config_get_runtime_verdict_cache();
+extern const char* detect_config_get_runtime_profile();
+extern bool detect_config_get_runtime_is_fingerprint();
+extern bool detect_config_get_runtime_is_explore();
+extern bool detect_config_get_runtime_is_static_decode();
+extern bool detect_config_get_runtime_is_stage_scan();
+extern bool detect_config_get_runtime_is_inline_process();
+extern bool detect_config_get_runtime_is_virtual_thread();
+extern bool detect_config_get_runtime_is_scan_memory();
 extern void detect_config_parse_cli_args(const wchar_t *args);
 extern void detect_config_init();
+extern void detect_config_collect_rules(PyObject *rules_list);
 
 #endif
 
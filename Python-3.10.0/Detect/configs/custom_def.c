@@ -8,7 +8,10 @@
 #include "pycore_pystate.h"
 #include "Detect/configs/custom_def.h"
 #include "Detect/object/object_common.h"
+#include "Detect/virtual/virtual_clock.h"
+#include "Detect/record/record.h"
 #include "Detect/utils/dict.h"
+#include "Detect/detect_state.h"
 
 /**
  * @description: 跳过当前处理逻辑的通用处理函数
@@ -25,6 +28,68 @@ static PyObject* detect_config_custom_skip_common(PyObject *self,
 	return detect_object_class_call(self, args, kwargs);
 }
 
+/**
+ * @description: time.sleep的自定义处理函数，不进行真实的睡眠，只推进虚拟时钟
+ * @param hook对象 hook对象
+ * @param callable 原被hook的调用对象
+ * @param args 位置参数元组
+ * @param kwargs 关键字参数字典
+ */
+static PyObject* detect_config_custom_virtual_sleep(PyObject *self,
+												PyObject *callable, 
+												PyObject *args,
+	  								            PyObject *kwargs) {
+	_PyTime_t secs;
+
+	/* 参数为外部输入等无法转换为时间的对象时，不推进虚拟时钟 */
+	if (PyTuple_Size(args) > 0) {
+		if (_PyTime_FromSecondsObject(&secs, PyTuple_GetItem(args, 0), _PyTime_ROUND_TIMEOUT)) {
+			PyErr_Clear();
+		} else {
+			detect_virtual_clock_advance(secs);
+		}
+	}
+
+	return detect_object_class_call(self, args, kwargs);
+}
+
+/**
+ * @description: socket.socketpair的自定义处理函数。asyncio等标准库在创建事件循环时使用socketpair
+ *               作为唤醒管道，而socket.socket已被hook为外部输入类，所以标准库中的调用直接创建
+ *               真实的_socket对象；被检测脚本中的调用仍按hook对象处理
+ * @param hook对象 hook对象
+ * @param callable 原被hook的调用对象
+ * @param args 位置参数元组
+ * @param kwargs 关键字参数字典
+ */
+static PyObject* detect_config_custom_lib_socketpair(PyObject *self,
+												PyObject *callable, 
+												PyObject *args,
+	  								            PyObject *kwargs) {
+	PyThreadState *tstate = _PyThreadState_GET();
+	PyObject *socket_module, *socketpair_func, *res;
+
+	if (detect_record_need_record(tstate, tstate->frame)) {
+		return detect_object_class_call(self, args, kwargs);
+	}
+
+	socket_module = PyImport_ImportModule("_socket");
+	if (socket_module == NULL) {
+		return NULL;
+	}
+
+	socketpair_func = PyObject_GetAttrString(socket_module, "socketpair");
+	Py_DECREF(socket_module);
+	if (socketpair_func == NULL) {
+		return NULL;
+	}
+
+	res = PyObject_Call(socketpair_func, args, kwargs);
+	Py_DECREF(socketpair_func);
+
+	return res;
+}
+
 /* 自定义类定义 */
 static DETECT_CUSTOM_DEF g_custom_class_def[] = {
 	
@@ -41,9 +106,13 @@ static DETECT_CUSTOM_DEF g_custom_func_def[] = {
 	{"os", NULL, NULL, "dup", detect_config_custom_skip_common},
 	{"os", NULL, NULL, "dup2", detect_config_custom_skip_common},
 	{"os", NULL, NULL, "exit", detect_config_custom_skip_common},
+	{"os", NULL, NULL, "_exit", detect_config_custom_skip_common},
 	{"os", NULL, NULL, "fork", detect_config_custom_skip_common},
 	{"sys", NULL, NULL, "exit", detect_config_custom_skip_common},
-	{"time", NULL, NULL, "sleep", detect_config_custom_skip_common},
+	{"time", NULL, NULL, "sleep", detect_config_custom_virtual_sleep},
+	{"socket", NULL, NULL, "getaddrinfo", detect_config_custom_skip_common},
+	{"socket", NULL, NULL, "gethostbyname", detect_config_custom_skip_common},
+	{"socket", NULL, NULL, "socketpair", detect_config_custom_lib_socketpair},
 	{"ctypes", NULL, NULL, "c_char_p", detect_config_custom_skip_common},
 	{"ctypes", NULL, NULL, "c_void_p", detect_config_custom_skip_common},
 	{"ctypes", NULL, NULL, "CFUNCTYPE", detect_config_custom_skip_common},
@@ -53,24 +122,18 @@ static DETECT_CUSTOM_DEF g_custom_func_def[] = {
 	{"importlib", NULL, NULL,  "reload", detect_config_custom_skip_common},
 };
 
-/* 下面这些字典全局变量供其他模块使用 */
-PyObject *g_custom_class_dict;  // 自定义类字典
-PyObject *g_custom_method_dict; // 自定义方法字典
-PyObject *g_custom_func_dict;   // 自定义函数字典
-
-PyObject *g_custom_all_dict;    // 包含上述四种自定义的集合字典
-
 /**
  * @description: 自定义配置初始化，主要是构建各外部输入对象的字典
  */
 void detect_config_custom_def_init() {
+	DETECT_STATE_T *state = detect_state_get();
 	unsigned int index;
 	PyObject *dict_tmp;
 
-	g_custom_class_dict  = PyDict_New();
-	g_custom_method_dict = PyDict_New();
-	g_custom_func_dict   = PyDict_New();
-	g_custom_all_dict    = PyDict_New();
+	state->custom_class_dict  = PyDict_New();
+	state->custom_method_dict = PyDict_New();
+	state->custom_func_dict   = PyDict_New();
+	state->custom_all_dict    = PyDict_New();
 
 	/* 
 	  初始化自定义类字典, key为"模块名-类名, 
@@ -132,3 +195,55 @@ void detect_config_custom_def_init() {
 	return ;
 }
 
+
+/**
+ * @description: 收集自定义配置项，用于计算规则集的版本
+ * @param rules_list 规则列表
+ * @return void
+ */
+void detect_config_custom_def_collect_rules(PyObject *rules_list) {
+	static DETECT_CUSTOM_DEF *tables[] = {g_custom_class_def, g_custom_method_def, g_custom_func_def};
+	static const unsigned int sizes[] = {
+		sizeof(g_custom_class_def)/sizeof(DETECT_CUSTOM_DEF),
+		sizeof(g_custom_method_def)/sizeof(DETECT_CUSTOM_DEF),
+		sizeof(g_custom_func_def)/sizeof(DETECT_CUSTOM_DEF),
+	};
+	DETECT_CUSTOM_DEF *item;
+	unsigned int table, index;
+
+	for (table = 0; table < sizeof(tables)/sizeof(tables[0]); table++) {
+		for (index = 0; index < sizes[table]; index++) {
+			item = &tables[table][index];
+			detect_config_append_rule(rules_list, "custom", item->module_name, item->class_name,
+									  item->method_name, item->func_name, NULL, table);
+		}
+	}
+}
+
+/**
+ * @description: 收集自定义配置中可调用对象的名字(类名、方法名、函数名)，用于静态预过滤。
+ *               例如os.dup2虽然不是威胁调用，但它是反弹shell的证据，不能被预过滤为正常
+ * @param names_set 名字集合
+ * @return void
+ */
+void detect_config_custom_def_collect_names(PyObject *names_set) {
+	static DETECT_CUSTOM_DEF *tables[] = {g_custom_class_def, g_custom_method_def, g_custom_func_def};
+	static const unsigned int sizes[] = {
+		sizeof(g_custom_class_def)/sizeof(DETECT_CUSTOM_DEF),
+		sizeof(g_custom_method_def)/sizeof(DETECT_CUSTOM_DEF),
+		sizeof(g_custom_func_def)/sizeof(DETECT_CUSTOM_DEF),
+	};
+	DETECT_CUSTOM_DEF *item;
+	unsigned int table, index;
+	PyObject *name;
+
+	for (table = 0; table < sizeof(tables)/sizeof(tables[0]); table++) {
+		for (index = 0; index < sizes[table]; index++) {
+			item = &tables[table][index];
+			name = PyUnicode_FromString(item->func_name ? item->func_name :
+										item->method_name ? item->method_name : item->class_name);
+			PySet_Add(names_set, name);
+			Py_DECREF(name);
+		}
+	}
+}
@@ -17,13 +17,16 @@ typedef struct _detect_custom_def {
 	custom_func pfunc;
 } DETECT_CUSTOM_DEF;
 
-PyObject *g_custom_class_dict;  // 自定义类字典
-PyObject *g_custom_method_dict; // 自定义方法字典
-PyObject *g_custom_func_dict;   // 自定义函数字典
+/* 配置字典保存在解释器级的detect状态中，使用处需要包含Detect/detect_state.h */
+#define g_custom_class_dict (detect_state_get_or_default()->custom_class_dict)  // 自定义类字典
+#define g_custom_method_dict (detect_state_get_or_default()->custom_method_dict) // 自定义方法字典
+#define g_custom_func_dict (detect_state_get_or_default()->custom_func_dict)   // 自定义函数字典
 
-PyObject *g_custom_all_dict;    // 包含上述四种威胁的集合字典
+#define g_custom_all_dict (detect_state_get_or_default()->custom_all_dict)    // 包含上述四种威胁的集合字典
 
 extern void detect_config_custom_def_init();
+extern void detect_config_custom_def_collect_rules(PyObject *rules_list);
+extern void detect_config_custom_def_collect_names(PyObject *names_set);
 
 #endif
 
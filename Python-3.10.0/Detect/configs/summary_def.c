@@ -0,0 +1,143 @@
+/*
+ * @Description: 库函数摘要定义。外部输入流入这些纯数据变换的标准库函数时，不再真实执行库函数，
+ *               直接按摘要将外部输入传播到返回值
+ */
+
+#include <stdio.h>
+#include "Python.h"
+#include "pycore_interp.h"
+#include "pycore_pystate.h"
+#include "Detect/configs/summary_def.h"
+#include "Detect/detect_state.h"
+
+/* 库函数摘要定义，模块名为函数的__module__，函数名为__qualname__ */
+static DETECT_SUMMARY_DEF g_summary_func_def[] = {
+	{"base64",       "b64decode",          {1}},
+	{"base64",       "b64encode",          {1}},
+	{"base64",       "standard_b64decode", {1}},
+	{"base64",       "standard_b64encode", {1}},
+	{"base64",       "urlsafe_b64decode",  {1}},
+	{"base64",       "urlsafe_b64encode",  {1}},
+	{"base64",       "b32decode",          {1}},
+	{"base64",       "b32encode",          {1}},
+	{"base64",       "b16decode",          {1}},
+	{"base64",       "b16encode",          {1}},
+	{"base64",       "b85decode",          {1}},
+	{"base64",       "b85encode",          {1}},
+	{"base64",       "a85decode",          {1}},
+	{"base64",       "a85encode",          {1}},
+	{"base64",       "decodebytes",        {1}},
+	{"base64",       "encodebytes",        {1}},
+	{"binascii",     "a2b_base64",         {1}},
+	{"binascii",     "b2a_base64",         {1}},
+	{"binascii",     "hexlify",            {1}},
+	{"binascii",     "unhexlify",          {1}},
+	{"binascii",     "a2b_hex",            {1}},
+	{"binascii",     "b2a_hex",            {1}},
+	{"zlib",         "compress",           {1}},
+	{"zlib",         "decompress",         {1}},
+	{"_codecs",      "decode",             {1}}, // codecs.decode为_codecs模块的C函数
+	{"_codecs",      "encode",             {1}},
+	{"json",         "loads",              {1}},
+	{"json",         "dumps",              {1}},
+	{"shlex",        "split",              {1}},
+	{"shlex",        "quote",              {1}},
+	{"shlex",        "join",               {1}},
+	{"urllib.parse", "quote",              {1}},
+	{"urllib.parse", "quote_plus",         {1}},
+	{"urllib.parse", "unquote",            {1}},
+	{"urllib.parse", "unquote_plus",       {1}},
+	{"urllib.parse", "urlencode",          {1}},
+	{"urllib.parse", "urlparse",           {1}},
+	{"urllib.parse", "urlsplit",           {1}},
+	{"urllib.parse", "urljoin",            {1, 2}},
+	{"urllib.parse", "parse_qs",           {1}},
+	{"urllib.parse", "parse_qsl",          {1}},
+	{"posixpath",    "join",               {-1}},
+	{"posixpath",    "basename",           {1}},
+	{"posixpath",    "dirname",            {1}},
+	{"posixpath",    "normpath",           {1}},
+	{"posixpath",    "abspath",            {1}},
+	{"posixpath",    "expanduser",         {1}},
+	{"html",         "escape",             {1}},
+	{"html",         "unescape",           {1}},
+	{"textwrap",     "dedent",             {1}},
+};
+
+/**
+ * @description: 库函数摘要配置初始化，构建摘要字典
+ */
+void detect_config_summary_def_init() {
+	unsigned int index;
+	PyObject *key, *pos_list;
+
+	/* 初始化库函数摘要字典，key为"模块名-函数名"，value为外部输入传播的参数位置列表 */
+	detect_state_get()->summary_func_dict = PyDict_New();
+
+	for (index = 0; index < sizeof(g_summary_func_def)/sizeof(DETECT_SUMMARY_DEF); index++) {
+		key      = PyUnicode_FromFormat("%s-%s", g_summary_func_def[index].module_name,
+											     g_summary_func_def[index].func_name);
+		pos_list = detect_config_create_pos_list(g_summary_func_def[index].taint_pos, MAX_POS);
+
+		PyDict_SetItem(g_summary_func_dict, key, pos_list);
+
+		Py_DECREF(key);
+		Py_DECREF(pos_list);
+	}
+
+	return ;
+}
+
+/**
+ * @description: 获取可调用对象的库函数摘要，只处理python函数和C扩展模块函数
+ * @param callable 可调用对象
+ * @return PyObject* 外部输入传播的参数位置列表(借用引用)，为NULL时代表没有摘要
+ */
+PyObject* detect_config_summary_def_get_taint_pos(PyObject *callable) {
+	PyObject *module_name, *func_name, *key, *pos_list;
+
+	if (g_summary_func_dict == NULL) {
+		return NULL;
+	}
+
+	if (PyFunction_Check(callable)) {
+		module_name = ((PyFunctionObject *)callable)->func_module;
+		func_name   = ((PyFunctionObject *)callable)->func_qualname;
+		if (module_name == NULL || !PyUnicode_Check(module_name) || !PyUnicode_Check(func_name)) {
+			return NULL;
+		}
+		key = PyUnicode_FromFormat("%U-%U", module_name, func_name);
+	} else if (PyCFunction_Check(callable)) {
+		module_name = ((PyCFunctionObject *)callable)->m_module;
+		if (module_name == NULL || !PyUnicode_Check(module_name)) {
+			return NULL;
+		}
+		key = PyUnicode_FromFormat("%U-%s", module_name, ((PyCFunctionObject *)callable)->m_ml->ml_name);
+	} else {
+		return NULL;
+	}
+
+	if (key == NULL) {
+		PyErr_Clear();
+		return NULL;
+	}
+
+	pos_list = PyDict_GetItemWithError(g_summary_func_dict, key);
+	Py_DECREF(key);
+
+	return pos_list;
+}
+
+/**
+ * @description: 收集库函数摘要配置项，用于计算规则集的版本
+ * @param rules_list 规则列表
+ * @return void
+ */
+void detect_config_summary_def_collect_rules(PyObject *rules_list) {
+	unsigned int index;
+
+	for (index = 0; index < sizeof(g_summary_func_def)/sizeof(DETECT_SUMMARY_DEF); index++) {
+		detect_config_append_rule(rules_list, "summary", g_summary_func_def[index].module_name, NULL, NULL,
+								  g_summary_func_def[index].func_name, g_summary_func_def[index].taint_pos, 0);
+	}
+}
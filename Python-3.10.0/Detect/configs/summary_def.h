@@ -0,0 +1,22 @@
+#ifndef DETECT_CONFIGS_SUMMARY_DEF_H
+#define DETECT_CONFIGS_SUMMARY_DEF_H
+
+#include "stdbool.h"
+#include "Python.h"
+#include "Detect/configs/common.h"
+
+/* 库函数摘要定义，外部输入从taint_pos位置的参数直接传播到返回值 */
+typedef struct _detect_summary_def {
+	const char *module_name;
+	const char *func_name;
+	int taint_pos[MAX_POS]; // 外部输入传播的参数位置，-1代表任意位置
+} DETECT_SUMMARY_DEF;
+
+/* 配置字典保存在解释器级的detect状态中，使用处需要包含Detect/detect_state.h */
+#define g_summary_func_dict (detect_state_get_or_default()->summary_func_dict) // 库函数摘要字典
+
+extern void detect_config_summary_def_init();
+extern void detect_config_summary_def_collect_rules(PyObject *rules_list);
+extern PyObject* detect_config_summary_def_get_taint_pos(PyObject *callable);
+
+#endif
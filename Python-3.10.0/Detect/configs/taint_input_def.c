@@ -8,6 +8,7 @@
 #include "pycore_pystate.h"
 #include "Detect/configs/taint_input_def.h"
 #include "Detect/utils/dict.h"
+#include "Detect/detect_state.h"
 
 /* 外部输入类定义 */
 static DETECT_TAINT_INPUT g_taint_input_class_def[] = {
@@ -28,6 +29,10 @@ static DETECT_TAINT_INPUT g_taint_input_method_def[] = {
 /* 外部输入函数定义 */
 static DETECT_TAINT_INPUT g_taint_input_func_def[] = {
 	{"socket",         NULL, NULL, "create_server", NULL, {0}},
+	{"socket",         NULL, NULL, "create_connection", NULL, {0}},
+	{"asyncio",        NULL, NULL, "open_connection",      NULL, {0}},
+	{"asyncio",        NULL, NULL, "open_unix_connection", NULL, {0}},
+	{"asyncio",        NULL, NULL, "start_server",         NULL, {0}},
 	{"builtins",       NULL, NULL, "input",         NULL, {0}},
 	{"builtins",       NULL, NULL, "raw_input",     NULL, {0}},
 	{"requests",       NULL, NULL, "post",          NULL, {0}},
@@ -47,26 +52,19 @@ static DETECT_TAINT_INPUT g_taint_input_var_def[] = {
 	{"os",     NULL, NULL, NULL, "environ", {0}},
 };
 
-/* 下面这些字典全局变量供其他模块使用 */
-PyObject *g_taint_input_class_dict;  // 外部输入类字典
-PyObject *g_taint_input_method_dict; // 外部输入方法字典
-PyObject *g_taint_input_func_dict;   // 外部输入函数字典
-PyObject *g_taint_input_var_dict;    // 外部输入变量字典
-
-PyObject *g_taint_input_all_dict;    // 包含上述四种外部输入的集合字典
-
 /**
  * @description: 外部输入初始化，主要是构建各外部输入对象的字典
  */
 void detect_config_taint_input_def_init() {
+	DETECT_STATE_T *state = detect_state_get();
 	unsigned int index;
 	PyObject *dict_tmp;
 
-	g_taint_input_class_dict  = PyDict_New();
-	g_taint_input_method_dict = PyDict_New();
-	g_taint_input_func_dict   = PyDict_New();
-	g_taint_input_var_dict    = PyDict_New();
-	g_taint_input_all_dict    = PyDict_New();
+	state->taint_input_class_dict  = PyDict_New();
+	state->taint_input_method_dict = PyDict_New();
+	state->taint_input_func_dict   = PyDict_New();
+	state->taint_input_var_dict    = PyDict_New();
+	state->taint_input_all_dict    = PyDict_New();
 
 	/* 
 	  初始化外部输入类字典, key为"模块名-类名, 
@@ -155,3 +153,60 @@ void detect_config_taint_input_def_init() {
 
 	return ;
 }
+
+/**
+ * @description: 收集外部输入配置项，用于计算规则集的版本
+ * @param rules_list 规则列表
+ * @return void
+ */
+void detect_config_taint_input_def_collect_rules(PyObject *rules_list) {
+	static DETECT_TAINT_INPUT *tables[] = {g_taint_input_class_def, g_taint_input_method_def,
+										   g_taint_input_func_def, g_taint_input_var_def};
+	static const unsigned int sizes[] = {
+		sizeof(g_taint_input_class_def)/sizeof(DETECT_TAINT_INPUT),
+		sizeof(g_taint_input_method_def)/sizeof(DETECT_TAINT_INPUT),
+		sizeof(g_taint_input_func_def)/sizeof(DETECT_TAINT_INPUT),
+		sizeof(g_taint_input_var_def)/sizeof(DETECT_TAINT_INPUT),
+	};
+	DETECT_TAINT_INPUT *item;
+	unsigned int table, index;
+
+	for (table = 0; table < sizeof(tables)/sizeof(tables[0]); table++) {
+		for (index = 0; index < sizes[table]; index++) {
+			item = &tables[table][index];
+			detect_config_append_rule(rules_list, "taint", item->module_name, item->class_name,
+									  item->method_name, item->func_name ? item->func_name : item->var_name,
+									  item->taint_pos, table);
+		}
+	}
+}
+
+/**
+ * @description: 收集外部输入配置中对象的名字(类名、方法名、函数名、变量名)，用于静态预过滤
+ * @param names_set 名字集合
+ * @return void
+ */
+void detect_config_taint_input_def_collect_names(PyObject *names_set) {
+	static DETECT_TAINT_INPUT *tables[] = {g_taint_input_class_def, g_taint_input_method_def,
+										   g_taint_input_func_def, g_taint_input_var_def};
+	static const unsigned int sizes[] = {
+		sizeof(g_taint_input_class_def)/sizeof(DETECT_TAINT_INPUT),
+		sizeof(g_taint_input_method_def)/sizeof(DETECT_TAINT_INPUT),
+		sizeof(g_taint_input_func_def)/sizeof(DETECT_TAINT_INPUT),
+		sizeof(g_taint_input_var_def)/sizeof(DETECT_TAINT_INPUT),
+	};
+	DETECT_TAINT_INPUT *item;
+	unsigned int table, index;
+	PyObject *name;
+
+	for (table = 0; table < sizeof(tables)/sizeof(tables[0]); table++) {
+		for (index = 0; index < sizes[table]; index++) {
+			item = &tables[table][index];
+			name = PyUnicode_FromString(item->var_name ? item->var_name :
+										item->func_name ? item->func_name :
+										item->method_name ? item->method_name : item->class_name);
+			PySet_Add(names_set, name);
+			Py_DECREF(name);
+		}
+	}
+}
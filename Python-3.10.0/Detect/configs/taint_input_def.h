@@ -14,13 +14,16 @@ typedef struct _detect_taint_input {
 	int taint_pos[MAX_POS]; // 返回的外部输入的位置: 0 --- 返回值，1 --- 第一个参数，...
 } DETECT_TAINT_INPUT;
 
-extern PyObject *g_taint_input_class_dict;  // 外部输入类字典
-extern PyObject *g_taint_input_method_dict; // 外部输入方法字典
-extern PyObject *g_taint_input_func_dict;   // 外部输入函数字典
-extern PyObject *g_taint_input_var_dict;    // 外部输入变量字典
-extern PyObject *g_taint_input_all_dict;    // 包含上述四种外部输入的集合字典
+/* 配置字典保存在解释器级的detect状态中，使用处需要包含Detect/detect_state.h */
+#define g_taint_input_class_dict (detect_state_get_or_default()->taint_input_class_dict)  // 外部输入类字典
+#define g_taint_input_method_dict (detect_state_get_or_default()->taint_input_method_dict) // 外部输入方法字典
+#define g_taint_input_func_dict (detect_state_get_or_default()->taint_input_func_dict)   // 外部输入函数字典
+#define g_taint_input_var_dict (detect_state_get_or_default()->taint_input_var_dict)    // 外部输入变量字典
+#define g_taint_input_all_dict (detect_state_get_or_default()->taint_input_all_dict)    // 包含上述四种外部输入的集合字典
 
 extern void detect_config_taint_input_def_init();
+extern void detect_config_taint_input_def_collect_rules(PyObject *rules_list);
+extern void detect_config_taint_input_def_collect_names(PyObject *names_set);
 
 #endif
 
@@ -8,6 +8,7 @@
 #include "pycore_pystate.h"
 #include "Detect/configs/threat_def.h"
 #include "Detect/utils/dict.h"
+#include "Detect/detect_state.h"
 
 /* 威胁类定义 */
 static DETECT_THREAT_DEF g_threat_class_def[] = {
@@ -50,10 +51,13 @@ static DETECT_THREAT_DEF g_threat_func_def[] = {
 	{"os",         NULL, NULL, "execle",          {1, 2}, DETECT_THREAT_TYPE_COMMAND_EXEC},
 	{"os",         NULL, NULL, "execl",           {1, 2}, DETECT_THREAT_TYPE_COMMAND_EXEC},
 	{"pty",        NULL, NULL, "spawn",           {1},    DETECT_THREAT_TYPE_COMMAND_EXEC},
+	{"asyncio",    NULL, NULL, "create_subprocess_shell", {1},    DETECT_THREAT_TYPE_COMMAND_EXEC},
+	{"asyncio",    NULL, NULL, "create_subprocess_exec",  {1, 2}, DETECT_THREAT_TYPE_COMMAND_EXEC},
 	{"popen2",     NULL, NULL, "popen2",          {1},    DETECT_THREAT_TYPE_COMMAND_EXEC},
 	{"popen2",     NULL, NULL, "popen3",          {1},    DETECT_THREAT_TYPE_COMMAND_EXEC},
 	{"popen2",     NULL, NULL, "popen4",          {1},    DETECT_THREAT_TYPE_COMMAND_EXEC},
 	{"scapy.all",  NULL, NULL, "sniff",          {1},    DETECT_THREAT_TYPE_COMMAND_EXEC},
+	{"_xxsubinterpreters", NULL, NULL, "run_string", {2}, DETECT_THREAT_TYPE_CODE_EXEC}, // 子解释器中没有detect状态，代码在当前解释器中作为阶段执行
 	{"builtins",   NULL, NULL, "eval",            {1},  DETECT_THREAT_TYPE_CODE_EXEC, true}, // 执行原逻辑
 	{"builtins",   NULL, NULL, "exec",            {-1}, DETECT_THREAT_TYPE_CODE_EXEC, true}, // 执行原逻辑
 	//{"builtins",   NULL, NULL, "__import__",      {-1}, DETECT_THREAT_TYPE_CODE_EXEC, true}, // 该函数会将未定义模块置为威胁对象导致误报
@@ -66,13 +70,6 @@ static DETECT_THREAT_DEF g_threat_func_def[] = {
 	
 };
 
-/* 下面这些字典全局变量供其他模块使用 */
-PyObject *g_threat_class_dict;  // 威胁类字典
-PyObject *g_threat_method_dict; // 威胁方法字典
-PyObject *g_threat_func_dict;   // 威胁函数字典
-
-PyObject *g_threat_all_dict;    // 包含上述四种威胁的集合字典
-
 
 /**
  * @description: 初始化一个威胁字典的公共域
@@ -93,13 +90,14 @@ static void detect_config_construct_threat_dict_common_fields(PyObject *dict,
  * @description: 威胁配置初始化，主要是构建各外部输入对象的字典
  */
 void detect_config_threat_def_init() {
+	DETECT_STATE_T *state = detect_state_get();
 	unsigned int index;
 	PyObject *dict_tmp;
 
-	g_threat_class_dict  = PyDict_New();
-	g_threat_method_dict = PyDict_New();
-	g_threat_func_dict   = PyDict_New();
-	g_threat_all_dict    = PyDict_New();
+	state->threat_class_dict  = PyDict_New();
+	state->threat_method_dict = PyDict_New();
+	state->threat_func_dict   = PyDict_New();
+	state->threat_all_dict    = PyDict_New();
 
 	/* 
 	  初始化威胁类字典, key为"模块名-类名, 
@@ -158,3 +156,84 @@ void detect_config_threat_def_init() {
 	return ;
 }
 
+/**
+ * @description: 收集威胁配置中可调用对象的名字(类名、方法名、函数名)，用于静态预过滤
+ * @param names_set 名字集合
+ * @return void
+ */
+void detect_config_threat_def_collect_names(PyObject *names_set) {
+	unsigned int index;
+	PyObject *name;
+
+	for (index = 0; index < sizeof(g_threat_class_def)/sizeof(DETECT_THREAT_DEF); index++) {
+		name = PyUnicode_FromString(g_threat_class_def[index].class_name);
+		PySet_Add(names_set, name);
+		Py_DECREF(name);
+	}
+
+	for (index = 0; index < sizeof(g_threat_method_def)/sizeof(DETECT_THREAT_DEF); index++) {
+		name = PyUnicode_FromString(g_threat_method_def[index].method_name);
+		PySet_Add(names_set, name);
+		Py_DECREF(name);
+	}
+
+	for (index = 0; index < sizeof(g_threat_func_def)/sizeof(DETECT_THREAT_DEF); index++) {
+		name = PyUnicode_FromString(g_threat_func_def[index].func_name);
+		PySet_Add(names_set, name);
+		Py_DECREF(name);
+	}
+}
+
+/**
+ * @description: 判断模块是否包含威胁配置中的可调用对象
+ * @param module_name 模块名
+ * @return bool
+ */
+bool detect_config_threat_def_is_threat_module(PyObject *module_name) {
+	static DETECT_THREAT_DEF *tables[] = {g_threat_class_def, g_threat_method_def, g_threat_func_def};
+	static const unsigned int sizes[] = {
+		sizeof(g_threat_class_def)/sizeof(DETECT_THREAT_DEF),
+		sizeof(g_threat_method_def)/sizeof(DETECT_THREAT_DEF),
+		sizeof(g_threat_func_def)/sizeof(DETECT_THREAT_DEF),
+	};
+	unsigned int table, index;
+
+	if (!PyUnicode_Check(module_name)) {
+		return false;
+	}
+
+	for (table = 0; table < sizeof(tables)/sizeof(tables[0]); table++) {
+		for (index = 0; index < sizes[table]; index++) {
+			if (_PyUnicode_EqualToASCIIString(module_name, tables[table][index].module_name)) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @description: 收集威胁配置项，用于计算规则集的版本
+ * @param rules_list 规则列表
+ * @return void
+ */
+void detect_config_threat_def_collect_rules(PyObject *rules_list) {
+	static DETECT_THREAT_DEF *tables[] = {g_threat_class_def, g_threat_method_def, g_threat_func_def};
+	static const unsigned int sizes[] = {
+		sizeof(g_threat_class_def)/sizeof(DETECT_THREAT_DEF),
+		sizeof(g_threat_method_def)/sizeof(DETECT_THREAT_DEF),
+		sizeof(g_threat_func_def)/sizeof(DETECT_THREAT_DEF),
+	};
+	DETECT_THREAT_DEF *item;
+	unsigned int table, index;
+
+	for (table = 0; table < sizeof(tables)/sizeof(tables[0]); table++) {
+		for (index = 0; index < sizes[table]; index++) {
+			item = &tables[table][index];
+			detect_config_append_rule(rules_list, "threat", item->module_name, item->class_name,
+									  item->method_name, item->func_name, item->param_pos,
+									  item->threat_type * 2 + item->need_execute);
+		}
+	}
+}
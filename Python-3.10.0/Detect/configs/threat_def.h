@@ -24,13 +24,17 @@ typedef struct _detect_threat_def {
 	bool need_execute;                // 是否需要执行原处理逻辑，默认为false，即不执行
 } DETECT_THREAT_DEF;
 
-PyObject *g_threat_class_dict;  // 威胁类字典
-PyObject *g_threat_method_dict; // 威胁方法字典
-PyObject *g_threat_func_dict;   // 威胁函数字典
+/* 配置字典保存在解释器级的detect状态中，使用处需要包含Detect/detect_state.h */
+#define g_threat_class_dict (detect_state_get_or_default()->threat_class_dict)  // 威胁类字典
+#define g_threat_method_dict (detect_state_get_or_default()->threat_method_dict) // 威胁方法字典
+#define g_threat_func_dict (detect_state_get_or_default()->threat_func_dict)   // 威胁函数字典
 
-PyObject *g_threat_all_dict;    // 包含上述四种威胁的集合字典
+#define g_threat_all_dict (detect_state_get_or_default()->threat_all_dict)    // 包含上述四种威胁的集合字典
 
 extern void detect_config_threat_def_init();
+extern void detect_config_threat_def_collect_names(PyObject *names_set);
+extern bool detect_config_threat_def_is_threat_module(PyObject *module_name);
+extern void detect_config_threat_def_collect_rules(PyObject *rules_list);
 
 #endif
 
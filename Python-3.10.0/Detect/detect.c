@@ -18,6 +18,8 @@
 #include "Detect/object/object.h"
 #include "Detect/hook/hook.h"
 #include "Detect/analysis/analysis.h"
+#include "Detect/detect_state.h"
+#include "Detect/detect_profile.h"
 
 /**
   * @description: 检查是否需要使能detect恶意脚本检测模块。当编译python时，
@@ -48,17 +50,26 @@ static bool detect_check_if_enable_detect_module() {
 }
 
  /**
-  * @description: detect初始化函数
+  * @description: detect初始化函数，为当前解释器创建detect状态并完成各模块初始化，
+  *               每个(子)解释器都需要单独初始化一次
   * @return void
   */
  int detect_init() {
 	int ret = 0;
-	static bool has_init = false; // 该变量保证只初始化一次
+	DETECT_STATE_T *state;
  
-	if (has_init || !detect_check_if_enable_detect_module()) {
+	if (!detect_check_if_enable_detect_module()) {
 		return ret;
 	}
 
+	/* 该状态保证每个解释器只初始化一次 */
+	state = detect_state_create();
+	if (state == NULL || state->has_init) {
+		return ret;
+	}
+
+	/* 采样profiler按进程开启，初始化阶段的模块导入也计入采样；批量扫描时只在第一个样本初始化时开启 */
+	detect_profile_start();
 	 
 	/* 配置初始化 */
 	detect_config_init();
@@ -73,8 +84,7 @@ static bool detect_check_if_enable_detect_module() {
 	detect_analysis_init();
 
 
-	has_init = true;
+	state->has_init = true;
  
 	return ret;
  }
-
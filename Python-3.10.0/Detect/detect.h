@@ -1,6 +1,15 @@
 #ifndef DETECT_H
 #define DETECT_H
 
+#include "Detect/detect_scan.h"
+#include "Detect/detect_archive.h"
+#include "Detect/detect_memory.h"
+#include "Detect/detect_profile.h"
+#include "Detect/analysis/analysis_prescan.h"
+#include "Detect/analysis/analysis.h"
+#include "Detect/analysis/analysis_cache.h"
+#include "Detect/analysis/analysis_explore.h"
+
 extern void detect_init();
 
 #endif
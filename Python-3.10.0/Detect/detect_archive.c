@@ -0,0 +1,320 @@
+/*
+ * @Description: 压缩包扫描。sdist和wheel等压缩包不解压到磁盘，在主解释器中流式枚举成员，
+ *               入口脚本读入内存后以"压缩包路径/成员路径"的虚拟路径在子解释器中检测
+ */
+
+#include "Python.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "Detect/analysis/analysis_common.h"
+#include "Detect/detect_scan.h"
+#include "Detect/detect_archive.h"
+
+/* 单个成员的最大长度，超过时不检测，防止压缩炸弹耗尽内存 */
+#define DETECT_ARCHIVE_MEMBER_MAX_SIZE (4 * 1024 * 1024)
+
+/* 未检测的成员或压缩包在检测结果字典中的key，值为未检测的原因 */
+#define UNSCANNED_STRING "Unscanned"
+
+/* 支持的压缩包后缀 */
+static const wchar_t *g_archive_suffix[] = {
+	L".zip", L".whl", L".egg", L".tar", L".tar.gz", L".tgz", L".tar.bz2", L".tar.xz", NULL
+};
+
+/* 需要检测的入口脚本，安装和导入压缩包时会自动执行这些脚本 */
+static const char *g_archive_entry_point[] = {
+	"setup.py", "__init__.py", "__main__.py", NULL
+};
+
+/**
+ * @description: 根据后缀判断文件是否为支持的压缩包
+ * @param filename 文件路径
+ * @return bool
+ */
+bool detect_archive_is_archive(const wchar_t *filename) {
+	size_t len = wcslen(filename), suffix_len;
+	const wchar_t **suffix;
+
+	for (suffix = g_archive_suffix; *suffix != NULL; suffix++) {
+		suffix_len = wcslen(*suffix);
+		if (len > suffix_len && !wcscmp(filename + len - suffix_len, *suffix)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @description: 判断压缩包成员是否为需要检测的入口脚本
+ * @param name 成员路径
+ * @return bool
+ */
+static bool detect_archive_is_entry_point(const char *name) {
+	const char *basename = strrchr(name, '/');
+	const char **entry_point;
+
+	basename = basename != NULL ? basename + 1 : name;
+
+	for (entry_point = g_archive_entry_point; *entry_point != NULL; entry_point++) {
+		if (!strcmp(basename, *entry_point)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @description: 输出未检测的成员或压缩包的结果。这类结果不是检测结论，包装脚本把它视为可疑
+ * @param path 成员的虚拟路径或者压缩包路径
+ * @param reason 未检测的原因
+ * @return void
+ */
+static void detect_archive_print_unscanned(PyObject *path, const char *reason) {
+	PyObject *result_dict, *reason_obj;
+
+	result_dict = PyDict_New();
+	reason_obj  = PyUnicode_FromString(reason);
+	if (result_dict != NULL && reason_obj != NULL &&
+		PyDict_SetItemString(result_dict, FILENAME_STRING, path) == 0 &&
+		PyDict_SetItemString(result_dict, MALICIOUS_STRING, Py_False) == 0 &&
+		PyDict_SetItemString(result_dict, UNSCANNED_STRING, reason_obj) == 0) {
+		PyObject_Print(result_dict, stdout, Py_PRINT_RAW);
+		fprintf(stdout, "\n");
+		fflush(stdout);
+	}
+
+	Py_XDECREF(result_dict);
+	Py_XDECREF(reason_obj);
+	PyErr_Clear();
+}
+
+/**
+ * @description: 检测压缩包中的单个成员并输出检测结果，成员无法检测时输出未检测的结果
+ * @param archive 压缩包路径
+ * @param name 成员路径
+ * @param data 成员内容，bytes对象；为NULL时表示成员无法读取
+ * @param size 成员解压后的长度
+ * @return void
+ */
+static void detect_archive_scan_member(PyObject *archive, PyObject *name, PyObject *data, Py_ssize_t size) {
+	PyObject *virtual_path;
+	wchar_t *filename;
+	char *source, *result = NULL;
+
+	virtual_path = PyUnicode_FromFormat("%U/%U", archive, name);
+	if (virtual_path == NULL) {
+		PyErr_Clear();
+		return;
+	}
+
+	if (size < 0 || size > DETECT_ARCHIVE_MEMBER_MAX_SIZE) {
+		detect_archive_print_unscanned(virtual_path, "Member too large");
+		Py_DECREF(virtual_path);
+		return;
+	}
+	if (data == NULL || !PyBytes_Check(data)) {
+		detect_archive_print_unscanned(virtual_path, "Member unreadable");
+		Py_DECREF(virtual_path);
+		return;
+	}
+
+	filename = PyUnicode_AsWideCharString(virtual_path, NULL);
+	if (filename == NULL) {
+		PyErr_Clear();
+		detect_archive_print_unscanned(virtual_path, "Member unreadable");
+		Py_DECREF(virtual_path);
+		return;
+	}
+
+	/* 成员内容拷贝到原始内存中，python对象不能跨解释器使用 */
+	size = PyBytes_GET_SIZE(data);
+	source = PyMem_RawMalloc(size + 1);
+	if (source != NULL) {
+		memcpy(source, PyBytes_AS_STRING(data), size);
+		source[size] = '\0';
+
+		result = detect_scan_source(filename, source, size);
+		PyMem_RawFree(source);
+	}
+
+	if (result != NULL) {
+		fprintf(stdout, "%s\n", result);
+		fflush(stdout);
+		PyMem_RawFree(result);
+	} else {
+		detect_archive_print_unscanned(virtual_path, "Member scan failed");
+	}
+
+	PyMem_Free(filename);
+	Py_DECREF(virtual_path);
+}
+
+/**
+ * @description: 枚举zip格式压缩包(.zip/.whl/.egg)的成员，zip的中央目录位于文件尾部，只读取入口脚本的内容
+ * @param archive 压缩包路径
+ * @return int 输出了结果的入口脚本数量，-1 --- 压缩包无法打开
+ */
+static int detect_archive_scan_zip(PyObject *archive) {
+	PyObject *zipfile_module, *zip, *infolist, *info, *name, *file_size, *data;
+	const char *name_str;
+	Py_ssize_t index, size;
+	int count = 0;
+
+	zipfile_module = PyImport_ImportModule("zipfile");
+	if (zipfile_module == NULL) {
+		return -1;
+	}
+
+	zip = PyObject_CallMethod(zipfile_module, "ZipFile", "O", archive);
+	Py_DECREF(zipfile_module);
+	if (zip == NULL) {
+		return -1;
+	}
+
+	infolist = PyObject_CallMethod(zip, "infolist", NULL);
+	if (infolist == NULL || !PyList_Check(infolist)) {
+		Py_XDECREF(infolist);
+		Py_DECREF(zip);
+		return -1;
+	}
+
+	for (index = 0; index < PyList_GET_SIZE(infolist); index++) {
+		info = PyList_GET_ITEM(infolist, index);
+
+		name = PyObject_GetAttrString(info, "filename");
+		file_size = PyObject_GetAttrString(info, "file_size");
+		name_str = name != NULL ? PyUnicode_AsUTF8(name) : NULL;
+
+		/* 超过最大长度的入口脚本不读取内容，同样输出未检测的结果 */
+		if (name_str != NULL && file_size != NULL && detect_archive_is_entry_point(name_str)) {
+			size = PyLong_AsSsize_t(file_size);
+			data = size >= 0 && size <= DETECT_ARCHIVE_MEMBER_MAX_SIZE ?
+				   PyObject_CallMethod(zip, "read", "O", info) : NULL;
+			PyErr_Clear();
+			detect_archive_scan_member(archive, name, data, size);
+			Py_XDECREF(data);
+			count++;
+		}
+
+		Py_XDECREF(name);
+		Py_XDECREF(file_size);
+		PyErr_Clear();
+	}
+
+	Py_DECREF(infolist);
+	Py_XDECREF(PyObject_CallMethod(zip, "close", NULL));
+	Py_DECREF(zip);
+	PyErr_Clear();
+
+	return count;
+}
+
+/**
+ * @description: 以流模式枚举tar格式压缩包(.tar/.tar.gz/.tgz/.tar.bz2/.tar.xz)的成员，
+ *               只顺序解压一遍，成员内容在读取下一个成员之前读入内存
+ * @param archive 压缩包路径
+ * @return int 输出了结果的入口脚本数量，-1 --- 压缩包无法打开
+ */
+static int detect_archive_scan_tar(PyObject *archive) {
+	PyObject *tarfile_module, *tar, *member, *name, *size, *is_file, *fileobj, *data;
+	const char *name_str;
+	Py_ssize_t member_size;
+	int count = 0;
+
+	tarfile_module = PyImport_ImportModule("tarfile");
+	if (tarfile_module == NULL) {
+		return -1;
+	}
+
+	/* "r|*"为流模式，自动识别压缩格式，不支持随机访问 */
+	tar = PyObject_CallMethod(tarfile_module, "open", "Os", archive, "r|*");
+	Py_DECREF(tarfile_module);
+	if (tar == NULL) {
+		return -1;
+	}
+
+	while ((member = PyObject_CallMethod(tar, "next", NULL)) != NULL && member != Py_None) {
+		name = PyObject_GetAttrString(member, "name");
+		size = PyObject_GetAttrString(member, "size");
+		is_file = PyObject_CallMethod(member, "isfile", NULL);
+		name_str = name != NULL ? PyUnicode_AsUTF8(name) : NULL;
+
+		if (name_str != NULL && size != NULL && is_file == Py_True && detect_archive_is_entry_point(name_str)) {
+			member_size = PyLong_AsSsize_t(size);
+			fileobj = NULL;
+			data = NULL;
+			if (member_size >= 0 && member_size <= DETECT_ARCHIVE_MEMBER_MAX_SIZE) {
+				fileobj = PyObject_CallMethod(tar, "extractfile", "O", member);
+				data = fileobj != NULL && fileobj != Py_None ? PyObject_CallMethod(fileobj, "read", NULL) : NULL;
+			}
+			PyErr_Clear();
+			detect_archive_scan_member(archive, name, data, member_size);
+			Py_XDECREF(data);
+			Py_XDECREF(fileobj);
+			count++;
+		}
+
+		Py_XDECREF(name);
+		Py_XDECREF(size);
+		Py_XDECREF(is_file);
+		Py_DECREF(member);
+		PyErr_Clear();
+	}
+
+	Py_XDECREF(member);
+	Py_XDECREF(PyObject_CallMethod(tar, "close", NULL));
+	Py_DECREF(tar);
+	PyErr_Clear();
+
+	return count;
+}
+
+/**
+ * @description: 扫描压缩包中的入口脚本，每个成员的检测结果按行输出到标准输出。超过最大长度或者无法检测的
+ *               入口脚本、以及没有入口脚本的压缩包输出带Unscanned的结果。调用方需持有GIL
+ * @param archive 压缩包路径
+ * @return int 进程退出码
+ */
+int detect_archive_scan(const wchar_t *archive) {
+	PyObject *archive_obj, *zipfile_module, *is_zipfile;
+	int ret = -1;
+
+	archive_obj = PyUnicode_FromWideChar(archive, -1);
+	zipfile_module = PyImport_ImportModule("zipfile");
+	if (archive_obj == NULL || zipfile_module == NULL) {
+		Py_XDECREF(archive_obj);
+		Py_XDECREF(zipfile_module);
+		PyErr_Clear();
+		return 2;
+	}
+
+	/* 按文件内容而不是后缀判断格式，wheel和egg都是zip格式 */
+	is_zipfile = PyObject_CallMethod(zipfile_module, "is_zipfile", "O", archive_obj);
+	Py_DECREF(zipfile_module);
+
+	if (is_zipfile == Py_True) {
+		ret = detect_archive_scan_zip(archive_obj);
+	} else if (is_zipfile == Py_False) {
+		ret = detect_archive_scan_tar(archive_obj);
+	}
+
+	Py_XDECREF(is_zipfile);
+	PyErr_Clear();
+
+	if (ret < 0) {
+		fprintf(stderr, "detect: can't open archive '%ls'\n", archive);
+		Py_DECREF(archive_obj);
+		return 2;
+	}
+
+	/* 没有入口脚本时同样输出结果，不能让压缩包没有任何输出 */
+	if (ret == 0) {
+		detect_archive_print_unscanned(archive_obj, "No entry point");
+	}
+	Py_DECREF(archive_obj);
+
+	return 0;
+}
@@ -0,0 +1,10 @@
+#ifndef DETECT_DETECT_ARCHIVE_H
+#define DETECT_DETECT_ARCHIVE_H
+
+#include <stdbool.h>
+#include <wchar.h>
+
+extern bool detect_archive_is_archive(const wchar_t *filename);
+extern int detect_archive_scan(const wchar_t *archive);
+
+#endif
@@ -0,0 +1,73 @@
+/*
+ * @Description: detect模块的线程级上下文。记录信息、frame过滤缓存、污染区栈以及分析状态
+ *               按线程保存，跨线程的事实通过解释器级的证据库合并
+ */
+
+#include <stdbool.h>
+#include "Python.h"
+#include "pycore_interp.h"
+#include "pycore_pystate.h"
+#include "Detect/detect_context.h"
+#include "Detect/detect_state.h"
+
+const DETECT_CONTEXT_T g_detect_context_default;
+
+/**
+ * @description: 为线程创建detect上下文，只有已经初始化detect模块的解释器中的线程才会创建
+ * @param tstate 线程对象
+ * @return DETECT_CONTEXT_T*
+ */
+DETECT_CONTEXT_T* detect_context_create(PyThreadState *tstate) {
+	DETECT_CONTEXT_T *context;
+
+	if (tstate->interp->detect_state == NULL) {
+		return NULL;
+	}
+
+	context = PyMem_RawCalloc(1, sizeof(DETECT_CONTEXT_T));
+	if (context == NULL) {
+		return NULL;
+	}
+
+	context->taint_area_stack = PyList_New(0);
+	if (context->taint_area_stack == NULL) {
+		PyErr_Clear();
+		PyMem_RawFree(context);
+		return NULL;
+	}
+
+	tstate->detect_context = context;
+
+	return context;
+}
+
+/**
+ * @description: 释放detect上下文
+ * @param context detect上下文，可以为NULL
+ * @return void
+ */
+void detect_context_free(DETECT_CONTEXT_T *context) {
+	if (context == NULL) {
+		return;
+	}
+
+	Py_CLEAR(context->record_info.cur_call_info.callable_info.module_name);
+	Py_CLEAR(context->record_info.cur_call_info.callable_info.class_name);
+	Py_CLEAR(context->record_info.cur_call_info.callable_info.method_name);
+	Py_CLEAR(context->record_info.cur_call_info.callable_info.func_name);
+	Py_CLEAR(context->taint_area_stack);
+
+	PyMem_RawFree(context);
+}
+
+/**
+ * @description: 释放线程的detect上下文，在线程对象清理时调用
+ * @param tstate 线程对象
+ * @return void
+ */
+void detect_context_clear(PyThreadState *tstate) {
+	DETECT_CONTEXT_T *context = tstate->detect_context;
+
+	tstate->detect_context = NULL;
+	detect_context_free(context);
+}
@@ -0,0 +1,53 @@
+#ifndef DETECT_DETECT_CONTEXT_H
+#define DETECT_DETECT_CONTEXT_H
+
+#include <stdbool.h>
+#include "Python.h"
+#include "pycore_pystate.h"
+#include "frameobject.h"
+#include "Detect/record/opcode_event.h"
+
+/* detect模块的线程级上下文，挂载在PyThreadState的detect_context字段上。
+   样本创建的各线程交替执行opcode，调用信息等中间状态必须按线程隔离 */
+typedef struct {
+	bool is_disabled;                      // 当前线程是否临时关闭了detect模块
+	bool is_analysing;                     // 当前线程是否处于分析状态
+	DETECT_RECORD_INFO_T record_info;      // 执行信息
+	PyFrameObject *last_check_frame;       // 上一次检查过的frame
+	bool last_check_frame_need_proc;       // 上一次检查过的frame是否需要处理
+	PyObject *taint_area_stack;            // 间接污染的污染区栈
+} DETECT_CONTEXT_T;
+
+extern DETECT_CONTEXT_T* detect_context_create(PyThreadState *tstate);
+extern void detect_context_free(DETECT_CONTEXT_T *context);
+extern void detect_context_clear(PyThreadState *tstate);
+
+/**
+ * @description: 获取当前线程的detect上下文，首次使用时创建。当前解释器未初始化detect模块时为NULL
+ * @return DETECT_CONTEXT_T*
+ */
+static inline DETECT_CONTEXT_T* detect_context_get() {
+	PyThreadState *tstate = _PyThreadState_GET();
+
+	if (tstate->detect_context != NULL) {
+		return (DETECT_CONTEXT_T*)tstate->detect_context;
+	}
+
+	return detect_context_create(tstate);
+}
+
+/* 所有字段均为零值的只读默认上下文 */
+extern const DETECT_CONTEXT_T g_detect_context_default;
+
+/**
+ * @description: 获取当前线程的detect上下文用于读取字段，当前解释器未初始化detect模块或者创建失败时
+ *               返回只读的默认上下文。各模块的上下文字段访问宏基于该函数，修改字段需要通过detect_context_get()
+ * @return const DETECT_CONTEXT_T*
+ */
+static inline const DETECT_CONTEXT_T* detect_context_get_or_default() {
+	DETECT_CONTEXT_T *context = detect_context_get();
+
+	return context != NULL ? context : &g_detect_context_default;
+}
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * @Description: 扫描内存模式。单个样本的检测进程生命周期很短，detect初始化之后的小块分配改由
+ *               obmalloc中的bump arena提供，分代回收放宽触发阈值；写出检测结论后不再执行
+ *               Py_FinalizeEx的完整清理，刷新输出后直接_exit，arena随进程整体释放
+ */
+
+#include "Python.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "pycore_pymem.h"
+#include "pycore_pylifecycle.h"
+#include "pycore_pystate.h"
+#include "Detect/configs/config.h"
+#include "Detect/detect_memory.h"
+#include "Detect/detect_profile.h"
+
+/* bump arena的大小。arena中的内存不会复用，过大的arena会让短命对象不断触碰新的页面，
+   只需容纳样本导入模块和初始化阶段分配的长期存活对象，用尽后回退到pymalloc */
+#define DETECT_MEMORY_ARENA_SIZE ((size_t)16 << 20)
+
+/* 是否已经进入扫描内存模式，进入后检测结束时直接退出进程 */
+static bool g_detect_memory_is_started = false;
+
+/**
+ * @description: 进入扫描内存模式，在单个样本的detect初始化之后调用。批量扫描模式下每个样本
+ *               都需要在子解释器结束时释放内存，不进入该模式
+ * @return void
+ */
+void detect_memory_begin(void) {
+	if (!detect_config_get_runtime_is_enable() || !detect_config_get_runtime_is_scan_memory()) {
+		return;
+	}
+
+	/* 预留失败时保持pymalloc分配，检测结束时仍然直接退出 */
+	_PyObject_ScanArenaEnable(DETECT_MEMORY_ARENA_SIZE);
+	g_detect_memory_is_started = true;
+}
+
+/**
+ * @description: 刷新sys模块中的输出流
+ * @param name 输出流名称
+ * @return void
+ */
+static void detect_memory_flush_stream(const char *name) {
+	PyObject *stream = PySys_GetObject(name), *ret;
+
+	if (stream == NULL || stream == Py_None) {
+		return;
+	}
+
+	ret = PyObject_CallMethod(stream, "flush", NULL);
+	Py_XDECREF(ret);
+	PyErr_Clear();
+}
+
+/**
+ * @description: 检测结论写出后调用。扫描内存模式下刷新python和C的输出缓冲后直接_exit，
+ *               跳过解释器清理和最后几轮垃圾回收；未进入该模式时直接返回，由调用方正常退出。
+ *               得出检测结论时与exit(0)一样不再执行atexit回调
+ * @param status 进程退出码
+ * @return void
+ */
+void detect_memory_finish(int status) {
+	if (!g_detect_memory_is_started) {
+		return;
+	}
+
+	detect_memory_flush_stream("stdout");
+	detect_memory_flush_stream("stderr");
+	fflush(NULL);
+
+	/* _exit不执行atexit，采样结果需要在退出前输出 */
+	detect_profile_dump();
+
+	_exit(status);
+}
+
+/**
+ * @description: 脚本自然执行结束并输出检测结果后调用。detect_analysis_finish_proc已经在hook下执行了
+ *               atexit回调并清空注册表，这里执行其后新注册的回调，与Py_FinalizeEx一致，之后再直接退出
+ * @param status 进程退出码
+ * @return void
+ */
+void detect_memory_finish_proc(int status) {
+	if (!g_detect_memory_is_started) {
+		return;
+	}
+
+	_PyAtExit_Call(_PyInterpreterState_GET());
+	PyErr_Clear();
+
+	detect_memory_finish(status);
+}
@@ -0,0 +1,10 @@
+#ifndef DETECT_DETECT_MEMORY_H
+#define DETECT_DETECT_MEMORY_H
+
+#include "Python.h"
+
+extern void detect_memory_begin(void);
+extern void detect_memory_finish(int status);
+extern void detect_memory_finish_proc(int status);
+
+#endif
@@ -0,0 +1,535 @@
+/*
+ * @Description: 采样profiler。通过-D profile=<file>开启后，ITIMER_PROF定时器每隔固定的CPU时间触发
+ *               SIGPROF，信号处理函数只读取持有GIL线程的frame链，把各frame的code对象指针和f_lasti写入
+ *               环形缓冲区；解释器在opcode间隙持有GIL时再解析为调用栈(co_filename:co_name:line)并汇总到
+ *               C哈希表中，进程退出时输出flamegraph使用的folded stack格式。不经过sys.setprofile，不与
+ *               detect的trace hook争用c_profilefunc
+ */
+
+#include "Python.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/time.h>
+#include "frameobject.h"
+#include "pycore_pystate.h"
+#include "pycore_interp.h"
+#include "Detect/configs/config.h"
+#include "Detect/detect_profile.h"
+
+/* 采样间隔(微秒)，按进程消耗的CPU时间计时 */
+#define DETECT_PROFILE_INTERVAL_US 1000
+/* 解析后的调用栈字符串的最大长度，超出的叶子端frame被截断 */
+#define DETECT_PROFILE_STACK_SIZE 4096
+/* 单个采样最多记录的frame数量，从叶子端开始计数 */
+#define DETECT_PROFILE_FRAME_MAX 128
+/* 环形缓冲区的采样记录数量，解释器长时间停留在C函数中未及时汇总时，写满后的采样计入丢弃数量 */
+#define DETECT_PROFILE_RING_SIZE 128
+/* 汇总哈希表的初始容量，必须为2的幂 */
+#define DETECT_PROFILE_TABLE_INIT_SIZE 1024
+/* 已解析的code对象集合的初始容量，必须为2的幂 */
+#define DETECT_PROFILE_CODES_INIT_SIZE 256
+
+/* 采样中的一个frame，只保存原始指针和f_lasti，在信号处理函数之外解析 */
+typedef struct {
+	PyCodeObject *code;
+	int lasti;
+} DETECT_PROFILE_FRAME;
+
+/* 环形缓冲区中的一个采样，frame从叶子端开始保存，count为0表示没有线程持有GIL */
+typedef struct {
+	int count;
+	int is_detect;
+	DETECT_PROFILE_FRAME frames[DETECT_PROFILE_FRAME_MAX];
+} DETECT_PROFILE_RECORD;
+
+/* 汇总哈希表中的一项，相同调用栈的采样合并计数 */
+typedef struct {
+	char *stack;
+	unsigned long count;
+} DETECT_PROFILE_ENTRY;
+
+volatile int g_detect_profile_depth = 0;
+volatile int g_detect_profile_pending = 0;
+bool g_detect_profile_is_started = false;
+
+static bool g_detect_profile_is_dumped = false;
+static char *g_detect_profile_path = NULL;
+
+/* 单生产者单消费者的环形缓冲区：信号处理函数只推进head，汇总函数只推进tail */
+static DETECT_PROFILE_RECORD *g_detect_profile_ring = NULL;
+static unsigned long g_detect_profile_head = 0;
+static unsigned long g_detect_profile_tail = 0;
+/* 防止多个线程上的信号处理函数同时写入环形缓冲区 */
+static volatile int g_detect_profile_busy = 0;
+static unsigned long g_detect_profile_dropped = 0;
+
+static DETECT_PROFILE_ENTRY *g_detect_profile_table = NULL;
+static size_t g_detect_profile_table_size = 0;
+static size_t g_detect_profile_table_used = 0;
+
+/* 已解析过的code对象，持有强引用，保证之后的采样中相同的指针仍然指向同一个code对象 */
+static PyCodeObject **g_detect_profile_codes = NULL;
+static size_t g_detect_profile_codes_size = 0;
+static size_t g_detect_profile_codes_used = 0;
+
+/**
+ * @description: 向采样记录追加字符串，超出记录长度时截断
+ * @param buf 采样记录
+ * @param pos 当前写入位置
+ * @param str 追加的字符串
+ * @return size_t 追加后的写入位置
+ */
+static size_t detect_profile_append_cstr(char *buf, size_t pos, const char *str) {
+	while (*str != '\0' && pos < DETECT_PROFILE_STACK_SIZE - 1) {
+		buf[pos++] = *str++;
+	}
+	return pos;
+}
+
+/**
+ * @description: 向采样记录追加unicode字符串。汇总时不创建新对象，直接读取字符串数据，
+ *               非ASCII字符替换为'?'，folded格式的分隔符';'和' '分别替换为':'和'_'
+ * @param buf 采样记录
+ * @param pos 当前写入位置
+ * @param str unicode对象
+ * @return size_t 追加后的写入位置
+ */
+static size_t detect_profile_append_unicode(char *buf, size_t pos, PyObject *str) {
+	Py_ssize_t i, len;
+	Py_UCS4 ch;
+	const void *data;
+	int kind;
+
+	if (str == NULL || !PyUnicode_Check(str) || !PyUnicode_IS_READY(str)) {
+		return detect_profile_append_cstr(buf, pos, "?");
+	}
+
+	kind = PyUnicode_KIND(str);
+	data = PyUnicode_DATA(str);
+	len = PyUnicode_GET_LENGTH(str);
+	for (i = 0; i < len && pos < DETECT_PROFILE_STACK_SIZE - 1; i++) {
+		ch = PyUnicode_READ(kind, data, i);
+		if (ch == ';') {
+			ch = ':';
+		} else if (ch == ' ') {
+			ch = '_';
+		} else if (ch < 0x20 || ch > 0x7e) {
+			ch = '?';
+		}
+		buf[pos++] = (char)ch;
+	}
+
+	return pos;
+}
+
+/**
+ * @description: 向采样记录追加十进制整数
+ * @param buf 采样记录
+ * @param pos 当前写入位置
+ * @param value 整数
+ * @return size_t 追加后的写入位置
+ */
+static size_t detect_profile_append_int(char *buf, size_t pos, int value) {
+	char digits[16];
+	int count = 0;
+
+	if (value < 0) {
+		value = 0;
+	}
+	do {
+		digits[count++] = (char)('0' + value % 10);
+		value /= 10;
+	} while (value > 0 && count < (int)sizeof(digits));
+
+	while (count > 0 && pos < DETECT_PROFILE_STACK_SIZE - 1) {
+		buf[pos++] = digits[--count];
+	}
+
+	return pos;
+}
+
+/**
+ * @description: 记录持有GIL线程的调用栈，只读取frame链上的code对象指针和f_lasti，不解析行号也不访问
+ *               code对象的内容。处于detect处理函数中时置位is_detect
+ * @param record 采样记录
+ * @return void
+ */
+static void detect_profile_fill_record(DETECT_PROFILE_RECORD *record) {
+	PyThreadState *tstate = _PyRuntimeState_GetThreadState(&_PyRuntime);
+	PyFrameObject *frame = tstate != NULL ? tstate->frame : NULL;
+	int count = 0;
+
+	for (; frame != NULL && count < DETECT_PROFILE_FRAME_MAX; frame = frame->f_back) {
+		record->frames[count].code  = frame->f_code;
+		record->frames[count].lasti = frame->f_lasti;
+		count++;
+	}
+
+	record->count = count;
+	record->is_detect = g_detect_profile_depth > 0;
+}
+
+/**
+ * @description: SIGPROF信号处理函数，采样当前调用栈写入环形缓冲区，由解释器在opcode间隙汇总
+ * @param signum 信号值
+ * @return void
+ */
+static void detect_profile_signal_handler(int signum) {
+	int saved_errno = errno;
+	unsigned long head, tail;
+
+	if (__sync_lock_test_and_set(&g_detect_profile_busy, 1)) {
+		errno = saved_errno;
+		return;
+	}
+
+	head = g_detect_profile_head;
+	tail = __atomic_load_n(&g_detect_profile_tail, __ATOMIC_ACQUIRE);
+	if (head - tail >= DETECT_PROFILE_RING_SIZE) {
+		g_detect_profile_dropped++;
+	} else {
+		detect_profile_fill_record(&g_detect_profile_ring[head % DETECT_PROFILE_RING_SIZE]);
+		__atomic_store_n(&g_detect_profile_head, head + 1, __ATOMIC_RELEASE);
+	}
+	g_detect_profile_pending = 1;
+
+	__sync_lock_release(&g_detect_profile_busy);
+	errno = saved_errno;
+}
+
+/**
+ * @description: 在已解析的code对象集合中查找指针，不存在时返回空项的位置
+ * @param codes 集合
+ * @param size 集合容量
+ * @param code code对象指针
+ * @return PyCodeObject**
+ */
+static PyCodeObject** detect_profile_codes_lookup(PyCodeObject **codes, size_t size, PyCodeObject *code) {
+	size_t index = ((size_t)code >> 4) & (size - 1);
+
+	while (codes[index] != NULL && codes[index] != code) {
+		index = (index + 1) & (size - 1);
+	}
+
+	return &codes[index];
+}
+
+/**
+ * @description: 判断code对象是否仍被某个线程的frame链使用。采样之后frame可能已经返回，code对象
+ *               可能已经释放，只有仍在frame链上的指针才能安全访问
+ * @param code code对象指针
+ * @return bool
+ */
+static bool detect_profile_code_is_live(PyCodeObject *code) {
+	PyInterpreterState *interp;
+	PyThreadState *tstate;
+	PyFrameObject *frame;
+	bool is_live = false;
+
+	/* 与pystate.c的HEAD_LOCK相同，防止遍历时其他线程创建或销毁线程状态 */
+	PyThread_acquire_lock(_PyRuntime.interpreters.mutex, WAIT_LOCK);
+	for (interp = _PyRuntime.interpreters.head; interp != NULL && !is_live; interp = interp->next) {
+		for (tstate = interp->tstate_head; tstate != NULL && !is_live; tstate = tstate->next) {
+			for (frame = tstate->frame; frame != NULL; frame = frame->f_back) {
+				if (frame->f_code == code) {
+					is_live = true;
+					break;
+				}
+			}
+		}
+	}
+	PyThread_release_lock(_PyRuntime.interpreters.mutex);
+
+	return is_live;
+}
+
+/**
+ * @description: 确认采样中的code对象指针可以访问。第一次出现的指针仍在frame链上时加入集合并持有强引用，
+ *               之后相同的指针不会再被释放或复用
+ * @param code code对象指针
+ * @return bool 是否可以访问
+ */
+static bool detect_profile_code_pin(PyCodeObject *code) {
+	PyCodeObject **codes, **slot;
+	size_t size, i;
+
+	if (g_detect_profile_codes != NULL &&
+		*detect_profile_codes_lookup(g_detect_profile_codes, g_detect_profile_codes_size, code) == code) {
+		return true;
+	}
+	if (!detect_profile_code_is_live(code)) {
+		return false;
+	}
+
+	/* 使用超过七成时扩容为两倍 */
+	if (g_detect_profile_codes == NULL || (g_detect_profile_codes_used + 1) * 10 >= g_detect_profile_codes_size * 7) {
+		size = g_detect_profile_codes_size ? g_detect_profile_codes_size * 2 : DETECT_PROFILE_CODES_INIT_SIZE;
+		codes = PyMem_RawCalloc(size, sizeof(PyCodeObject *));
+		if (codes == NULL) {
+			return false;
+		}
+		for (i = 0; i < g_detect_profile_codes_size; i++) {
+			if (g_detect_profile_codes[i] != NULL) {
+				*detect_profile_codes_lookup(codes, size, g_detect_profile_codes[i]) = g_detect_profile_codes[i];
+			}
+		}
+		PyMem_RawFree(g_detect_profile_codes);
+		g_detect_profile_codes = codes;
+		g_detect_profile_codes_size = size;
+	}
+
+	slot = detect_profile_codes_lookup(g_detect_profile_codes, g_detect_profile_codes_size, code);
+	Py_INCREF(code);
+	*slot = code;
+	g_detect_profile_codes_used++;
+
+	return true;
+}
+
+/**
+ * @description: 把采样记录解析为folded格式的调用栈，根frame在前，以';'分隔。没有线程持有GIL时记为[idle]，
+ *               处于detect处理函数中时在末尾追加[detect]，采样后已经释放的frame记为[expired]。
+ *               需要持有GIL
+ * @param record 采样记录
+ * @param buf 调用栈字符串
+ * @return void
+ */
+static void detect_profile_resolve_record(const DETECT_PROFILE_RECORD *record, char *buf) {
+	PyCodeObject *code;
+	size_t pos = 0;
+	int count = record->count;
+
+	if (count == 0) {
+		pos = detect_profile_append_cstr(buf, pos, "[idle]");
+	}
+	while (count > 0) {
+		code = record->frames[--count].code;
+		if (detect_profile_code_pin(code)) {
+			pos = detect_profile_append_unicode(buf, pos, code->co_filename);
+			pos = detect_profile_append_cstr(buf, pos, ":");
+			pos = detect_profile_append_unicode(buf, pos, code->co_name);
+			pos = detect_profile_append_cstr(buf, pos, ":");
+			pos = detect_profile_append_int(buf, pos, PyCode_Addr2Line(code, record->frames[count].lasti * 2));
+		} else {
+			pos = detect_profile_append_cstr(buf, pos, "[expired]");
+		}
+		if (count > 0) {
+			pos = detect_profile_append_cstr(buf, pos, ";");
+		}
+	}
+
+	if (record->is_detect) {
+		pos = detect_profile_append_cstr(buf, pos, ";[detect]");
+	}
+	buf[pos] = '\0';
+}
+
+/**
+ * @description: 计算调用栈字符串的FNV-1a哈希值
+ * @param stack 调用栈字符串
+ * @return size_t
+ */
+static size_t detect_profile_hash(const char *stack) {
+	size_t hash = (size_t)14695981039346656037ULL;
+
+	while (*stack != '\0') {
+		hash ^= (unsigned char)*stack++;
+		hash *= (size_t)1099511628211ULL;
+	}
+
+	return hash;
+}
+
+/**
+ * @description: 在汇总哈希表中查找调用栈对应的项，不存在时返回空项的位置
+ * @param table 哈希表
+ * @param size 哈希表容量
+ * @param stack 调用栈字符串
+ * @return DETECT_PROFILE_ENTRY*
+ */
+static DETECT_PROFILE_ENTRY* detect_profile_table_lookup(DETECT_PROFILE_ENTRY *table, size_t size, const char *stack) {
+	size_t index = detect_profile_hash(stack) & (size - 1);
+
+	while (table[index].stack != NULL && strcmp(table[index].stack, stack)) {
+		index = (index + 1) & (size - 1);
+	}
+
+	return &table[index];
+}
+
+/**
+ * @description: 汇总哈希表使用超过七成时扩容为两倍
+ * @return bool 是否可以继续插入新项
+ */
+static bool detect_profile_table_grow(void) {
+	DETECT_PROFILE_ENTRY *table;
+	size_t size, i;
+
+	if (g_detect_profile_table != NULL && (g_detect_profile_table_used + 1) * 10 < g_detect_profile_table_size * 7) {
+		return true;
+	}
+
+	size = g_detect_profile_table_size ? g_detect_profile_table_size * 2 : DETECT_PROFILE_TABLE_INIT_SIZE;
+	table = PyMem_RawCalloc(size, sizeof(DETECT_PROFILE_ENTRY));
+	if (table == NULL) {
+		return g_detect_profile_table != NULL && g_detect_profile_table_used + 1 < g_detect_profile_table_size;
+	}
+
+	for (i = 0; i < g_detect_profile_table_size; i++) {
+		if (g_detect_profile_table[i].stack != NULL) {
+			*detect_profile_table_lookup(table, size, g_detect_profile_table[i].stack) = g_detect_profile_table[i];
+		}
+	}
+
+	PyMem_RawFree(g_detect_profile_table);
+	g_detect_profile_table = table;
+	g_detect_profile_table_size = size;
+
+	return true;
+}
+
+/**
+ * @description: 把一个采样计入汇总哈希表，内存不足时计入丢弃数量
+ * @param stack 调用栈字符串
+ * @return void
+ */
+static void detect_profile_table_add(const char *stack) {
+	DETECT_PROFILE_ENTRY *entry;
+
+	if (!detect_profile_table_grow()) {
+		g_detect_profile_dropped++;
+		return;
+	}
+
+	entry = detect_profile_table_lookup(g_detect_profile_table, g_detect_profile_table_size, stack);
+	if (entry->stack == NULL) {
+		entry->stack = _PyMem_RawStrdup(stack);
+		if (entry->stack == NULL) {
+			g_detect_profile_dropped++;
+			return;
+		}
+		g_detect_profile_table_used++;
+	}
+	entry->count++;
+}
+
+/**
+ * @description: 开启采样profiler，每个进程只开启一次。未配置profile时直接返回
+ * @return void
+ */
+void detect_profile_start(void) {
+	const char *path = detect_config_get_runtime_profile();
+	struct sigaction action;
+	struct itimerval timer;
+
+	if (path == NULL || *path == '\0' || g_detect_profile_is_started) {
+		return;
+	}
+
+	g_detect_profile_path = _PyMem_RawStrdup(path);
+	g_detect_profile_ring = PyMem_RawCalloc(DETECT_PROFILE_RING_SIZE, sizeof(DETECT_PROFILE_RECORD));
+	if (g_detect_profile_path == NULL || g_detect_profile_ring == NULL) {
+		goto error;
+	}
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = detect_profile_signal_handler;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	if (sigaction(SIGPROF, &action, NULL) < 0) {
+		goto error;
+	}
+
+	/* 定时器开启前置位，之后opcode处理函数才开始维护标记，第一个采样就能区分检测代码 */
+	g_detect_profile_is_started = true;
+
+	timer.it_interval.tv_sec = 0;
+	timer.it_interval.tv_usec = DETECT_PROFILE_INTERVAL_US;
+	timer.it_value = timer.it_interval;
+	if (setitimer(ITIMER_PROF, &timer, NULL) < 0) {
+		g_detect_profile_is_started = false;
+		signal(SIGPROF, SIG_DFL);
+		goto error;
+	}
+
+	/* 脚本调用exit或者检测结论写出后exit(0)都会执行atexit，扫描内存模式的_exit之前会主动调用dump */
+	atexit(detect_profile_dump);
+	return;
+
+error:
+	PyMem_RawFree(g_detect_profile_path);
+	PyMem_RawFree(g_detect_profile_ring);
+	g_detect_profile_path = NULL;
+	g_detect_profile_ring = NULL;
+}
+
+/**
+ * @description: 把环形缓冲区中的采样解析后汇总到哈希表，在持有GIL的线程的opcode间隙调用
+ * @return void
+ */
+void detect_profile_drain(void) {
+	static char stack[DETECT_PROFILE_STACK_SIZE];
+	unsigned long tail, head;
+
+	g_detect_profile_pending = 0;
+	if (g_detect_profile_ring == NULL) {
+		return;
+	}
+
+	tail = g_detect_profile_tail;
+	head = __atomic_load_n(&g_detect_profile_head, __ATOMIC_ACQUIRE);
+	while (tail != head) {
+		detect_profile_resolve_record(&g_detect_profile_ring[tail % DETECT_PROFILE_RING_SIZE], stack);
+		detect_profile_table_add(stack);
+		tail++;
+		__atomic_store_n(&g_detect_profile_tail, tail, __ATOMIC_RELEASE);
+	}
+}
+
+/**
+ * @description: 停止采样并把汇总结果以folded stack格式写入profile文件，每行为"调用栈 采样数"，
+ *               丢弃的采样记为[dropped]。解释器清理之后仍然可以调用，此时code对象已经无法访问，
+ *               环形缓冲区中未汇总的采样计入丢弃数量。只输出一次
+ * @return void
+ */
+void detect_profile_dump(void) {
+	struct itimerval timer;
+	FILE *fp;
+	size_t i;
+
+	if (!g_detect_profile_is_started || g_detect_profile_is_dumped) {
+		return;
+	}
+	g_detect_profile_is_dumped = true;
+
+	memset(&timer, 0, sizeof(timer));
+	setitimer(ITIMER_PROF, &timer, NULL);
+	signal(SIGPROF, SIG_IGN);
+
+	if (_PyRuntime.initialized && !_Py_IsFinalizing() && PyGILState_Check()) {
+		detect_profile_drain();
+	} else {
+		g_detect_profile_dropped += g_detect_profile_head - g_detect_profile_tail;
+	}
+
+	fp = fopen(g_detect_profile_path, "w");
+	if (fp == NULL) {
+		fprintf(stderr, "detect profile: can't open '%s': %s\n", g_detect_profile_path, strerror(errno));
+		return;
+	}
+
+	for (i = 0; i < g_detect_profile_table_size; i++) {
+		if (g_detect_profile_table[i].stack != NULL) {
+			fprintf(fp, "%s %lu\n", g_detect_profile_table[i].stack, g_detect_profile_table[i].count);
+		}
+	}
+	if (g_detect_profile_dropped > 0) {
+		fprintf(fp, "[dropped] %lu\n", g_detect_profile_dropped);
+	}
+
+	fclose(fp);
+}
@@ -0,0 +1,38 @@
+#ifndef DETECT_DETECT_PROFILE_H
+#define DETECT_DETECT_PROFILE_H
+
+#include <stdbool.h>
+#include "Python.h"
+
+/* 是否已经开启采样，未开启时opcode处理函数前后不维护标记，也不检查待汇总的采样 */
+extern bool g_detect_profile_is_started;
+/* 当前是否处于detect的opcode处理函数中，采样时以该标记区分样本代码和检测代码的耗时 */
+extern volatile int g_detect_profile_depth;
+/* 采样环形缓冲区中是否有待汇总的采样 */
+extern volatile int g_detect_profile_pending;
+
+extern void detect_profile_start(void);
+extern void detect_profile_drain(void);
+extern void detect_profile_dump(void);
+
+/* 进入和离开detect处理函数，只在开启采样后调用 */
+#define DETECT_PROFILE_ENTER() (g_detect_profile_depth++)
+#define DETECT_PROFILE_LEAVE() (g_detect_profile_depth--)
+
+/* 在opcode处理函数中执行样本代码(虚拟线程、二阶段载荷)时暂时清除标记，结束后恢复 */
+#define DETECT_PROFILE_SUSPEND(saved) \
+	do { \
+		(saved) = g_detect_profile_depth; \
+		g_detect_profile_depth = 0; \
+	} while (0)
+#define DETECT_PROFILE_RESUME(saved) (g_detect_profile_depth = (saved))
+
+/* 在解释器执行opcode的间隙汇总信号处理函数写入的采样 */
+#define DETECT_PROFILE_POLL() \
+	do { \
+		if (g_detect_profile_pending) { \
+			detect_profile_drain(); \
+		} \
+	} while (0)
+
+#endif
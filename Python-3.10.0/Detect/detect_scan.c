@@ -0,0 +1,318 @@
+/*
+ * @Description: 子解释器扫描。每个样本在独立的子解释器中执行检测，得出结论后销毁子解释器，
+ *               各样本的hook对象、配置字典和分析状态互相隔离，无需fork即可在同一进程内连续扫描
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+#include "Python.h"
+#include "pycore_interp.h"
+#include "pycore_pystate.h"
+#include "pycore_pathconfig.h"
+#include "pycore_fileutils.h"
+#include "Detect/detect.h"
+#include "Detect/detect_state.h"
+#include "Detect/analysis/analysis_common.h"
+#include "Detect/virtual/virtual_thread.h"
+
+/* 样本路径清单中单行的最大长度 */
+#define DETECT_SCAN_LINE_MAX 4096
+
+/**
+ * @description: 设置当前子解释器的sys.argv和sys.path[0]，与直接执行样本时保持一致
+ * @param filename 样本路径
+ * @return void
+ */
+static void detect_scan_set_sys_args(const wchar_t *filename) {
+	PyWideStringList args = {1, (wchar_t**)&filename};
+	PyObject *argv, *sys_path, *path0 = NULL;
+
+	argv = Py_BuildValue("[u]", filename);
+	if (argv != NULL) {
+		PySys_SetObject("argv", argv);
+		Py_DECREF(argv);
+	}
+
+	sys_path = PySys_GetObject("path");
+	if (sys_path != NULL && _PyPathConfig_ComputeSysPath0(&args, &path0) > 0) {
+		PyList_Insert(sys_path, 0, path0);
+		Py_DECREF(path0);
+	}
+
+	PyErr_Clear();
+}
+
+/**
+ * @description: 在当前子解释器的__main__模块中执行样本。SystemExit以及样本自身抛出的异常
+ *               都只代表样本执行结束，不影响检测结论
+ * @param filename 样本路径
+ * @return int 0 --- 执行结束，-1 --- 样本无法打开
+ */
+static int detect_scan_run_file(const wchar_t *filename) {
+	FILE *fp;
+	PyObject *filename_obj, *main_module, *main_dict, *result;
+	const char *filename_str;
+	PyCompilerFlags cf = _PyCompilerFlags_INIT;
+
+	fp = _Py_wfopen(filename, L"rb");
+	if (fp == NULL) {
+		fprintf(stderr, "detect: can't open file '%ls': [Errno %d] %s\n",
+				filename, errno, strerror(errno));
+		return -1;
+	}
+
+	filename_obj = PyUnicode_FromWideChar(filename, -1);
+	main_module = PyImport_AddModule("__main__");
+	if (filename_obj == NULL || main_module == NULL) {
+		Py_XDECREF(filename_obj);
+		fclose(fp);
+		PyErr_Clear();
+		return -1;
+	}
+
+	main_dict = PyModule_GetDict(main_module);
+	PyDict_SetItemString(main_dict, "__file__", filename_obj);
+	PyDict_SetItemString(main_dict, "__cached__", Py_None);
+	filename_str = PyUnicode_AsUTF8(filename_obj);
+
+	/* 执行完成后fp由PyRun_FileExFlags关闭 */
+	result = PyRun_FileExFlags(fp, filename_str, Py_file_input, main_dict, main_dict, 1, &cf);
+
+	Py_XDECREF(result);
+	Py_DECREF(filename_obj);
+	PyErr_Clear();
+
+	return 0;
+}
+
+/**
+ * @description: 将检测结果字典转换为字符串，并释放检测结果字典
+ * @param result_dict 检测结果字典
+ * @return char* 由调用方通过PyMem_RawFree释放，失败时返回NULL
+ */
+static char* detect_scan_result_to_string(PyObject *result_dict) {
+	PyObject *result_str;
+	const char *result_utf8;
+	char *result = NULL;
+
+	result_str  = PyObject_Str(result_dict);
+	result_utf8 = result_str != NULL ? PyUnicode_AsUTF8(result_str) : NULL;
+	if (result_utf8 != NULL) {
+		result = PyMem_RawMalloc(strlen(result_utf8) + 1);
+		if (result != NULL) {
+			strcpy(result, result_utf8);
+		}
+	}
+
+	Py_XDECREF(result_str);
+	Py_DECREF(result_dict);
+	PyErr_Clear();
+
+	return result;
+}
+
+/**
+ * @description: 在当前子解释器的__main__模块中执行内存中已编译的样本，用于压缩包成员等不落盘的样本
+ * @param filename 样本的虚拟路径
+ * @param code 样本的code对象，为NULL时代表样本无法编译，与直接执行时抛出SyntaxError一致
+ * @return int 0 --- 执行结束，-1 --- 无法创建__main__模块
+ */
+static int detect_scan_run_code(const wchar_t *filename, PyObject *code) {
+	PyObject *filename_obj, *main_module, *main_dict, *result;
+
+	if (code == NULL) {
+		return 0;
+	}
+
+	filename_obj = PyUnicode_FromWideChar(filename, -1);
+	main_module = PyImport_AddModule("__main__");
+	if (filename_obj == NULL || main_module == NULL) {
+		Py_XDECREF(filename_obj);
+		PyErr_Clear();
+		return -1;
+	}
+
+	main_dict = PyModule_GetDict(main_module);
+	PyDict_SetItemString(main_dict, "__file__", filename_obj);
+	PyDict_SetItemString(main_dict, "__cached__", Py_None);
+
+	result = PyEval_EvalCode(code, main_dict, main_dict);
+
+	Py_XDECREF(result);
+	Py_DECREF(filename_obj);
+	PyErr_Clear();
+
+	return 0;
+}
+
+/**
+ * @description: 在新建的子解释器中检测单个样本，检测结束后销毁子解释器。调用方需持有GIL
+ * @param filename 样本路径，内存中的样本为虚拟路径
+ * @param source 以'\0'结尾的样本内容，为NULL时从磁盘读取样本。内容需由调用方以PyMem_Raw分配，
+ *               不能是python对象，对象不能跨解释器使用
+ * @param size 样本内容的长度
+ * @return char* 检测结果字典的字符串形式，由调用方通过PyMem_RawFree释放；样本无法检测时返回NULL
+ */
+static char* detect_scan_sample(const wchar_t *filename, const char *source, Py_ssize_t size) {
+	PyThreadState *main_tstate = PyThreadState_Get();
+	PyThreadState *sub_tstate;
+	PyInterpreterState *interp;
+	DETECT_STATE_T *state;
+	PyObject *result_dict = NULL, *code = NULL;
+	char *result = NULL;
+	int ret;
+
+	/* 缓存命中时无需创建子解释器执行样本 */
+	result_dict = source != NULL ? detect_analysis_cache_lookup_source(filename, source, size)
+								 : detect_analysis_cache_lookup(filename);
+	if (result_dict != NULL) {
+		return detect_scan_result_to_string(result_dict);
+	}
+
+	sub_tstate = Py_NewInterpreter();
+	if (sub_tstate == NULL) {
+		fprintf(stderr, "detect: can't create sub-interpreter for '%ls'\n", filename);
+		PyThreadState_Swap(main_tstate);
+		return NULL;
+	}
+
+	/* 子解释器的配置拷贝自主解释器，需要改为当前样本的路径，检测模块以此识别主脚本的frame */
+	interp = sub_tstate->interp;
+	PyMem_RawFree(interp->config.run_filename);
+	interp->config.run_filename = _PyMem_RawWcsdup(filename);
+
+	/* sys.argv属于外部输入，需要在hook安装之前设置 */
+	detect_scan_set_sys_args(filename);
+
+	/* 静态预过滤，不可能到达威胁调用的样本直接给出正常结论。内存中的样本只编译一次，
+	   编译得到的code对象的co_filename即为虚拟路径 */
+	if (source != NULL) {
+		code = detect_analysis_prescan_compile_source(filename, source);
+		result_dict = code != NULL ? detect_analysis_prescan_code(code) : NULL;
+	} else {
+		result_dict = detect_analysis_prescan(filename);
+	}
+
+	if (result_dict == NULL) {
+		/* 在子解释器中初始化detect模块，hook安装在子解释器自己的sys.modules中 */
+		detect_init();
+		state = detect_state_get();
+		if (state != NULL) {
+			state->is_sub_interpreter = true;
+		}
+
+		ret = source != NULL ? detect_scan_run_code(filename, code) : detect_scan_run_file(filename);
+		if (ret == 0) {
+			/* 运行仍未被调度的虚拟线程，之后探索样本中未被调用过的函数 */
+			detect_virtual_thread_finish();
+			detect_analysis_explore_proc();
+
+			/* 样本执行结束，停止记录和分析，并清除未触发的异步SystemExit */
+			if (state != NULL) {
+				state->is_finished = true;
+				state->need_stop = false;
+			}
+			PyThreadState_SetAsyncExc(sub_tstate->thread_id, NULL);
+
+			/* 得分未达到阈值时给出权重最高的结论或者正常的检测结果 */
+			result_dict = detect_analysis_create_finish_result_dict();
+			if (result_dict == NULL) {
+				result_dict = detect_analysis_create_detect_ok_result_dict(NULL);
+			}
+		}
+
+		/* 结束仍在等待锁的虚拟线程，线程栈上的frame在子解释器销毁之前释放 */
+		detect_virtual_thread_clear();
+	}
+
+	Py_XDECREF(code);
+
+	if (result_dict != NULL) {
+		/* 保存检测结论到缓存 */
+		detect_analysis_cache_store(result_dict);
+
+		result = detect_scan_result_to_string(result_dict);
+	}
+
+	/* 销毁子解释器，detect状态在解释器清理阶段一并释放 */
+	Py_EndInterpreter(sub_tstate);
+	PyThreadState_Swap(main_tstate);
+
+	return result;
+}
+
+/**
+ * @description: 在新建的子解释器中检测磁盘上的单个样本。调用方需持有GIL
+ * @param filename 样本路径
+ * @return char* 检测结果字典的字符串形式，由调用方通过PyMem_RawFree释放；样本无法检测时返回NULL
+ */
+char* detect_scan_file(const wchar_t *filename) {
+	return detect_scan_sample(filename, NULL, 0);
+}
+
+/**
+ * @description: 在新建的子解释器中检测内存中的单个样本，样本不落盘。调用方需持有GIL
+ * @param filename 样本的虚拟路径，例如"pkg.whl/pkg/__init__.py"
+ * @param source 以'\0'结尾的样本内容，由调用方以PyMem_Raw分配
+ * @param size 样本内容的长度
+ * @return char* 检测结果字典的字符串形式，由调用方通过PyMem_RawFree释放；样本无法检测时返回NULL
+ */
+char* detect_scan_source(const wchar_t *filename, const char *source, Py_ssize_t size) {
+	return detect_scan_sample(filename, source, size);
+}
+
+/**
+ * @description: 批量扫描，样本路径清单中每行一个样本路径，空行和以'#'开头的行会被忽略。
+ *               每个样本的检测结果按行输出到标准输出
+ * @param manifest 样本路径清单
+ * @return int 进程退出码
+ */
+int detect_scan_batch(const wchar_t *manifest) {
+	FILE *fp;
+	char line[DETECT_SCAN_LINE_MAX];
+	wchar_t *filename;
+	char *result;
+
+	fp = _Py_wfopen(manifest, L"r");
+	if (fp == NULL) {
+		fprintf(stderr, "detect: can't open file '%ls': [Errno %d] %s\n",
+				manifest, errno, strerror(errno));
+		return 2;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		line[strcspn(line, "\r\n")] = '\0';
+
+		if (line[0] == '\0' || line[0] == '#') {
+			continue;
+		}
+
+		filename = Py_DecodeLocale(line, NULL);
+		if (filename == NULL) {
+			fprintf(stderr, "detect: can't decode path '%s'\n", line);
+			continue;
+		}
+
+		/* 压缩包按成员逐个检测，结果由压缩包扫描输出 */
+		if (detect_archive_is_archive(filename)) {
+			detect_archive_scan(filename);
+			PyMem_RawFree(filename);
+			continue;
+		}
+
+		result = detect_scan_file(filename);
+		if (result != NULL) {
+			fprintf(stdout, "%s\n", result);
+			fflush(stdout);
+			PyMem_RawFree(result);
+		}
+
+		PyMem_RawFree(filename);
+	}
+
+	fclose(fp);
+
+	return 0;
+}
@@ -0,0 +1,11 @@
+#ifndef DETECT_DETECT_SCAN_H
+#define DETECT_DETECT_SCAN_H
+
+#include <wchar.h>
+#include "Python.h"
+
+extern char* detect_scan_file(const wchar_t *filename);
+extern char* detect_scan_source(const wchar_t *filename, const char *source, Py_ssize_t size);
+extern int detect_scan_batch(const wchar_t *manifest);
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * @Description: detect模块的解释器级状态。原先的全局变量都收敛到该状态中，
+ *               使得每个子解释器都拥有独立的配置字典、hook对象和分析中间状态
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include "Python.h"
+#include "pycore_interp.h"
+#include "pycore_pystate.h"
+#include "Detect/detect_state.h"
+#include "Detect/virtual/virtual_fs.h"
+
+const DETECT_STATE_T g_detect_state_default = {
+	.coverage_extra_index = -1,
+};
+
+/**
+ * @description: 为当前解释器创建detect状态，已创建时直接返回
+ * @return DETECT_STATE_T*
+ */
+DETECT_STATE_T* detect_state_create() {
+	PyInterpreterState *interp = _PyInterpreterState_GET();
+	DETECT_STATE_T *state;
+
+	if (interp->detect_state != NULL) {
+		return interp->detect_state;
+	}
+
+	state = PyMem_RawCalloc(1, sizeof(DETECT_STATE_T));
+	if (state == NULL) {
+		return NULL;
+	}
+
+	state->run_state = RUN_STATE_INITIALIZING;
+	state->coverage_extra_index = -1;
+	interp->detect_state = state;
+
+	return state;
+}
+
+/**
+ * @description: 释放解释器的detect状态，在解释器清理阶段、模块销毁之后调用
+ * @param interp 解释器对象
+ * @return void
+ */
+void detect_state_clear(PyInterpreterState *interp) {
+	DETECT_STATE_T *state = interp->detect_state;
+	int index;
+
+	if (state == NULL) {
+		return;
+	}
+
+	Py_CLEAR(state->result_dict);
+	detect_virtual_fs_clear(&state->virtual_fs_dict);
+	Py_CLEAR(state->virtual_thread_queue);
+	Py_CLEAR(state->virtual_thread_sentinel);
+	Py_CLEAR(state->virtual_thread_blocked_queue);
+
+	Py_CLEAR(state->taint_input_class_dict);
+	Py_CLEAR(state->taint_input_method_dict);
+	Py_CLEAR(state->taint_input_func_dict);
+	Py_CLEAR(state->taint_input_var_dict);
+	Py_CLEAR(state->taint_input_all_dict);
+	Py_CLEAR(state->threat_class_dict);
+	Py_CLEAR(state->threat_method_dict);
+	Py_CLEAR(state->threat_func_dict);
+	Py_CLEAR(state->threat_all_dict);
+	Py_CLEAR(state->custom_class_dict);
+	Py_CLEAR(state->custom_method_dict);
+	Py_CLEAR(state->custom_func_dict);
+	Py_CLEAR(state->custom_all_dict);
+	Py_CLEAR(state->summary_func_dict);
+
+	Py_CLEAR(state->entered_code_set);
+
+	Py_CLEAR(state->analysis_func_list);
+	Py_CLEAR(state->malicious_commands_list);
+	detect_analysis_sequence_free(state->sequence_automaton);
+	Py_CLEAR(state->finding_dict);
+	Py_CLEAR(state->stage_stack);
+	Py_CLEAR(state->stage_sample_filename);
+	state->sequence_automaton = NULL;
+	Py_CLEAR(state->re_module);
+	Py_CLEAR(state->re_search_method);
+	Py_CLEAR(state->lib_path);
+	callable_cfunc_cache_clear(state->cfunc_cache);
+	for (index = 0; index < MODULE_MISSING_KIND_MAX; index++) {
+		Py_CLEAR(state->missing_module_dicts[index]);
+	}
+	Py_CLEAR(state->missing_module_sys_path);
+	Py_CLEAR(state->missing_module_meta_path);
+
+	/* 最后释放undefined单例，其他引用释放的hook对象都进入空闲链表后再统一清理空闲链表 */
+	Py_CLEAR(state->undef_object);
+	detect_object_freelist_clear(state->object_freelists);
+
+	interp->detect_state = NULL;
+	PyMem_RawFree(state);
+}
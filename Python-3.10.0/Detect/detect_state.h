@@ -0,0 +1,106 @@
+#ifndef DETECT_DETECT_STATE_H
+#define DETECT_DETECT_STATE_H
+
+#include <stdbool.h>
+#include "Python.h"
+#include "pycore_interp.h"
+#include "pycore_pystate.h"
+#include "Detect/configs/config.h"
+#include "Detect/analysis/analysis_evidence.h"
+#include "Detect/analysis/analysis_sequence.h"
+#include "Detect/utils/callable.h"
+#include "Detect/object/object_common.h"
+#include "Detect/utils/module.h"
+
+/* detect模块的解释器级状态，挂载在PyInterpreterState的detect_state字段上 */
+typedef struct {
+	bool has_init;                  // 当前解释器是否已经初始化了detect模块
+	bool is_sub_interpreter;        // 是否为子解释器扫描模式
+	bool is_finished;               // 子解释器扫描模式下，是否已经结束检测，结束后不再记录和分析
+	bool need_stop;                 // 子解释器扫描模式下，是否需要持续停止脚本执行
+	DETECT_RUN_STATE run_state;     // 运行状态
+	_PyTime_t virtual_clock_offset; // 虚拟时钟偏移，单位为纳秒
+	PyObject *virtual_fs_dict;      // 虚拟文件系统的覆盖层，key为绝对路径，value为memfd或代表已删除的None
+	PyObject *virtual_thread_queue;     // 等待调度的虚拟线程队列，元素为新启动线程的(func, args, kwargs, ident)或被唤醒线程的capsule
+	PyObject *virtual_thread_sentinel;  // 正在运行的虚拟线程的结束哨兵锁
+	unsigned long virtual_thread_ident; // 正在运行的虚拟线程的标识
+	unsigned long virtual_thread_next_ident; // 最近分配的虚拟线程标识
+	int virtual_thread_depth;           // 虚拟线程的嵌套运行深度，0表示主线程
+	long virtual_thread_opcode_count;   // 当前线程自上次调度以来执行的opcode数量
+	bool virtual_thread_interrupted;    // 是否因opcode预算用尽向当前虚拟线程投递了SystemExit
+	PyObject *virtual_thread_blocked_queue; // 等待锁而挂起的虚拟线程，元素为(capsule, lock)，锁释放时重新调度
+	struct _detect_virtual_thread *virtual_thread_current; // 正在运行的虚拟线程，主线程为NULL
+	PyObject *result_dict;          // 子解释器扫描模式下的检测结果字典
+
+	/* 外部输入、威胁、自定义和库函数摘要配置字典 */
+	PyObject *taint_input_class_dict;
+	PyObject *taint_input_method_dict;
+	PyObject *taint_input_func_dict;
+	PyObject *taint_input_var_dict;
+	PyObject *taint_input_all_dict;
+	PyObject *threat_class_dict;
+	PyObject *threat_method_dict;
+	PyObject *threat_func_dict;
+	PyObject *threat_all_dict;
+	PyObject *custom_class_dict;
+	PyObject *custom_method_dict;
+	PyObject *custom_func_dict;
+	PyObject *custom_all_dict;
+	PyObject *summary_func_dict;
+
+	/* record模块 */
+	PyObject *entered_code_set;            // 执行过的非lib代码的code对象集合，用于探索未被调用过的函数
+	Py_ssize_t coverage_extra_index;       // 指令覆盖位图在co_extra中的索引，未申请时为-1
+
+	/* analysis模块 */
+	PyObject *analysis_func_list;          // 分析函数列表
+	PyObject *malicious_commands_list;     // 恶意命令列表
+	DETECT_ANALYSIS_EVIDENCE_T evidence;   // 跨线程合并的证据库
+	DETECT_SEQ_AUTOMATON_T *sequence_automaton; // 序列规则自动机
+	atomic_int sequence_state;             // 序列规则自动机的当前状态
+	PyObject *finding_dict;                // 得分未达到阈值时权重最高的检测结论
+	long finding_weight;                   // 该检测结论的权重
+	PyObject *stage_stack;                 // 正在执行的嵌套阶段名栈
+	PyObject *stage_sample_filename;       // 进入阶段前样本本身的路径
+	int stage_count;                       // 已经展开的阶段数量
+
+	/* object模块 */
+	PyObject *undef_object;                // undefined对象单例
+	DETECT_OBJECT_FREELIST_T object_freelists[DETECT_OBJECT_FREELIST_MAX]; // hook对象空闲链表
+
+	/* utils模块 */
+	PyObject *re_module;                   // re模块
+	PyObject *re_search_method;            // re.search方法
+	PyObject *lib_path;                    // lib目录
+	CALLABLE_CFUNC_CACHE_ENTRY_T cfunc_cache[CALLABLE_CFUNC_CACHE_SIZE]; // c方法模块名缓存
+	PyObject *missing_module_dicts[MODULE_MISSING_KIND_MAX]; // 缺失模块的负缓存，key为模块绝对名，value为代替模块的对象
+	PyObject *missing_module_sys_path;     // 建立负缓存时sys.path的快照，元组
+	PyObject *missing_module_meta_path;    // 建立负缓存时sys.meta_path的快照，元组
+} DETECT_STATE_T;
+
+/**
+ * @description: 获取当前解释器的detect状态，未初始化detect模块时为NULL
+ * @return DETECT_STATE_T*
+ */
+static inline DETECT_STATE_T* detect_state_get() {
+	return (DETECT_STATE_T*)_PyInterpreterState_GET()->detect_state;
+}
+
+/* 所有字段均为零值的只读默认状态 */
+extern const DETECT_STATE_T g_detect_state_default;
+
+/**
+ * @description: 获取当前解释器的detect状态用于读取字段，未初始化detect模块的解释器(例如样本自行创建的子解释器)
+ *               返回只读的默认状态。各模块的状态字段访问宏基于该函数，赋值需要通过detect_state_get()
+ * @return const DETECT_STATE_T*
+ */
+static inline const DETECT_STATE_T* detect_state_get_or_default() {
+	DETECT_STATE_T *state = detect_state_get();
+
+	return state != NULL ? state : &g_detect_state_default;
+}
+
+extern DETECT_STATE_T* detect_state_create();
+extern void detect_state_clear(PyInterpreterState *interp);
+
+#endif
@@ -10,8 +10,11 @@
 #include "Detect/hook/hook_object.h"
 #include "Detect/hook/hook_indirect_taint.h"
 #include "Detect/object/object.h"
+#include "Detect/virtual/virtual_process.h"
+#include "Detect/virtual/virtual_thread.h"
 #include "Detect/utils/module.h"
 #include "Detect/utils/dict.h"
+#include "Detect/detect_state.h"
 
 /**
  * @description: 根据配置表字典，导入未导入的模块
@@ -36,7 +39,10 @@ static int detect_hook_import_config_dict_modules(PyObject *config_dict) {
 		if (NULL == PyImport_Import(module_name)) {
 			PyObject *new_module_obj_list;
 			int index;
-		
+
+			/* __import__不存在的模块会抛出异常，创建模块前需先清除，否则带着异常再次导入 */
+			PyErr_Clear();
+
 			/* 如果模块不存在，创建新的模块对象 */			
 			new_module_obj_list = module_create_module(module_name);
 
@@ -45,9 +51,6 @@ static int detect_hook_import_config_dict_modules(PyObject *config_dict) {
 				PyModule_AddObject(PyList_GetItem(new_module_obj_list, index), 
 									"__getattr__", detect_object_undef_object_create());
 			}
-
-			/* __import__不存在的模块会抛出异常 */
-			PyErr_Clear();
 		}
 	}
 
@@ -89,6 +92,12 @@ int detect_hook_init() {
 	/* 初始化间接污染模块 */
 	detect_hook_indirect_taint_init();
 
+	/* multiprocessing的子进程和进程池任务改为内联执行 */
+	detect_virtual_process_init();
+
+	/* threading的线程改为在主线程上协作调度 */
+	detect_virtual_thread_init();
+
 	return ret;
 }
 
@@ -11,9 +11,10 @@
 #include "frameobject.h"
 #include "Detect/hook/hook_indirect_taint.h"
 #include "Detect/utils/list.h"
+#include "Detect/detect_context.h"
 
-/* 污染区栈 */
-static PyObject *taint_area_stack;
+/* 污染区栈保存在线程级的detect上下文中，没有上下文时为NULL */
+#define taint_area_stack (detect_context_get_or_default()->taint_area_stack)
 
 /**
   * @description: 释放污染区
@@ -39,7 +40,7 @@ static bool detect_hook_indirect_taint_check_in_taint_area(PyFrameObject *frame)
 	DETECT_INDIRECT_TAINT_AREA_T *top_taint_area;
 	int current_opcode_index;
 
-	if (PyList_Size(taint_area_stack) == 0) {
+	if (taint_area_stack == NULL || PyList_Size(taint_area_stack) == 0) {
 		return false;
 	}
 
@@ -72,7 +73,7 @@ void detect_hook_indirect_taint_set_area(PyFrameObject *frame, int opcode, int o
 	DETECT_INDIRECT_TAINT_AREA_T *new_taint_area;
 
 	/* 检查当前是否已经处于污染区 */
-	if (detect_hook_indirect_taint_check_in_taint_area(frame)) {
+	if (taint_area_stack == NULL || detect_hook_indirect_taint_check_in_taint_area(frame)) {
 		return;
 	}
 
@@ -178,7 +179,8 @@ void detect_hook_indirect_taint_pop_area(PyFrameObject *frame, int opcode, int s
   * @return void
   */
 void detect_hook_indirect_taint_init() {
-	taint_area_stack = PyList_New(0);
+	/* 污染区栈随线程上下文一起创建，这里只需要为主线程创建上下文 */
+	detect_context_get();
 
 	return;
 }
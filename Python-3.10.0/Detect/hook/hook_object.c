@@ -11,6 +11,7 @@
 #include "Detect/object/object.h"
 #include "Detect/utils/module.h"
 #include "Detect/utils/dict.h"
+#include "Detect/detect_state.h"
 
  /**
   * @description: 根据类、函数和变量配置字典，替换指定的对象为hook对象
@@ -12,8 +12,11 @@
 #include "Detect/hook/hook_opcode_prev_handlers.h"
 #include "Detect/hook/hook_indirect_taint.h"
 #include "Detect/record/record.h"
+#include "Detect/record/record_coverage.h"
 #include "Detect/analysis/analysis.h"
 #include "Detect/utils/frame.h"
+#include "Detect/virtual/virtual_thread.h"
+#include "Detect/detect_state.h"
 
 /**
   * @description: opcode处理前函数
@@ -25,15 +28,35 @@
   */
 int detect_hook_opcode_prev_handler(PyThreadState *tstate, PyObject ***stack_pointer_addr, int opcode, int oparg) {
 	int skip_count = 0;
+	DETECT_STATE_T *state = detect_state_get();
+
+	/* 子解释器已经结束检测，脚本尚未停止时继续停止脚本执行 */
+	if (state != NULL && state->is_finished) {
+		if (state->need_stop) {
+			detect_analysis_stop_sub_interpreter();
+		}
+		return skip_count;
+	}
 
 	/* 检查是否需要进行opcode处理 */
 	if (!detect_record_need_record(tstate, tstate->frame)) {
 		return skip_count;
 	}
 
+	/* 记录指令覆盖 */
+	detect_record_coverage_mark(tstate, tstate->frame);
+
 	/* 进行实时检测分析 */
 	detect_analysis_main_proc();
 
+	/* 按opcode预算调度虚拟线程 */
+	detect_virtual_thread_tick();
+
+	/* 子解释器在本次分析或者被调度的虚拟线程中得出了检测结论，不再执行当前opcode的hook逻辑 */
+	if (state->is_finished) {
+		return skip_count;
+	}
+
 	/* opcode自定义处理逻辑 */
 	switch (opcode) {
 	/* frame栈操作opcode，无需hook */
@@ -103,7 +126,8 @@ int detect_hook_opcode_prev_handler(PyThreadState *tstate, PyObject ***stack_poi
 	case DELETE_SUBSCR:
 		break;
 
-	/* 协程操作符opcode */
+	/* 协程操作符opcode，hook对象实现了tp_as_async和__aenter__/__aexit__，
+	   await hook对象立即得到自身，无需hook */
 	case GET_AWAITABLE:
 	case GET_AITER:
 	case GET_ANEXT:
@@ -1,13 +1,24 @@
 #ifndef DETECT_HOOK_OPCODE_H
 #define DETECT_HOOK_OPCODE_H
 
+#include "Detect/detect_profile.h"
+
 extern int detect_hook_opcode_prev_handler(PyThreadState *frame, PyObject ***stack_pointer, int opcode, int oparg);
 extern int detect_hook_opcode_after_handler(PyThreadState *frame, PyObject ***stack_pointer, int opcode, int oparg);
 
-/* opcode处理前函数在虚拟机的dispatch_opcode标签下调用 */
+/* opcode处理前函数在虚拟机的dispatch_opcode标签下调用。未开启采样时只有一次判断，
+   不维护采样标记也不检查待汇总的采样 */
 #define DETECT_OPCODE_PREV_HANDLE(tstate, stack_pointer_addr, opcode, oparg) \
 	do { \
-        int skip_count = detect_hook_opcode_prev_handler(tstate, stack_pointer_addr, opcode, oparg); \
+		int skip_count; \
+		if (g_detect_profile_is_started) { \
+			DETECT_PROFILE_POLL(); \
+			DETECT_PROFILE_ENTER(); \
+			skip_count = detect_hook_opcode_prev_handler(tstate, stack_pointer_addr, opcode, oparg); \
+			DETECT_PROFILE_LEAVE(); \
+		} else { \
+			skip_count = detect_hook_opcode_prev_handler(tstate, stack_pointer_addr, opcode, oparg); \
+		} \
 		if (skip_count > 0) { \
 			/* 跳过包括当前opcode的后续skip_count个opcode的执行 */ \
 			JUMPBY(skip_count-1); \
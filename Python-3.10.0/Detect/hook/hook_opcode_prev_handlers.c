@@ -14,6 +14,10 @@
 #include "Detect/hook/hook_opcode_macro.h"
 #include "Detect/hook/hook_indirect_taint.h"
 #include "Detect/analysis/analysis.h"
+#include "Detect/analysis/analysis_evidence.h"
+#include "Detect/configs/threat_def.h"
+#include "Detect/virtual/virtual_process.h"
+#include "Detect/virtual/virtual_thread.h"
 #include "Detect/utils/module.h"
 #include "Detect/utils/frame.h"
 #include "Detect/utils/exception.h"
@@ -43,6 +47,80 @@ static PyObject* detect_hook_get_func_param_need_return(PyObject **p_stack, Py_s
 	return res;
 }
 
+/**
+  * @description: 根据库函数摘要传播外部输入，摘要中参数位置上有object模块的对象时，返回该对象作为函数的返回值
+  * @param func 可调用对象
+  * @param args 位置参数数组
+  * @param nargs 位置参数数量
+  * @return PyObject* object模块对象，为NULL时代表未命中摘要，需要正常调用
+  */
+static PyObject* detect_hook_get_func_summary_return(PyObject *func, PyObject *const *args, Py_ssize_t nargs) {
+	PyObject *pos_list;
+	PyObject *res = NULL;
+	Py_ssize_t index, pos;
+
+	/* 参数中没有object模块的对象时无需查找摘要 */
+	for (index = 0; index < nargs; index++) {
+		if (detect_object_get_object_type(args[index]) < DETECT_OBJECT_TYPE_MAX) {
+			break;
+		}
+	}
+	if (index == nargs) {
+		return NULL;
+	}
+
+	pos_list = detect_config_summary_def_get_taint_pos(func);
+	if (pos_list == NULL) {
+		return NULL;
+	}
+
+	for (index = 0; index < PyList_GET_SIZE(pos_list); index++) {
+		pos = PyLong_AsSsize_t(PyList_GET_ITEM(pos_list, index));
+
+		/* -1代表任意位置的参数 */
+		if (pos == -1) {
+			return detect_hook_get_func_param_need_return((PyObject **)args + nargs, nargs);
+		}
+
+		if (pos >= 1 && pos <= nargs &&
+			detect_object_get_object_type(args[pos-1]) < detect_object_get_object_type(res)) {
+			res = args[pos-1];
+		}
+	}
+
+	Py_XINCREF(res);
+
+	return res;
+}
+
+/**
+  * @description: 命中库函数摘要时不进入被调函数，直接将可调用对象及其参数全部出栈
+  * @param stack_pointer_addr 栈顶指针的地址
+  * @param oparg 当前opcode的参数
+  * @param kwnames 关键字参数名的元组
+  * @return PyObject* 函数返回值，为NULL时代表未命中摘要，栈保持不变
+  */
+static PyObject* detect_hook_call_function_by_summary(PyObject ***pp_stack,
+              						 Py_ssize_t oparg,
+              						 PyObject *kwnames) {
+	PyObject **pfunc = (*pp_stack) - oparg - 1; // 获取可调用对象
+	Py_ssize_t nkwargs = (kwnames == NULL) ? 0 : PyTuple_GET_SIZE(kwnames); // 获取关键字参数的数量
+	PyObject *x, *w;
+
+	x = detect_hook_get_func_summary_return(*pfunc, pfunc + 1, oparg - nkwargs);
+	if (x == NULL) {
+		return NULL;
+	}
+
+	/* 将可调用对象及其参数全部出栈 */
+	while ((*pp_stack) > pfunc) {
+		w = EXT_POP(*pp_stack);
+		Py_DECREF(w);
+	}
+
+	return x;
+}
+
 /**
   * @description: 函数调用的处理逻辑
   * @param tstate 当前线程对象
@@ -75,6 +153,116 @@ static PyObject* detect_hook_call_function(PyThreadState *tstate,
     return x;
 }
 
+/* 类型是否实现了指定的数值、序列或映射槽位 */
+#define NB_SLOT(tp, slot) ((tp)->tp_as_number != NULL && (tp)->tp_as_number->slot != NULL)
+#define SQ_SLOT(tp, slot) ((tp)->tp_as_sequence != NULL && (tp)->tp_as_sequence->slot != NULL)
+#define MP_SLOT(tp, slot) ((tp)->tp_as_mapping != NULL && (tp)->tp_as_mapping->slot != NULL)
+
+ /**
+   * @description: 判断类型是否实现了二元操作符对应的槽位
+   * @param tp 操作数类型
+   * @param opcode opcode
+   * @return bool
+   */
+static bool detect_hook_binary_type_has_slot(PyTypeObject *tp, int opcode) {
+	switch (opcode) {
+	case BINARY_POWER:
+		return NB_SLOT(tp, nb_power);
+	case BINARY_MULTIPLY:
+		return NB_SLOT(tp, nb_multiply) || SQ_SLOT(tp, sq_repeat);
+	case BINARY_MATRIX_MULTIPLY:
+		return NB_SLOT(tp, nb_matrix_multiply);
+	case BINARY_TRUE_DIVIDE:
+		return NB_SLOT(tp, nb_true_divide);
+	case BINARY_FLOOR_DIVIDE:
+		return NB_SLOT(tp, nb_floor_divide);
+	case BINARY_MODULO:
+		return NB_SLOT(tp, nb_remainder);
+	case BINARY_ADD:
+		return NB_SLOT(tp, nb_add) || SQ_SLOT(tp, sq_concat);
+	case BINARY_SUBTRACT:
+		return NB_SLOT(tp, nb_subtract);
+	case BINARY_SUBSCR:
+		return MP_SLOT(tp, mp_subscript) || SQ_SLOT(tp, sq_item);
+	case BINARY_LSHIFT:
+		return NB_SLOT(tp, nb_lshift);
+	case BINARY_RSHIFT:
+		return NB_SLOT(tp, nb_rshift);
+	case BINARY_AND:
+		return NB_SLOT(tp, nb_and);
+	case BINARY_XOR:
+		return NB_SLOT(tp, nb_xor);
+	case BINARY_OR:
+		return NB_SLOT(tp, nb_or);
+
+	/* 原地操作符未实现时会回退到对应的二元操作符 */
+	case INPLACE_POWER:
+		return NB_SLOT(tp, nb_inplace_power) || NB_SLOT(tp, nb_power);
+	case INPLACE_MULTIPLY:
+		return NB_SLOT(tp, nb_inplace_multiply) || NB_SLOT(tp, nb_multiply) ||
+			   SQ_SLOT(tp, sq_inplace_repeat) || SQ_SLOT(tp, sq_repeat);
+	case INPLACE_MATRIX_MULTIPLY:
+		return NB_SLOT(tp, nb_inplace_matrix_multiply) || NB_SLOT(tp, nb_matrix_multiply);
+	case INPLACE_TRUE_DIVIDE:
+		return NB_SLOT(tp, nb_inplace_true_divide) || NB_SLOT(tp, nb_true_divide);
+	case INPLACE_FLOOR_DIVIDE:
+		return NB_SLOT(tp, nb_inplace_floor_divide) || NB_SLOT(tp, nb_floor_divide);
+	case INPLACE_MODULO:
+		return NB_SLOT(tp, nb_inplace_remainder) || NB_SLOT(tp, nb_remainder);
+	case INPLACE_ADD:
+		return NB_SLOT(tp, nb_inplace_add) || NB_SLOT(tp, nb_add) ||
+			   SQ_SLOT(tp, sq_inplace_concat) || SQ_SLOT(tp, sq_concat);
+	case INPLACE_SUBTRACT:
+		return NB_SLOT(tp, nb_inplace_subtract) || NB_SLOT(tp, nb_subtract);
+	case INPLACE_LSHIFT:
+		return NB_SLOT(tp, nb_inplace_lshift) || NB_SLOT(tp, nb_lshift);
+	case INPLACE_RSHIFT:
+		return NB_SLOT(tp, nb_inplace_rshift) || NB_SLOT(tp, nb_rshift);
+	case INPLACE_AND:
+		return NB_SLOT(tp, nb_inplace_and) || NB_SLOT(tp, nb_and);
+	case INPLACE_XOR:
+		return NB_SLOT(tp, nb_inplace_xor) || NB_SLOT(tp, nb_xor);
+	case INPLACE_OR:
+		return NB_SLOT(tp, nb_inplace_or) || NB_SLOT(tp, nb_or);
+
+	case COMPARE_OP:
+		return tp->tp_richcompare != NULL;
+	default:
+		return false;
+	}
+}
+
+ /**
+   * @description: 在真正执行二元操作之前判断是否可能执行成功。hook类没有实现数值、序列和映射槽位，
+   *               内置类型的槽位也不接受hook对象作为操作数，尝试执行只会构造TypeError后再被清除，
+   *               所以只有操作数为实现了对应魔术方法的自定义类型，或者下标操作的左操作数为字典时才尝试执行
+   * @param left 左操作数
+   * @param right 右操作数
+   * @param opcode opcode
+   * @param oparg 当前opcode的参数
+   * @return bool true --- 需要尝试执行，false --- 直接返回优先级高的操作数
+   */
+static bool detect_hook_binary_can_dispatch(PyObject *left, PyObject *right, int opcode, int oparg) {
+	PyTypeObject *left_tp  = Py_TYPE(left);
+	PyTypeObject *right_tp = Py_TYPE(right);
+
+	/* ==和!=的结果总是置为object模块对象，无需执行 */
+	if (opcode == COMPARE_OP && (oparg == Py_EQ || oparg == Py_NE)) {
+		return false;
+	}
+
+	if (PyType_HasFeature(left_tp, Py_TPFLAGS_HEAPTYPE) && detect_hook_binary_type_has_slot(left_tp, opcode)) {
+		return true;
+	}
+
+	/* 下标操作只由左操作数决定。内置字典接受任意可哈希的键，hook对象作为键时查找仍可能成功 */
+	if (opcode == BINARY_SUBSCR) {
+		return PyDict_Check(left);
+	}
+
+	return PyType_HasFeature(right_tp, Py_TPFLAGS_HEAPTYPE) && detect_hook_binary_type_has_slot(right_tp, opcode);
+}
+
  /**
    * @description: 二元操作符处理执行函数
    * @param left 左操作数
@@ -229,20 +417,23 @@ int detect_hook_opcode_binary_prev_handler(PyThreadState *tstate, PyObject ***st
 		PyObject *right = POP();
     	PyObject *left  = TOP();
 
-		/* 之所以尝试执行是因为不能错过left定义了相关魔术方法的情况 */
-		res = detect_hook_binary_execute(left, right, opcode, oparg);
+		/* 之所以尝试执行是因为不能错过操作数定义了相关魔术方法的情况，不可能成功时不再尝试 */
+		res = NULL;
+		if (detect_hook_binary_can_dispatch(left, right, opcode, oparg)) {
+			res = detect_hook_binary_execute(left, right, opcode, oparg);
+			PyErr_Clear();
+		}
 		
-		/* 过程中发生了异常 */
+		/* 过程中发生了异常或者无需执行 */
 		if (res == NULL) {
 			res = right_type > left_type ? left : right;
+			Py_INCREF(res);
 		}
 
-		Py_INCREF(res);
 		SET_TOP(res);
 
 		Py_DECREF(left);
    	    Py_DECREF(right);
-		PyErr_Clear();
 	}
 
 	return skip_count;
@@ -263,16 +454,36 @@ int detect_hook_opcode_import_name_prev_handler(PyThreadState *tstate, PyObject
     PyObject *fromlist = POP();
     PyObject *level = TOP();
     PyObject *res;
+	bool is_absolute = PyLong_CheckExact(level) && _PyLong_Sign(level) == 0;
+	/* fromlist为空时import语句的值为顶层模块，非空时为模块本身，两种值分开缓存 */
+	MODULE_MISSING_KIND_E kind = fromlist == Py_None || !PyObject_IsTrue(fromlist) ?
+								 MODULE_MISSING_IMPORT : MODULE_MISSING_IMPORT_FROM;
+
+	/* 已知缺失的模块直接使用缓存的未定义对象，不再重复搜索导入路径 */
+	if (is_absolute && (res = module_missing_cache_get(name, kind)) != NULL) {
+		SET_TOP(res);
+		Py_DECREF(level);
+		Py_DECREF(fromlist);
+
+		/* 跳过当前opcode的执行 */
+		skip_count = 1;
+		return skip_count;
+	}
 
 	/* 导入指定模块 */
 	res = module_import_name(tstate, frame, name, fromlist, level);
 
 	/* 因为模块未找到而导入失败 */
     if (res == NULL && exception_get_curexectype() == PyExc_ModuleNotFoundError) {
-		/* 创建一个未定义对象来代替模块对象 */
+		/* 创建一个未定义对象来代替模块对象，按模块绝对名加入负缓存 */
 		PyObject *undef_object = detect_object_undef_object_create();
 		SET_TOP(undef_object);
 
+		if (is_absolute) {
+			PyErr_Clear();
+			module_missing_cache_set(name, kind, undef_object);
+		}
+
 		/* 跳过当前opcode的执行 */
 		skip_count = 1;
 
@@ -287,6 +498,17 @@ int detect_hook_opcode_import_name_prev_handler(PyThreadState *tstate, PyObject
 		
 		/* 导入成功，无需再执行当前opcode */
 		SET_TOP(res);
+
+		/* 导入了包含威胁调用的模块，作为是否需要展平分支再检测的证据 */
+		if (detect_config_threat_def_is_threat_module(name)) {
+			detect_analysis_evidence_set(DETECT_EVIDENCE_THREAT_MODULE);
+		}
+
+		/* multiprocessing.pool在使用时才导入，导入后替换为内联进程池 */
+		detect_virtual_process_patch_pool(name);
+
+		/* concurrent.futures.thread在使用时才导入，导入后线程池改为启动虚拟工作线程 */
+		detect_virtual_thread_patch_executor();
 		skip_count = 1;
 		Py_DECREF(level);
     	Py_DECREF(fromlist);
@@ -363,6 +585,13 @@ int detect_hook_opcode_call_function_prev_handler(PyThreadState *tstate, PyObjec
 	PyObject *res;      // 函数返回值
 	PyObject *res_tmp;
 
+	/* 命中库函数摘要时直接传播外部输入，不进入被调函数 */
+	res = detect_hook_call_function_by_summary(stack_pointer_addr, oparg, NULL);
+	if (res != NULL) {
+		PUSH(res);
+		return skip_count;
+	}
+
 	/* 检测函数参数是否包含object模块中类实例对象 */
 	res_tmp = detect_hook_get_func_param_need_return(*stack_pointer_addr, oparg);
 	
@@ -404,6 +633,14 @@ int detect_hook_opcode_call_function_kw_prev_handler(PyThreadState *tstate, PyOb
 	PyObject *res;           // 函数返回值
 	PyObject *res_tmp;
 
+	/* 命中库函数摘要时直接传播外部输入，不进入被调函数 */
+	res = detect_hook_call_function_by_summary(stack_pointer_addr, oparg, names);
+	if (res != NULL) {
+		PUSH(res);
+		Py_DECREF(names);
+		return skip_count;
+	}
+
 	/* 检测函数参数是否包含object模块中类实例对象 */
 	res_tmp = detect_hook_get_func_param_need_return(*stack_pointer_addr, oparg);
 
@@ -477,10 +714,16 @@ int detect_hook_opcode_call_function_ex_prev_handler(PyThreadState *tstate, PyOb
         }
     }
 
-	/* 获取参数中的object模块中类实例对象 */
-	res_tmp = detect_object_get_highest_priority_item_by_args_and_kwargs(callargs, kwargs);
+	/* 命中库函数摘要时直接传播外部输入，不进入被调函数 */
+	res = detect_hook_get_func_summary_return(func, &PyTuple_GET_ITEM(callargs, 0), PyTuple_GET_SIZE(callargs));
+	if (res != NULL) {
+		res_tmp = NULL;
+	} else {
+		/* 获取参数中的object模块中类实例对象 */
+		res_tmp = detect_object_get_highest_priority_item_by_args_and_kwargs(callargs, kwargs);
 
-    res = PyObject_Call(func, callargs, kwargs);
+		res = PyObject_Call(func, callargs, kwargs);
+	}
 
 	/* 如果函数调用时发生了异常，那么清除异常 */
 	if (res == NULL) {
@@ -520,6 +763,14 @@ int detect_hook_opcode_call_method_prev_handler(PyThreadState *tstate, PyObject
 
     meth = PEEK(oparg + 2);
     if (meth == NULL) {
+		/* 命中库函数摘要时直接传播外部输入，不进入被调函数 */
+		res = detect_hook_call_function_by_summary(stack_pointer_addr, oparg, NULL);
+		if (res != NULL) {
+			(void)POP(); /* POP the NULL. */
+			PUSH(res);
+			return skip_count;
+		}
+
         /* 绑定方法 */
 		res_tmp = detect_hook_get_func_param_need_return(*stack_pointer_addr, oparg);
         res = detect_hook_call_function(tstate, stack_pointer_addr, oparg, NULL);
@@ -554,6 +805,135 @@ int detect_hook_opcode_call_method_prev_handler(PyThreadState *tstate, PyObject
 	return skip_count;
 }
 
+/**
+  * @description: 判断指令是否为异常处理代码的入口，即SETUP_FINALLY、SETUP_WITH或SETUP_ASYNC_WITH的跳转目标。
+  *               分支展平时顺序执行到异常处理入口会在没有异常的栈上执行，跳转或返回指令不能跳过
+  * @param code code对象
+  * @param target 指令的下标
+  * @return bool
+  */
+static bool detect_hook_is_handler_entry(PyCodeObject *code, int target) {
+	const _Py_CODEUNIT *first_instr = (_Py_CODEUNIT *) PyBytes_AS_STRING(code->co_code);
+	int count = (int)(PyBytes_GET_SIZE(code->co_code) / sizeof(_Py_CODEUNIT));
+	int index, opcode, oparg = 0;
+
+	for (index = 0; index < count; index++) {
+		opcode = _Py_OPCODE(first_instr[index]);
+		oparg  = _Py_OPARG(first_instr[index]) | oparg;
+		if (opcode == EXTENDED_ARG) {
+			oparg <<= 8;
+			continue;
+		}
+
+		if ((opcode == SETUP_FINALLY || opcode == SETUP_WITH || opcode == SETUP_ASYNC_WITH) &&
+			index + 1 + oparg == target) {
+			return true;
+		}
+		oparg = 0;
+	}
+
+	return false;
+}
+
+/**
+  * @description: 判断指令是否为async for循环的头部，即紧接着GET_ANEXT的SETUP_FINALLY。async for依靠该块捕获
+  *               StopAsyncIteration结束循环，分支展平时不能像try块一样跳过，回到循环头部的跳转也不能跳过
+  * @param code code对象
+  * @param index 指令的下标
+  * @return bool
+  */
+static bool detect_hook_is_async_for_head(PyCodeObject *code, int index) {
+	const _Py_CODEUNIT *first_instr = (_Py_CODEUNIT *) PyBytes_AS_STRING(code->co_code);
+	int count = (int)(PyBytes_GET_SIZE(code->co_code) / sizeof(_Py_CODEUNIT));
+
+	return index >= 0 && index + 1 < count &&
+		   _Py_OPCODE(first_instr[index]) == SETUP_FINALLY && _Py_OPCODE(first_instr[index + 1]) == GET_ANEXT;
+}
+
+/**
+  * @description: 判断跳转目标是否为包含当前指令的for循环的出口，即break语句的跳转目标
+  * @param code code对象
+  * @param index 当前指令的下标
+  * @param target 跳转目标的下标
+  * @return bool
+  */
+static bool detect_hook_is_for_loop_exit(PyCodeObject *code, int index, int target) {
+	const _Py_CODEUNIT *first_instr = (_Py_CODEUNIT *) PyBytes_AS_STRING(code->co_code);
+	int pos, opcode, oparg = 0;
+
+	for (pos = 0; pos < index; pos++) {
+		opcode = _Py_OPCODE(first_instr[pos]);
+		oparg  = _Py_OPARG(first_instr[pos]) | oparg;
+		if (opcode == EXTENDED_ARG) {
+			oparg <<= 8;
+			continue;
+		}
+
+		if (opcode == FOR_ITER && pos + 1 + oparg == target) {
+			return true;
+		}
+		oparg = 0;
+	}
+
+	return false;
+}
+
+/**
+  * @description: 计算JUMP_FORWARD跳过的else分支在正常执行时的栈深度变化。条件表达式的两个分支各自入栈一个值，
+  *               分支展平时顺序执行两个分支会多留下if分支的值，循环中会不断累积直到栈溢出。分支中有循环、
+  *               异常处理等无法按顺序计算的指令时返回0
+  * @param code code对象
+  * @param start else分支第一个指令的下标
+  * @param end JUMP_FORWARD跳转目标的下标
+  * @return int 栈深度的增加量
+  */
+static int detect_hook_else_branch_stack_effect(PyCodeObject *code, int start, int end) {
+	const _Py_CODEUNIT *first_instr = (_Py_CODEUNIT *) PyBytes_AS_STRING(code->co_code);
+	int pos, opcode, oparg = 0, effect, depth = 0;
+
+	for (pos = start; pos < end; pos++) {
+		opcode = _Py_OPCODE(first_instr[pos]);
+		oparg  = _Py_OPARG(first_instr[pos]) | oparg;
+		if (opcode == EXTENDED_ARG) {
+			oparg <<= 8;
+			continue;
+		}
+
+		switch (opcode) {
+		case JUMP_FORWARD:
+			/* 嵌套的条件表达式，沿正常执行的路径跳过其else分支 */
+			pos += oparg;
+			break;
+		case POP_JUMP_IF_FALSE:
+		case POP_JUMP_IF_TRUE:
+		case JUMP_IF_FALSE_OR_POP:
+		case JUMP_IF_TRUE_OR_POP:
+			depth += PyCompile_OpcodeStackEffectWithJump(opcode, oparg, 0);
+			break;
+		case FOR_ITER:
+		case JUMP_ABSOLUTE:
+		case JUMP_IF_NOT_EXC_MATCH:
+		case SETUP_FINALLY:
+		case SETUP_WITH:
+		case SETUP_ASYNC_WITH:
+		case RETURN_VALUE:
+		case RAISE_VARARGS:
+		case RERAISE:
+			return 0;
+		default:
+			effect = PyCompile_OpcodeStackEffectWithJump(opcode, oparg, 0);
+			if (effect == PY_INVALID_STACK_EFFECT) {
+				return 0;
+			}
+			depth += effect;
+			break;
+		}
+		oparg = 0;
+	}
+
+	return pos == end && depth > 0 ? depth : 0;
+}
+
 /**
   * @description: opcode RETURN_VALUE处理前函数定义
   * @param tstate 当前线程对象
@@ -568,8 +948,19 @@ int detect_hook_opcode_return_value_prev_handler(PyThreadState *tstate, PyObject
 	/* 判断该opcode是否需要跳过，如果该return不是字节码对象的最后一个opcode，
 	 * 代表其可能为代码底部一个循环的break，二次执行时我们跳过它即可 */
 	if (detect_config_get_runtime_is_jump_branch()) {
+		const _Py_CODEUNIT *first_instr = (_Py_CODEUNIT *) PyBytes_AS_STRING(tstate->frame->f_code->co_code);
+		int lasti = tstate->frame->f_lasti;
+
+		/* for循环中的return之前已经通过ROT_TWO、POP_TOP弹出了迭代器，跳过return后回到FOR_ITER时
+		 * 栈上已经没有迭代器；return之后紧接着异常处理代码时也无法继续执行，此时只能正常返回 */
+		if ((lasti >= 2 && _Py_OPCODE(first_instr[lasti - 1]) == POP_TOP &&
+			 _Py_OPCODE(first_instr[lasti - 2]) == ROT_TWO) ||
+			detect_hook_is_handler_entry(tstate->frame->f_code, lasti + 1)) {
+			return skip_count;
+		}
+
 		code_size = PyBytes_Size(tstate->frame->f_code->co_code) / 2;
-		if (tstate->frame->f_lasti +1 < code_size) {
+		if (lasti + 1 < code_size) {
 			/* 代表不是最后一个opcode，选择跳过 */
 			skip_count = 1;
 
@@ -622,15 +1013,23 @@ int detect_hook_opcode_jump_forward_prev_handler(PyThreadState *tstate, PyObject
 		/* 判断其上一个opcode是否为POP_BLOCK,是的话代表为try块中最后一个opcode，
 		 * 目前先跳过except部分代码，后续再研究异常*/
 		const _Py_CODEUNIT *first_instr, *last_instr;
-		int opcode;
+		int opcode, count;
 
 		first_instr = (_Py_CODEUNIT *) PyBytes_AS_STRING(tstate->frame->f_code->co_code);
 		last_instr = first_instr + tstate->frame->f_lasti - 1;
 
-		/* 判断上一个opcode，是try块和except块时不跳过 */
+		/* 判断上一个opcode，是try块和except块时不跳过；跳过的是with块等的异常处理部分时同样不跳过 */
 		opcode = _Py_OPCODE(*last_instr);
-		if (opcode != POP_BLOCK && opcode != POP_EXCEPT) {
+		if (opcode != POP_BLOCK && opcode != POP_EXCEPT &&
+			!detect_hook_is_handler_entry(tstate->frame->f_code, tstate->frame->f_lasti + 1)) {
 			skip_count = 1;
+
+			/* 条件表达式的if分支的值出栈，展平后以else分支的值作为结果 */
+			for (count = detect_hook_else_branch_stack_effect(tstate->frame->f_code, tstate->frame->f_lasti + 1,
+															  tstate->frame->f_lasti + 1 + oparg);
+				 count > 0; count--) {
+				Py_DECREF(POP());
+			}
 		}
 	}
 
@@ -703,7 +1102,7 @@ int detect_hook_opcode_jump_absolute_prev_handler(PyThreadState *tstate, PyObjec
 
 		/* 判断后面第一个opcode */
 		opcode = _Py_OPCODE(*jump_instr);
-		if (opcode == FOR_ITER) {
+		if (opcode == FOR_ITER || detect_hook_is_async_for_head(tstate->frame->f_code, oparg)) {
 			skip_count = 0;
 		} else {
 			skip_count = 1;			
@@ -786,6 +1185,12 @@ int detect_hook_opcode_pop_top_prev_handler(PyThreadState *tstate, PyObject ***s
 				break;
 			}
 
+			/* 跳转到包含当前指令的for循环的出口，break之后还有其他语句时只有这一个jump_absolute */
+			if (detect_hook_is_for_loop_exit(tstate->frame->f_code, tstate->frame->f_lasti, _Py_OPARG(*next_instr))) {
+				skip_count = 2;
+				break;
+			}
+
 			/* 判断后面第二个opcode */
 			next_instr++;
 			opcode = _Py_OPCODE(*next_instr);
@@ -846,8 +1251,9 @@ int detect_hook_opcode_pop_top_prev_handler(PyThreadState *tstate, PyObject ***s
 int detect_hook_opcode_setup_finally_prev_handler(PyThreadState *tstate, PyObject ***stack_pointer_addr, int oparg) {
 	int skip_count = 0;
 
-	/* 分支展平时先跳过，异常比较复杂，后续再深入解决 */
-	if (detect_config_get_runtime_is_jump_branch()) {
+	/* 分支展平时先跳过，异常比较复杂，后续再深入解决。async for的循环头部不能跳过 */
+	if (detect_config_get_runtime_is_jump_branch() &&
+		!detect_hook_is_async_for_head(tstate->frame->f_code, tstate->frame->f_lasti)) {
 		skip_count = 1;
 	}
 
@@ -10,6 +10,7 @@
 #include "Detect/object/object_common.h"
 #include "Detect/object/custom/object_custom_class.h"
 #include "Detect/utils/dict.h"
+#include "Detect/detect_state.h"
 
 /**
   * @description: custom类实例化对象初始化
@@ -17,6 +17,9 @@
 int detect_object_init() {
 	int ret = 0;
 
+	/* 初始化hook对象通用的辅助类型 */
+	ret = detect_object_common_init();
+
 	/* 初始化taint类 */
 	ret = detect_object_taint_class_init();
 
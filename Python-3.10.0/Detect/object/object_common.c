@@ -9,7 +9,9 @@
 #include "import.h"
 #include "object.h"
 #include "Detect/object/object_common.h"
+#include "pycore_object.h"
 #include "Detect/utils/dict.h"
+#include "Detect/detect_state.h"
 
 /**
   * @description: 判断给定对象是否为taint类的子类或者是其实例化对象
@@ -178,6 +180,10 @@ int detect_object_create_subclass(PyTypeObject *parent_class,
  
 		/* 子类初始化 */
 		ret = PyType_Ready((PyTypeObject*)subclass);
+
+		/* type.__new__会把子类的申请和释放函数重置为通用实现，这里改回使用空闲链表的实现 */
+		((PyTypeObject*)subclass)->tp_alloc = detect_object_class_alloc;
+		((PyTypeObject*)subclass)->tp_free  = detect_object_class_free;
  
 		/* 添加子类到配置字典 */
 		dict_setitem_string_object(value, HOOK_OBJECT_STRING, subclass);
@@ -325,41 +331,196 @@ void detect_object_class_dealloc(PyObject *self) {
 }
 
 /**
-* @description: 类的tp_iter通用函数, __iter__魔术方法通用实现
-* @param self 类实例对象
+* @description: 获取类型对应的hook对象空闲链表
+* @param type 类型对象
+* @return DETECT_OBJECT_FREELIST_T* 空闲链表，当前解释器未初始化detect模块时为NULL
+*/
+static DETECT_OBJECT_FREELIST_T* detect_object_get_freelist(PyTypeObject *type) {
+	DETECT_STATE_T *state = detect_state_get();
+	DETECT_OBJECT_FREELIST_T *freelist;
+
+	if (state == NULL) {
+		return NULL;
+	}
+
+	freelist = &state->object_freelists[PyType_IS_GC(type) ? DETECT_OBJECT_FREELIST_GC : DETECT_OBJECT_FREELIST_PLAIN];
+
+	/* 链表只缓存首次释放的对象大小，继承hook类时增加了字段的类型不进入链表 */
+	if (freelist->basicsize == 0) {
+		freelist->basicsize = type->tp_basicsize;
+	}
+
+	return freelist->basicsize == type->tp_basicsize ? freelist : NULL;
+}
+
+/**
+* @description: 类的tp_alloc通用函数，优先复用空闲链表中的对象
+* @param type 类型对象
+* @param nitems 可变长对象的元素数量
 * @return PyObject*
 */
-PyObject* detect_object_class_iter(PyObject *self) {
-	PyHookObject *hook_object = (PyHookObject *)self;
+PyObject* detect_object_class_alloc(PyTypeObject *type, Py_ssize_t nitems) {
+	DETECT_OBJECT_FREELIST_T *freelist = detect_object_get_freelist(type);
+	PyObject *obj;
 
-	/* 一次新的迭代，重置对象中的迭代计数 */
-	hook_object->iter_count = 0;
+	if (freelist == NULL || nitems != 0 || freelist->numfree == 0) {
+		return PyType_GenericAlloc(type, nitems);
+	}
 
-	Py_INCREF(self);
+	obj = freelist->items[--freelist->numfree];
 
-	return self;
+	/* 与PyType_GenericAlloc保持一致，先将对象memset 0后再做初始化 */
+	memset(obj, 0, type->tp_basicsize);
+	_PyObject_Init(obj, type);
+
+	if (PyType_IS_GC(type)) {
+		_PyObject_GC_TRACK(obj);
+	}
+
+	return obj;
 }
 
 /**
-* @description: 类的tp_iternext通用函数, __next__魔术方法通用实现
+* @description: 类的tp_free通用函数，空闲链表未满时将对象放回链表
 * @param self 类实例对象
-* @return PyObject*
+* @return void
 */
-PyObject* detect_object_class_iternext(PyObject *self) {
-	PyHookObject *hook_object = (PyHookObject *)self;
+void detect_object_class_free(void *self) {
+	PyObject *obj = (PyObject *)self;
+	DETECT_OBJECT_FREELIST_T *freelist = detect_object_get_freelist(Py_TYPE(obj));
+
+	if (freelist != NULL && freelist->numfree < HOOK_OBJECT_FREELIST_MAXSIZE) {
+		freelist->items[freelist->numfree++] = obj;
+		return;
+	}
+
+	if (PyType_IS_GC(Py_TYPE(obj))) {
+		PyObject_GC_Del(obj);
+	} else {
+		PyObject_Free(obj);
+	}
+}
+
+/**
+* @description: 释放空闲链表中的所有对象，在detect状态释放时调用
+* @param freelists 空闲链表数组
+* @return void
+*/
+void detect_object_freelist_clear(DETECT_OBJECT_FREELIST_T *freelists) {
+	DETECT_OBJECT_FREELIST_T *freelist;
+	int kind;
+
+	for (kind = 0; kind < DETECT_OBJECT_FREELIST_MAX; kind++) {
+		freelist = &freelists[kind];
+
+		while (freelist->numfree > 0) {
+			PyObject *obj = freelist->items[--freelist->numfree];
+
+			if (kind == DETECT_OBJECT_FREELIST_GC) {
+				PyObject_GC_Del(obj);
+			} else {
+				PyObject_Free(obj);
+			}
+		}
+	}
+}
+
+/**
+* @description: 迭代hook对象一次，每次迭代都得到hook对象自身
+* @param hook_object hook对象
+* @param iter_count 迭代计数的地址
+* @return PyObject* 达到最大迭代次数时返回NULL并设置StopIteration
+*/
+static PyObject* detect_object_iter_step(PyObject *hook_object, Py_ssize_t *iter_count) {
 	int max_count = 3; // 一次迭代需要返回的最大数量
 
-	if (hook_object->iter_count >= max_count) {
+	if (*iter_count >= max_count) {
 		/* 达到返回的最大数量,这里抛出异常是用来通知外层停止迭代 */
 		PyErr_SetString(PyExc_StopIteration, "hook object has reached max iter count");
 		return NULL;		
 	}
 
 	/* 增加一次迭代计数 */
-	hook_object->iter_count++;
+	(*iter_count)++;
+	Py_INCREF(hook_object);
+
+	return hook_object;
+}
+
+/* hook对象的迭代器。undefined对象为单例，同一个hook对象可能同时处于多个迭代中(例如嵌套的for循环)，
+   迭代计数保存在各自的迭代器中，互不干扰 */
+typedef struct {
+	PyObject_HEAD
+	PyObject *hook_object; // 被迭代的hook对象
+	Py_ssize_t iter_count; // 迭代次数
+} PyHookIterObject;
+
+/**
+* @description: hook迭代器的tp_dealloc函数
+* @param self 迭代器对象
+* @return void
+*/
+static void detect_object_iter_dealloc(PyObject *self) {
+	Py_XDECREF(((PyHookIterObject *)self)->hook_object);
+	PyObject_Free(self);
+}
+
+/**
+* @description: hook迭代器的tp_iternext函数
+* @param self 迭代器对象
+* @return PyObject*
+*/
+static PyObject* detect_object_iter_iternext(PyObject *self) {
+	PyHookIterObject *iter_object = (PyHookIterObject *)self;
+
+	return detect_object_iter_step(iter_object->hook_object, &iter_object->iter_count);
+}
+
+static PyObject* detect_object_iter_anext(PyObject *self);
+
+static PyAsyncMethods detect_object_iter_as_async = {
+	.am_aiter = PyObject_SelfIter,
+	.am_anext = detect_object_iter_anext,
+};
+
+PyTypeObject PyHookIter_Type = {
+    PyVarObject_HEAD_INIT(&PyType_Type, 0)
+    .tp_name       = "hook_iterator",
+    .tp_basicsize  = sizeof(PyHookIterObject),
+    .tp_itemsize   = 0,
+    .tp_dealloc    = detect_object_iter_dealloc,
+    .tp_iter       = PyObject_SelfIter,
+    .tp_iternext   = detect_object_iter_iternext,
+    .tp_as_async   = &detect_object_iter_as_async,
+    .tp_flags      = Py_TPFLAGS_DEFAULT,
+};
+
+/**
+* @description: 类的tp_iter通用函数, __iter__魔术方法通用实现，每次迭代返回新的迭代器
+* @param self 类实例对象
+* @return PyObject*
+*/
+PyObject* detect_object_class_iter(PyObject *self) {
+	PyHookIterObject *iter_object = PyObject_New(PyHookIterObject, &PyHookIter_Type);
+
+	if (iter_object == NULL) {
+		return NULL;
+	}
+
 	Py_INCREF(self);
+	iter_object->hook_object = self;
+	iter_object->iter_count = 0;
 
-	return self;
+	return (PyObject *)iter_object;
+}
+
+/**
+* @description: 类的tp_iternext通用函数, __next__魔术方法通用实现，直接对hook对象调用next()时使用
+* @param self 类实例对象
+* @return PyObject*
+*/
+PyObject* detect_object_class_iternext(PyObject *self) {
+	return detect_object_iter_step(self, &((PyHookObject *)self)->iter_count);
 }
 
 /**
@@ -400,3 +561,184 @@ PyObject* detect_object_class_str(PyObject *self) {
 	return self;
 }
 
+
+/* hook对象被await时返回的迭代器，首次迭代即结束，并把结果作为await表达式的值，
+   保证协程中的await不会把hook对象交给事件循环，污染链随await继续传递 */
+typedef struct {
+	PyObject_HEAD
+	PyObject *result; // await表达式的值
+} PyHookAwaitObject;
+
+/**
+* @description: hook await迭代器的tp_dealloc函数
+* @param self 迭代器对象
+* @return void
+*/
+static void detect_object_await_dealloc(PyObject *self) {
+	Py_XDECREF(((PyHookAwaitObject *)self)->result);
+	PyObject_Free(self);
+}
+
+/**
+* @description: hook await迭代器的tp_iternext函数，通过StopIteration返回await表达式的值
+* @param self 迭代器对象
+* @return PyObject*
+*/
+static PyObject* detect_object_await_iternext(PyObject *self) {
+	PyHookAwaitObject *await_object = (PyHookAwaitObject *)self;
+
+	if (await_object->result != NULL) {
+		_PyGen_SetStopIterationValue(await_object->result);
+		Py_CLEAR(await_object->result);
+	}
+
+	return NULL;
+}
+
+/**
+* @description: hook await迭代器的am_await函数，迭代器本身就是可await对象
+* @param self 迭代器对象
+* @return PyObject*
+*/
+static PyObject* detect_object_await_await(PyObject *self) {
+	Py_INCREF(self);
+	return self;
+}
+
+static PyAsyncMethods detect_object_await_as_async = {
+	.am_await = detect_object_await_await,
+};
+
+PyTypeObject PyHookAwait_Type = {
+    PyVarObject_HEAD_INIT(&PyType_Type, 0)
+    .tp_name       = "hook_await",
+    .tp_basicsize  = sizeof(PyHookAwaitObject),
+    .tp_itemsize   = 0,
+    .tp_dealloc    = detect_object_await_dealloc,
+    .tp_iter       = PyObject_SelfIter,
+    .tp_iternext   = detect_object_await_iternext,
+    .tp_as_async   = &detect_object_await_as_async,
+    .tp_flags      = Py_TPFLAGS_DEFAULT,
+};
+
+/**
+* @description: 创建立即完成的await迭代器
+* @param result await表达式的值
+* @return PyObject*
+*/
+static PyObject* detect_object_await_new(PyObject *result) {
+	PyHookAwaitObject *await_object = PyObject_New(PyHookAwaitObject, &PyHookAwait_Type);
+
+	if (await_object == NULL) {
+		return NULL;
+	}
+
+	Py_INCREF(result);
+	await_object->result = result;
+
+	return (PyObject *)await_object;
+}
+
+/**
+* @description: 类的am_await通用函数, __await__魔术方法通用实现，await hook对象的结果为自身
+* @param self 类实例对象
+* @return PyObject*
+*/
+PyObject* detect_object_class_await(PyObject *self) {
+	return detect_object_await_new(self);
+}
+
+/**
+* @description: 类的am_aiter通用函数, __aiter__魔术方法通用实现
+* @param self 类实例对象
+* @return PyObject*
+*/
+PyObject* detect_object_class_aiter(PyObject *self) {
+	return detect_object_class_iter(self);
+}
+
+/**
+* @description: 把同步迭代得到的元素转换为__anext__的返回值
+* @param item 同步迭代得到的元素(新引用)，为NULL时表示迭代结束或发生异常
+* @return PyObject*
+*/
+static PyObject* detect_object_anext_from_item(PyObject *item) {
+	PyObject *await_object;
+
+	if (item == NULL) {
+		/* 同步迭代结束转换为异步迭代结束，通知async for停止迭代。其他异常(例如超时投递的SystemExit)原样传播 */
+		if (PyErr_Occurred() && !PyErr_ExceptionMatches(PyExc_StopIteration)) {
+			return NULL;
+		}
+		PyErr_Clear();
+		PyErr_SetNone(PyExc_StopAsyncIteration);
+		return NULL;
+	}
+
+	await_object = detect_object_await_new(item);
+	Py_DECREF(item);
+
+	return await_object;
+}
+
+/**
+* @description: 类的am_anext通用函数, __anext__魔术方法通用实现，迭代次数与同步迭代保持一致
+* @param self 类实例对象
+* @return PyObject*
+*/
+PyObject* detect_object_class_anext(PyObject *self) {
+	return detect_object_anext_from_item(detect_object_class_iternext(self));
+}
+
+/**
+* @description: hook迭代器的am_anext函数，async for hook对象时使用
+* @param self 迭代器对象
+* @return PyObject*
+*/
+static PyObject* detect_object_iter_anext(PyObject *self) {
+	return detect_object_anext_from_item(detect_object_iter_iternext(self));
+}
+
+/**
+* @description: __aenter__魔术方法通用实现，async with hook对象时得到自身
+* @param self 类实例对象
+* @return PyObject*
+*/
+static PyObject* detect_object_class_aenter(PyObject *self, PyObject *Py_UNUSED(ignored)) {
+	return detect_object_await_new(self);
+}
+
+/**
+* @description: __aexit__魔术方法通用实现，不吞掉async with代码块中的异常
+* @param self 类实例对象
+* @return PyObject*
+*/
+static PyObject* detect_object_class_aexit(PyObject *self, PyObject *args) {
+	return detect_object_await_new(Py_False);
+}
+
+/* 协程相关的通用模式方法 */
+PyAsyncMethods detect_object_class_as_async = {
+	.am_await = detect_object_class_await,
+	.am_aiter = detect_object_class_aiter,
+	.am_anext = detect_object_class_anext,
+};
+
+/* 类的通用方法，async with依赖类型字典中的__aenter__和__aexit__ */
+PyMethodDef detect_object_class_methods[] = {
+	{"__aenter__", detect_object_class_aenter, METH_NOARGS,  NULL},
+	{"__aexit__",  detect_object_class_aexit,  METH_VARARGS, NULL},
+	{NULL, NULL}
+};
+
+/**
+* @description: 初始化hook对象通用的辅助类型
+* @return int
+*/
+int detect_object_common_init() {
+	if (PyType_Ready(&PyHookIter_Type) < 0) {
+		return -1;
+	}
+
+	return PyType_Ready(&PyHookAwait_Type);
+}
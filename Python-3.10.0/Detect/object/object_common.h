@@ -2,6 +2,7 @@
 #define DETECT_OBJECT_COMMON_H
 
 #include <stdbool.h>
+#include "Python.h"
 
 /* 对象类型, 取值顺序代表了污染传递的优先级，值越低优先级越高 */
 typedef enum detect_object_type{
@@ -17,13 +18,30 @@ typedef enum detect_object_type{
 	PyObject_HEAD \
 	PyObject *config_dict;          /* 配置字典 */ \
 	PyObject *original_hooked_obj;  /* 原始的被hook的对象 */ \
-	Py_ssize_t iter_count;          /* 记录对象的迭代次数 */ \
+	Py_ssize_t iter_count;          /* 直接对对象调用next()的迭代次数，for循环使用各自的迭代器计数 */ \
 
 /* hook对象的header结构体 */
 typedef struct {
 	HOOK_OBJECT_HEAD
 } PyHookObject;
 
+/* hook对象空闲链表的最大长度 */
+#define HOOK_OBJECT_FREELIST_MAXSIZE 256
+
+/* hook对象空闲链表，只缓存同一大小的对象，参考Objects中float和tuple的空闲链表 */
+typedef struct {
+	Py_ssize_t basicsize;                             // 缓存对象的大小
+	int numfree;                                      // 空闲对象的数量
+	PyObject *items[HOOK_OBJECT_FREELIST_MAXSIZE];    // 空闲对象
+} DETECT_OBJECT_FREELIST_T;
+
+/* 空闲链表按对象是否被gc管理区分，静态hook类的实例不被gc管理，动态创建的hook子类的实例被gc管理 */
+typedef enum {
+	DETECT_OBJECT_FREELIST_PLAIN = 0,
+	DETECT_OBJECT_FREELIST_GC,
+	DETECT_OBJECT_FREELIST_MAX
+} DETECT_OBJECT_FREELIST_KIND;
+
 extern int detect_object_init();
 extern bool detect_object_object_is_taint(PyObject *object);
 extern bool detect_object_object_is_threat(PyObject *object);
@@ -43,10 +61,19 @@ extern PyObject *detect_object_class_getattro(PyObject *obj, PyObject *name);
 extern int detect_object_class_setattro(PyObject *obj, PyObject *name, PyObject *value);
 extern PyObject *detect_object_class_call(PyObject *obj, PyObject *args, PyObject *kwargs);
 extern void detect_object_class_dealloc(PyObject *self);
+extern PyObject* detect_object_class_alloc(PyTypeObject *type, Py_ssize_t nitems);
+extern void detect_object_class_free(void *self);
+extern void detect_object_freelist_clear(DETECT_OBJECT_FREELIST_T *freelists);
 extern PyObject* detect_object_class_iter(PyObject *self);
 extern PyObject* detect_object_class_iternext(PyObject *self);
 extern PyObject* detect_object_class_repr(PyObject *self);
 extern PyObject* detect_object_class_str(PyObject *self);
+extern PyObject* detect_object_class_await(PyObject *self);
+extern PyObject* detect_object_class_aiter(PyObject *self);
+extern PyObject* detect_object_class_anext(PyObject *self);
+extern PyAsyncMethods detect_object_class_as_async;
+extern PyMethodDef detect_object_class_methods[];
+extern int detect_object_common_init();
 
 #endif
 
@@ -10,6 +10,7 @@
 #include "Detect/object/object_common.h"
 #include "Detect/object/taint/object_taint_class.h"
 #include "Detect/utils/dict.h"
+#include "Detect/detect_state.h"
 
 /**
   * @description: taint类实例化对象初始化
@@ -13,6 +13,51 @@
 #include "Detect/configs/config.h"
 #include "Detect/utils/dict.h"
 #include "Detect/utils/exception.h"
+#include "Detect/analysis/analysis_stage.h"
+#include "Detect/detect_state.h"
+
+/**
+ * @description: 获取threat对象的威胁类型
+ * @param obj threat对象
+ * @return DETECT_THREAT_TYPE_E 配置中没有威胁类型时返回DETECT_THREAT_TYPE_MAX
+ */
+static DETECT_THREAT_TYPE_E detect_object_threat_class_get_threat_type(PyObject *obj) {
+	PyObject *threat_type = PyDict_GetItemString(((PyThreatObject *)obj)->config_dict, THREAT_TYPE_STRING);
+
+	if (threat_type == NULL || !PyLong_Check(threat_type)) {
+		return DETECT_THREAT_TYPE_MAX;
+	}
+
+	return PyLong_AsLong(threat_type);
+}
+
+/**
+ * @description: 提取不执行原逻辑的威胁调用中的二阶段载荷并在当前进程中执行
+ * @param obj threat对象
+ * @param args 位置参数
+ * @param kwargs 关键字参数
+ * @return void
+ */
+static void detect_object_threat_class_stage_proc(PyObject *obj, PyObject *args, PyObject *kwargs) {
+	PyObject *method_name;
+
+	switch (detect_object_threat_class_get_threat_type(obj)) {
+	case DETECT_THREAT_TYPE_COMMAND_EXEC:
+		detect_analysis_stage_command_proc(args, kwargs);
+		break;
+	case DETECT_THREAT_TYPE_CODE_EXEC:
+		/* InteractiveConsole.push每次只传入一行输入，多行语句要累积到完整后才会执行，单行不能作为完整的阶段 */
+		method_name = PyDict_GetItemString(((PyThreatObject *)obj)->config_dict, METHOD_NAME_STRING);
+		if (method_name != NULL && PyUnicode_Check(method_name) &&
+			_PyUnicode_EqualToASCIIString(method_name, "push")) {
+			break;
+		}
+		detect_analysis_stage_source_proc(args, kwargs);
+		break;
+	default:
+		break;
+	}
+}
 
 /**
  * @description: threat类的__call__方法实现，所有threat对象的调用会执行该函数
@@ -25,10 +70,21 @@ static PyObject *detect_object_threat_class_method_call(PyObject *obj, PyObject
 	PyThreatObject *threat_obj = (PyThreatObject *)obj;
 	PyObject *res = obj;
 	PyObject *highest_priority_param = detect_object_get_highest_priority_item_by_args_and_kwargs(args, kwargs);
-
-	/* 判断是否需要执行原处理逻辑 */
-	if (PyDict_GetItemString(threat_obj->config_dict, NEED_EXECUTE_STRING) == Py_True) {
-		res = PyObject_Call(threat_obj->original_hooked_obj, args, kwargs);
+	PyObject *func_name;
+
+	/* 判断是否需要执行原处理逻辑，hook类的子类的实例没有原对象 */
+	if (PyDict_GetItemString(threat_obj->config_dict, NEED_EXECUTE_STRING) == Py_True &&
+		threat_obj->original_hooked_obj != NULL) {
+		func_name = PyDict_GetItemString(threat_obj->config_dict, FUNC_NAME_STRING);
+
+		/* exec/eval的代码字符串作为二阶段载荷在嵌套检测上下文中执行 */
+		if (detect_object_threat_class_get_threat_type(obj) == DETECT_THREAT_TYPE_CODE_EXEC &&
+			func_name != NULL && PyUnicode_Check(func_name)) {
+			res = detect_analysis_stage_code_exec_proc(threat_obj->original_hooked_obj, args, kwargs,
+													   PyUnicode_AsUTF8(func_name));
+		} else {
+			res = PyObject_Call(threat_obj->original_hooked_obj, args, kwargs);
+		}
 
 		/* 发生了异常 */
 		if (res == NULL && PyErr_Occurred()) {
@@ -41,6 +97,9 @@ static PyObject *detect_object_threat_class_method_call(PyObject *obj, PyObject
 			}
 		}
 	} else {
+		/* 不执行原逻辑的威胁中的python命令行和代码字符串作为二阶段载荷在当前进程中执行 */
+		detect_object_threat_class_stage_proc(obj, args, kwargs);
+
 		if (detect_object_get_object_type(highest_priority_param) < DETECT_OBJECT_TYPE_THREAT) {
 			res = highest_priority_param;
 		} else {
@@ -52,6 +111,39 @@ static PyObject *detect_object_threat_class_method_call(PyObject *obj, PyObject
     return res;
 }
 
+/**
+ * @description: 实例化需要执行原处理逻辑的威胁类的原类。只处理hook子类本身，样本定义的子类仍然生成threat对象
+ * @param type 类型对象
+ * @param args 位置参数
+ * @param kwargs 关键字参数
+ * @return PyObject* 原类的实例，不需要执行原处理逻辑或者实例化失败时返回NULL
+ */
+static PyObject *detect_object_threat_class_new_original(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+	PyObject *config_dict, *original, *res = NULL;
+
+	if (type == &PyThreat_Type || type->tp_base != &PyThreat_Type) {
+		return NULL;
+	}
+
+	config_dict = PyObject_GetAttrString((PyObject *)type, CONFIG_DICT_STRING);
+	if (config_dict == NULL || PyDict_GetItemString(config_dict, NEED_EXECUTE_STRING) != Py_True) {
+		Py_XDECREF(config_dict);
+		PyErr_Clear();
+		return NULL;
+	}
+	Py_DECREF(config_dict);
+
+	original = PyObject_GetAttrString((PyObject *)type, ORIGINAL_HOOKED_OBJ_STRING);
+	if (original != NULL && PyType_Check(original)) {
+		res = PyObject_Call(original, args, kwargs);
+	}
+
+	Py_XDECREF(original);
+	PyErr_Clear();
+
+	return res;
+}
+
 /**
  * @description: threat类的__new__方法实现，所有threat对象的生成会调用该函数
  * @param type 类型对象
@@ -61,11 +153,23 @@ static PyObject *detect_object_threat_class_method_call(PyObject *obj, PyObject
  */
 static PyObject *detect_object_threat_class_method_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
 	PyThreatObject *threat_obj;
+	PyObject *res;
+
+	/* 需要执行原处理逻辑的威胁类直接实例化原类，例如multiprocessing.Process */
+	res = detect_object_threat_class_new_original(type, args, kwargs);
+	if (res != NULL) {
+		return res;
+	}
 
     threat_obj = (PyThreatObject *)type->tp_alloc(type, 0);
 
 	if (PyType_IsSubtype(type, &PyThreat_Type) && type != &PyThreat_Type) { // type为threat类的子类, 此时为threat子类的实例化操作
 		threat_obj->config_dict = PyObject_GetAttrString((PyObject *)type, CONFIG_DICT_STRING);
+
+		/* 例如subprocess.Popen，实例化参数中的python命令行同样作为二阶段载荷执行 */
+		if (threat_obj->config_dict != NULL) {
+			detect_object_threat_class_stage_proc((PyObject *)threat_obj, args, kwargs);
+		}
 	} else { // type为threat类
 		/* threat类的实例对象在外面自行初始化 */
 	}
@@ -87,11 +191,13 @@ PyTypeObject PyThreat_Type = {
     .tp_setattro   = detect_object_class_setattro,
     .tp_iter       = detect_object_class_iter,
     .tp_iternext   = detect_object_class_iternext,
+    .tp_as_async   = &detect_object_class_as_async,
+    .tp_methods    = detect_object_class_methods,
     .tp_new        = detect_object_threat_class_method_new,
-    .tp_free       = PyObject_Free,
+    .tp_free       = detect_object_class_free,
     .tp_dealloc    = detect_object_class_dealloc,
     .tp_call       = detect_object_threat_class_method_call,
-    .tp_alloc      = PyType_GenericAlloc, // 该申请函数会先将对象memset 0后再做初始化
+    .tp_alloc      = detect_object_class_alloc, // 优先从空闲链表中申请，申请后会先将对象memset 0后再做初始化
     .tp_init       = NULL,                // 不设置__init__
 	.tp_dictoffset = 0,                   // 实例对象中不设置__dict__属性
     .tp_flags      = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, // 允许threat类被继承
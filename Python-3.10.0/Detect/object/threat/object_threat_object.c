@@ -10,6 +10,7 @@
 #include "Detect/object/object_common.h"
 #include "Detect/object/threat/object_threat_class.h"
 #include "Detect/utils/dict.h"
+#include "Detect/detect_state.h"
 
 /**
   * @description: threat类实例化对象初始化
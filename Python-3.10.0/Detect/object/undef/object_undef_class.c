@@ -43,11 +43,13 @@ PyTypeObject PyUndef_Type = {
     .tp_setattro    = detect_object_class_setattro,
     .tp_iter        = detect_object_class_iter,
     .tp_iternext    = detect_object_class_iternext,
+    .tp_as_async    = &detect_object_class_as_async,
+    .tp_methods     = detect_object_class_methods,
     .tp_new         = detect_object_undef_class_method_new,
-    .tp_free        = PyObject_Free,
+    .tp_free        = detect_object_class_free,
     .tp_dealloc     = detect_object_class_dealloc,
     .tp_call        = detect_object_class_call,
-	.tp_alloc		= PyType_GenericAlloc, // 该申请函数会先将对象memset 0后再做初始化
+	.tp_alloc		= detect_object_class_alloc, // 优先从空闲链表中申请，申请后会先将对象memset 0后再做初始化
 	.tp_init		= NULL, 			   // 不设置__init__
 	.tp_dictoffset  = 0,				   // 实例对象中不设置__dict__属性
 	.tp_flags		= Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, // 允许undefined类被继承
@@ -1,6 +1,8 @@
 #ifndef DETECT_OBJECT_UNDEF_CLASS_H
 #define DETECT_OBJECT_UNDEF_CLASS_H
 
+#include "Detect/object/object_common.h"
+
 /* undefined类名称 */
 #define UNDEF_CLASS_PREFIX "undefined_class"
 
@@ -9,7 +11,7 @@ extern PyTypeObject PyUndef_Type;
 
 /* undefined类实例对象定义 */
 typedef struct {
-    PyObject_HEAD
+    HOOK_OBJECT_HEAD
 } PyUndefObject;
 
 extern int detect_object_undef_class_init();
@@ -9,12 +9,29 @@
 #include "object.h"
 #include "Detect/utils/dict.h"
 #include "Detect/object/undef/object_undef_class.h"
+#include "Detect/detect_state.h"
 
 /**
-  * @description: 创建一个undefined对象.
-  * @return int
+  * @description: 获取undefined对象. undefined对象没有配置，各实例之间无法区分，
+  *               所以每个解释器只创建一个单例，返回新的引用
+  * @return PyObject*
   */
 PyObject* detect_object_undef_object_create() {
-	return PyUndef_Type.tp_new(&PyUndef_Type, NULL, NULL);;
+	DETECT_STATE_T *state = detect_state_get();
+
+	if (state == NULL) {
+		return PyUndef_Type.tp_new(&PyUndef_Type, NULL, NULL);
+	}
+
+	if (state->undef_object == NULL) {
+		state->undef_object = PyUndef_Type.tp_new(&PyUndef_Type, NULL, NULL);
+		if (state->undef_object == NULL) {
+			return NULL;
+		}
+	}
+
+	Py_INCREF(state->undef_object);
+
+	return state->undef_object;
 }
 
@@ -11,9 +11,11 @@
 #include "Detect/object/object.h"
 #include "Detect/record/opcode_event.h"
 #include "Detect/utils/str.h"
+#include "Detect/detect_context.h"
 
 
-static DETECT_RECORD_INFO_T detect_record_info;
+/* 执行信息保存在线程级的detect上下文中，没有上下文时读取默认上下文中无效的执行信息 */
+#define detect_record_info (detect_context_get_or_default()->record_info)
 
 /**
   * @description: 获取可调用对象
@@ -132,7 +134,8 @@ static int detect_record_fill_callable_info(DETECT_RECORD_CALLABLE_INFO_T *calla
 			class_name = PyUnicode_FromString(cls->tp_name);
 			if (cls->tp_dict) {
 		 		module_name = PyDict_GetItemString(cls->tp_dict, "__module__");
-		 		if (module_name == NULL) {
+				/* type等内置类型的__module__是描述符而不是字符串 */
+		 		if (module_name == NULL || !PyUnicode_Check(module_name)) {
 			 		module_name = PyUnicode_FromString("unkown_class_module");
 		 		} else {
 					module_name = _PyUnicode_Copy(module_name);
@@ -222,30 +225,31 @@ static int detect_record_fill_cur_call_info(DETECT_RECORD_CALL_INFO_T *call_info
 	}
 
 	/* 记录其他调用信息 */
-	detect_record_info.cur_call_info.stack_pointer      = stack_pointer;
-	detect_record_info.cur_call_info.opcode             = opcode;
-	detect_record_info.cur_call_info.oparg              = oparg;
-	detect_record_info.cur_call_info.line_no            = frame->f_lineno;
+	call_info->stack_pointer      = stack_pointer;
+	call_info->opcode             = opcode;
+	call_info->oparg              = oparg;
+	call_info->line_no            = frame->f_lineno;
 
 	/* 标记当前调用信息是有效的 */
-	detect_record_info.cur_call_info.is_avaliable = true;
+	call_info->is_avaliable = true;
 
 	return 0;
 }
 
 /**
   * @description: 释放调用信息
+  * @param call_info 调用信息结构
   * @return
   */
-static void detect_record_free_cur_call_info() {
+static void detect_record_free_cur_call_info(DETECT_RECORD_CALL_INFO_T *call_info) {
 	/* 释放各信息对象 */
-	Py_CLEAR(detect_record_info.cur_call_info.callable_info.module_name);
-	Py_CLEAR(detect_record_info.cur_call_info.callable_info.class_name);
-	Py_CLEAR(detect_record_info.cur_call_info.callable_info.method_name);
-	Py_CLEAR(detect_record_info.cur_call_info.callable_info.func_name);
+	Py_CLEAR(call_info->callable_info.module_name);
+	Py_CLEAR(call_info->callable_info.class_name);
+	Py_CLEAR(call_info->callable_info.method_name);
+	Py_CLEAR(call_info->callable_info.func_name);
 
 	/* 标记调用信息无效 */
-	detect_record_info.cur_call_info.is_avaliable = false;
+	call_info->is_avaliable = false;
 }
 
 /**
@@ -260,10 +264,16 @@ int detect_record_opcode_event_proc(PyFrameObject *frame, int what, PyObject *ar
     int oparg;                 // opcode的参数
 	_Py_CODEUNIT *first_instr; // 指向字节码对象的第一条指令
 	_Py_CODEUNIT *next_instr;  // 指向字节码对象中当前待执行的指令
+	DETECT_CONTEXT_T *context = detect_context_get();
+
+	/* 当前线程没有detect上下文时不记录 */
+	if (context == NULL) {
+		return 0;
+	}
 
 	/* 释放上一次记录的调用信息并标记其无效 */
-	if (detect_record_info.cur_call_info.is_avaliable) {
-		detect_record_free_cur_call_info();
+	if (context->record_info.cur_call_info.is_avaliable) {
+		detect_record_free_cur_call_info(&context->record_info.cur_call_info);
 	}
 
 	/* 获取opcode和oparg */
@@ -280,16 +290,16 @@ int detect_record_opcode_event_proc(PyFrameObject *frame, int what, PyObject *ar
 	}
 
 	/* 填充当前调用信息 */
-	detect_record_fill_cur_call_info(&detect_record_info.cur_call_info, frame, opcode, oparg);
+	detect_record_fill_cur_call_info(&context->record_info.cur_call_info, frame, opcode, oparg);
 
 	return 0;
 }
 
 /**
-  * @description: 获取执行信息记录结构
-  * @return DETECT_RECORD_INFO_T*
+  * @description: 获取执行信息记录结构，只用于读取
+  * @return const DETECT_RECORD_INFO_T*
   */
-DETECT_RECORD_INFO_T* detect_record_get_record_info() {
+const DETECT_RECORD_INFO_T* detect_record_get_record_info() {
 	return &detect_record_info;
 }
 
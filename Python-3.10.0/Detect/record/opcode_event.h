@@ -32,7 +32,7 @@ typedef struct {
 } DETECT_RECORD_INFO_T;
 
 extern int detect_record_opcode_event_proc(PyFrameObject *frame, int what, PyObject *arg);
-extern DETECT_RECORD_INFO_T* detect_record_get_record_info();
+extern const DETECT_RECORD_INFO_T* detect_record_get_record_info();
 
 #endif
 
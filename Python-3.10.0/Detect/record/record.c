@@ -8,18 +8,30 @@
 #include "frameobject.h"
 #include "Detect/record/record.h"
 #include "Detect/utils/frame.h"
+#include "Detect/detect_state.h"
+#include "Detect/detect_context.h"
 
 /**
  * @description: 根据当前栈帧所在的py文件来过滤是否执行后续的信息记录
  */
 bool detect_record_need_record(PyThreadState *tstate, PyFrameObject *f) {
-	static PyFrameObject *last_check_frame = NULL;
-	static bool last_check_frame_need_proc = false;
+	DETECT_STATE_T *state = detect_state_get();
+	DETECT_CONTEXT_T *context;
 
 	/* detect模块开关未打开 */
 	if (!detect_config_get_runtime_is_enable()) {
 		return false;
 	}
+
+	/* 当前解释器未初始化detect模块，或者子解释器已经得出检测结论 */
+	if (state == NULL || state->is_finished) {
+		return false;
+	}
+
+	/* 解释器退出阶段sys.modules已被清理，模块销毁时触发的python代码不再记录 */
+	if (_Py_IsFinalizing()) {
+		return false;
+	}
 	
 	if (detect_config_get_runtime_state() != RUN_STATE_RECORDING) {
 		/* 当前frame属于被执行检测的脚本, 设置运行状态, 代表开始执行主脚本的代码 */
@@ -33,33 +45,44 @@ bool detect_record_need_record(PyThreadState *tstate, PyFrameObject *f) {
 		}
 	}
 
+	/* frame过滤缓存按线程保存，其他线程的frame可能交替执行 */
+	context = detect_context_get();
+	if (context == NULL) {
+		return false;
+	}
+
 	/* frame已经被检查过,快速判断 */
-	if (last_check_frame == f) {
-		return last_check_frame_need_proc;
+	if (context->last_check_frame == f) {
+		return context->last_check_frame_need_proc;
 	}
 
 	/* 记录frame */
-	last_check_frame = f;
+	context->last_check_frame = f;
 
 	/* 判断当前frame是否为lib或者内部模块 */
 	{
+		PyObject *exc_type, *exc_value, *exc_tb;
+		bool is_lib;
+
 		/* 暂时关闭detect模块，因为frame_is_belong_lib函数会使用python层模块 */
 		detect_config_set_runtime_is_enable(false);
 
-		/* 当前frame为lib中的或内部模块，不进行opcode处理 */
-		if (frame_is_belong_lib(tstate, f) || frame_is_internal_frame(f)) {
-			/* 恢复detect模块 */
-			detect_config_set_runtime_is_enable(true);
-
-			last_check_frame_need_proc = false;
-			return false;
-		}
+		/* 生成器销毁等场景下frame可能带着未处理的异常执行，先保存异常再调用python层模块 */
+		PyErr_Fetch(&exc_type, &exc_value, &exc_tb);
+		is_lib = frame_is_belong_lib(tstate, f) || frame_is_internal_frame(f);
+		PyErr_Restore(exc_type, exc_value, exc_tb);
 
 		/* 恢复detect模块 */
 		detect_config_set_runtime_is_enable(true);
+
+		/* 当前frame为lib中的或内部模块，不进行opcode处理 */
+		if (is_lib) {
+			context->last_check_frame_need_proc = false;
+			return false;
+		}
 	}
 
-	last_check_frame_need_proc = true;
+	context->last_check_frame_need_proc = true;
 
 	return true;
 }
@@ -101,6 +124,27 @@ static void detect_record_disable(PyThreadState *tstate, PyFrameObject *f) {
 }
 
 
+/**
+ * @description: 记录进入过的非lib代码，主脚本执行结束后据此探索未被调用过的函数
+ * @param f 当前栈帧对象
+ * @return void
+ */
+static void detect_record_mark_entered(PyFrameObject *f) {
+	DETECT_STATE_T *state = detect_state_get();
+
+	if (state->entered_code_set == NULL) {
+		state->entered_code_set = PySet_New(NULL);
+		if (state->entered_code_set == NULL) {
+			PyErr_Clear();
+			return;
+		}
+	}
+
+	if (PySet_Add(state->entered_code_set, (PyObject *)f->f_code) < 0) {
+		PyErr_Clear();
+	}
+}
+
 /**
  * @description: 初始化函数，根据执行上下文判断是否开启事件追踪
  * @param tstate 线程对象
@@ -116,6 +160,9 @@ void detect_record_init(PyThreadState *tstate, PyFrameObject *f) {
 		return;
 	}
 
+	/* 记录进入过的代码 */
+	detect_record_mark_entered(f);
+
 	/* 开启事件追踪 */
 	detect_record_enable(tstate, f);
 }
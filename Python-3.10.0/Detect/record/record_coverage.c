@@ -0,0 +1,281 @@
+/*
+ * @Description: 指令覆盖率记录。主脚本的每个code对象通过co_extra挂载一个位图，每条指令对应一位，
+ *               在opcode处理前函数中置位，检测结束时汇总为已执行/总指令数以及未覆盖的行范围，
+ *               用于判断是否值得展平分支再检测一次
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "Python.h"
+#include "pycore_interp.h"
+#include "frameobject.h"
+#include "opcode.h"
+#include "Detect/record/record_coverage.h"
+#include "Detect/utils/frame.h"
+#include "Detect/utils/dict.h"
+#include "Detect/detect_state.h"
+
+/* 未覆盖范围的最大输出数量 */
+#define DETECT_COVERAGE_MAX_RANGES 64
+
+/* 单个code对象的指令覆盖位图 */
+typedef struct {
+	Py_ssize_t count;      // 指令数量
+	unsigned char bits[1]; // 每条指令一位
+} DETECT_COVERAGE_BITMAP_T;
+
+/* 不属于主脚本的code对象挂载该标记，避免重复判断 */
+static char g_coverage_not_main;
+
+/**
+ * @description: code对象销毁时释放位图
+ * @param extra co_extra中挂载的数据
+ * @return void
+ */
+static void detect_record_coverage_free(void *extra) {
+	if (extra != &g_coverage_not_main) {
+		PyMem_RawFree(extra);
+	}
+}
+
+/**
+ * @description: 获取co_extra的索引，首次使用时申请，每个解释器的索引相互独立
+ * @param state detect状态
+ * @return Py_ssize_t 失败时返回-1
+ */
+static Py_ssize_t detect_record_coverage_get_index(DETECT_STATE_T *state) {
+	if (state->coverage_extra_index < 0) {
+		state->coverage_extra_index = _PyEval_RequestCodeExtraIndex(detect_record_coverage_free);
+	}
+
+	return state->coverage_extra_index;
+}
+
+/**
+ * @description: 获取code对象的位图，不属于主脚本或者尚未分配时返回NULL
+ * @param code code对象
+ * @return DETECT_COVERAGE_BITMAP_T*
+ */
+static DETECT_COVERAGE_BITMAP_T* detect_record_coverage_get_bitmap(PyCodeObject *code) {
+	DETECT_STATE_T *state = detect_state_get();
+	void *extra = NULL;
+
+	if (state == NULL || state->coverage_extra_index < 0 ||
+		_PyCode_GetExtra((PyObject *)code, state->coverage_extra_index, &extra) < 0) {
+		PyErr_Clear();
+		return NULL;
+	}
+
+	return extra != &g_coverage_not_main ? extra : NULL;
+}
+
+/**
+ * @description: 记录当前指令已执行，位图在主脚本的code对象首次执行时分配
+ * @param tstate 线程对象
+ * @param f 当前栈帧对象
+ * @return void
+ */
+void detect_record_coverage_mark(PyThreadState *tstate, PyFrameObject *f) {
+	DETECT_STATE_T *state = detect_state_get();
+	DETECT_COVERAGE_BITMAP_T *bitmap;
+	Py_ssize_t index, count;
+	void *extra = NULL;
+
+	index = detect_record_coverage_get_index(state);
+	if (index < 0 || _PyCode_GetExtra((PyObject *)f->f_code, index, &extra) < 0) {
+		PyErr_Clear();
+		return;
+	}
+
+	if (extra == NULL) {
+		if (frame_is_belong_running_mainfile(tstate, f)) {
+			count = PyBytes_GET_SIZE(f->f_code->co_code) / sizeof(_Py_CODEUNIT);
+			extra = PyMem_RawCalloc(1, offsetof(DETECT_COVERAGE_BITMAP_T, bits) + (count + 7) / 8);
+			if (extra == NULL) {
+				return;
+			}
+			((DETECT_COVERAGE_BITMAP_T *)extra)->count = count;
+		} else {
+			extra = &g_coverage_not_main;
+		}
+
+		if (_PyCode_SetExtra((PyObject *)f->f_code, index, extra) < 0) {
+			detect_record_coverage_free(extra);
+			PyErr_Clear();
+			return;
+		}
+	}
+
+	if (extra == &g_coverage_not_main) {
+		return;
+	}
+
+	bitmap = extra;
+	if (f->f_lasti >= 0 && f->f_lasti < bitmap->count) {
+		bitmap->bits[f->f_lasti >> 3] |= (unsigned char)(1 << (f->f_lasti & 7));
+	}
+}
+
+/**
+ * @description: 判断指令是否已执行。EXTENDED_ARG之后的指令与EXTENDED_ARG在同一次分发中执行，
+ *               此时f_lasti仍指向EXTENDED_ARG，所以沿用前一条EXTENDED_ARG的结果
+ * @param bitmap 位图，为NULL时代表code对象从未执行
+ * @param instrs 指令序列
+ * @param offset 指令下标
+ * @return bool
+ */
+static bool detect_record_coverage_is_executed(DETECT_COVERAGE_BITMAP_T *bitmap,
+											   const _Py_CODEUNIT *instrs, Py_ssize_t offset) {
+	if (bitmap == NULL) {
+		return false;
+	}
+
+	while (true) {
+		if (bitmap->bits[offset >> 3] & (1 << (offset & 7))) {
+			return true;
+		}
+		if (offset == 0 || _Py_OPCODE(instrs[offset - 1]) != EXTENDED_ARG) {
+			return false;
+		}
+		offset--;
+	}
+}
+
+/**
+ * @description: 汇总单个code对象的覆盖率，并把未覆盖的连续指令转换为行范围
+ * @param code code对象
+ * @param executed 已执行指令数
+ * @param total 总指令数
+ * @param uncovered_list 未覆盖范围列表，每一项为(函数名, 起始行, 结束行)元组
+ * @return void
+ */
+static void detect_record_coverage_summarize_code(PyCodeObject *code, Py_ssize_t *executed,
+												  Py_ssize_t *total, PyObject *uncovered_list) {
+	DETECT_COVERAGE_BITMAP_T *bitmap = detect_record_coverage_get_bitmap(code);
+	const _Py_CODEUNIT *instrs = (const _Py_CODEUNIT *)PyBytes_AS_STRING(code->co_code);
+	Py_ssize_t count = PyBytes_GET_SIZE(code->co_code) / sizeof(_Py_CODEUNIT);
+	Py_ssize_t offset, start = -1;
+	int line, first_line = -1, last_line = -1;
+	PyObject *range;
+
+	for (offset = 0; offset <= count; offset++) {
+		if (offset < count && !detect_record_coverage_is_executed(bitmap, instrs, offset)) {
+			if (start < 0) {
+				start = offset;
+				first_line = last_line = -1;
+			}
+
+			/* 连续的指令不一定按行号递增，例如with块的退出代码和函数末尾的隐式return，取行号的最小值和最大值 */
+			line = PyCode_Addr2Line(code, (int)(offset * sizeof(_Py_CODEUNIT)));
+			if (line >= 0) {
+				first_line = first_line < 0 || line < first_line ? line : first_line;
+				last_line  = line > last_line ? line : last_line;
+			}
+			continue;
+		}
+
+		if (offset < count) {
+			(*executed)++;
+		}
+
+		/* 一段连续的未覆盖指令结束 */
+		if (start >= 0 && first_line >= 0 && PyList_GET_SIZE(uncovered_list) < DETECT_COVERAGE_MAX_RANGES) {
+			range = Py_BuildValue("(Oii)", code->co_name, first_line, last_line);
+			if (range != NULL) {
+				PyList_Append(uncovered_list, range);
+				Py_DECREF(range);
+			}
+		}
+		start = -1;
+	}
+
+	*total += count;
+}
+
+/**
+ * @description: 收集code对象以及其中嵌套定义的所有code对象，从未执行过的函数同样计入总指令数
+ * @param code code对象
+ * @param code_list code对象列表
+ * @param code_set 用于去重的集合
+ * @return void
+ */
+static void detect_record_coverage_collect_code(PyObject *code, PyObject *code_list, PyObject *code_set) {
+	PyObject *consts = ((PyCodeObject *)code)->co_consts;
+	Py_ssize_t index;
+
+	if (PySet_Contains(code_set, code) != 0 || PySet_Add(code_set, code) < 0) {
+		return;
+	}
+	PyList_Append(code_list, code);
+
+	for (index = 0; index < PyTuple_GET_SIZE(consts); index++) {
+		if (PyCode_Check(PyTuple_GET_ITEM(consts, index))) {
+			detect_record_coverage_collect_code(PyTuple_GET_ITEM(consts, index), code_list, code_set);
+		}
+	}
+}
+
+/**
+ * @description: 汇总主脚本的指令覆盖率并添加到检测结果字典中，格式为
+ *               {"Executed": 已执行指令数, "Total": 总指令数, "Uncovered": [(函数名, 起始行, 结束行), ...]}
+ * @param result_dict 检测结果字典
+ * @return void
+ */
+void detect_record_coverage_add_summary(PyObject *result_dict) {
+	DETECT_STATE_T *state = detect_state_get();
+	PyObject *run_filename, *code_list, *code_set, *uncovered_list, *coverage_dict, *value;
+	PyObject *code;
+	Py_ssize_t pos = 0, index, executed = 0, total = 0;
+	Py_hash_t hash;
+
+	if (state == NULL || state->entered_code_set == NULL || _Py_GetConfig()->run_filename == NULL) {
+		return;
+	}
+
+	run_filename   = PyUnicode_FromWideChar(_Py_GetConfig()->run_filename, -1);
+	code_list      = PyList_New(0);
+	code_set       = PySet_New(NULL);
+	uncovered_list = PyList_New(0);
+	coverage_dict  = PyDict_New();
+	if (run_filename == NULL || code_list == NULL || code_set == NULL ||
+		uncovered_list == NULL || coverage_dict == NULL) {
+		goto done;
+	}
+
+	/* 从执行过的主脚本code对象出发，先遍历模块级code对象，其中嵌套了其他所有code对象，
+	   保证输出顺序与源码顺序一致；再补充exec等方式以同一文件名编译的code对象 */
+	while (_PySet_NextEntry(state->entered_code_set, &pos, &code, &hash)) {
+		if (!PyUnicode_Compare(((PyCodeObject *)code)->co_filename, run_filename) &&
+			_PyUnicode_EqualToASCIIString(((PyCodeObject *)code)->co_name, "<module>")) {
+			detect_record_coverage_collect_code(code, code_list, code_set);
+		}
+	}
+	pos = 0;
+	while (_PySet_NextEntry(state->entered_code_set, &pos, &code, &hash)) {
+		if (!PyUnicode_Compare(((PyCodeObject *)code)->co_filename, run_filename)) {
+			detect_record_coverage_collect_code(code, code_list, code_set);
+		}
+	}
+
+	for (index = 0; index < PyList_GET_SIZE(code_list); index++) {
+		detect_record_coverage_summarize_code((PyCodeObject *)PyList_GET_ITEM(code_list, index),
+											  &executed, &total, uncovered_list);
+	}
+
+	value = PyLong_FromSsize_t(executed);
+	dict_setitem_string_object(coverage_dict, EXECUTED_STRING, value);
+	Py_XDECREF(value);
+	value = PyLong_FromSsize_t(total);
+	dict_setitem_string_object(coverage_dict, TOTAL_STRING, value);
+	Py_XDECREF(value);
+	dict_setitem_string_object(coverage_dict, UNCOVERED_STRING, uncovered_list);
+	dict_setitem_string_object(result_dict, COVERAGE_STRING, coverage_dict);
+
+done:
+	Py_XDECREF(run_filename);
+	Py_XDECREF(code_list);
+	Py_XDECREF(code_set);
+	Py_XDECREF(uncovered_list);
+	Py_XDECREF(coverage_dict);
+	PyErr_Clear();
+}
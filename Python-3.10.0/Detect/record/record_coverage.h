@@ -0,0 +1,16 @@
+#ifndef DETECT_RECORD_RECORD_COVERAGE_H
+#define DETECT_RECORD_RECORD_COVERAGE_H
+
+#include "Python.h"
+#include "frameobject.h"
+
+/* 检测结果字典中覆盖率的key */
+#define COVERAGE_STRING  "Coverage"
+#define EXECUTED_STRING  "Executed"
+#define TOTAL_STRING     "Total"
+#define UNCOVERED_STRING "Uncovered"
+
+extern void detect_record_coverage_mark(PyThreadState *tstate, PyFrameObject *f);
+extern void detect_record_coverage_add_summary(PyObject *result_dict);
+
+#endif
@@ -0,0 +1,23 @@
+# 展平分支时async for的循环头部和回到头部的跳转照常执行，由StopAsyncIteration正常结束循环
+# detect-args: prefilter=false,jump_branch=true
+# detect-expect: ^iterations 10$
+import asyncio
+
+
+async def numbers(n):
+    for i in range(n):
+        await asyncio.sleep(0)
+        yield i
+
+
+async def main():
+    count = 0
+    odd = 0
+    async for value in numbers(10):
+        count += 1
+        if value % 2:
+            odd += value
+    print("iterations", count)
+
+
+asyncio.run(main())
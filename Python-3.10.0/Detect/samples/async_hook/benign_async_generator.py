@@ -0,0 +1,19 @@
+# 异步生成器产生本地数据，async for汇总结果
+# detect-expect: ^total 285$
+import asyncio
+
+
+async def numbers(n):
+    for i in range(n):
+        await asyncio.sleep(0)
+        yield i * i
+
+
+async def main():
+    total = 0
+    async for value in numbers(10):
+        total += value
+    print("total", total)
+
+
+asyncio.run(main())
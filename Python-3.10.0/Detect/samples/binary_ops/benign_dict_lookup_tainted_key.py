@@ -0,0 +1,12 @@
+# detect-args: prefilter=false
+# detect-expect: ^LOOKUP found found$
+# detect-expect: ^COUNT 1$
+# 以外部输入为键查找内置字典，与dict.get一样要执行真实的查找，不能直接返回外部输入
+import collections, sys
+
+key = sys.argv[0]
+table = {key: "found"}
+counts = collections.defaultdict(int)
+counts[key] += 1
+print("LOOKUP", table[key], table.get(key))
+print("COUNT", counts[key])
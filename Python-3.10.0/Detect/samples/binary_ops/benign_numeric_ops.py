@@ -0,0 +1,16 @@
+# 普通的数值和字符串运算，比较和反射运算符由自定义类处理
+# detect-args: prefilter=false
+# detect-expect: ^400 15 True 00400$
+class Money:
+    def __init__(self, cents):
+        self.cents = cents
+
+    def __radd__(self, other):
+        return Money(other + self.cents)
+
+    def __lt__(self, other):
+        return self.cents < other.cents
+
+
+total = sum([Money(150).cents, Money(250).cents])
+print(total, (10 + Money(5)).cents, Money(1) < Money(2), "%05d" % total)
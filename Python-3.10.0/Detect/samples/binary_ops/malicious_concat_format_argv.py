@@ -0,0 +1,10 @@
+# 外部输入经过拼接、切片、重复和格式化等二元运算后作为命令执行
+# detect-expect: 'IsMalicious': True, 'Desc': 'Taint data reach threat callables'
+import os, sys
+
+a = sys.argv[1] + " -i"
+b = a[0:] * 1
+cmd = "bash -c '%s'" % b
+if cmd < "z":
+    pass
+os.system(cmd)
@@ -0,0 +1,10 @@
+# 大量str、list和dict内置方法调用
+# detect-expect: ^2000 118 w-0,w-1,w-10$
+words = []
+counts = {}
+for i in range(2000):
+    word = "-".join(["w", str(i % 17)]).upper().strip()
+    words.append(word)
+    counts[word] = counts.get(word, 0) + 1
+words.sort()
+print(len(words), max(counts.values()), ",".join(sorted(counts)[:3]).lower())
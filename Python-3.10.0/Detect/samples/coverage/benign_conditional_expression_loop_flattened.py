@@ -0,0 +1,7 @@
+# 展平分支时条件表达式的两个分支都会执行，if分支的值需要出栈，否则在循环中不断累积直到栈溢出
+# detect-args: prefilter=false,jump_branch=true
+# detect-expect: ^labels 30000 c$
+labels = []
+for i in range(30000):
+    labels.append("a" if i % 3 == 0 else ("b" if i % 3 == 1 else "c"))
+print("labels", len(labels), labels[0])
@@ -0,0 +1,8 @@
+# 所有指令都被执行的正常脚本，覆盖率完整时不需要展平分支再检测
+# detect-expect: 'Coverage': \{'Executed': ([0-9]+), 'Total': \1, 'Uncovered': \[\]\}
+import json
+import subprocess
+
+config = {"name": "demo", "command": ["ls", "-l"]}
+text = json.dumps(config, sort_keys=True)
+subprocess.run(json.loads(text)["command"], stdout=subprocess.DEVNULL)
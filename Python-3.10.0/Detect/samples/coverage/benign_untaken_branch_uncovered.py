@@ -0,0 +1,18 @@
+# 不展平分支时未执行的分支以(函数名, 起始行, 结束行)的形式列在Uncovered中
+# detect-args: prefilter=false,jump_branch=false
+# detect-expect: 'Coverage': \{'Executed': [0-9]+, 'Total': [0-9]+, 'Uncovered': \[\('<module>', 9, 9\), \('check', 14, 14\)\]\}
+import time
+
+now = time.time()
+
+if now < 0:
+    print("clock before epoch")
+
+
+def check(value):
+    if value < 0:
+        return "negative"
+    return "ok"
+
+
+print(check(now))
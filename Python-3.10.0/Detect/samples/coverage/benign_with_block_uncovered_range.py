@@ -0,0 +1,9 @@
+# with块的异常处理代码(第7行)之后紧接着if不成立时的隐式return(第6行)，未覆盖的连续指令按行号的最小值和最大值给出范围
+# detect-args: prefilter=false,jump_branch=false
+# detect-expect: 'Uncovered': \[\('<module>', 6, 7\)\]
+import io
+
+if __name__ == "__main__":
+    with io.StringIO() as buf:
+        buf.write("written")
+        print(buf.getvalue())
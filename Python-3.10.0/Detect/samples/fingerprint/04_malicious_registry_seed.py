@@ -0,0 +1,20 @@
+# 常量中没有特征类别的恶意命令，结论按字节码指纹写入缓存
+# detect-expect-not: NearDuplicate
+# detect-expect: 'IsMalicious': True, 'Desc': 'Execute Malicious Command'
+import os
+import sys
+
+
+def run(host, port, retries):
+    for attempt in range(retries):
+        command = "reg add " + host + " /v " + str(port)
+        if os.system(command) == 0:
+            return attempt
+    return -1
+
+
+if __name__ == "__main__":
+    verbose = len(sys.argv) > 1
+    result = run("10.0.0.1", 4444, 3)
+    if verbose:
+        print("attempts", result)
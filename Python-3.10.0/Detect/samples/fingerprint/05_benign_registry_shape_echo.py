@@ -0,0 +1,19 @@
+# detect-expect-not: NearDuplicate
+# 与04结构相同，常量都没有特征类别，但常量的长度量级不同，指纹不同，不能复用04的恶意结论
+import os
+import sys
+
+
+def run(host, depth, retries):
+    for attempt in range(retries):
+        command = "echo " + host + " " + str(depth)
+        if os.system(command) == 0:
+            return attempt
+    return -1
+
+
+if __name__ == "__main__":
+    verbose = len(sys.argv) > 1
+    result = run("10.0.0.1", 1, 3)
+    if verbose:
+        print("attempts", result)
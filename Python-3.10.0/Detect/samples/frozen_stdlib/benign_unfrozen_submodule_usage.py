@@ -0,0 +1,9 @@
+# 只使用冻结包中未冻结的子模块生成邮件内容
+# detect-args: prefilter=false
+# detect-expect: ^libc: 
+import ctypes.util
+from email.mime.text import MIMEText
+
+msg = MIMEText("libc: %s" % ctypes.util.find_library("c"))
+msg["Subject"] = "report"
+print(msg.as_string().splitlines()[-1])
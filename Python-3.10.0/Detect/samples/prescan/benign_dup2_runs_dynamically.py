@@ -0,0 +1,7 @@
+# detect-expect: ^quiet$
+# os.dup2是自定义处理的函数，是反弹shell的证据之一，脚本不能被静态预过滤直接判为正常，需要执行检测
+import os
+
+devnull = os.open(os.devnull, os.O_WRONLY)
+os.dup2(devnull, 2)
+print("quiet")
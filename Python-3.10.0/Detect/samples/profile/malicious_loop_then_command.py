@@ -0,0 +1,15 @@
+# 开启采样时先执行耗时的循环再执行命令行参数，采样不影响检测结论
+# detect-expect-file: @tmp/profile.folded malicious_loop_then_command\.py:<module>:14;[^ ;]*malicious_loop_then_command\.py:spin:(10|11)(;\[detect\])? [0-9]+$
+import os
+import sys
+
+
+def spin(n):
+    total = 0
+    for i in range(n):
+        total += i * i
+    return total
+
+
+spin(200000)
+os.system(" ".join(sys.argv[1:]))
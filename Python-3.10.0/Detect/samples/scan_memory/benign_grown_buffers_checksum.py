@@ -0,0 +1,12 @@
+# 大量小对象反复扩容，校验扩容后的内容没有被破坏
+# detect-args: prefilter=false
+# detect-expect: ^4000 18889$
+parts = []
+data = b""
+for i in range(4000):
+    data += bytes([i % 251])
+    parts.append(str(i))
+text = ",".join(parts)
+assert data == bytes(i % 251 for i in range(4000))
+assert text.split(",")[-1] == "3999"
+print(len(data), len(text))
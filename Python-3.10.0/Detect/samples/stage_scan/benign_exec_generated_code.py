@@ -0,0 +1,6 @@
+# exec执行的二阶段代码只定义并调用普通函数
+# detect-expect: ^12$
+template = "def area(w, h):\n    return w * h\nresult = area(%d, %d)\n"
+namespace = {}
+exec(template % (3, 4), namespace)
+print(namespace["result"])
@@ -0,0 +1,9 @@
+# 包含空字符的代码字符串与真实的exec一样被拒绝，空字符之前的代码不会被截断后单独执行
+# detect-args: prefilter=false
+# detect-expect: ^DONE$
+# detect-expect-not: ^TRUNCATED
+try:
+    exec("print('TRUNCATED')\0print('HIDDEN')")
+except ValueError:
+    pass
+print("DONE")
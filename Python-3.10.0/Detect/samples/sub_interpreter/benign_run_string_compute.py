@@ -0,0 +1,12 @@
+# 在子解释器中执行普通计算
+# detect-expect: ^done$
+import _xxsubinterpreters as interpreters
+
+interp = interpreters.create()
+interpreters.run_string(interp, """
+import json, re
+data = json.dumps({"values": [i * i for i in range(10)]})
+print(re.search("values", data) is not None)
+""")
+interpreters.destroy(interp)
+print("done")
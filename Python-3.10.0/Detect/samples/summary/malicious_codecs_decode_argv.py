@@ -0,0 +1,6 @@
+# 命令行参数经过codecs.decode变换后作为命令执行，codecs.decode为_codecs模块的C函数
+# detect-expect: 'IsMalicious': True, 'Desc': 'Taint data reach threat callables'
+import codecs, os, sys
+
+cmd = codecs.decode(sys.argv[1], "rot13")
+os.system(cmd)
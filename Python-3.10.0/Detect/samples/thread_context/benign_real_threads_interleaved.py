@@ -0,0 +1,33 @@
+# detect-args: virtual_thread=false,prefilter=false
+# detect-expect: ^REAL_THREADS True$
+# detect-expect: ^RESULTS \[0, 4950, 9900, 14850\]$
+# 关闭虚拟线程，多个真实线程频繁切换、交替进入with块和不同的frame，各线程的调用信息、frame过滤缓存和
+# 污染区栈互不干扰，计算结果正确且没有误报
+import sys, threading
+
+sys.setswitchinterval(1e-6)
+lock = threading.Lock()
+ids = set()
+results = {}
+
+
+def step(n):
+    return n
+
+
+def work(k):
+    ids.add(threading.get_native_id())
+    total = 0
+    for i in range(100):
+        with lock:
+            total += step(i) * k
+    results[k] = total
+
+
+threads = [threading.Thread(target=work, args=(k,)) for k in range(4)]
+for t in threads:
+    t.start()
+for t in threads:
+    t.join()
+print("REAL_THREADS", threading.get_native_id() not in ids)
+print("RESULTS", [results[k] for k in range(4)])
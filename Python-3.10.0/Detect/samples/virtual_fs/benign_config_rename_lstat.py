@@ -0,0 +1,14 @@
+# 先写临时文件再重命名的原子写入，用lstat确认结果，文件只存在于虚拟文件系统中
+# detect-args: prefilter=false
+# detect-expect: ^35 dark$
+import json
+import os
+
+staging = "/tmp/settings.json.tmp"
+target = "/tmp/settings.json"
+with open(staging, "w") as fp:
+    json.dump({"theme": "dark", "autosave": True}, fp)
+os.rename(staging, target)
+info = os.lstat(target)
+with open(target) as fp:
+    print(info.st_size, json.load(fp)["theme"])
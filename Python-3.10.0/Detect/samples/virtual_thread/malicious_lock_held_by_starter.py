@@ -0,0 +1,24 @@
+# 工作线程先记录启动次数再等待启动线程持有的Lock，锁释放后从等待处继续执行命令行参数，
+# 启动次数只增加一次
+# detect-expect: ^STARTED 1$
+import os
+import sys
+import threading
+import time
+
+lock = threading.Lock()
+started = []
+
+
+def worker():
+    started.append(1)
+    with lock:
+        print("STARTED", len(started))
+        os.system(" ".join(sys.argv[1:]))
+
+
+t = threading.Thread(target=worker)
+with lock:
+    t.start()
+    time.sleep(0.1)
+t.join()
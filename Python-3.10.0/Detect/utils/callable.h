@@ -1,6 +1,8 @@
 #ifndef DETECT_UTILS_CFUNC_H
 #define DETECT_UTILS_CFUNC_H
 
+#include "Python.h"
+
 /* 可调用对象类型 */
 typedef enum {
 	CALLABLE_FUNCTION_TYPE = 0,   // 普通python函数或者未绑定实例的python实例方法
@@ -17,7 +19,22 @@ typedef enum {
 	CALLABLE_UNKNOWN_TYPE,
 }CALLABLE_TYPE_E;
 
+/* c方法模块名缓存的槽位数量，必须为2的幂 */
+#define CALLABLE_CFUNC_CACHE_SIZE 256
+
+/* c方法模块名缓存的最大探测次数 */
+#define CALLABLE_CFUNC_CACHE_MAX_PROBE 8
+
+/* c方法模块名缓存项，key为方法定义、所属类型及类型的版本号 */
+typedef struct {
+	PyMethodDef  *ml;
+	PyTypeObject *type;
+	unsigned int version_tag;
+	PyObject     *module_name;
+} CALLABLE_CFUNC_CACHE_ENTRY_T;
+
 extern PyObject* callable_cfunc_get_module_name(PyObject *callable);
+extern void callable_cfunc_cache_clear(CALLABLE_CFUNC_CACHE_ENTRY_T *cache);
 extern CALLABLE_TYPE_E callable_get_callable_type(PyObject *callable);
 
 #endif
@@ -7,6 +7,7 @@
 #include "pycore_interp.h"
 #include "frameobject.h"
 #include "str.h"
+#include "Detect/detect_state.h"
  
 /**
   * @description: 检查frame对象是否属于直接被执行的主文件
@@ -140,11 +141,11 @@ bool frame_is_internal_frame(PyFrameObject *frame) {
   */
 bool frame_is_belong_lib(PyThreadState *tstate, PyFrameObject *frame) {
 	PyObject *executable_name, *norm_executable_name, *norm_frame_filename;
-	static PyObject *lib_path = NULL;
 	PyObject *path_module, *normpath_method, *dirname_method, *join_method;
 	bool is_belong = false;
+	DETECT_STATE_T *state = tstate->interp->detect_state;
 
-	if (tstate->interp->config.executable == NULL) {
+	if (tstate->interp->config.executable == NULL || state == NULL) {
 		return false;
 	}
 	
@@ -157,7 +158,7 @@ bool frame_is_belong_lib(PyThreadState *tstate, PyFrameObject *frame) {
         						normpath_method, frame->f_code->co_filename, NULL);
 
 	/* 获取lib目录 */
-	if (lib_path == NULL) {
+	if (state->lib_path == NULL) {
 		PyObject *tmp_path, *parent_path;
 		PyObject *lib;
 
@@ -176,7 +177,7 @@ bool frame_is_belong_lib(PyThreadState *tstate, PyFrameObject *frame) {
 		/* 和lib拼接成lib目录 */
 		lib = PyUnicode_FromString("lib");
 		join_method = PyObject_GetAttrString(path_module, "join");
-		lib_path = PyObject_CallFunctionObjArgs(
+		state->lib_path = PyObject_CallFunctionObjArgs(
         						join_method, parent_path, lib, NULL);
 
 		Py_DECREF(executable_name);
@@ -187,7 +188,7 @@ bool frame_is_belong_lib(PyThreadState *tstate, PyFrameObject *frame) {
 	}
 
 	/* 判断frame所属文件是否在lib目录下 */
-	if (PyUnicode_Find(norm_frame_filename, lib_path, 0, PyUnicode_GET_LENGTH(lib_path)+1, 1) > -1) {
+	if (PyUnicode_Find(norm_frame_filename, state->lib_path, 0, PyUnicode_GET_LENGTH(state->lib_path)+1, 1) > -1) {
 		is_belong = true;
 	}
 
@@ -8,6 +8,7 @@
 #include "frameobject.h"
 #include "pycore_pyerrors.h"
 #include "Detect/utils/module.h"
+#include "Detect/detect_state.h"
 
 /**
  * @description: 根据模块名检查该模块是否已被导入
@@ -110,6 +111,7 @@ PyObject* module_create_module(PyObject *module_name) {
 	PyObject *sys_modules, *new_module_obj_list;
 	PyObject *module_name_list, *module_name_obj, *sep_obj;
 	PyObject *top_module_obj, *sub_module_obj, *last_level_module_obj;
+	bool is_missing;
 	int index;
 
 	new_module_obj_list = PyList_New(0);
@@ -125,11 +127,22 @@ PyObject* module_create_module(PyObject *module_name) {
 	/* 判断顶层模块是否存在 */
 	module_name_obj = PyList_GetItem(module_name_list, 0);
 
-	/* 检查模块是否存在 */
-	top_module_obj = PyImport_Import(module_name_obj);
+	/* 检查模块是否存在，已知缺失的模块不再重复搜索 */
+	top_module_obj = module_missing_cache_get(module_name_obj, MODULE_MISSING_STUB);
 	if (top_module_obj == NULL) {
+		top_module_obj = PyImport_Import(module_name_obj);
+	}
+	if (top_module_obj == NULL) {
+		is_missing = PyErr_ExceptionMatches(PyExc_ModuleNotFoundError);
+		if (is_missing) {
+			PyErr_Clear();
+		}
+
 		/* 创建模块 */
 		top_module_obj = PyModule_NewObject(module_name_obj);
+		if (is_missing) {
+			module_missing_cache_set(module_name_obj, MODULE_MISSING_STUB, top_module_obj);
+		}
 
 		/* 获取sys.modules字典 */
 		sys_modules = PyImport_GetModuleDict();
@@ -154,11 +167,22 @@ PyObject* module_create_module(PyObject *module_name) {
 		/* 构建子模块名 */
 		module_name_obj = PyUnicode_Join(sep_obj, PyList_GetSlice(module_name_list, 0, index+1));
 
-		/* 检查子模块是否存在 */
-		sub_module_obj = PyImport_Import(module_name_obj);
+		/* 检查子模块是否存在，已知缺失的模块不再重复搜索 */
+		sub_module_obj = module_missing_cache_get(module_name_obj, MODULE_MISSING_STUB);
+		if (sub_module_obj == NULL) {
+			sub_module_obj = PyImport_Import(module_name_obj);
+		}
 		if (sub_module_obj == NULL) {
+			is_missing = PyErr_ExceptionMatches(PyExc_ModuleNotFoundError);
+			if (is_missing) {
+				PyErr_Clear();
+			}
+
 			/* 创建子模块 */
 			sub_module_obj = PyModule_NewObject(PyList_GetItem(module_name_list, index));
+			if (is_missing) {
+				module_missing_cache_set(module_name_obj, MODULE_MISSING_STUB, sub_module_obj);
+			}
 
 			/* 标记该模块是被创建的 */
 			PyModule_AddObject(sub_module_obj, CREATED_BY_DETECT_KEY, Py_True);
@@ -225,3 +249,122 @@ PyObject* module_get_attr(PyObject *module_obj, PyObject *attr_name) {
 	return attr_value;
 }
 
+/**
+  * @description: 检查sys.path或sys.meta_path的快照是否仍然有效。快照保存列表中的各元素，只比较元素的身份，
+  *               列表未被修改时只需要逐个比较指针
+  * @param snapshot 快照元组
+  * @param name sys模块中的属性名
+  * @return bool true --- 快照仍然有效
+  */
+static bool module_missing_cache_check_snapshot(PyObject *snapshot, const char *name) {
+	PyObject *current = PySys_GetObject(name);
+	Py_ssize_t index;
+
+	if (snapshot == NULL || current == NULL || !PyList_Check(current) ||
+		PyList_GET_SIZE(current) != PyTuple_GET_SIZE(snapshot)) {
+		return false;
+	}
+
+	for (index = 0; index < PyTuple_GET_SIZE(snapshot); index++) {
+		if (PyList_GET_ITEM(current, index) != PyTuple_GET_ITEM(snapshot, index)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+  * @description: 拍摄sys.path或sys.meta_path的快照
+  * @param snapshot 快照的地址
+  * @param name sys模块中的属性名
+  * @return void
+  */
+static void module_missing_cache_take_snapshot(PyObject **snapshot, const char *name) {
+	PyObject *current = PySys_GetObject(name);
+
+	Py_CLEAR(*snapshot);
+	if (current != NULL) {
+		*snapshot = PySequence_Tuple(current);
+		if (*snapshot == NULL) {
+			PyErr_Clear();
+		}
+	}
+}
+
+/**
+  * @description: 清空缺失模块的负缓存并重新拍摄sys.path和sys.meta_path的快照
+  * @param state detect状态
+  * @return void
+  */
+static void module_missing_cache_reset(DETECT_STATE_T *state) {
+	int index;
+
+	for (index = 0; index < MODULE_MISSING_KIND_MAX; index++) {
+		Py_CLEAR(state->missing_module_dicts[index]);
+	}
+	module_missing_cache_take_snapshot(&state->missing_module_sys_path, "path");
+	module_missing_cache_take_snapshot(&state->missing_module_meta_path, "meta_path");
+}
+
+/**
+  * @description: 从缺失模块的负缓存中获取代替模块的对象。只在命中时校验sys.path和sys.meta_path，
+  *               二者发生变化后模块可能变得可以导入，此时清空缓存
+  * @param module_name 模块绝对名
+  * @param kind 负缓存的种类
+  * @return PyObject* 代替模块的对象(新引用)，模块不在负缓存中时返回NULL且不设置异常
+  */
+PyObject* module_missing_cache_get(PyObject *module_name, MODULE_MISSING_KIND_E kind) {
+	DETECT_STATE_T *state = detect_state_get();
+	PyObject *stub_obj;
+
+	if (state == NULL || state->missing_module_dicts[kind] == NULL) {
+		return NULL;
+	}
+
+	stub_obj = PyDict_GetItemWithError(state->missing_module_dicts[kind], module_name);
+	if (stub_obj == NULL) {
+		PyErr_Clear();
+		return NULL;
+	}
+
+	if (!module_missing_cache_check_snapshot(state->missing_module_sys_path, "path") ||
+		!module_missing_cache_check_snapshot(state->missing_module_meta_path, "meta_path")) {
+		module_missing_cache_reset(state);
+		return NULL;
+	}
+
+	Py_INCREF(stub_obj);
+
+	return stub_obj;
+}
+
+/**
+  * @description: 将缺失的模块及代替它的对象加入负缓存，所有种类的负缓存都为空时拍摄快照
+  * @param module_name 模块绝对名
+  * @param kind 负缓存的种类
+  * @param stub_obj 代替模块的对象
+  * @return void
+  */
+void module_missing_cache_set(PyObject *module_name, MODULE_MISSING_KIND_E kind, PyObject *stub_obj) {
+	DETECT_STATE_T *state = detect_state_get();
+	int index;
+
+	if (state == NULL) {
+		return;
+	}
+
+	for (index = 0; index < MODULE_MISSING_KIND_MAX && state->missing_module_dicts[index] == NULL; index++);
+	if (index == MODULE_MISSING_KIND_MAX) {
+		module_missing_cache_reset(state);
+	}
+
+	if (state->missing_module_dicts[kind] == NULL) {
+		state->missing_module_dicts[kind] = PyDict_New();
+	}
+
+	if (state->missing_module_dicts[kind] == NULL ||
+		PyDict_SetItem(state->missing_module_dicts[kind], module_name, stub_obj) < 0) {
+		PyErr_Clear();
+	}
+}
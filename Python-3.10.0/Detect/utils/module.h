@@ -3,6 +3,14 @@
 
 #define CREATED_BY_DETECT_KEY "created_by_detect"
 
+/* 缺失模块负缓存的种类，不同来源的代替对象分开缓存 */
+typedef enum {
+	MODULE_MISSING_IMPORT,      // fromlist为空的import语句，值为语句绑定的顶层名字的代替对象
+	MODULE_MISSING_IMPORT_FROM, // fromlist非空的from ... import语句，值为模块本身的代替对象
+	MODULE_MISSING_STUB,        // module_create_module创建的模块对象
+	MODULE_MISSING_KIND_MAX,
+} MODULE_MISSING_KIND_E;
+
 extern bool module_is_imported_by_name(PyObject *module_name);
 extern PyObject *module_get_module_dict_by_name(PyObject *module_name);
 extern PyObject *module_import_name(PyThreadState *tstate, PyFrameObject *f,
@@ -10,6 +18,8 @@ extern PyObject *module_import_name(PyThreadState *tstate, PyFrameObject *f,
 extern PyObject* module_create_module(PyObject *module_name);
 extern PyObject* module_get_attr_by_string(PyObject *module_obj, const char *attr_name);
 extern PyObject* module_get_attr(PyObject *module_obj, PyObject *attr_name);
+extern PyObject* module_missing_cache_get(PyObject *module_name, MODULE_MISSING_KIND_E kind);
+extern void module_missing_cache_set(PyObject *module_name, MODULE_MISSING_KIND_E kind, PyObject *stub_obj);
 
 #endif
 
@@ -5,9 +5,11 @@
 #include <stdbool.h>
 #include <wchar.h>
 #include "Python.h"
+#include "Detect/detect_state.h"
 
-static PyObject* g_re_module = NULL;
-static PyObject* g_re_search_method = NULL;
+/* re模块和search方法属于解释器级对象，保存在detect状态中 */
+#define g_re_module        (detect_state_get_or_default()->re_module)
+#define g_re_search_method (detect_state_get_or_default()->re_search_method)
 
 /**
  * @description: re的search实现
@@ -16,15 +18,25 @@ static PyObject* g_re_search_method = NULL;
  * @param flags
  */
 PyObject* re_search(const char *pattern, PyObject *string, int flags) {
+	DETECT_STATE_T *state = detect_state_get();
 	PyObject *pattern_obj, *flags_obj;
 	PyObject *searches;
 
-	/* 获取sre模块和compile方法 */
+	/* 获取sre模块和compile方法，未初始化detect模块的解释器中不缓存 */
+	if (state == NULL) {
+		return NULL;
+	}
 	if (g_re_module == NULL) {
-		g_re_module = PyImport_ImportModule("re");
+		state->re_module = PyImport_ImportModule("re");
+		if (g_re_module == NULL) {
+			return NULL;
+		}
 	}
 	if (g_re_search_method == NULL) {
-		g_re_search_method = PyObject_GetAttrString(g_re_module, "search");
+		state->re_search_method = PyObject_GetAttrString(g_re_module, "search");
+		if (g_re_search_method == NULL) {
+			return NULL;
+		}
 	}
 
 	/* 执行search */
@@ -38,7 +38,8 @@ char *str_convert_wchar_to_string(const wchar_t *pSrc) {
  * @param PyObject*
  */
 PyObject* str_copy_from_unicode_object(PyObject* obj) {
-	if (obj == NULL) {
+	/* 函数的__module__等属性可能为None，非字符串对象不复制，也不设置异常 */
+	if (obj == NULL || !PyUnicode_Check(obj)) {
 		return NULL;
 	}
 
@@ -0,0 +1,39 @@
+/*
+ * @Description: 虚拟时钟，检测模式下阻塞等待不消耗真实时间，只推进虚拟时钟
+ */
+
+#include "Python.h"
+#include "Detect/virtual/virtual_clock.h"
+#include "Detect/virtual/virtual_io.h"
+#include "Detect/detect_state.h"
+
+/* 虚拟时钟相对真实时钟的偏移，单位为纳秒，只增不减。每个解释器各有一份 */
+#define g_virtual_clock_offset (detect_state_get_or_default()->virtual_clock_offset)
+
+/**
+ * @description: 推进虚拟时钟，用来代替真实的阻塞等待
+ * @param t 需要推进的时间，单位为纳秒
+ * @return void
+ */
+void detect_virtual_clock_advance(_PyTime_t t) {
+	DETECT_STATE_T *state = detect_state_get();
+
+	if (t <= 0 || state == NULL) {
+		return;
+	}
+
+	state->virtual_clock_offset += t;
+}
+
+/**
+ * @description: 获取虚拟时钟偏移，time模块在返回当前时间时叠加该偏移，
+ *               保证脚本观察到的时间与虚拟等待一致。未开启虚拟I/O时返回0
+ * @return _PyTime_t 单位为纳秒
+ */
+_PyTime_t detect_virtual_clock_get_offset(void) {
+	if (!detect_virtual_io_is_active()) {
+		return 0;
+	}
+
+	return g_virtual_clock_offset;
+}
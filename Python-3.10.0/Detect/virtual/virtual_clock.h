@@ -0,0 +1,10 @@
+#ifndef DETECT_VIRTUAL_VIRTUAL_CLOCK_H
+#define DETECT_VIRTUAL_VIRTUAL_CLOCK_H
+
+#include "Python.h"
+
+/* 虚拟时钟接口会被select、_socket等编译为so库的扩展模块调用，需要导出符号 */
+PyAPI_FUNC(void) detect_virtual_clock_advance(_PyTime_t t);
+PyAPI_FUNC(_PyTime_t) detect_virtual_clock_get_offset(void);
+
+#endif
@@ -0,0 +1,677 @@
+/*
+ * @Description: 虚拟文件系统，检测模式下文件的写入、创建、删除和重命名只作用于内存中的覆盖层，
+ *               不修改真实磁盘。覆盖层以规范化后的绝对路径为key，value为保存文件内容的memfd，
+ *               被删除的文件记录为None。读文件时优先查找覆盖层，写入已存在的真实文件时先复制到覆盖层
+ */
+
+#include "Python.h"
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Detect/configs/config.h"
+#include "Detect/virtual/virtual_fs.h"
+#include "Detect/detect_state.h"
+
+/* 写入已存在的真实文件时复制到覆盖层的最大长度，超出时打开失败，避免写入真实磁盘 */
+#define DETECT_VIRTUAL_FS_MAX_COPY (64 * 1024 * 1024)
+/* 提供给分析模块的单个文件内容的最大长度 */
+#define DETECT_VIRTUAL_FS_MAX_READ (1024 * 1024)
+
+/* 覆盖层字典保存在解释器级的detect状态中 */
+#define g_virtual_fs_dict (detect_state_get_or_default()->virtual_fs_dict)
+
+/* 设备、进程信息等伪文件系统直接使用真实的文件操作 */
+static const char *g_virtual_fs_excluded_dirs[] = {
+	"/dev", "/proc", "/sys",
+};
+
+/**
+ * @description: 判断当前是否开启虚拟文件系统。只有在detect模块开启、虚拟文件系统开关打开
+ *               并且已经开始执行主脚本时才生效，避免影响解释器启动和detect初始化
+ * @return bool
+ */
+bool detect_virtual_fs_is_active(void) {
+#ifdef HAVE_MEMFD_CREATE
+	if (!detect_config_get_runtime_is_enable() || !detect_config_get_runtime_is_virtual_fs()) {
+		return false;
+	}
+
+	return detect_config_get_runtime_state() != RUN_STATE_INITIALIZING;
+#else
+	return false;
+#endif
+}
+
+#ifdef HAVE_MEMFD_CREATE
+
+/**
+ * @description: 生成覆盖层的key，相对路径基于当前目录或者dir_fd转换为绝对路径，并按字面规范化'.'和'..'
+ * @param path 路径
+ * @param dir_fd 相对路径的基准目录，AT_FDCWD代表当前目录
+ * @return PyObject* bytes对象，失败时返回NULL且不设置异常
+ */
+static PyObject* detect_virtual_fs_make_key(const char *path, int dir_fd) {
+	char base[PATH_MAX], link[32];
+	const char *iter, *end;
+	char *joined, *out;
+	size_t base_len = 0, out_len = 1, comp_len;
+	ssize_t link_len;
+	PyObject *key;
+
+	if (path[0] != '/') {
+		if (dir_fd == AT_FDCWD) {
+			if (getcwd(base, sizeof(base)) == NULL) {
+				return NULL;
+			}
+			base_len = strlen(base);
+		} else {
+			snprintf(link, sizeof(link), "/proc/self/fd/%d", dir_fd);
+			link_len = readlink(link, base, sizeof(base) - 1);
+			if (link_len <= 0) {
+				return NULL;
+			}
+			base_len = (size_t)link_len;
+		}
+	}
+
+	joined = PyMem_RawMalloc(base_len + strlen(path) + 2);
+	out    = PyMem_RawMalloc(base_len + strlen(path) + 2);
+	if (joined == NULL || out == NULL) {
+		PyMem_RawFree(joined);
+		PyMem_RawFree(out);
+		return NULL;
+	}
+	memcpy(joined, base, base_len);
+	joined[base_len] = '/';
+	strcpy(joined + base_len + 1, path);
+
+	/* 逐段规范化，结果除根目录外不以'/'结尾 */
+	out[0] = '/';
+	for (iter = joined; *iter != '\0'; iter = end) {
+		while (*iter == '/') {
+			iter++;
+		}
+		for (end = iter; *end != '\0' && *end != '/'; end++);
+		comp_len = end - iter;
+
+		if (comp_len == 0 || (comp_len == 1 && iter[0] == '.')) {
+			continue;
+		}
+		if (comp_len == 2 && iter[0] == '.' && iter[1] == '.') {
+			while (out_len > 1 && out[out_len - 1] != '/') {
+				out_len--;
+			}
+			if (out_len > 1) {
+				out_len--;
+			}
+			continue;
+		}
+		if (out_len > 1) {
+			out[out_len++] = '/';
+		}
+		memcpy(out + out_len, iter, comp_len);
+		out_len += comp_len;
+	}
+
+	key = PyBytes_FromStringAndSize(out, out_len);
+	if (key == NULL) {
+		PyErr_Clear();
+	}
+
+	PyMem_RawFree(joined);
+	PyMem_RawFree(out);
+
+	return key;
+}
+
+/**
+ * @description: 获取路径对应的覆盖层key，伪文件系统下的路径以及生成失败时返回NULL
+ * @param path 路径
+ * @param dir_fd 相对路径的基准目录
+ * @return PyObject* bytes对象
+ */
+static PyObject* detect_virtual_fs_get_key(const char *path, int dir_fd) {
+	PyObject *key;
+	const char *key_str;
+	size_t length;
+	unsigned int index;
+
+	if (path == NULL || detect_state_get() == NULL) {
+		return NULL;
+	}
+
+	key = detect_virtual_fs_make_key(path, dir_fd);
+	if (key == NULL) {
+		return NULL;
+	}
+
+	key_str = PyBytes_AS_STRING(key);
+	for (index = 0; index < sizeof(g_virtual_fs_excluded_dirs)/sizeof(const char*); index++) {
+		length = strlen(g_virtual_fs_excluded_dirs[index]);
+		if (!strncmp(key_str, g_virtual_fs_excluded_dirs[index], length) &&
+			(key_str[length] == '/' || key_str[length] == '\0')) {
+			Py_DECREF(key);
+			return NULL;
+		}
+	}
+
+	return key;
+}
+
+/**
+ * @description: 查找覆盖层中的文件
+ * @param key 覆盖层key
+ * @return PyObject* 借用引用，memfd或者代表已删除的None，不存在时返回NULL
+ */
+static PyObject* detect_virtual_fs_lookup(PyObject *key) {
+	if (g_virtual_fs_dict == NULL) {
+		return NULL;
+	}
+
+	return PyDict_GetItem(g_virtual_fs_dict, key);
+}
+
+/**
+ * @description: 设置覆盖层中的文件，被替换的memfd会被关闭
+ * @param key 覆盖层key
+ * @param value memfd或者代表已删除的None，引用被接管
+ * @return int 0 --- 成功，-1 --- 失败且设置errno
+ */
+static int detect_virtual_fs_set_entry(PyObject *key, PyObject *value) {
+	DETECT_STATE_T *state = detect_state_get();
+	PyObject *old;
+
+	if (value == NULL || state == NULL) {
+		Py_XDECREF(value);
+		PyErr_Clear();
+		errno = ENOMEM;
+		return -1;
+	}
+
+	if (g_virtual_fs_dict == NULL) {
+		state->virtual_fs_dict = PyDict_New();
+	}
+
+	old = detect_virtual_fs_lookup(key);
+	if (old != NULL && PyLong_Check(old)) {
+		close(_PyLong_AsInt(old));
+	}
+
+	if (g_virtual_fs_dict == NULL || PyDict_SetItem(g_virtual_fs_dict, key, value) < 0) {
+		Py_DECREF(value);
+		PyErr_Clear();
+		errno = ENOMEM;
+		return -1;
+	}
+	Py_DECREF(value);
+
+	return 0;
+}
+
+/**
+ * @description: 为覆盖层创建新的memfd，需要时复制真实文件的内容和权限
+ * @param key 覆盖层key
+ * @param real_path 需要复制的真实文件，为NULL时创建空文件
+ * @param mode 新建文件的权限，会应用umask
+ * @return int memfd，失败时返回-1且设置errno
+ */
+static int detect_virtual_fs_create(PyObject *key, const char *real_path, int mode) {
+	const char *name = strrchr(PyBytes_AS_STRING(key), '/') + 1;
+	char buf[8192];
+	struct stat st;
+	ssize_t n, written, offset;
+	mode_t mask;
+	int memfd, real_fd;
+
+	memfd = memfd_create(name, MFD_CLOEXEC);
+	if (memfd < 0) {
+		return -1;
+	}
+
+	if (real_path == NULL) {
+		mask = umask(0);
+		umask(mask);
+		fchmod(memfd, (mode_t)mode & ~mask & 07777);
+		return memfd;
+	}
+
+	real_fd = open(real_path, O_RDONLY | O_CLOEXEC);
+	if (real_fd < 0 || fstat(real_fd, &st) < 0) {
+		goto error;
+	}
+	fchmod(memfd, st.st_mode & 07777);
+
+	while ((n = read(real_fd, buf, sizeof(buf))) != 0) {
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			goto error;
+		}
+		for (offset = 0; offset < n; offset += written) {
+			written = write(memfd, buf + offset, n - offset);
+			if (written < 0) {
+				goto error;
+			}
+		}
+	}
+
+	close(real_fd);
+
+	return memfd;
+
+error:
+	n = errno;
+	if (real_fd >= 0) {
+		close(real_fd);
+	}
+	close(memfd);
+	errno = (int)n;
+
+	return -1;
+}
+
+/**
+ * @description: 重新打开memfd，得到独立的文件偏移，打开标志与真实open一致
+ * @param memfd 覆盖层中的memfd
+ * @param flags 打开标志
+ * @return int 文件描述符，失败时返回-1且设置errno
+ */
+static int detect_virtual_fs_reopen(int memfd, int flags) {
+	char link[32];
+	int fd;
+
+	snprintf(link, sizeof(link), "/proc/self/fd/%d", memfd);
+	do {
+		fd = open(link, flags & ~(O_CREAT | O_EXCL | O_NOFOLLOW));
+	} while (fd < 0 && errno == EINTR);
+
+	return fd;
+}
+
+/**
+ * @description: 判断真实文件的父目录是否存在
+ * @param key 覆盖层key
+ * @return bool
+ */
+static bool detect_virtual_fs_parent_exists(PyObject *key) {
+	const char *key_str = PyBytes_AS_STRING(key);
+	size_t length = strrchr(key_str, '/') - key_str;
+	char *parent;
+	struct stat st;
+	bool exists;
+
+	if (length == 0) {
+		return true;
+	}
+
+	parent = PyMem_RawMalloc(length + 1);
+	if (parent == NULL) {
+		return false;
+	}
+	memcpy(parent, key_str, length);
+	parent[length] = '\0';
+
+	exists = stat(parent, &st) == 0 && S_ISDIR(st.st_mode);
+	PyMem_RawFree(parent);
+
+	return exists;
+}
+
+/**
+ * @description: open/os.open的虚拟实现。覆盖层中的文件直接打开；带有写入意图时，新文件创建在覆盖层中，
+ *               已存在的真实文件先复制到覆盖层(截断时不复制)；只读打开覆盖层外的文件时使用真实文件
+ * @param path 路径
+ * @param dir_fd 相对路径的基准目录
+ * @param flags 打开标志
+ * @param mode 新建文件的权限
+ * @return int 文件描述符；失败时返回-1且设置errno；不处理时返回DETECT_VIRTUAL_FS_NOT_HANDLED
+ */
+int detect_virtual_fs_open(const char *path, int dir_fd, int flags, int mode) {
+	PyObject *key, *entry;
+	struct stat st;
+	int memfd, fd = DETECT_VIRTUAL_FS_NOT_HANDLED;
+	bool is_write;
+
+	if (!detect_virtual_fs_is_active() || (flags & O_DIRECTORY)) {
+		return DETECT_VIRTUAL_FS_NOT_HANDLED;
+	}
+
+	key = detect_virtual_fs_get_key(path, dir_fd);
+	if (key == NULL) {
+		return DETECT_VIRTUAL_FS_NOT_HANDLED;
+	}
+
+	is_write = (flags & O_ACCMODE) != O_RDONLY || (flags & (O_CREAT | O_TRUNC | O_APPEND));
+	entry = detect_virtual_fs_lookup(key);
+
+	if (entry != NULL && PyLong_Check(entry)) {
+		/* 覆盖层中的文件 */
+		if ((flags & O_CREAT) && (flags & O_EXCL)) {
+			errno = EEXIST;
+			fd = -1;
+		} else {
+			fd = detect_virtual_fs_reopen(_PyLong_AsInt(entry), flags);
+		}
+	} else if (entry != NULL) {
+		/* 已被删除的文件 */
+		if (!(flags & O_CREAT)) {
+			errno = ENOENT;
+			fd = -1;
+		} else {
+			memfd = detect_virtual_fs_create(key, NULL, mode);
+			fd = memfd < 0 || detect_virtual_fs_set_entry(key, PyLong_FromLong(memfd)) < 0 ?
+				 -1 : detect_virtual_fs_reopen(memfd, flags);
+		}
+	} else if (is_write) {
+		/* 覆盖层外的文件，写入时复制 */
+		if (stat(PyBytes_AS_STRING(key), &st) == 0) {
+			if (S_ISDIR(st.st_mode)) {
+				errno = EISDIR;
+				fd = -1;
+			} else if (!S_ISREG(st.st_mode)) {
+				fd = DETECT_VIRTUAL_FS_NOT_HANDLED;
+			} else if ((flags & O_CREAT) && (flags & O_EXCL)) {
+				errno = EEXIST;
+				fd = -1;
+			} else if (!(flags & O_TRUNC) && st.st_size > DETECT_VIRTUAL_FS_MAX_COPY) {
+				errno = EFBIG;
+				fd = -1;
+			} else {
+				memfd = detect_virtual_fs_create(key, (flags & O_TRUNC) ? NULL : PyBytes_AS_STRING(key), mode);
+				fd = memfd < 0 || detect_virtual_fs_set_entry(key, PyLong_FromLong(memfd)) < 0 ?
+					 -1 : detect_virtual_fs_reopen(memfd, flags);
+			}
+		} else if (errno != ENOENT) {
+			fd = -1;
+		} else if (!(flags & O_CREAT) || !detect_virtual_fs_parent_exists(key)) {
+			errno = ENOENT;
+			fd = -1;
+		} else {
+			memfd = detect_virtual_fs_create(key, NULL, mode);
+			fd = memfd < 0 || detect_virtual_fs_set_entry(key, PyLong_FromLong(memfd)) < 0 ?
+				 -1 : detect_virtual_fs_reopen(memfd, flags);
+		}
+	}
+
+	Py_DECREF(key);
+
+	return fd;
+}
+
+/**
+ * @description: os.stat和os.lstat的虚拟实现，覆盖层中的文件返回memfd的信息。覆盖层按字面路径记录，
+ *               通过符号链接写入时链接本身仍然存在，不跟随符号链接时返回真实链接的信息
+ * @param path 路径
+ * @param dir_fd 相对路径的基准目录
+ * @param follow_symlinks 是否跟随符号链接
+ * @param st 文件信息
+ * @return int 0 --- 成功；失败时返回-1且设置errno；不处理时返回DETECT_VIRTUAL_FS_NOT_HANDLED
+ */
+int detect_virtual_fs_stat(const char *path, int dir_fd, int follow_symlinks, struct stat *st) {
+	PyObject *key, *entry;
+	struct stat link_st;
+	int result = DETECT_VIRTUAL_FS_NOT_HANDLED;
+
+	if (!detect_virtual_fs_is_active()) {
+		return DETECT_VIRTUAL_FS_NOT_HANDLED;
+	}
+
+	key = detect_virtual_fs_get_key(path, dir_fd);
+	if (key == NULL) {
+		return DETECT_VIRTUAL_FS_NOT_HANDLED;
+	}
+
+	entry = detect_virtual_fs_lookup(key);
+	if (entry != NULL && PyLong_Check(entry)) {
+		if (!follow_symlinks && lstat(PyBytes_AS_STRING(key), &link_st) == 0 && S_ISLNK(link_st.st_mode)) {
+			*st = link_st;
+			result = 0;
+		} else {
+			result = fstat(_PyLong_AsInt(entry), st);
+		}
+	} else if (entry != NULL) {
+		errno = ENOENT;
+		result = -1;
+	}
+
+	Py_DECREF(key);
+
+	return result;
+}
+
+/**
+ * @description: os.unlink/os.remove的虚拟实现，删除覆盖层中的文件，真实文件只记录为已删除
+ * @param path 路径
+ * @param dir_fd 相对路径的基准目录
+ * @return int 0 --- 成功；失败时返回-1且设置errno；不处理时返回DETECT_VIRTUAL_FS_NOT_HANDLED
+ */
+int detect_virtual_fs_unlink(const char *path, int dir_fd) {
+	PyObject *key, *entry;
+	struct stat st;
+	int result;
+
+	if (!detect_virtual_fs_is_active()) {
+		return DETECT_VIRTUAL_FS_NOT_HANDLED;
+	}
+
+	key = detect_virtual_fs_get_key(path, dir_fd);
+	if (key == NULL) {
+		return DETECT_VIRTUAL_FS_NOT_HANDLED;
+	}
+
+	entry = detect_virtual_fs_lookup(key);
+	if (entry != NULL && PyLong_Check(entry)) {
+		result = detect_virtual_fs_set_entry(key, Py_NewRef(Py_None));
+	} else if (entry != NULL) {
+		errno = ENOENT;
+		result = -1;
+	} else if (lstat(PyBytes_AS_STRING(key), &st) < 0) {
+		result = -1;
+	} else if (S_ISDIR(st.st_mode)) {
+		errno = EISDIR;
+		result = -1;
+	} else {
+		result = detect_virtual_fs_set_entry(key, Py_NewRef(Py_None));
+	}
+
+	Py_DECREF(key);
+
+	return result;
+}
+
+/**
+ * @description: os.rename/os.replace的虚拟实现，源文件移动到覆盖层中的目标路径，源路径记录为已删除。
+ *               目录的重命名不处理
+ * @param src 源路径
+ * @param src_dir_fd 源路径的基准目录
+ * @param dst 目标路径
+ * @param dst_dir_fd 目标路径的基准目录
+ * @return int 0 --- 成功；失败时返回-1且设置errno；不处理时返回DETECT_VIRTUAL_FS_NOT_HANDLED
+ */
+int detect_virtual_fs_rename(const char *src, int src_dir_fd, const char *dst, int dst_dir_fd) {
+	PyObject *src_key, *dst_key = NULL, *entry;
+	struct stat st;
+	int memfd, result = DETECT_VIRTUAL_FS_NOT_HANDLED;
+
+	if (!detect_virtual_fs_is_active()) {
+		return DETECT_VIRTUAL_FS_NOT_HANDLED;
+	}
+
+	src_key = detect_virtual_fs_get_key(src, src_dir_fd);
+	dst_key = src_key != NULL ? detect_virtual_fs_get_key(dst, dst_dir_fd) : NULL;
+	if (src_key == NULL || dst_key == NULL) {
+		goto finally;
+	}
+
+	entry = detect_virtual_fs_lookup(src_key);
+	if (entry != NULL && PyLong_Check(entry)) {
+		/* 目标路径的旧文件被关闭，源路径的memfd转移到目标路径 */
+		memfd = _PyLong_AsInt(entry);
+		if (PyObject_RichCompareBool(src_key, dst_key, Py_EQ) == 1) {
+			result = 0;
+		} else if (PyDict_SetItem(g_virtual_fs_dict, src_key, Py_None) < 0) {
+			PyErr_Clear();
+			errno = ENOMEM;
+			result = -1;
+		} else {
+			result = detect_virtual_fs_set_entry(dst_key, PyLong_FromLong(memfd));
+		}
+	} else if (entry != NULL) {
+		errno = ENOENT;
+		result = -1;
+	} else if (lstat(PyBytes_AS_STRING(src_key), &st) < 0) {
+		result = -1;
+	} else if (S_ISREG(st.st_mode)) {
+		if (st.st_size > DETECT_VIRTUAL_FS_MAX_COPY) {
+			errno = EFBIG;
+			result = -1;
+		} else {
+			memfd = detect_virtual_fs_create(dst_key, PyBytes_AS_STRING(src_key), 0);
+			result = memfd < 0 || detect_virtual_fs_set_entry(dst_key, PyLong_FromLong(memfd)) < 0 ||
+					 detect_virtual_fs_set_entry(src_key, Py_NewRef(Py_None)) < 0 ? -1 : 0;
+		}
+	}
+
+finally:
+	Py_XDECREF(src_key);
+	Py_XDECREF(dst_key);
+
+	return result;
+}
+
+/**
+ * @description: os.chmod的虚拟实现，只处理覆盖层中的文件
+ * @param path 路径
+ * @param dir_fd 相对路径的基准目录
+ * @param mode 权限
+ * @return int 0 --- 成功；失败时返回-1且设置errno；不处理时返回DETECT_VIRTUAL_FS_NOT_HANDLED
+ */
+int detect_virtual_fs_chmod(const char *path, int dir_fd, int mode) {
+	PyObject *key, *entry;
+	int result = DETECT_VIRTUAL_FS_NOT_HANDLED;
+
+	if (!detect_virtual_fs_is_active()) {
+		return DETECT_VIRTUAL_FS_NOT_HANDLED;
+	}
+
+	key = detect_virtual_fs_get_key(path, dir_fd);
+	if (key == NULL) {
+		return DETECT_VIRTUAL_FS_NOT_HANDLED;
+	}
+
+	entry = detect_virtual_fs_lookup(key);
+	if (entry != NULL && PyLong_Check(entry)) {
+		result = fchmod(_PyLong_AsInt(entry), (mode_t)mode);
+	} else if (entry != NULL) {
+		errno = ENOENT;
+		result = -1;
+	}
+
+	Py_DECREF(key);
+
+	return result;
+}
+
+#else /* !HAVE_MEMFD_CREATE */
+
+int detect_virtual_fs_open(const char *path, int dir_fd, int flags, int mode) {
+	return DETECT_VIRTUAL_FS_NOT_HANDLED;
+}
+
+int detect_virtual_fs_stat(const char *path, int dir_fd, int follow_symlinks, struct stat *st) {
+	return DETECT_VIRTUAL_FS_NOT_HANDLED;
+}
+
+int detect_virtual_fs_unlink(const char *path, int dir_fd) {
+	return DETECT_VIRTUAL_FS_NOT_HANDLED;
+}
+
+int detect_virtual_fs_rename(const char *src, int src_dir_fd, const char *dst, int dst_dir_fd) {
+	return DETECT_VIRTUAL_FS_NOT_HANDLED;
+}
+
+int detect_virtual_fs_chmod(const char *path, int dir_fd, int mode) {
+	return DETECT_VIRTUAL_FS_NOT_HANDLED;
+}
+
+#endif /* HAVE_MEMFD_CREATE */
+
+/**
+ * @description: 获取检测过程中写入的文件，供分析模块使用
+ * @return PyObject* 字典，key为文件路径，value为文件内容(最多DETECT_VIRTUAL_FS_MAX_READ字节)，
+ *                   没有写入过文件时返回NULL
+ */
+PyObject* detect_virtual_fs_get_files(void) {
+	DETECT_STATE_T *state = detect_state_get();
+	PyObject *files, *key, *value, *path, *content;
+	Py_ssize_t pos = 0, size;
+	struct stat st;
+	int fd;
+
+	if (state == NULL || state->virtual_fs_dict == NULL) {
+		return NULL;
+	}
+
+	files = PyDict_New();
+	if (files == NULL) {
+		PyErr_Clear();
+		return NULL;
+	}
+
+	while (PyDict_Next(state->virtual_fs_dict, &pos, &key, &value)) {
+		if (!PyLong_Check(value)) {
+			continue;
+		}
+
+		fd = _PyLong_AsInt(value);
+		size = fstat(fd, &st) == 0 ? Py_MIN((Py_ssize_t)st.st_size, DETECT_VIRTUAL_FS_MAX_READ) : 0;
+		content = PyBytes_FromStringAndSize(NULL, size);
+		if (content != NULL && size > 0) {
+			size = pread(fd, PyBytes_AS_STRING(content), size, 0);
+			if (size >= 0) {
+				_PyBytes_Resize(&content, size);
+			} else {
+				Py_CLEAR(content);
+			}
+		}
+
+		path = PyUnicode_DecodeFSDefaultAndSize(PyBytes_AS_STRING(key), PyBytes_GET_SIZE(key));
+		if (path != NULL && content != NULL) {
+			PyDict_SetItem(files, path, content);
+		}
+		Py_XDECREF(path);
+		Py_XDECREF(content);
+	}
+
+	PyErr_Clear();
+
+	return files;
+}
+
+/**
+ * @description: 关闭覆盖层中所有的memfd并清理覆盖层字典
+ * @param fs_dict 覆盖层字典
+ * @return void
+ */
+void detect_virtual_fs_clear(PyObject **fs_dict) {
+	PyObject *key, *value;
+	Py_ssize_t pos = 0;
+
+	if (*fs_dict == NULL) {
+		return;
+	}
+
+	while (PyDict_Next(*fs_dict, &pos, &key, &value)) {
+		if (PyLong_Check(value)) {
+			close(_PyLong_AsInt(value));
+		}
+	}
+
+	Py_CLEAR(*fs_dict);
+}
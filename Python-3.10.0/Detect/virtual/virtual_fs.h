@@ -0,0 +1,20 @@
+#ifndef DETECT_VIRTUAL_VIRTUAL_FS_H
+#define DETECT_VIRTUAL_VIRTUAL_FS_H
+
+#include <stdbool.h>
+#include <sys/stat.h>
+#include "Python.h"
+
+/* 虚拟文件系统不处理该路径，调用方继续执行真实的文件操作 */
+#define DETECT_VIRTUAL_FS_NOT_HANDLED (-2)
+
+extern bool detect_virtual_fs_is_active(void);
+extern int detect_virtual_fs_open(const char *path, int dir_fd, int flags, int mode);
+extern int detect_virtual_fs_stat(const char *path, int dir_fd, int follow_symlinks, struct stat *st);
+extern int detect_virtual_fs_unlink(const char *path, int dir_fd);
+extern int detect_virtual_fs_rename(const char *src, int src_dir_fd, const char *dst, int dst_dir_fd);
+extern int detect_virtual_fs_chmod(const char *path, int dir_fd, int mode);
+extern PyObject* detect_virtual_fs_get_files(void);
+extern void detect_virtual_fs_clear(PyObject **fs_dict);
+
+#endif
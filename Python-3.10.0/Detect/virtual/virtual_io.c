@@ -0,0 +1,101 @@
+/*
+ * @Description: 虚拟I/O，检测模式下让阻塞类原语立即返回，避免样本消耗真实的等待时间
+ */
+
+#include <stdbool.h>
+#include "Python.h"
+#include "Detect/configs/config.h"
+#include "Detect/object/object.h"
+#include "Detect/virtual/virtual_io.h"
+
+/**
+ * @description: 判断当前是否处于虚拟I/O模式。只有在detect模块开启、虚拟I/O开关打开
+ *               并且已经开始执行主脚本时才生效，避免影响解释器启动和detect初始化
+ * @return bool
+ */
+bool detect_virtual_io_is_active(void) {
+	if (!detect_config_get_runtime_is_enable() || !detect_config_get_runtime_is_virtual_io()) {
+		return false;
+	}
+
+	return detect_config_get_runtime_state() != RUN_STATE_INITIALIZING;
+}
+
+/**
+ * @description: 从select的等待列表中挑选出hook对象
+ * @param seq 等待列表，select已经将一次性的迭代器物化为列表
+ * @param has_hook_object 是否存在hook对象
+ * @return PyObject* 由hook对象组成的新列表
+ */
+static PyObject* detect_virtual_io_select_hook_objects(PyObject *seq, bool *has_hook_object) {
+	PyObject *fast_seq, *hook_list, *item;
+	Py_ssize_t index;
+
+	hook_list = PyList_New(0);
+	if (hook_list == NULL) {
+		return NULL;
+	}
+
+	fast_seq = PySequence_Fast(seq, "arguments 1-3 must be sequences");
+	if (fast_seq == NULL) {
+		/* 非序列交由原select逻辑报错 */
+		PyErr_Clear();
+		return hook_list;
+	}
+
+	for (index = 0; index < PySequence_Fast_GET_SIZE(fast_seq); index++) {
+		item = PySequence_Fast_GET_ITEM(fast_seq, index);
+
+		if (detect_object_get_object_type(item) != DETECT_OBJECT_TYPE_MAX) {
+			PyList_Append(hook_list, item);
+			*has_hook_object = true;
+		}
+	}
+
+	Py_DECREF(fast_seq);
+
+	return hook_list;
+}
+
+/**
+ * @description: select.select的虚拟实现。taint等hook对象没有真实的文件描述符，
+ *               当等待列表中出现hook对象时直接认为其可读可写并立即返回，否则交由
+ *               原select逻辑处理
+ * @param rlist 等待读的列表
+ * @param wlist 等待写的列表
+ * @param xlist 等待异常的列表
+ * @return PyObject* 三元组(可读列表, 可写列表, [])；不需要虚拟处理时返回NULL且不设置异常
+ */
+PyObject* detect_virtual_io_select(PyObject *rlist, PyObject *wlist, PyObject *xlist) {
+	PyObject *r_hook_list, *w_hook_list, *x_hook_list;
+	PyObject *result = NULL;
+	bool has_hook_object = false;
+
+	if (!detect_virtual_io_is_active()) {
+		return NULL;
+	}
+
+	r_hook_list = detect_virtual_io_select_hook_objects(rlist, &has_hook_object);
+	w_hook_list = detect_virtual_io_select_hook_objects(wlist, &has_hook_object);
+	x_hook_list = detect_virtual_io_select_hook_objects(xlist, &has_hook_object);
+
+	if (r_hook_list == NULL || w_hook_list == NULL || x_hook_list == NULL) {
+		PyErr_Clear();
+		goto finally;
+	}
+
+	/* hook对象不会产生异常事件，异常列表始终返回空 */
+	if (has_hook_object) {
+		Py_SETREF(x_hook_list, PyList_New(0));
+		if (x_hook_list != NULL) {
+			result = PyTuple_Pack(3, r_hook_list, w_hook_list, x_hook_list);
+		}
+	}
+
+finally:
+	Py_XDECREF(r_hook_list);
+	Py_XDECREF(w_hook_list);
+	Py_XDECREF(x_hook_list);
+
+	return result;
+}
@@ -0,0 +1,11 @@
+#ifndef DETECT_VIRTUAL_VIRTUAL_IO_H
+#define DETECT_VIRTUAL_VIRTUAL_IO_H
+
+#include <stdbool.h>
+#include "Python.h"
+
+/* 虚拟I/O接口会被select、_socket等编译为so库的扩展模块调用，需要导出符号 */
+PyAPI_FUNC(bool) detect_virtual_io_is_active(void);
+PyAPI_FUNC(PyObject*) detect_virtual_io_select(PyObject *rlist, PyObject *wlist, PyObject *xlist);
+
+#endif
@@ -0,0 +1,602 @@
+/*
+ * @Description: 虚拟进程，检测模式下multiprocessing.Process的target和multiprocessing.Pool的任务
+ *               在当前解释器中内联执行，不创建真实的子进程。子进程中的代码同样处于hook之下，
+ *               检测不再需要等待子进程，分析也不会泄漏到被检测进程之外
+ */
+
+#include "Python.h"
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "structmember.h"
+#include "Detect/configs/config.h"
+#include "Detect/virtual/virtual_process.h"
+
+/* 需要替换_Popen的multiprocessing.context中的进程类 */
+static const char *g_process_class_names[] = {
+	"Process", "ForkProcess", "SpawnProcess", "ForkServerProcess"
+};
+
+/* 内联执行的进程，代替multiprocessing.popen_*中的Popen类 */
+typedef struct {
+	PyObject_HEAD
+	int returncode; // target执行结束后的退出码
+	long pid;       // 进程号，内联执行时为当前进程号
+	int sentinel;   // 进程结束的哨兵fd，写端已关闭，始终可读
+} DetectInlinePopenObject;
+
+/* 内联执行的异步结果，代替multiprocessing.pool.ApplyResult */
+typedef struct {
+	PyObject_HEAD
+	PyObject *value;     // 执行结果
+	PyObject *exception; // 执行过程中抛出的异常对象，没有异常时为NULL
+} DetectInlineResultObject;
+
+/* 内联执行的进程池，代替multiprocessing.pool.Pool */
+typedef struct {
+	PyObject_HEAD
+} DetectInlinePoolObject;
+
+static PyTypeObject DetectInlinePopen_Type;
+static PyTypeObject DetectInlineResult_Type;
+static PyTypeObject DetectInlinePool_Type;
+
+/**
+ * @description: 判断当前是否内联执行子进程
+ * @return bool
+ */
+static bool detect_virtual_process_is_active(void) {
+	return detect_config_get_runtime_is_enable() && detect_config_get_runtime_is_inline_process();
+}
+
+/**
+ * @description: 获取SystemExit对应的退出码，与子进程中multiprocessing.process._bootstrap的处理一致
+ * @return int 退出码
+ */
+static int detect_virtual_process_get_exit_code(void) {
+	PyObject *exc_type, *exc_value, *exc_tb, *code;
+	int exitcode = 1;
+
+	if (!PyErr_ExceptionMatches(PyExc_SystemExit)) {
+		PyErr_Clear();
+		return exitcode;
+	}
+
+	PyErr_Fetch(&exc_type, &exc_value, &exc_tb);
+	PyErr_NormalizeException(&exc_type, &exc_value, &exc_tb);
+
+	code = exc_value != NULL ? PyObject_GetAttrString(exc_value, "code") : NULL;
+	if (code == Py_None) {
+		exitcode = 0;
+	} else if (code != NULL && PyLong_Check(code)) {
+		exitcode = _PyLong_AsInt(code);
+	}
+
+	Py_XDECREF(code);
+	Py_XDECREF(exc_type);
+	Py_XDECREF(exc_value);
+	Py_XDECREF(exc_tb);
+	PyErr_Clear();
+
+	return exitcode;
+}
+
+/**
+ * @description: InlinePopen的__new__方法，在BaseProcess.start中调用，直接执行进程对象的run方法
+ * @param type 类型对象
+ * @param args 位置参数，(process_obj,)
+ * @param kwargs 关键字参数
+ * @return PyObject* 已经执行结束的InlinePopen对象
+ */
+static PyObject* detect_virtual_process_popen_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+	DetectInlinePopenObject *self;
+	PyObject *process_obj, *res;
+	int fds[2];
+
+	if (!PyArg_ParseTuple(args, "O:InlinePopen", &process_obj)) {
+		return NULL;
+	}
+
+	self = (DetectInlinePopenObject *)type->tp_alloc(type, 0);
+	if (self == NULL) {
+		return NULL;
+	}
+
+	self->pid = getpid();
+	self->sentinel = -1;
+	if (pipe(fds) == 0) {
+		close(fds[1]);
+		fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+		self->sentinel = fds[0];
+	}
+
+	/* run默认调用target(*args, **kwargs)，子类可能重写了run */
+	res = PyObject_CallMethod(process_obj, "run", NULL);
+	if (res != NULL) {
+		Py_DECREF(res);
+		self->returncode = 0;
+	} else {
+		self->returncode = detect_virtual_process_get_exit_code();
+	}
+
+	/* 调用后置状态与子进程正常退出一致，BaseProcess.start在之后继续执行 */
+	PyErr_Clear();
+
+	return (PyObject *)self;
+}
+
+/**
+ * @description: InlinePopen的poll和wait方法，进程已经执行结束，直接返回退出码
+ * @return PyObject*
+ */
+static PyObject* detect_virtual_process_popen_poll(DetectInlinePopenObject *self, PyObject *args, PyObject *kwargs) {
+	return PyLong_FromLong(self->returncode);
+}
+
+/**
+ * @description: InlinePopen的terminate和kill方法，进程已经执行结束，无需处理
+ * @return PyObject*
+ */
+static PyObject* detect_virtual_process_popen_terminate(DetectInlinePopenObject *self, PyObject *args) {
+	Py_RETURN_NONE;
+}
+
+/**
+ * @description: InlinePopen的close方法，关闭哨兵fd
+ * @return PyObject*
+ */
+static PyObject* detect_virtual_process_popen_close(DetectInlinePopenObject *self, PyObject *args) {
+	if (self->sentinel >= 0) {
+		close(self->sentinel);
+		self->sentinel = -1;
+	}
+
+	Py_RETURN_NONE;
+}
+
+/**
+ * @description: InlinePopen的析构函数
+ * @return void
+ */
+static void detect_virtual_process_popen_dealloc(DetectInlinePopenObject *self) {
+	if (self->sentinel >= 0) {
+		close(self->sentinel);
+	}
+
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyMethodDef g_inline_popen_methods[] = {
+	{"poll",      (PyCFunction)(void(*)(void))detect_virtual_process_popen_poll, METH_VARARGS | METH_KEYWORDS, NULL},
+	{"wait",      (PyCFunction)(void(*)(void))detect_virtual_process_popen_poll, METH_VARARGS | METH_KEYWORDS, NULL},
+	{"terminate", (PyCFunction)detect_virtual_process_popen_terminate, METH_NOARGS, NULL},
+	{"kill",      (PyCFunction)detect_virtual_process_popen_terminate, METH_NOARGS, NULL},
+	{"close",     (PyCFunction)detect_virtual_process_popen_close,     METH_NOARGS, NULL},
+	{NULL, NULL, 0, NULL}
+};
+
+static PyMemberDef g_inline_popen_members[] = {
+	{"returncode", T_INT,  offsetof(DetectInlinePopenObject, returncode), 0,        NULL},
+	{"pid",        T_LONG, offsetof(DetectInlinePopenObject, pid),        READONLY, NULL},
+	{"sentinel",   T_INT,  offsetof(DetectInlinePopenObject, sentinel),   READONLY, NULL},
+	{NULL, 0, 0, 0, NULL}
+};
+
+static PyTypeObject DetectInlinePopen_Type = {
+	PyVarObject_HEAD_INIT(&PyType_Type, 0)
+	.tp_name      = "detect.InlinePopen",
+	.tp_basicsize = sizeof(DetectInlinePopenObject),
+	.tp_dealloc   = (destructor)detect_virtual_process_popen_dealloc,
+	.tp_flags     = Py_TPFLAGS_DEFAULT,
+	.tp_methods   = g_inline_popen_methods,
+	.tp_members   = g_inline_popen_members,
+	.tp_new       = detect_virtual_process_popen_new,
+};
+
+/**
+ * @description: 根据已经执行结束的任务生成异步结果，并立即调用回调函数
+ * @param value 任务的返回值，引用被该函数接管；为NULL时代表任务抛出了异常
+ * @param callback 成功时的回调函数，可以为NULL或None
+ * @param error_callback 失败时的回调函数，可以为NULL或None
+ * @return PyObject* InlineResult对象
+ */
+static PyObject* detect_virtual_process_result_create(PyObject *value, PyObject *callback, PyObject *error_callback) {
+	DetectInlineResultObject *result;
+	PyObject *exc_type, *exc_value, *exc_tb, *res;
+
+	result = PyObject_New(DetectInlineResultObject, &DetectInlineResult_Type);
+	if (result == NULL) {
+		Py_XDECREF(value);
+		return NULL;
+	}
+
+	result->value = value;
+	result->exception = NULL;
+
+	if (value == NULL) {
+		PyErr_Fetch(&exc_type, &exc_value, &exc_tb);
+		PyErr_NormalizeException(&exc_type, &exc_value, &exc_tb);
+		if (exc_value != NULL && exc_tb != NULL) {
+			PyException_SetTraceback(exc_value, exc_tb);
+		}
+		result->exception = exc_value;
+		Py_XDECREF(exc_type);
+		Py_XDECREF(exc_tb);
+
+		if (result->exception == NULL) {
+			result->exception = PyObject_CallNoArgs(PyExc_RuntimeError);
+		}
+
+		res = error_callback != NULL && error_callback != Py_None ?
+			  PyObject_CallOneArg(error_callback, result->exception) : NULL;
+	} else {
+		res = callback != NULL && callback != Py_None ? PyObject_CallOneArg(callback, value) : NULL;
+	}
+
+	/* 回调函数在结果处理线程中执行，其中的异常不会传递给调用方 */
+	Py_XDECREF(res);
+	PyErr_Clear();
+
+	return (PyObject *)result;
+}
+
+/**
+ * @description: InlineResult的get方法，返回执行结果或抛出执行过程中的异常
+ * @return PyObject*
+ */
+static PyObject* detect_virtual_process_result_get(DetectInlineResultObject *self, PyObject *args, PyObject *kwargs) {
+	if (self->exception != NULL) {
+		PyErr_SetObject((PyObject *)Py_TYPE(self->exception), self->exception);
+		return NULL;
+	}
+
+	Py_INCREF(self->value);
+	return self->value;
+}
+
+/**
+ * @description: InlineResult的wait方法，任务已经执行结束，直接返回
+ * @return PyObject*
+ */
+static PyObject* detect_virtual_process_result_wait(DetectInlineResultObject *self, PyObject *args, PyObject *kwargs) {
+	Py_RETURN_NONE;
+}
+
+/**
+ * @description: InlineResult的ready方法
+ * @return PyObject*
+ */
+static PyObject* detect_virtual_process_result_ready(DetectInlineResultObject *self, PyObject *args) {
+	Py_RETURN_TRUE;
+}
+
+/**
+ * @description: InlineResult的successful方法
+ * @return PyObject*
+ */
+static PyObject* detect_virtual_process_result_successful(DetectInlineResultObject *self, PyObject *args) {
+	return PyBool_FromLong(self->exception == NULL);
+}
+
+/**
+ * @description: InlineResult的析构函数
+ * @return void
+ */
+static void detect_virtual_process_result_dealloc(DetectInlineResultObject *self) {
+	Py_XDECREF(self->value);
+	Py_XDECREF(self->exception);
+	PyObject_Free(self);
+}
+
+static PyMethodDef g_inline_result_methods[] = {
+	{"get",        (PyCFunction)(void(*)(void))detect_virtual_process_result_get,  METH_VARARGS | METH_KEYWORDS, NULL},
+	{"wait",       (PyCFunction)(void(*)(void))detect_virtual_process_result_wait, METH_VARARGS | METH_KEYWORDS, NULL},
+	{"ready",      (PyCFunction)detect_virtual_process_result_ready,      METH_NOARGS, NULL},
+	{"successful", (PyCFunction)detect_virtual_process_result_successful, METH_NOARGS, NULL},
+	{NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject DetectInlineResult_Type = {
+	PyVarObject_HEAD_INIT(&PyType_Type, 0)
+	.tp_name      = "detect.InlineResult",
+	.tp_basicsize = sizeof(DetectInlineResultObject),
+	.tp_dealloc   = (destructor)detect_virtual_process_result_dealloc,
+	.tp_flags     = Py_TPFLAGS_DEFAULT,
+	.tp_methods   = g_inline_result_methods,
+};
+
+/**
+ * @description: 依次执行可迭代对象中的每个任务
+ * @param func 任务函数
+ * @param iterable 任务参数
+ * @param is_star 是否将每个任务参数展开为位置参数，用于starmap
+ * @return PyObject* 结果列表，任务抛出异常时返回NULL
+ */
+static PyObject* detect_virtual_process_pool_map_list(PyObject *func, PyObject *iterable, bool is_star) {
+	PyObject *iterator, *item, *item_args, *value, *results;
+
+	iterator = PyObject_GetIter(iterable);
+	results  = iterator != NULL ? PyList_New(0) : NULL;
+	if (results == NULL) {
+		Py_XDECREF(iterator);
+		return NULL;
+	}
+
+	while ((item = PyIter_Next(iterator)) != NULL) {
+		if (is_star) {
+			item_args = PySequence_Tuple(item);
+			value = item_args != NULL ? PyObject_Call(func, item_args, NULL) : NULL;
+			Py_XDECREF(item_args);
+		} else {
+			value = PyObject_CallOneArg(func, item);
+		}
+		Py_DECREF(item);
+
+		if (value == NULL || PyList_Append(results, value) < 0) {
+			Py_XDECREF(value);
+			Py_CLEAR(results);
+			break;
+		}
+		Py_DECREF(value);
+	}
+
+	Py_DECREF(iterator);
+	if (results != NULL && PyErr_Occurred()) {
+		Py_CLEAR(results);
+	}
+
+	return results;
+}
+
+/**
+ * @description: InlinePool的__new__方法，initializer在当前解释器中执行一次
+ * @return PyObject*
+ */
+static PyObject* detect_virtual_process_pool_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+	static char *kwlist[] = {"processes", "initializer", "initargs", "maxtasksperchild", "context", NULL};
+	PyObject *processes = NULL, *initializer = NULL, *initargs = NULL, *maxtasks = NULL, *context = NULL;
+	PyObject *res, *init_args;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|OOOOO:Pool", kwlist,
+									 &processes, &initializer, &initargs, &maxtasks, &context)) {
+		return NULL;
+	}
+
+	if (initializer != NULL && initializer != Py_None) {
+		init_args = initargs != NULL ? PySequence_Tuple(initargs) : PyTuple_New(0);
+		res = init_args != NULL ? PyObject_Call(initializer, init_args, NULL) : NULL;
+		Py_XDECREF(init_args);
+		Py_XDECREF(res);
+
+		/* initializer在工作进程中执行，异常不会传递给调用方 */
+		PyErr_Clear();
+	}
+
+	return type->tp_alloc(type, 0);
+}
+
+/**
+ * @description: InlinePool的apply和apply_async方法
+ * @return PyObject*
+ */
+static PyObject* detect_virtual_process_pool_apply_common(PyObject *args, PyObject *kwargs, bool is_async) {
+	static char *kwlist[] = {"func", "args", "kwds", "callback", "error_callback", NULL};
+	PyObject *func, *func_args = NULL, *func_kwargs = NULL, *callback = NULL, *error_callback = NULL;
+	PyObject *args_tuple, *value;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, is_async ? "O|OOOO:apply_async" : "O|OO:apply", kwlist,
+									 &func, &func_args, &func_kwargs, &callback, &error_callback)) {
+		return NULL;
+	}
+
+	args_tuple = func_args != NULL ? PySequence_Tuple(func_args) : PyTuple_New(0);
+	if (args_tuple == NULL) {
+		return NULL;
+	}
+
+	value = PyObject_Call(func, args_tuple,
+						  func_kwargs != NULL && PyDict_Check(func_kwargs) ? func_kwargs : NULL);
+	Py_DECREF(args_tuple);
+
+	return is_async ? detect_virtual_process_result_create(value, callback, error_callback) : value;
+}
+
+static PyObject* detect_virtual_process_pool_apply(PyObject *self, PyObject *args, PyObject *kwargs) {
+	return detect_virtual_process_pool_apply_common(args, kwargs, false);
+}
+
+static PyObject* detect_virtual_process_pool_apply_async(PyObject *self, PyObject *args, PyObject *kwargs) {
+	return detect_virtual_process_pool_apply_common(args, kwargs, true);
+}
+
+/**
+ * @description: InlinePool的map、starmap、imap、imap_unordered及其异步版本
+ * @param is_star 是否为starmap
+ * @param is_async 是否为异步版本，返回InlineResult
+ * @param is_iter 是否为imap，返回迭代器
+ * @return PyObject*
+ */
+static PyObject* detect_virtual_process_pool_map_common(PyObject *args, PyObject *kwargs,
+														bool is_star, bool is_async, bool is_iter) {
+	static char *kwlist[] = {"func", "iterable", "chunksize", "callback", "error_callback", NULL};
+	PyObject *func, *iterable, *chunksize = NULL, *callback = NULL, *error_callback = NULL;
+	PyObject *results, *iterator;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, is_async ? "OO|OOO:map_async" : "OO|O:map", kwlist,
+									 &func, &iterable, &chunksize, &callback, &error_callback)) {
+		return NULL;
+	}
+
+	results = detect_virtual_process_pool_map_list(func, iterable, is_star);
+
+	if (is_async) {
+		return detect_virtual_process_result_create(results, callback, error_callback);
+	}
+
+	if (is_iter && results != NULL) {
+		iterator = PyObject_GetIter(results);
+		Py_DECREF(results);
+		return iterator;
+	}
+
+	return results;
+}
+
+static PyObject* detect_virtual_process_pool_map(PyObject *self, PyObject *args, PyObject *kwargs) {
+	return detect_virtual_process_pool_map_common(args, kwargs, false, false, false);
+}
+
+static PyObject* detect_virtual_process_pool_map_async(PyObject *self, PyObject *args, PyObject *kwargs) {
+	return detect_virtual_process_pool_map_common(args, kwargs, false, true, false);
+}
+
+static PyObject* detect_virtual_process_pool_starmap(PyObject *self, PyObject *args, PyObject *kwargs) {
+	return detect_virtual_process_pool_map_common(args, kwargs, true, false, false);
+}
+
+static PyObject* detect_virtual_process_pool_starmap_async(PyObject *self, PyObject *args, PyObject *kwargs) {
+	return detect_virtual_process_pool_map_common(args, kwargs, true, true, false);
+}
+
+static PyObject* detect_virtual_process_pool_imap(PyObject *self, PyObject *args, PyObject *kwargs) {
+	return detect_virtual_process_pool_map_common(args, kwargs, false, false, true);
+}
+
+/**
+ * @description: InlinePool的close、terminate和join方法，任务都已经执行结束，无需处理
+ * @return PyObject*
+ */
+static PyObject* detect_virtual_process_pool_close(PyObject *self, PyObject *args) {
+	Py_RETURN_NONE;
+}
+
+/**
+ * @description: InlinePool的__enter__方法
+ * @return PyObject*
+ */
+static PyObject* detect_virtual_process_pool_enter(PyObject *self, PyObject *args) {
+	Py_INCREF(self);
+	return self;
+}
+
+static PyMethodDef g_inline_pool_methods[] = {
+	{"apply",          (PyCFunction)(void(*)(void))detect_virtual_process_pool_apply,         METH_VARARGS | METH_KEYWORDS, NULL},
+	{"apply_async",    (PyCFunction)(void(*)(void))detect_virtual_process_pool_apply_async,   METH_VARARGS | METH_KEYWORDS, NULL},
+	{"map",            (PyCFunction)(void(*)(void))detect_virtual_process_pool_map,           METH_VARARGS | METH_KEYWORDS, NULL},
+	{"map_async",      (PyCFunction)(void(*)(void))detect_virtual_process_pool_map_async,     METH_VARARGS | METH_KEYWORDS, NULL},
+	{"starmap",        (PyCFunction)(void(*)(void))detect_virtual_process_pool_starmap,       METH_VARARGS | METH_KEYWORDS, NULL},
+	{"starmap_async",  (PyCFunction)(void(*)(void))detect_virtual_process_pool_starmap_async, METH_VARARGS | METH_KEYWORDS, NULL},
+	{"imap",           (PyCFunction)(void(*)(void))detect_virtual_process_pool_imap,          METH_VARARGS | METH_KEYWORDS, NULL},
+	{"imap_unordered", (PyCFunction)(void(*)(void))detect_virtual_process_pool_imap,          METH_VARARGS | METH_KEYWORDS, NULL},
+	{"close",          (PyCFunction)detect_virtual_process_pool_close, METH_NOARGS,  NULL},
+	{"terminate",      (PyCFunction)detect_virtual_process_pool_close, METH_NOARGS,  NULL},
+	{"join",           (PyCFunction)detect_virtual_process_pool_close, METH_NOARGS,  NULL},
+	{"__enter__",      (PyCFunction)detect_virtual_process_pool_enter, METH_NOARGS,  NULL},
+	{"__exit__",       (PyCFunction)detect_virtual_process_pool_close, METH_VARARGS, NULL},
+	{NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject DetectInlinePool_Type = {
+	PyVarObject_HEAD_INIT(&PyType_Type, 0)
+	.tp_name      = "detect.InlinePool",
+	.tp_basicsize = sizeof(DetectInlinePoolObject),
+	.tp_flags     = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+	.tp_methods   = g_inline_pool_methods,
+	.tp_new       = detect_virtual_process_pool_new,
+};
+
+/**
+ * @description: 替换模块中的对象，模块未导入时不处理
+ * @param module_name 模块名
+ * @param name 对象名
+ * @param value 替换后的对象
+ * @return void
+ */
+static void detect_virtual_process_replace(const char *module_name, const char *name, PyObject *value) {
+	PyObject *module = PyDict_GetItemString(PyImport_GetModuleDict(), module_name);
+
+	if (module != NULL && PyModule_Check(module)) {
+		PyDict_SetItemString(PyModule_GetDict(module), name, value);
+	}
+}
+
+/**
+ * @description: 替换multiprocessing.pool.Pool为内联进程池。multiprocessing.pool在使用时才导入，
+ *               所以在导入multiprocessing包之后调用。每个子解释器有各自的模块，已替换过的模块直接跳过
+ * @param import_name 导入的模块名，为NULL时表示初始化阶段的调用
+ * @return void
+ */
+void detect_virtual_process_patch_pool(PyObject *import_name) {
+	PyObject *module;
+	size_t length = strlen("multiprocessing");
+
+	if (!detect_virtual_process_is_active()) {
+		return;
+	}
+
+	/* 只有导入multiprocessing包时才会加载multiprocessing.pool */
+	if (import_name != NULL) {
+		const char *name = PyUnicode_Check(import_name) ? PyUnicode_AsUTF8(import_name) : NULL;
+		if (name == NULL || strncmp(name, "multiprocessing", length) != 0 ||
+			(name[length] != '\0' && name[length] != '.')) {
+			PyErr_Clear();
+			return;
+		}
+	}
+
+	module = PyDict_GetItemString(PyImport_GetModuleDict(), "multiprocessing.pool");
+	if (module == NULL || !PyModule_Check(module)) {
+		return;
+	}
+
+	if (PyDict_GetItemString(PyModule_GetDict(module), "Pool") == (PyObject *)&DetectInlinePool_Type) {
+		return;
+	}
+
+	PyDict_SetItemString(PyModule_GetDict(module), "Pool", (PyObject *)&DetectInlinePool_Type);
+}
+
+/**
+ * @description: 虚拟进程初始化，在hook模块替换配置对象之后调用。Process的各启动方式都通过_Popen创建
+ *               子进程，替换为InlinePopen后target在start中内联执行；Pool替换为InlinePool
+ * @return void
+ */
+void detect_virtual_process_init(void) {
+	PyObject *context_module, *process_class, *base_context, *pool_method;
+	unsigned int index;
+
+	if (!detect_virtual_process_is_active()) {
+		return;
+	}
+
+	if (PyType_Ready(&DetectInlinePopen_Type) < 0 || PyType_Ready(&DetectInlineResult_Type) < 0 ||
+		PyType_Ready(&DetectInlinePool_Type) < 0) {
+		PyErr_Clear();
+		return;
+	}
+
+	context_module = PyDict_GetItemString(PyImport_GetModuleDict(), "multiprocessing.context");
+	if (context_module == NULL || !PyModule_Check(context_module)) {
+		return;
+	}
+
+	for (index = 0; index < sizeof(g_process_class_names)/sizeof(g_process_class_names[0]); index++) {
+		process_class = PyDict_GetItemString(PyModule_GetDict(context_module), g_process_class_names[index]);
+		if (process_class != NULL && PyType_Check(process_class)) {
+			PyObject_SetAttrString(process_class, "_Popen", (PyObject *)&DetectInlinePopen_Type);
+		}
+	}
+
+	/* multiprocessing.Pool是默认上下文的绑定方法，get_context()得到的上下文通过BaseContext.Pool创建进程池 */
+	base_context = PyDict_GetItemString(PyModule_GetDict(context_module), "BaseContext");
+	pool_method  = PyStaticMethod_New((PyObject *)&DetectInlinePool_Type);
+	if (base_context != NULL && PyType_Check(base_context) && pool_method != NULL) {
+		PyObject_SetAttrString(base_context, "Pool", pool_method);
+	}
+	Py_XDECREF(pool_method);
+
+	detect_virtual_process_replace("multiprocessing", "Pool", (PyObject *)&DetectInlinePool_Type);
+	detect_virtual_process_patch_pool(NULL);
+
+	PyErr_Clear();
+}
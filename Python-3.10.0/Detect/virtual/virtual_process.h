@@ -0,0 +1,9 @@
+#ifndef DETECT_VIRTUAL_VIRTUAL_PROCESS_H
+#define DETECT_VIRTUAL_VIRTUAL_PROCESS_H
+
+#include "Python.h"
+
+extern void detect_virtual_process_init(void);
+extern void detect_virtual_process_patch_pool(PyObject *import_name);
+
+#endif
@@ -0,0 +1,818 @@
+/*
+ * @Description: 虚拟线程，检测模式下threading的线程不创建真实的系统线程，而是作为协程在主线程上
+ *               确定性地调度执行。每个虚拟线程有独立的栈，在锁等待、sleep等阻塞点以及opcode预算用尽时切换，
+ *               等待锁的线程挂起到锁释放后从等待处继续，同一样本每次检测的线程交错顺序一致，检测结论可以复现
+ */
+
+#include "Python.h"
+#include <stdbool.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "pycore_pyerrors.h"
+#include "Detect/configs/config.h"
+#include "Detect/detect_context.h"
+#include "Detect/virtual/virtual_thread.h"
+#include "Detect/detect_profile.h"
+#include "Detect/detect_state.h"
+
+/* 每执行多少条opcode调度一次等待中的虚拟线程 */
+#define DETECT_VIRTUAL_THREAD_QUANTUM    10000
+/* 虚拟线程单次运行最多执行的opcode数量，用尽后投递SystemExit结束该线程 */
+#define DETECT_VIRTUAL_THREAD_BUDGET     1000000
+/* 虚拟线程嵌套运行的最大深度，超过后新线程留在队列中等待上层调度 */
+#define DETECT_VIRTUAL_THREAD_DEPTH_MAX  16
+/* 虚拟线程的栈大小，与Linux系统线程的默认栈大小一致，只占用虚拟地址空间，按实际使用分配物理内存 */
+#define DETECT_VIRTUAL_THREAD_STACK_SIZE (8 * 1024 * 1024)
+#define DETECT_VIRTUAL_THREAD_CAPSULE_NAME "detect.virtual_thread"
+
+/* 切换虚拟线程时随栈一起保存和恢复的线程状态。虚拟线程运行时保存的是调度它的线程的状态，挂起时保存的是自己的状态 */
+typedef struct {
+	PyFrameObject *frame;           // 当前frame
+	int recursion_depth;            // 递归深度
+	int recursion_headroom;         // 处理RecursionError时额外允许的递归深度
+	CFrame *cframe;                 // 当前的CFrame
+	_PyErr_StackItem *exc_info;     // 正在处理的异常栈
+	PyObject *context;              // contextvars上下文
+	int trash_delete_nesting;       // 延迟释放的嵌套深度
+	PyObject *trash_delete_later;   // 延迟释放的对象链表
+	void *detect_context;           // detect模块的线程级上下文
+	int profile_depth;              // 采样时区分检测代码的标记
+	unsigned long ident;            // 线程标识
+	PyObject *sentinel;             // 线程的结束哨兵锁
+	long opcode_count;              // 自上次调度以来执行的opcode数量
+	bool interrupted;               // 是否因opcode预算用尽投递了SystemExit
+} DETECT_VIRTUAL_THREAD_SAVED_T;
+
+/* 虚拟线程 */
+typedef struct _detect_virtual_thread {
+	ucontext_t context;             // 虚拟线程的执行上下文
+	ucontext_t *resumer;            // 调度该线程的执行上下文，线程结束或等待锁时切换回去
+	void *stack;                    // 虚拟线程的栈
+	PyObject *task;                 // (func, args, kwargs, ident)
+	bool is_finished;               // 线程函数是否已经返回
+	bool is_killed;                 // 是否需要在等待处抛出SystemExit结束线程
+	void *blocked_lock;             // 正在等待的锁，未等待时为NULL
+	CFrame root_cframe;             // 虚拟线程的最外层CFrame
+	_PyErr_StackItem exc_state;     // 虚拟线程的最外层异常栈
+	DETECT_VIRTUAL_THREAD_SAVED_T saved;
+} DETECT_VIRTUAL_THREAD_T;
+
+/**
+ * @description: 判断当前是否处于虚拟线程模式。只有在detect模块开启、虚拟线程开关打开
+ *               并且已经开始执行主脚本时才生效，避免影响解释器启动和detect初始化
+ * @return bool
+ */
+bool detect_virtual_thread_is_active(void) {
+	if (!detect_config_get_runtime_is_enable() || !detect_config_get_runtime_is_virtual_thread()) {
+		return false;
+	}
+
+	if (detect_state_get() == NULL) {
+		return false;
+	}
+
+	return detect_config_get_runtime_state() != RUN_STATE_INITIALIZING;
+}
+
+/**
+ * @description: 虚拟线程加入等待队列，在下一个调度点执行
+ * @param func 线程函数
+ * @param args 位置参数元组
+ * @param kwargs 关键字参数字典，可以为NULL
+ * @return PyObject* 虚拟线程的标识
+ */
+static PyObject* detect_virtual_thread_enqueue(PyObject *func, PyObject *args, PyObject *kwargs) {
+	DETECT_STATE_T *state = detect_state_get();
+	PyObject *task;
+	int ret;
+
+	if (state->virtual_thread_queue == NULL) {
+		state->virtual_thread_queue = PyList_New(0);
+		if (state->virtual_thread_queue == NULL) {
+			return NULL;
+		}
+	}
+
+	state->virtual_thread_next_ident++;
+	task = Py_BuildValue("(OOOk)", func, args, kwargs != NULL ? kwargs : Py_None,
+						 state->virtual_thread_next_ident);
+	if (task == NULL) {
+		return NULL;
+	}
+
+	ret = PyList_Append(state->virtual_thread_queue, task);
+	Py_DECREF(task);
+	if (ret < 0) {
+		return NULL;
+	}
+
+	return PyLong_FromUnsignedLong(state->virtual_thread_next_ident);
+}
+
+/**
+ * @description: _thread.start_new_thread的虚拟实现
+ * @param self NULL
+ * @param args (function, args[, kwargs])
+ * @return PyObject* 虚拟线程的标识
+ */
+static PyObject* detect_virtual_thread_start_new_thread(PyObject *self, PyObject *args) {
+	PyObject *func, *func_args, *kwargs = NULL;
+
+	if (!PyArg_UnpackTuple(args, "start_new_thread", 2, 3, &func, &func_args, &kwargs)) {
+		return NULL;
+	}
+
+	if (!PyCallable_Check(func)) {
+		PyErr_SetString(PyExc_TypeError, "first arg must be callable");
+		return NULL;
+	}
+
+	if (!PyTuple_Check(func_args)) {
+		PyErr_SetString(PyExc_TypeError, "2nd arg must be a tuple");
+		return NULL;
+	}
+
+	if (kwargs != NULL && !PyDict_Check(kwargs)) {
+		PyErr_SetString(PyExc_TypeError, "optional 3rd arg must be a dictionary");
+		return NULL;
+	}
+
+	return detect_virtual_thread_enqueue(func, func_args, kwargs);
+}
+
+/**
+ * @description: 当前线程的标识，虚拟线程中为虚拟线程的标识，RLock据此区分锁的持有者
+ * @return unsigned long 线程标识
+ */
+unsigned long detect_virtual_thread_current_ident(void) {
+	DETECT_STATE_T *state = detect_state_get();
+
+	if (state != NULL && state->virtual_thread_depth > 0) {
+		return state->virtual_thread_ident;
+	}
+
+	return PyThread_get_thread_ident();
+}
+
+/**
+ * @description: _thread.get_ident的虚拟实现，虚拟线程中返回虚拟线程的标识，
+ *               threading以该标识区分current_thread
+ * @param self NULL
+ * @param noargs NULL
+ * @return PyObject* 线程标识
+ */
+static PyObject* detect_virtual_thread_get_ident(PyObject *self, PyObject *noargs) {
+	return PyLong_FromUnsignedLong(detect_virtual_thread_current_ident());
+}
+
+/**
+ * @description: _thread._set_sentinel的虚拟实现。真实的哨兵锁在线程状态销毁时释放，虚拟线程共用
+ *               主线程的线程状态，所以记录下哨兵锁，在虚拟线程运行结束时释放，join据此返回
+ * @param self NULL
+ * @param noargs NULL
+ * @return PyObject* 哨兵锁
+ */
+static PyObject* detect_virtual_thread_set_sentinel(PyObject *self, PyObject *noargs) {
+	DETECT_STATE_T *state = detect_state_get();
+	PyObject *thread_module, *lock;
+
+	thread_module = PyImport_ImportModule("_thread");
+	if (thread_module == NULL) {
+		return NULL;
+	}
+
+	lock = PyObject_CallMethod(thread_module, "allocate_lock", NULL);
+	Py_DECREF(thread_module);
+
+	if (lock != NULL && state->virtual_thread_depth > 0 && state->virtual_thread_sentinel == NULL) {
+		Py_INCREF(lock);
+		state->virtual_thread_sentinel = lock;
+	}
+
+	return lock;
+}
+
+/* 替换_thread和threading中线程接口的虚拟实现 */
+static PyMethodDef g_virtual_thread_start_new_thread_def = {
+	"start_new_thread", (PyCFunction)detect_virtual_thread_start_new_thread, METH_VARARGS, NULL
+};
+static PyMethodDef g_virtual_thread_get_ident_def = {
+	"get_ident", (PyCFunction)detect_virtual_thread_get_ident, METH_NOARGS, NULL
+};
+static PyMethodDef g_virtual_thread_set_sentinel_def = {
+	"_set_sentinel", (PyCFunction)detect_virtual_thread_set_sentinel, METH_NOARGS, NULL
+};
+
+/* 需要替换的模块属性，threading在导入时已经保存了_thread中的函数，需要一并替换 */
+static const struct {
+	const char *module_name;
+	const char *name;
+	PyMethodDef *method_def;
+} g_virtual_thread_patch_def[] = {
+	{"_thread",   "start_new_thread",  &g_virtual_thread_start_new_thread_def},
+	{"_thread",   "start_new",         &g_virtual_thread_start_new_thread_def},
+	{"_thread",   "get_ident",         &g_virtual_thread_get_ident_def},
+	{"_thread",   "_set_sentinel",     &g_virtual_thread_set_sentinel_def},
+	{"threading", "_start_new_thread", &g_virtual_thread_start_new_thread_def},
+	{"threading", "get_ident",         &g_virtual_thread_get_ident_def},
+	{"threading", "_set_sentinel",     &g_virtual_thread_set_sentinel_def},
+};
+
+/**
+ * @description: 虚拟的线程池工作线程，依次执行线程池工作队列中的任务，队列为空时直接结束，
+ *               不像真实的工作线程那样阻塞等待新任务
+ * @param executor ThreadPoolExecutor对象
+ * @param noargs NULL
+ * @return PyObject* None
+ */
+static PyObject* detect_virtual_thread_executor_worker(PyObject *executor, PyObject *noargs) {
+	PyObject *initializer, *initargs, *work_queue, *work_item, *ret;
+
+	/* 与真实的工作线程一样，先执行线程池的初始化函数，失败时线程池进入broken状态 */
+	initializer = PyObject_GetAttrString(executor, "_initializer");
+	initargs = PyObject_GetAttrString(executor, "_initargs");
+	if (initializer != NULL && initializer != Py_None && initargs != NULL && PyTuple_Check(initargs)) {
+		ret = PyObject_Call(initializer, initargs, NULL);
+		if (ret == NULL) {
+			PyErr_Clear();
+			ret = PyObject_CallMethod(executor, "_initializer_failed", NULL);
+			Py_XDECREF(ret);
+			Py_DECREF(initializer);
+			Py_DECREF(initargs);
+			PyErr_Clear();
+			Py_RETURN_NONE;
+		}
+		Py_DECREF(ret);
+	}
+	Py_XDECREF(initializer);
+	Py_XDECREF(initargs);
+	PyErr_Clear();
+
+	work_queue = PyObject_GetAttrString(executor, "_work_queue");
+	if (work_queue == NULL) {
+		return NULL;
+	}
+
+	while ((work_item = PyObject_CallMethod(work_queue, "get_nowait", NULL)) != NULL) {
+		/* None是线程池关闭的通知，放回队列留给其他工作线程 */
+		if (work_item == Py_None) {
+			ret = PyObject_CallMethod(work_queue, "put", "O", Py_None);
+			Py_XDECREF(ret);
+			Py_DECREF(work_item);
+			break;
+		}
+
+		/* 任务的异常保存在对应的future中 */
+		ret = PyObject_CallMethod(work_item, "run", NULL);
+		Py_XDECREF(ret);
+		Py_DECREF(work_item);
+		if (ret == NULL) {
+			break;
+		}
+	}
+
+	/* 队列为空时get_nowait抛出Empty */
+	PyErr_Clear();
+	Py_DECREF(work_queue);
+
+	Py_RETURN_NONE;
+}
+
+static PyMethodDef g_virtual_thread_executor_worker_def = {
+	"_worker", (PyCFunction)detect_virtual_thread_executor_worker, METH_NOARGS, NULL
+};
+
+/**
+ * @description: ThreadPoolExecutor._adjust_thread_count的虚拟实现。真实的工作线程执行完任务后
+ *               阻塞在工作队列上，虚拟线程无法挂起，所以每次提交任务都启动一个虚拟工作线程，
+ *               在下一个调度点执行完队列中的任务后结束
+ * @param executor ThreadPoolExecutor对象
+ * @param noargs NULL
+ * @return PyObject* None
+ */
+static PyObject* detect_virtual_thread_executor_adjust(PyObject *executor, PyObject *noargs) {
+	PyObject *worker, *args, *ident;
+
+	worker = PyCFunction_New(&g_virtual_thread_executor_worker_def, executor);
+	args = PyTuple_New(0);
+	ident = worker != NULL && args != NULL ? detect_virtual_thread_enqueue(worker, args, NULL) : NULL;
+
+	Py_XDECREF(worker);
+	Py_XDECREF(args);
+	if (ident == NULL) {
+		return NULL;
+	}
+	Py_DECREF(ident);
+
+	Py_RETURN_NONE;
+}
+
+static PyMethodDef g_virtual_thread_executor_adjust_def = {
+	"_adjust_thread_count", (PyCFunction)detect_virtual_thread_executor_adjust, METH_NOARGS, NULL
+};
+
+/**
+ * @description: 替换concurrent.futures.thread.ThreadPoolExecutor的工作线程创建。该模块在使用时
+ *               才导入，所以在样本的每次导入之后调用，已经替换或者未导入时直接返回
+ * @return void
+ */
+void detect_virtual_thread_patch_executor(void) {
+	PyObject *module, *executor_class, *method, *descr;
+
+	if (!detect_config_get_runtime_is_enable() || !detect_config_get_runtime_is_virtual_thread()) {
+		return;
+	}
+
+	module = PyDict_GetItemString(PyImport_GetModuleDict(), "concurrent.futures.thread");
+	if (module == NULL || !PyModule_Check(module)) {
+		return;
+	}
+
+	executor_class = PyDict_GetItemString(PyModule_GetDict(module), "ThreadPoolExecutor");
+	if (executor_class == NULL || !PyType_Check(executor_class)) {
+		return;
+	}
+
+	method = PyDict_GetItemString(((PyTypeObject *)executor_class)->tp_dict, "_adjust_thread_count");
+	if (method == NULL || Py_IS_TYPE(method, &PyMethodDescr_Type)) {
+		return;
+	}
+
+	descr = PyDescr_NewMethod((PyTypeObject *)executor_class, &g_virtual_thread_executor_adjust_def);
+	if (descr == NULL || PyObject_SetAttrString(executor_class, "_adjust_thread_count", descr) < 0) {
+		PyErr_Clear();
+	}
+	Py_XDECREF(descr);
+}
+
+/**
+ * @description: 释放虚拟线程的哨兵锁。真实线程的哨兵锁在线程状态销毁时释放，join据此返回
+ * @param sentinel 哨兵锁
+ * @return void
+ */
+static void detect_virtual_thread_release_sentinel(PyObject *sentinel) {
+	PyObject *locked, *ret;
+
+	locked = PyObject_CallMethod(sentinel, "locked", NULL);
+	if (locked != NULL && PyObject_IsTrue(locked) > 0) {
+		ret = PyObject_CallMethod(sentinel, "release", NULL);
+		Py_XDECREF(ret);
+	}
+	Py_XDECREF(locked);
+
+	PyErr_Clear();
+}
+
+/**
+ * @description: 释放虚拟线程，由虚拟线程的capsule析构时调用。等待中从未结束的线程栈上的frame不再执行，
+ *               其持有的引用随之泄漏，只释放线程栈和虚拟线程自身的资源
+ * @param capsule 虚拟线程的capsule
+ * @return void
+ */
+static void detect_virtual_thread_free(PyObject *capsule) {
+	DETECT_VIRTUAL_THREAD_T *thread = PyCapsule_GetPointer(capsule, DETECT_VIRTUAL_THREAD_CAPSULE_NAME);
+
+	if (thread == NULL) {
+		PyErr_Clear();
+		return;
+	}
+
+	if (thread->stack != NULL) {
+		munmap(thread->stack, DETECT_VIRTUAL_THREAD_STACK_SIZE);
+	}
+	detect_context_free(thread->saved.detect_context);
+	Py_XDECREF(thread->saved.context);
+	Py_XDECREF(thread->exc_state.exc_type);
+	Py_XDECREF(thread->exc_state.exc_value);
+	Py_XDECREF(thread->exc_state.exc_traceback);
+	Py_XDECREF(thread->saved.sentinel);
+	Py_XDECREF(thread->task);
+	PyMem_RawFree(thread);
+}
+
+/**
+ * @description: 虚拟线程的入口，在虚拟线程自己的栈上运行线程函数直到结束，与真实线程一样忽略SystemExit，
+ *               其他未捕获的异常作为unraisable异常输出。结束后切换回调度它的线程，不再返回
+ * @return void
+ */
+static void detect_virtual_thread_entry(void) {
+	DETECT_STATE_T *state = detect_state_get();
+	DETECT_VIRTUAL_THREAD_T *thread = state->virtual_thread_current;
+	PyObject *func = PyTuple_GET_ITEM(thread->task, 0);
+	PyObject *kwargs = PyTuple_GET_ITEM(thread->task, 2);
+	PyObject *result;
+
+	result = PyObject_Call(func, PyTuple_GET_ITEM(thread->task, 1), kwargs != Py_None ? kwargs : NULL);
+	if (result == NULL) {
+		if (PyErr_ExceptionMatches(PyExc_SystemExit)) {
+			PyErr_Clear();
+		} else {
+			_PyErr_WriteUnraisableMsg("in thread started by", func);
+		}
+	}
+	Py_XDECREF(result);
+
+	/* 预算用尽时投递的SystemExit可能还未触发，不能泄漏到调度该线程的上层。
+	   子解释器已经得出检测结论时保留异步SystemExit，继续停止脚本执行 */
+	if (state->virtual_thread_interrupted && !state->need_stop) {
+		PyThreadState_SetAsyncExc(_PyThreadState_GET()->thread_id, NULL);
+	}
+
+	thread->is_finished = true;
+	setcontext(thread->resumer);
+}
+
+/**
+ * @description: 创建虚拟线程，线程在独立的栈上运行，栈的最低页作为保护页，栈溢出时触发段错误而不是
+ *               改写其他内存
+ * @param task 虚拟线程(func, args, kwargs, ident)
+ * @return PyObject* 虚拟线程的capsule，失败时返回NULL并设置异常
+ */
+static PyObject* detect_virtual_thread_create(PyObject *task) {
+	DETECT_VIRTUAL_THREAD_T *thread;
+	PyObject *capsule;
+	void *stack;
+
+	thread = PyMem_RawCalloc(1, sizeof(DETECT_VIRTUAL_THREAD_T));
+	if (thread == NULL) {
+		return PyErr_NoMemory();
+	}
+
+	capsule = PyCapsule_New(thread, DETECT_VIRTUAL_THREAD_CAPSULE_NAME, detect_virtual_thread_free);
+	if (capsule == NULL) {
+		PyMem_RawFree(thread);
+		return NULL;
+	}
+
+	Py_INCREF(task);
+	thread->task = task;
+
+	stack = mmap(NULL, DETECT_VIRTUAL_THREAD_STACK_SIZE, PROT_READ | PROT_WRITE,
+				 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+	if (stack == MAP_FAILED) {
+		Py_DECREF(capsule);
+		return PyErr_SetFromErrno(PyExc_OSError);
+	}
+	thread->stack = stack;
+	mprotect(stack, sysconf(_SC_PAGESIZE), PROT_NONE);
+
+	if (getcontext(&thread->context) < 0) {
+		Py_DECREF(capsule);
+		return PyErr_SetFromErrno(PyExc_OSError);
+	}
+	thread->context.uc_stack.ss_sp = stack;
+	thread->context.uc_stack.ss_size = DETECT_VIRTUAL_THREAD_STACK_SIZE;
+	thread->context.uc_link = NULL;
+	makecontext(&thread->context, detect_virtual_thread_entry, 0);
+
+	/* 与新建的真实线程一样从空的frame链、异常栈和contextvars上下文开始，detect上下文在首次使用时创建 */
+	thread->saved.cframe = &thread->root_cframe;
+	thread->saved.exc_info = &thread->exc_state;
+	thread->saved.ident = PyLong_AsUnsignedLong(PyTuple_GET_ITEM(task, 3));
+
+	return capsule;
+}
+
+/**
+ * @description: 交换当前线程状态与虚拟线程保存的线程状态，切换到虚拟线程之前和切换回来之后各调用一次。
+ *               frame链、递归深度、异常栈等线程状态原本属于各自的系统线程，虚拟线程共用主线程的线程状态，
+ *               需要随栈一起切换
+ * @param state detect状态
+ * @param thread 虚拟线程
+ * @return void
+ */
+static void detect_virtual_thread_exchange(DETECT_STATE_T *state, DETECT_VIRTUAL_THREAD_T *thread) {
+	PyThreadState *tstate = _PyThreadState_GET();
+	DETECT_VIRTUAL_THREAD_SAVED_T saved = thread->saved;
+	int use_tracing = tstate->cframe->use_tracing;
+
+	thread->saved.frame = tstate->frame;
+	thread->saved.recursion_depth = tstate->recursion_depth;
+	thread->saved.recursion_headroom = tstate->recursion_headroom;
+	thread->saved.cframe = tstate->cframe;
+	thread->saved.exc_info = tstate->exc_info;
+	thread->saved.context = tstate->context;
+	thread->saved.trash_delete_nesting = tstate->trash_delete_nesting;
+	thread->saved.trash_delete_later = tstate->trash_delete_later;
+	thread->saved.detect_context = tstate->detect_context;
+	thread->saved.profile_depth = g_detect_profile_depth;
+	thread->saved.ident = state->virtual_thread_ident;
+	thread->saved.sentinel = state->virtual_thread_sentinel;
+	thread->saved.opcode_count = state->virtual_thread_opcode_count;
+	thread->saved.interrupted = state->virtual_thread_interrupted;
+
+	tstate->frame = saved.frame;
+	tstate->recursion_depth = saved.recursion_depth;
+	tstate->recursion_headroom = saved.recursion_headroom;
+	tstate->cframe = saved.cframe;
+	tstate->cframe->use_tracing = use_tracing;
+	tstate->exc_info = saved.exc_info;
+	tstate->context = saved.context;
+	tstate->context_ver++;
+	tstate->trash_delete_nesting = saved.trash_delete_nesting;
+	tstate->trash_delete_later = saved.trash_delete_later;
+	tstate->detect_context = saved.detect_context;
+	g_detect_profile_depth = saved.profile_depth;
+	state->virtual_thread_ident = saved.ident;
+	state->virtual_thread_sentinel = saved.sentinel;
+	state->virtual_thread_opcode_count = saved.opcode_count;
+	state->virtual_thread_interrupted = saved.interrupted;
+}
+
+/**
+ * @description: 运行虚拟线程，直到线程结束或者等待锁。等待锁的线程进入挂起列表，锁释放后从等待处继续运行
+ * @param state detect状态
+ * @param capsule 虚拟线程的capsule
+ * @return void
+ */
+static void detect_virtual_thread_run(DETECT_STATE_T *state, PyObject *capsule) {
+	DETECT_VIRTUAL_THREAD_T *thread = PyCapsule_GetPointer(capsule, DETECT_VIRTUAL_THREAD_CAPSULE_NAME);
+	DETECT_VIRTUAL_THREAD_T *last_current = state->virtual_thread_current;
+	PyObject *exc_type, *exc_value, *exc_traceback, *blocked;
+	ucontext_t resumer;
+
+	PyErr_Fetch(&exc_type, &exc_value, &exc_traceback);
+	detect_virtual_thread_exchange(state, thread);
+	state->virtual_thread_current = thread;
+	state->virtual_thread_depth++;
+
+	thread->resumer = &resumer;
+	swapcontext(&resumer, &thread->context);
+
+	state->virtual_thread_depth--;
+	state->virtual_thread_current = last_current;
+	if (thread->is_finished) {
+		detect_context_clear(_PyThreadState_GET());
+	}
+	detect_virtual_thread_exchange(state, thread);
+	PyErr_Restore(exc_type, exc_value, exc_traceback);
+
+	if (thread->is_finished) {
+		if (thread->saved.sentinel != NULL) {
+			detect_virtual_thread_release_sentinel(thread->saved.sentinel);
+		}
+		return;
+	}
+
+	/* 线程在等待锁，挂起直到该锁释放 */
+	if (state->virtual_thread_blocked_queue == NULL) {
+		state->virtual_thread_blocked_queue = PyList_New(0);
+	}
+	blocked = Py_BuildValue("(ON)", capsule, PyLong_FromVoidPtr(thread->blocked_lock));
+	if (blocked == NULL || state->virtual_thread_blocked_queue == NULL ||
+		PyList_Append(state->virtual_thread_blocked_queue, blocked) < 0) {
+		PyErr_Clear();
+	}
+	Py_XDECREF(blocked);
+}
+
+/**
+ * @description: 线程调度点，按顺序依次运行等待队列中的虚拟线程，包括新启动的线程和等待的锁已经释放的线程。
+ *               锁等待、sleep和队列读取等阻塞点在真实等待之前调用，被等待的条件可能在其他线程运行后满足
+ * @return int 运行的虚拟线程数量，出错时返回-1并设置异常
+ */
+int detect_virtual_thread_switch(void) {
+	DETECT_STATE_T *state;
+	PyObject *item, *capsule;
+	int count = 0;
+
+	if (!detect_virtual_thread_is_active()) {
+		return 0;
+	}
+
+	state = detect_state_get();
+	if (state->virtual_thread_depth >= DETECT_VIRTUAL_THREAD_DEPTH_MAX) {
+		return 0;
+	}
+
+	while (state->virtual_thread_queue != NULL && PyList_GET_SIZE(state->virtual_thread_queue) > 0) {
+		/* 子解释器已经得出检测结论，不再调度 */
+		if (state->is_finished) {
+			break;
+		}
+
+		item = PyList_GET_ITEM(state->virtual_thread_queue, 0);
+		Py_INCREF(item);
+		if (PySequence_DelItem(state->virtual_thread_queue, 0) < 0) {
+			Py_DECREF(item);
+			return -1;
+		}
+
+		/* 新启动的线程在首次运行时创建，被唤醒的线程已经是capsule */
+		if (PyCapsule_CheckExact(item)) {
+			capsule = item;
+		} else {
+			capsule = detect_virtual_thread_create(item);
+			Py_DECREF(item);
+			if (capsule == NULL) {
+				return -1;
+			}
+		}
+
+		detect_virtual_thread_run(state, capsule);
+		Py_DECREF(capsule);
+		count++;
+	}
+
+	return count;
+}
+
+/**
+ * @description: 当前线程需要无限等待被其他线程持有的锁，并且调度后锁仍未释放时调用。虚拟线程切换回调度它的
+ *               线程并挂起，该锁释放后重新进入等待队列，被调度时从这里返回，由调用方重新尝试获取锁。
+ *               主线程等待时所有虚拟线程都已结束或者在等待，没有线程可以释放锁，视为死锁
+ * @param lock 等待的锁
+ * @return int 0 --- 锁已经释放，-1 --- 已死锁或者线程需要结束，设置了异常
+ */
+int detect_virtual_thread_block(void *lock) {
+	DETECT_STATE_T *state = detect_state_get();
+	DETECT_VIRTUAL_THREAD_T *thread = state->virtual_thread_current;
+
+	if (thread == NULL) {
+		PyErr_SetString(PyExc_RuntimeError, "deadlock: all virtual threads are blocked");
+		return -1;
+	}
+
+	/* 线程已经需要结束时不再挂起，直接结束等待 */
+	if (!thread->is_killed && !state->virtual_thread_interrupted && !state->need_stop) {
+		thread->blocked_lock = lock;
+		swapcontext(&thread->context, thread->resumer);
+		thread->blocked_lock = NULL;
+	}
+
+	if (thread->is_killed || state->virtual_thread_interrupted || state->need_stop) {
+		PyErr_SetNone(PyExc_SystemExit);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @description: 锁释放时调用，等待该锁的挂起线程重新进入等待队列
+ * @param lock 释放的锁，为NULL时所有挂起线程都重新进入等待队列
+ * @return int 重新进入等待队列的虚拟线程数量
+ */
+int detect_virtual_thread_wake(void *lock) {
+	DETECT_STATE_T *state;
+	PyObject *blocked, *item;
+	Py_ssize_t index = 0;
+	int count = 0;
+
+	if (!detect_virtual_thread_is_active()) {
+		return 0;
+	}
+
+	state = detect_state_get();
+	blocked = state->virtual_thread_blocked_queue;
+	if (blocked == NULL || PyList_GET_SIZE(blocked) == 0) {
+		return 0;
+	}
+
+	if (state->virtual_thread_queue == NULL) {
+		state->virtual_thread_queue = PyList_New(0);
+		if (state->virtual_thread_queue == NULL) {
+			PyErr_Clear();
+			return 0;
+		}
+	}
+
+	while (index < PyList_GET_SIZE(blocked)) {
+		item = PyList_GET_ITEM(blocked, index);
+		if (lock != NULL && PyLong_AsVoidPtr(PyTuple_GET_ITEM(item, 1)) != lock) {
+			index++;
+			continue;
+		}
+
+		if (PyList_Append(state->virtual_thread_queue, PyTuple_GET_ITEM(item, 0)) < 0 ||
+			PySequence_DelItem(blocked, index) < 0) {
+			PyErr_Clear();
+			break;
+		}
+		count++;
+	}
+
+	return count;
+}
+
+/**
+ * @description: 每个被记录的opcode执行前调用。按opcode计数调度等待中的虚拟线程，
+ *               虚拟线程的opcode预算用尽时投递SystemExit结束该线程，避免死循环的线程独占主线程
+ * @return void
+ */
+void detect_virtual_thread_tick(void) {
+	DETECT_STATE_T *state;
+
+	if (!detect_virtual_thread_is_active()) {
+		return;
+	}
+
+	state = detect_state_get();
+	state->virtual_thread_opcode_count++;
+
+	if (state->virtual_thread_depth > 0 && state->virtual_thread_opcode_count >= DETECT_VIRTUAL_THREAD_BUDGET) {
+		state->virtual_thread_opcode_count = 0;
+		state->virtual_thread_interrupted = true;
+		PyThreadState_SetAsyncExc(_PyThreadState_GET()->thread_id, PyExc_SystemExit);
+		return;
+	}
+
+	if (state->virtual_thread_opcode_count % DETECT_VIRTUAL_THREAD_QUANTUM == 0 &&
+		detect_virtual_thread_switch() < 0) {
+		PyErr_Clear();
+	}
+}
+
+/**
+ * @description: 结束所有仍在等待锁的虚拟线程，线程从等待处抛出SystemExit，执行完finally等清理代码后结束，
+ *               线程栈上的frame正常释放。扫描结束、解释器销毁之前调用
+ * @return void
+ */
+void detect_virtual_thread_clear(void) {
+	DETECT_STATE_T *state = detect_state_get();
+	DETECT_VIRTUAL_THREAD_T *thread;
+	PyObject *item;
+
+	if (state == NULL) {
+		return;
+	}
+
+	/* 被结束的线程释放锁时可能唤醒其他线程，循环到没有等待中的线程为止。从未运行过的新线程直接丢弃 */
+	detect_virtual_thread_wake(NULL);
+	while (state->virtual_thread_queue != NULL && PyList_GET_SIZE(state->virtual_thread_queue) > 0) {
+		item = PyList_GET_ITEM(state->virtual_thread_queue, 0);
+		Py_INCREF(item);
+		if (PySequence_DelItem(state->virtual_thread_queue, 0) < 0) {
+			Py_DECREF(item);
+			break;
+		}
+
+		if (PyCapsule_CheckExact(item)) {
+			thread = PyCapsule_GetPointer(item, DETECT_VIRTUAL_THREAD_CAPSULE_NAME);
+			thread->is_killed = true;
+			detect_virtual_thread_run(state, item);
+		}
+		Py_DECREF(item);
+
+		detect_virtual_thread_wake(NULL);
+	}
+
+	PyErr_Clear();
+}
+
+/**
+ * @description: 主脚本执行结束时调用，运行仍在等待队列中的虚拟线程，例如从未被join的daemon线程，
+ *               之后唤醒所有仍在等待锁的线程再调度一次，仍然等待的线程视为死锁并结束
+ * @return void
+ */
+void detect_virtual_thread_finish(void) {
+	if (detect_virtual_thread_switch() < 0) {
+		PyErr_Clear();
+	}
+
+	if (detect_virtual_thread_wake(NULL) > 0 && detect_virtual_thread_switch() < 0) {
+		PyErr_Clear();
+	}
+
+	detect_virtual_thread_clear();
+}
+
+/**
+ * @description: 虚拟线程初始化，在hook模块替换配置对象之后调用。替换_thread和threading中的
+ *               线程创建、线程标识和哨兵锁接口，Thread.start之后线程进入等待队列；
+ *               ThreadPoolExecutor改为按任务启动虚拟工作线程
+ * @return void
+ */
+void detect_virtual_thread_init(void) {
+	PyObject *module, *func;
+	unsigned int index;
+
+	if (!detect_config_get_runtime_is_enable() || !detect_config_get_runtime_is_virtual_thread()) {
+		return;
+	}
+
+	module = PyImport_ImportModule("threading");
+	if (module == NULL) {
+		PyErr_Clear();
+		return;
+	}
+	Py_DECREF(module);
+
+	for (index = 0; index < sizeof(g_virtual_thread_patch_def)/sizeof(g_virtual_thread_patch_def[0]); index++) {
+		module = PyDict_GetItemString(PyImport_GetModuleDict(), g_virtual_thread_patch_def[index].module_name);
+		if (module == NULL || !PyModule_Check(module)) {
+			continue;
+		}
+
+		func = PyCFunction_New(g_virtual_thread_patch_def[index].method_def, NULL);
+		if (func != NULL) {
+			PyDict_SetItemString(PyModule_GetDict(module), g_virtual_thread_patch_def[index].name, func);
+			Py_DECREF(func);
+		}
+	}
+
+	detect_virtual_thread_patch_executor();
+
+	PyErr_Clear();
+}
@@ -0,0 +1,20 @@
+#ifndef DETECT_VIRTUAL_VIRTUAL_THREAD_H
+#define DETECT_VIRTUAL_VIRTUAL_THREAD_H
+
+#include <stdbool.h>
+#include "Python.h"
+
+extern void detect_virtual_thread_init(void);
+extern void detect_virtual_thread_patch_executor(void);
+extern void detect_virtual_thread_tick(void);
+extern void detect_virtual_thread_finish(void);
+extern void detect_virtual_thread_clear(void);
+
+/* 锁和队列的等待会被_queue等编译为so库的扩展模块调用，需要导出符号 */
+PyAPI_FUNC(bool) detect_virtual_thread_is_active(void);
+PyAPI_FUNC(int) detect_virtual_thread_switch(void);
+PyAPI_FUNC(unsigned long) detect_virtual_thread_current_ident(void);
+PyAPI_FUNC(int) detect_virtual_thread_block(void *lock);
+PyAPI_FUNC(int) detect_virtual_thread_wake(void *lock);
+
+#endif
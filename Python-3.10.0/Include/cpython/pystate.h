@@ -151,6 +151,9 @@ struct _ts {
 
     /* XXX signal handlers should also be here */
 
+    /* detect code: detect模块的线程级上下文，放在末尾以保持原有字段的偏移 */
+    void *detect_context;
+
 };
 
 // Alias for backward compatibility with Python 3.8
@@ -71,15 +71,7 @@ struct _Py_unicode_state {
     PyObject *latin1[256];
     struct _Py_unicode_fs_codec fs_codec;
 
-    /* This dictionary holds all interned unicode strings.  Note that references
-       to strings in this dictionary are *not* counted in the string's ob_refcnt.
-       When the interned string reaches a refcnt of 0 the string deallocation
-       function will delete the reference from this dictionary.
-
-       Another way to look at this is that to say that the actual reference
-       count of a string is:  s->ob_refcnt + (s->state ? 2 : 0)
-    */
-    PyObject *interned;
+    /* detect code: interned字典改为所有解释器共享，见unicodeobject.c中的interned */
 
     // Unicode identifiers (_Py_Identifier): see _PyUnicode_FromId()
     struct _Py_unicode_ids ids;
@@ -288,6 +280,9 @@ struct _is {
 
     PyObject *audit_hooks;
 
+    /* detect code: detect模块的解释器级状态，每个(子)解释器各有一份 */
+    void *detect_state;
+
     /* Small integers are preallocated in this array so that they
        can be shared.
        The integers that are preallocated are those in the range
@@ -18,6 +18,10 @@ PyAPI_FUNC(int) _PyMem_SetDefaultAllocator(
     PyMemAllocatorDomain domain,
     PyMemAllocatorEx *old_alloc);
 
+/* detect code: 扫描内存模式的bump arena，小块分配从arena中顺序切分并且不单独释放 */
+PyAPI_FUNC(int) _PyObject_ScanArenaEnable(size_t size);
+PyAPI_FUNC(int) _PyObject_ScanArenaIsActive(void);
+
 /* Special bytes broadcast into debug memory blocks at appropriate times.
    Strings of these are unlikely to be valid addresses, floats, ints or
    7-bit ASCII.
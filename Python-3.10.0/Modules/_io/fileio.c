@@ -19,6 +19,8 @@
 #endif
 #include <stddef.h> /* For offsetof */
 #include "_iomodule.h"
+/* detect code: 检测模式下的虚拟文件系统 */
+#include "Detect/virtual/virtual_fs.h"
 
 /*
  * Known likely problems:
@@ -378,6 +380,11 @@ _Py_COMP_DIAG_POP
 
         errno = 0;
         if (opener == Py_None) {
+#ifndef MS_WINDOWS
+            /* detect code: 检测模式下文件的写入重定向到虚拟文件系统，未处理时才打开真实文件 */
+            self->fd = detect_virtual_fs_open(name, AT_FDCWD, flags, 0666);
+            if (self->fd == DETECT_VIRTUAL_FS_NOT_HANDLED)
+#endif
             do {
                 Py_BEGIN_ALLOW_THREADS
 #ifdef MS_WINDOWS
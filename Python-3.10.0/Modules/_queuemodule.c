@@ -2,6 +2,9 @@
 #include "pycore_moduleobject.h"  // _PyModule_GetState()
 #include "structmember.h"         // PyMemberDef
 #include <stddef.h>               // offsetof()
+/* detect code: 检测模式下的虚拟线程和虚拟时钟 */
+#include "Detect/virtual/virtual_clock.h"
+#include "Detect/virtual/virtual_thread.h"
 
 typedef struct {
     PyTypeObject *SimpleQueueType;
@@ -126,6 +129,7 @@ _queue_SimpleQueue_put_impl(simplequeueobject *self, PyObject *item,
         /* A get() may be waiting, wake it up */
         self->locked = 0;
         PyThread_release_lock(self->lock);
+        detect_virtual_thread_wake(self->lock); /* detect code: 等待读取的虚拟线程在下一个调度点运行 */
     }
     /* END GIL-protected critical section */
     Py_RETURN_NONE;
@@ -242,7 +246,27 @@ _queue_SimpleQueue_get_impl(simplequeueobject *self, PyTypeObject *cls,
     while (self->lst_pos == PyList_GET_SIZE(self->lst)) {
         /* First a simple non-blocking try without releasing the GIL */
         r = PyThread_acquire_lock_timed(self->lock, 0, 0);
-        if (r == PY_LOCK_FAILURE && microseconds != 0) {
+        /* detect code: 虚拟线程模式下先运行等待调度的其他线程，之后队列仍为空时不进行真实等待，
+           带超时的读取推进虚拟时钟后按超时处理，无限等待挂起当前虚拟线程直到put写入数据 */
+        if (r == PY_LOCK_FAILURE && microseconds != 0 && detect_virtual_thread_is_active()) {
+            int ret = detect_virtual_thread_switch();
+            if (ret < 0) {
+                return NULL;
+            }
+            if (ret > 0) {
+                continue;
+            }
+            if (microseconds > 0) {
+                detect_virtual_clock_advance(timeout_val);
+            }
+            else if (detect_virtual_thread_block(self->lock) < 0) {
+                return NULL;
+            }
+            else {
+                continue;
+            }
+        }
+        else if (r == PY_LOCK_FAILURE && microseconds != 0) {
             Py_BEGIN_ALLOW_THREADS
             r = PyThread_acquire_lock_timed(self->lock, microseconds, 1);
             Py_END_ALLOW_THREADS
@@ -9,6 +9,10 @@
 #include "pycore_pystate.h"       // _PyThreadState_Init()
 #include <stddef.h>               // offsetof()
 #include "structmember.h"         // PyMemberDef
+/* detect code: 检测模式下的虚拟时钟 */
+#include "Detect/virtual/virtual_clock.h"
+#include "Detect/virtual/virtual_io.h"
+#include "Detect/virtual/virtual_thread.h"
 
 #ifdef HAVE_SIGNAL_H
 #  include <signal.h>             // SIGINT
@@ -75,6 +79,38 @@ lock_dealloc(lockobject *self)
     Py_DECREF(tp);
 }
 
+/* detect code: 虚拟线程模式下的锁等待。锁等待是线程调度点，先运行等待调度的虚拟线程，
+   锁仍被占用时不进行真实等待：带超时的等待推进虚拟时钟后返回超时；无限等待挂起当前虚拟线程，
+   锁释放后从这里继续尝试获取，主线程没有可调度的线程时视为死锁，返回PY_LOCK_INTR */
+static PyLockStatus
+acquire_virtual(PyThread_type_lock lock, _PyTime_t timeout)
+{
+    int ret;
+
+    for (;;) {
+        while ((ret = detect_virtual_thread_switch()) > 0) {
+            if (PyThread_acquire_lock_timed(lock, 0, 0) == PY_LOCK_ACQUIRED) {
+                return PY_LOCK_ACQUIRED;
+            }
+        }
+        if (ret < 0) {
+            return PY_LOCK_INTR;
+        }
+
+        if (timeout > 0) {
+            detect_virtual_clock_advance(timeout);
+            return PY_LOCK_FAILURE;
+        }
+
+        if (detect_virtual_thread_block(lock) < 0) {
+            return PY_LOCK_INTR;
+        }
+        if (PyThread_acquire_lock_timed(lock, 0, 0) == PY_LOCK_ACQUIRED) {
+            return PY_LOCK_ACQUIRED;
+        }
+    }
+}
+
 /* Helper to acquire an interruptible lock with a timeout.  If the lock acquire
  * is interrupted, signal handlers are run, and if they raise an exception,
  * PY_LOCK_INTR is returned.  Otherwise, PY_LOCK_ACQUIRED or PY_LOCK_FAILURE
@@ -97,6 +133,19 @@ acquire_timed(PyThread_type_lock lock, _PyTime_t timeout)
 
         /* first a simple non-blocking try without releasing the GIL */
         r = PyThread_acquire_lock_timed(lock, 0, 0);
+
+        /* detect code: 虚拟线程模式下由其他虚拟线程释放锁，不进行真实等待 */
+        if (r == PY_LOCK_FAILURE && microseconds != 0 && detect_virtual_thread_is_active()) {
+            return acquire_virtual(lock, timeout);
+        }
+
+        /* detect code: 检测模式下带超时的等待不消耗真实时间，推进虚拟时钟后直接返回超时。
+           无限等待依赖其他线程释放锁，仍然进行真实等待 */
+        if (r == PY_LOCK_FAILURE && timeout > 0 && detect_virtual_io_is_active()) {
+            detect_virtual_clock_advance(timeout);
+            return PY_LOCK_FAILURE;
+        }
+
         if (r == PY_LOCK_FAILURE && microseconds != 0) {
             Py_BEGIN_ALLOW_THREADS
             r = PyThread_acquire_lock_timed(lock, microseconds, 1);
@@ -212,6 +261,11 @@ lock_PyThread_release_lock(lockobject *self, PyObject *Py_UNUSED(ignored))
 
     PyThread_release_lock(self->lock_lock);
     self->locked = 0;
+
+    /* detect code: 锁释放是线程调度点，运行等待该锁而挂起的虚拟线程 */
+    if (detect_virtual_thread_wake(self->lock_lock) > 0 && detect_virtual_thread_switch() < 0) {
+        return NULL;
+    }
     Py_RETURN_NONE;
 }
 
@@ -364,7 +418,8 @@ rlock_acquire(rlockobject *self, PyObject *args, PyObject *kwds)
     if (lock_acquire_parse_args(args, kwds, &timeout) < 0)
         return NULL;
 
-    tid = PyThread_get_thread_ident();
+    /* detect code: 虚拟线程共用主线程，使用虚拟线程的标识区分锁的持有者 */
+    tid = detect_virtual_thread_current_ident();
     if (self->rlock_count > 0 && tid == self->rlock_owner) {
         unsigned long count = self->rlock_count + 1;
         if (count <= self->rlock_count) {
@@ -407,7 +462,7 @@ the lock is taken and its internal counter initialized to 1.");
 static PyObject *
 rlock_release(rlockobject *self, PyObject *Py_UNUSED(ignored))
 {
-    unsigned long tid = PyThread_get_thread_ident();
+    unsigned long tid = detect_virtual_thread_current_ident(); /* detect code */
 
     if (self->rlock_count == 0 || self->rlock_owner != tid) {
         PyErr_SetString(PyExc_RuntimeError,
@@ -417,6 +472,11 @@ rlock_release(rlockobject *self, PyObject *Py_UNUSED(ignored))
     if (--self->rlock_count == 0) {
         self->rlock_owner = 0;
         PyThread_release_lock(self->rlock_lock);
+
+        /* detect code: 锁释放是线程调度点，运行等待该锁而挂起的虚拟线程 */
+        if (detect_virtual_thread_wake(self->rlock_lock) > 0 && detect_virtual_thread_switch() < 0) {
+            return NULL;
+        }
     }
     Py_RETURN_NONE;
 }
@@ -444,9 +504,17 @@ rlock_acquire_restore(rlockobject *self, PyObject *args)
         return NULL;
 
     if (!PyThread_acquire_lock(self->rlock_lock, 0)) {
-        Py_BEGIN_ALLOW_THREADS
-        r = PyThread_acquire_lock(self->rlock_lock, 1);
-        Py_END_ALLOW_THREADS
+        /* detect code: 虚拟线程模式下不进行真实等待，锁被其他虚拟线程持有时挂起当前虚拟线程 */
+        if (detect_virtual_thread_is_active()) {
+            if (acquire_timed(self->rlock_lock, _PyTime_FromSeconds(-1)) != PY_LOCK_ACQUIRED) {
+                return NULL;
+            }
+        }
+        else {
+            Py_BEGIN_ALLOW_THREADS
+            r = PyThread_acquire_lock(self->rlock_lock, 1);
+            Py_END_ALLOW_THREADS
+        }
     }
     if (!r) {
         PyErr_SetString(ThreadError, "couldn't acquire lock");
@@ -480,6 +548,7 @@ rlock_release_save(rlockobject *self, PyObject *Py_UNUSED(ignored))
     self->rlock_count = 0;
     self->rlock_owner = 0;
     PyThread_release_lock(self->rlock_lock);
+    detect_virtual_thread_wake(self->rlock_lock); /* detect code: Condition.wait随后的等待会调度被唤醒的线程 */
     return Py_BuildValue("kk", count, owner);
 }
 
@@ -492,7 +561,7 @@ For internal use by `threading.Condition`.");
 static PyObject *
 rlock_is_owned(rlockobject *self, PyObject *Py_UNUSED(ignored))
 {
-    unsigned long tid = PyThread_get_thread_ident();
+    unsigned long tid = detect_virtual_thread_current_ident(); /* detect code */
 
     if (self->rlock_count > 0 && self->rlock_owner == tid) {
         Py_RETURN_TRUE;
@@ -31,6 +31,11 @@
 #include "pycore_pyerrors.h"
 #include "pycore_pystate.h"     // _PyThreadState_GET()
 #include "pydtrace.h"
+/* detect code: 扫描内存模式的bump arena */
+#include "pycore_pymem.h"
+
+/* detect code: 扫描内存模式下第0代回收触发阈值的放大倍数 */
+#define DETECT_SCAN_GC_THRESHOLD_FACTOR 100
 
 typedef struct _gc_runtime_state GCState;
 
@@ -2257,7 +2262,13 @@ _PyObject_GC_Alloc(int use_calloc, size_t basicsize)
     g->_gc_next = 0;
     g->_gc_prev = 0;
     gcstate->generations[0].count++; /* number of allocated GC objects */
-    if (gcstate->generations[0].count > gcstate->generations[0].threshold &&
+    /* detect code: 扫描内存模式下回收的对象不会归还内存，bump arena未用尽时放宽分代回收的触发阈值，
+       用尽后按原阈值回收 */
+    long threshold = gcstate->generations[0].threshold;
+    if (_PyObject_ScanArenaIsActive()) {
+        threshold *= DETECT_SCAN_GC_THRESHOLD_FACTOR;
+    }
+    if (gcstate->generations[0].count > threshold &&
         gcstate->enabled &&
         gcstate->generations[0].threshold &&
         !gcstate->collecting &&
@@ -7,6 +7,7 @@
 #include "pycore_pylifecycle.h"   // _Py_PreInitializeFromPyArgv()
 #include "pycore_pystate.h"       // _PyInterpreterState_GET()
 #include "Detect/detect.h"
+#include "Detect/configs/config.h"
 
 /* Includes for exit_sigint() */
 #include <stdio.h>                // perror()
@@ -581,14 +582,38 @@ pymain_run_python(int *exitcode)
     else if (config->run_module) {
         *exitcode = pymain_run_module(config->run_module, 1);
     }
+    else if (config->run_filename != NULL && detect_config_get_runtime_is_enable() &&
+             detect_archive_is_archive(config->run_filename)) {
+		/* detect code: 压缩包扫描模式，入口脚本不解压到磁盘，在内存中逐个检测。zip格式的压缩包
+		   也是合法的sys.path条目，需要在按__main__模块执行之前处理 */
+        *exitcode = detect_archive_scan(config->run_filename);
+    }
     else if (main_importer_path != NULL) {
         *exitcode = pymain_run_module(L"__main__", 0);
     }
+    else if (config->run_filename != NULL && detect_config_get_runtime_is_batch()) {
+		/* detect code: 批量扫描模式，执行的文件为样本路径清单，每个样本在独立的子解释器中检测 */
+        *exitcode = detect_scan_batch(config->run_filename);
+    }
     else if (config->run_filename != NULL) {
-		/* detect code: 恶意脚本检测初始化 */
-		detect_init();
-	
-        *exitcode = pymain_run_file(config);
+		/* detect code: 缓存命中或者静态预过滤已给出结论时不再执行脚本，否则进行恶意脚本检测初始化 */
+		if (detect_analysis_cache_main_proc(config->run_filename) ||
+			detect_analysis_prescan_main_proc(config->run_filename)) {
+			*exitcode = 0;
+		} else {
+			detect_init();
+
+			/* detect code: 单个样本的检测进入扫描内存模式 */
+			detect_memory_begin();
+
+			*exitcode = pymain_run_file(config);
+
+			/* detect code: 脚本自然执行结束，输出证据得分和是否需要展平分支再检测 */
+			detect_analysis_finish_proc();
+
+			/* detect code: 扫描内存模式下输出检测结果并执行剩余的atexit回调后直接退出，不再清理解释器 */
+			detect_memory_finish_proc(*exitcode);
+		}
     }
     else {
         *exitcode = pymain_run_stdin(config);
@@ -31,6 +31,8 @@
 #include "pycore_initconfig.h"    // _PyStatus_EXCEPTION()
 #include "pycore_pystate.h"       // _PyInterpreterState_GET()
 #include "structmember.h"         // PyMemberDef
+/* detect code: 检测模式下的虚拟文件系统 */
+#include "Detect/virtual/virtual_fs.h"
 #ifndef MS_WINDOWS
 #  include "posixmodule.h"
 #else
@@ -2515,6 +2517,19 @@ posix_do_stat(PyObject *module, const char *function_name, path_t *path,
         fd_and_follow_symlinks_invalid("stat", path->fd, follow_symlinks))
         return NULL;
 
+#ifndef MS_WINDOWS
+    /* detect code: 虚拟文件系统中写入或删除过的文件 */
+    if (path->fd == -1) {
+        result = detect_virtual_fs_stat(path->narrow, dir_fd, follow_symlinks, &st);
+        if (result != DETECT_VIRTUAL_FS_NOT_HANDLED) {
+            if (result != 0) {
+                return path_error(path);
+            }
+            return _pystat_fromstructstat(module, &st);
+        }
+    }
+#endif
+
     Py_BEGIN_ALLOW_THREADS
     if (path->fd != -1)
         result = FSTAT(path->fd, &st);
@@ -3247,6 +3262,17 @@ os_chmod_impl(PyObject *module, path_t *path, int mode, int dir_fd,
         return NULL;
     }
 
+#ifndef MS_WINDOWS
+    /* detect code: 虚拟文件系统中的文件只修改memfd的权限 */
+    result = detect_virtual_fs_chmod(path->narrow, dir_fd, mode);
+    if (result != DETECT_VIRTUAL_FS_NOT_HANDLED) {
+        if (result != 0) {
+            return path_error(path);
+        }
+        Py_RETURN_NONE;
+    }
+#endif
+
 #ifdef MS_WINDOWS
     Py_BEGIN_ALLOW_THREADS
     attr = GetFileAttributesW(path->wide);
@@ -4680,6 +4706,17 @@ internal_rename(path_t *src, path_t *dst, int src_dir_fd, int dst_dir_fd, int is
         return NULL;
     }
 
+#ifndef MS_WINDOWS
+    /* detect code: 检测模式下的重命名只作用于虚拟文件系统 */
+    result = detect_virtual_fs_rename(src->narrow, src_dir_fd, dst->narrow, dst_dir_fd);
+    if (result != DETECT_VIRTUAL_FS_NOT_HANDLED) {
+        if (result != 0) {
+            return path_error2(src, dst);
+        }
+        Py_RETURN_NONE;
+    }
+#endif
+
     Py_BEGIN_ALLOW_THREADS
 #ifdef HAVE_RENAMEAT
     if (dir_fd_specified) {
@@ -4963,6 +5000,17 @@ os_unlink_impl(PyObject *module, path_t *path, int dir_fd)
         return NULL;
     }
 
+#ifndef MS_WINDOWS
+    /* detect code: 检测模式下的删除只作用于虚拟文件系统 */
+    result = detect_virtual_fs_unlink(path->narrow, dir_fd);
+    if (result != DETECT_VIRTUAL_FS_NOT_HANDLED) {
+        if (result != 0) {
+            return path_error(path);
+        }
+        Py_RETURN_NONE;
+    }
+#endif
+
     Py_BEGIN_ALLOW_THREADS
     _Py_BEGIN_SUPPRESS_IPH
 #ifdef MS_WINDOWS
@@ -9130,6 +9178,17 @@ os_open_impl(PyObject *module, path_t *path, int flags, int mode, int dir_fd)
         return -1;
     }
 
+#ifndef MS_WINDOWS
+    /* detect code: 检测模式下文件的写入重定向到虚拟文件系统 */
+    fd = detect_virtual_fs_open(path->narrow, dir_fd, flags, mode);
+    if (fd != DETECT_VIRTUAL_FS_NOT_HANDLED) {
+        if (fd < 0) {
+            PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, path->object);
+        }
+        return fd;
+    }
+#endif
+
     _Py_BEGIN_SUPPRESS_IPH
     do {
         Py_BEGIN_ALLOW_THREADS
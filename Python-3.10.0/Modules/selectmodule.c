@@ -10,6 +10,9 @@
 
 #include "Python.h"
 #include "structmember.h"         // PyMemberDef
+/* detect code: 检测模式下的虚拟时钟和虚拟I/O */
+#include "Detect/virtual/virtual_clock.h"
+#include "Detect/virtual/virtual_io.h"
 
 #ifdef HAVE_SYS_DEVPOLL_H
 #include <sys/resource.h>
@@ -267,6 +270,30 @@ select_select_impl(PyObject *module, PyObject *rlist, PyObject *wlist,
     int n;
     _PyTime_t timeout, deadline = 0;
 
+    /* detect code: 等待列表可以是一次性的迭代器，检测模式下先物化为列表再重新进入，
+       虚拟I/O检查hook对象和原select逻辑使用同一份列表 */
+    if (detect_virtual_io_is_active() &&
+        !((PyList_CheckExact(rlist) || PyTuple_CheckExact(rlist)) &&
+          (PyList_CheckExact(wlist) || PyTuple_CheckExact(wlist)) &&
+          (PyList_CheckExact(xlist) || PyTuple_CheckExact(xlist)))) {
+        PyObject *lists[3] = {rlist, wlist, xlist};
+        int i;
+
+        for (i = 0; i < 3; i++) {
+            lists[i] = PySequence_Fast(lists[i], "arguments 1-3 must be sequences");
+            if (lists[i] == NULL) {
+                break;
+            }
+        }
+        if (i == 3) {
+            ret = select_select_impl(module, lists[0], lists[1], lists[2], timeout_obj);
+        }
+        while (--i >= 0) {
+            Py_DECREF(lists[i]);
+        }
+        return ret;
+    }
+
     if (timeout_obj == Py_None)
         tvp = (struct timeval *)NULL;
     else {
@@ -286,6 +313,20 @@ select_select_impl(PyObject *module, PyObject *rlist, PyObject *wlist,
             return NULL;
         }
         tvp = &tv;
+
+        /* detect code: 检测模式下不进行真实等待，推进虚拟时钟后只轮询一次 */
+        if (timeout > 0 && detect_virtual_io_is_active()) {
+            detect_virtual_clock_advance(timeout);
+            timeout = 0;
+            tv.tv_sec = 0;
+            tv.tv_usec = 0;
+        }
+    }
+
+    /* detect code: 等待列表中存在hook对象时，由虚拟I/O直接返回结果 */
+    ret = detect_virtual_io_select(rlist, wlist, xlist);
+    if (ret != NULL) {
+        return ret;
     }
 
 #ifdef SELECT_USES_HEAP
@@ -598,6 +639,13 @@ select_poll_poll_impl(pollObject *self, PyObject *timeout_obj)
             return NULL;
         }
 
+        /* detect code: 检测模式下不进行真实等待，推进虚拟时钟后只轮询一次 */
+        if (timeout > 0 && detect_virtual_io_is_active()) {
+            detect_virtual_clock_advance(timeout);
+            timeout = 0;
+            ms = 0;
+        }
+
         if (timeout >= 0) {
             deadline = _PyTime_GetMonotonicClock() + timeout;
         }
@@ -1549,6 +1597,13 @@ select_epoll_poll_impl(pyEpoll_Object *self, PyObject *timeout_obj,
             ms = -1;
         }
 
+        /* detect code: 检测模式下不进行真实等待，推进虚拟时钟后只轮询一次 */
+        if (timeout > 0 && detect_virtual_io_is_active()) {
+            detect_virtual_clock_advance(timeout);
+            timeout = 0;
+            ms = 0;
+        }
+
         if (timeout >= 0) {
             deadline = _PyTime_GetMonotonicClock() + timeout;
         }
@@ -11,6 +11,8 @@
 #include "pycore_pyerrors.h"      // _PyErr_SetString()
 #include "pycore_pylifecycle.h"   // NSIG
 #include "pycore_pystate.h"       // _PyThreadState_GET()
+/* detect code: 检测模式下的虚拟I/O */
+#include "Detect/virtual/virtual_io.h"
 
 #ifndef MS_WINDOWS
 #  include "posixmodule.h"
@@ -426,6 +428,11 @@ static PyObject *
 signal_pause_impl(PyObject *module)
 /*[clinic end generated code: output=391656788b3c3929 input=f03de0f875752062]*/
 {
+    /* detect code: 检测模式下不等待信号，直接返回 */
+    if (detect_virtual_io_is_active()) {
+        Py_RETURN_NONE;
+    }
+
     Py_BEGIN_ALLOW_THREADS
     (void)pause();
     Py_END_ALLOW_THREADS
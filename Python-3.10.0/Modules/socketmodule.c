@@ -102,6 +102,9 @@ Local naming conventions:
 #define PY_SSIZE_T_CLEAN
 #include "Python.h"
 #include "structmember.h"         // PyMemberDef
+/* detect code: 检测模式下的虚拟时钟和虚拟I/O */
+#include "Detect/virtual/virtual_clock.h"
+#include "Detect/virtual/virtual_io.h"
 
 #ifdef _Py_MEMORY_SANITIZER
 # include <sanitizer/msan_interface.h>
@@ -725,6 +728,13 @@ internal_select(PySocketSockObject *s, int writing, _PyTime_t interval,
     if (s->sock_fd == INVALID_SOCKET)
         return 0;
 
+    /* detect code: 检测模式下不进行真实等待，推进虚拟时钟后只轮询一次，
+       未就绪时立即按超时处理 */
+    if (interval > 0 && detect_virtual_io_is_active()) {
+        detect_virtual_clock_advance(interval);
+        interval = 0;
+    }
+
     /* Prefer poll, if available, since you can poll() any fd
      * which can't be done with select(). */
 #ifdef HAVE_POLL
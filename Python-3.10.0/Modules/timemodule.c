@@ -1,6 +1,10 @@
 /* Time module */
 
 #include "Python.h"
+/* detect code: 检测模式下的虚拟时钟 */
+#include "Detect/virtual/virtual_clock.h"
+#include "Detect/virtual/virtual_io.h"
+#include "Detect/virtual/virtual_thread.h"
 
 #include <ctype.h>
 
@@ -78,7 +82,12 @@ static int
 get_system_time(_PyTime_t *t)
 {
     // Avoid _PyTime_GetSystemClock() which silently ignores errors.
-    return _PyTime_GetSystemClockWithInfo(t, NULL);
+    if (_PyTime_GetSystemClockWithInfo(t, NULL) < 0) {
+        return -1;
+    }
+    /* detect code: 叠加虚拟时钟偏移 */
+    *t += detect_virtual_clock_get_offset();
+    return 0;
 }
 
 
@@ -367,6 +376,15 @@ time_sleep(PyObject *self, PyObject *obj)
                         "sleep length must be non-negative");
         return NULL;
     }
+    /* detect code: sleep是虚拟线程的调度点，先运行等待调度的其他线程 */
+    if (detect_virtual_thread_switch() < 0) {
+        return NULL;
+    }
+    /* detect code: 检测模式下不进行真实睡眠，只推进虚拟时钟 */
+    if (detect_virtual_io_is_active()) {
+        detect_virtual_clock_advance(secs);
+        Py_RETURN_NONE;
+    }
     if (pysleep(secs) != 0)
         return NULL;
     Py_RETURN_NONE;
@@ -464,6 +482,8 @@ parse_time_t_args(PyObject *args, const char *format, time_t *pwhen)
         return 0;
     if (ot == NULL || ot == Py_None) {
         whent = time(NULL);
+        /* detect code: 叠加虚拟时钟偏移 */
+        whent += (time_t)_PyTime_AsSecondsDouble(detect_virtual_clock_get_offset());
     }
     else {
         if (_PyTime_ObjectToTime_t(ot, &whent, _PyTime_ROUND_FLOOR) == -1)
@@ -749,6 +769,8 @@ time_strftime(PyObject *self, PyObject *args)
 
     if (tup == NULL) {
         time_t tt = time(NULL);
+        /* detect code: 叠加虚拟时钟偏移 */
+        tt += (time_t)_PyTime_AsSecondsDouble(detect_virtual_clock_get_offset());
         if (_PyTime_localtime(tt, &buf) != 0)
             return NULL;
     }
@@ -944,6 +966,8 @@ time_asctime(PyObject *self, PyObject *args)
         return NULL;
     if (tup == NULL) {
         time_t tt = time(NULL);
+        /* detect code: 叠加虚拟时钟偏移 */
+        tt += (time_t)_PyTime_AsSecondsDouble(detect_virtual_clock_get_offset());
         if (_PyTime_localtime(tt, &buf) != 0)
             return NULL;
     }
@@ -1106,7 +1130,12 @@ static int
 get_monotonic(_PyTime_t *t)
 {
     // Avoid _PyTime_GetMonotonicClock() which silently ignores errors.
-    return _PyTime_GetMonotonicClockWithInfo(t, NULL);
+    if (_PyTime_GetMonotonicClockWithInfo(t, NULL) < 0) {
+        return -1;
+    }
+    /* detect code: 叠加虚拟时钟偏移 */
+    *t += detect_virtual_clock_get_offset();
+    return 0;
 }
 
 
@@ -1145,7 +1174,12 @@ static int
 get_perf_counter(_PyTime_t *t)
 {
     // Avoid _PyTime_GetPerfCounter() which silently ignores errors.
-    return _PyTime_GetPerfCounterWithInfo(t, NULL);
+    if (_PyTime_GetPerfCounterWithInfo(t, NULL) < 0) {
+        return -1;
+    }
+    /* detect code: 叠加虚拟时钟偏移 */
+    *t += detect_virtual_clock_get_offset();
+    return 0;
 }
 
 
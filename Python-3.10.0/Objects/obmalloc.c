@@ -1945,10 +1945,83 @@ pymalloc_alloc(void *ctx, size_t nbytes)
 }
 
 
+/* detect code: 扫描内存模式的bump arena。检测进程的生命周期很短，detect初始化之后的小块分配
+   从一段连续预留的内存中顺序切分，释放时不做任何处理，写出检测结论后进程直接退出，arena整体
+   归还给操作系统。arena用尽后回退到pymalloc */
+static struct {
+    char *base;     /* arena起始地址，未开启时为NULL */
+    char *top;      /* 下一次分配的地址 */
+    char *end;      /* arena结束地址 */
+} detect_scan_arena = {NULL, NULL, NULL};
+
+#define DETECT_SCAN_ARENA_CONTAINS(p) \
+    ((char *)(p) >= detect_scan_arena.base && (char *)(p) < detect_scan_arena.end)
+
+/* detect code: 从bump arena中分配，未开启、超过小块阈值或者arena用尽时返回NULL */
+static inline void*
+detect_scan_arena_alloc(size_t nbytes)
+{
+    char *bp = detect_scan_arena.top;
+
+    if (UNLIKELY(nbytes == 0 || nbytes > SMALL_REQUEST_THRESHOLD)) {
+        return NULL;
+    }
+    nbytes = _Py_SIZE_ROUND_UP(nbytes, ALIGNMENT);
+    if (UNLIKELY((size_t)(detect_scan_arena.end - bp) < nbytes)) {
+        return NULL;
+    }
+
+    detect_scan_arena.top = bp + nbytes;
+    return (void *)bp;
+}
+
+/* detect code: 开启扫描内存模式，预留size字节的arena，物理内存在首次写入时才分配 */
+int
+_PyObject_ScanArenaEnable(size_t size)
+{
+#ifdef ARENAS_USE_MMAP
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void *base;
+
+    if (detect_scan_arena.base != NULL) {
+        return 0;
+    }
+
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;
+#endif
+    base = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+
+    detect_scan_arena.base = (char *)base;
+    detect_scan_arena.top = (char *)base;
+    detect_scan_arena.end = (char *)base + size;
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/* detect code: 扫描内存模式已开启并且arena尚未用尽 */
+int
+_PyObject_ScanArenaIsActive(void)
+{
+    return detect_scan_arena.base != NULL &&
+           (size_t)(detect_scan_arena.end - detect_scan_arena.top) >= SMALL_REQUEST_THRESHOLD;
+}
+
 static void *
 _PyObject_Malloc(void *ctx, size_t nbytes)
 {
-    void* ptr = pymalloc_alloc(ctx, nbytes);
+    /* detect code: 扫描内存模式下优先从bump arena分配 */
+    void* ptr = detect_scan_arena_alloc(nbytes);
+    if (ptr != NULL) {
+        return ptr;
+    }
+
+    ptr = pymalloc_alloc(ctx, nbytes);
     if (LIKELY(ptr != NULL)) {
         return ptr;
     }
@@ -1967,7 +2040,13 @@ _PyObject_Calloc(void *ctx, size_t nelem, size_t elsize)
     assert(elsize == 0 || nelem <= (size_t)PY_SSIZE_T_MAX / elsize);
     size_t nbytes = nelem * elsize;
 
-    void* ptr = pymalloc_alloc(ctx, nbytes);
+    /* detect code: bump arena中的内存从未被使用过，匿名映射保证其内容为0 */
+    void* ptr = detect_scan_arena_alloc(nbytes);
+    if (ptr != NULL) {
+        return ptr;
+    }
+
+    ptr = pymalloc_alloc(ctx, nbytes);
     if (LIKELY(ptr != NULL)) {
         memset(ptr, 0, nbytes);
         return ptr;
@@ -2233,6 +2312,11 @@ _PyObject_Free(void *ctx, void *p)
         return;
     }
 
+    /* detect code: bump arena中的内存不单独释放 */
+    if (DETECT_SCAN_ARENA_CONTAINS(p)) {
+        return;
+    }
+
     if (UNLIKELY(!pymalloc_free(ctx, p))) {
         /* pymalloc didn't allocate this address */
         PyMem_RawFree(p);
@@ -2320,6 +2404,18 @@ _PyObject_Realloc(void *ctx, void *ptr, size_t nbytes)
         return _PyObject_Malloc(ctx, nbytes);
     }
 
+    /* detect code: bump arena不记录块的大小，总是分配新块。复制到分配新块之前arena已分配区域的末尾为止，
+       新块从该位置之后开始，两者不会重叠，也不会越过已分配的内存，多复制的内容在新块中不会被使用 */
+    if (DETECT_SCAN_ARENA_CONTAINS(ptr)) {
+        size_t used = (size_t)(detect_scan_arena.top - (char *)ptr);
+
+        ptr2 = _PyObject_Malloc(ctx, nbytes);
+        if (ptr2 != NULL) {
+            memcpy(ptr2, ptr, Py_MIN(nbytes, used));
+        }
+        return ptr2;
+    }
+
     if (pymalloc_realloc(ctx, &ptr2, ptr, nbytes)) {
         return ptr2;
     }
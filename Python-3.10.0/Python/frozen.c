@@ -15,6 +15,12 @@
  */
 #include "frozen_hello.h"
 
+/* detect code: 冻结detect初始化依赖的标准库模块，由make DETECT_FROZEN_STDLIB=yes开启，
+ * 头文件由Tools/freeze/freeze_detect.py生成 */
+#ifdef DETECT_FROZEN_STDLIB
+#include "frozen_detect.h"
+#endif
+
 #define SIZE (int)sizeof(_Py_M__hello)
 
 static const struct _frozen _PyImport_FrozenModules[] = {
@@ -30,6 +36,10 @@ static const struct _frozen _PyImport_FrozenModules[] = {
     /* Test package (negative size indicates package-ness) */
     {"__phello__", _Py_M__hello, -SIZE},
     {"__phello__.spam", _Py_M__hello, SIZE},
+#ifdef DETECT_FROZEN_STDLIB
+    /* detect code: detect初始化导入的标准库模块 */
+    DETECT_FROZEN_MODULES
+#endif
     {0, 0, 0} /* sentinel */
 };
 
@@ -11,6 +11,10 @@
 #include "pycore_pystate.h"       // _PyThreadState_GET()
 #include "pycore_sysmodule.h"
 
+/* detect code: detect模块的解释器级状态和线程级上下文 */
+#include "Detect/detect_state.h"
+#include "Detect/detect_context.h"
+
 /* --------------------------------------------------------------------------
 CAUTION
 
@@ -318,6 +322,9 @@ interpreter_clear(PyInterpreterState *interp, PyThreadState *tstate)
     _PyWarnings_Fini(interp);
     _PyAtExit_Fini(interp);
 
+    /* detect code: 释放detect模块的解释器级状态 */
+    detect_state_clear(interp);
+
     // All Python types must be destroyed before the last GC collection. Python
     // types create a reference cycle to themselves in their in their
     // PyTypeObject.tp_mro member (the tuple contains the type).
@@ -659,6 +666,9 @@ new_threadstate(PyInterpreterState *interp, int init)
     tstate->context = NULL;
     tstate->context_ver = 1;
 
+    /* detect code: detect模块的线程级上下文在首次使用时创建 */
+    tstate->detect_context = NULL;
+
     if (init) {
         _PyThreadState_Init(tstate);
     }
@@ -869,6 +879,9 @@ PyThreadState_Clear(PyThreadState *tstate)
 
     Py_CLEAR(tstate->context);
 
+    /* detect code: 释放detect模块的线程级上下文 */
+    detect_context_clear(tstate);
+
     if (tstate->on_delete != NULL) {
         tstate->on_delete(tstate->on_delete_data);
     }
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+"""冻结detect初始化依赖的标准库模块。
+
+detect初始化时导入的subprocess、multiprocessing、socket、ssl、ctypes、urllib.request等模块
+及其依赖在每次启动时都需要逐个stat/open/read/unmarshal。开启DETECT_FROZEN_STDLIB编译选项后，
+这些模块的字节码编译进Python/frozen.c的冻结模块表中，由FrozenImporter直接加载。
+
+    closure
+        使用编译出的python(需要与目标版本一致)分别以enable=false和enable=true运行一个空脚本，
+        把detect初始化新导入的纯python标准库模块写入模块清单detect_modules.txt。
+        规则配置改变了导入的模块时重新生成清单并提交。
+
+    header FREEZE_IMPORTLIB LIBDIR LIST OUTPUT
+        由Makefile调用，使用Programs/_freeze_importlib逐个编译清单中的模块，
+        生成Python/frozen_detect.h，其中的DETECT_FROZEN_MODULES宏展开为冻结模块表的表项。
+        只调用_freeze_importlib，可以使用任意版本的python3运行。
+"""
+
+import os
+import subprocess
+import sys
+import tempfile
+
+DIR = os.path.dirname(os.path.abspath(__file__))
+LIST = os.path.join(DIR, 'detect_modules.txt')
+
+# 已经作为_frozen_importlib等冻结的模块，或者只能从文件系统加载的模块
+EXCLUDES = {
+    '_frozen_importlib',
+    '_frozen_importlib_external',
+    'importlib._bootstrap',
+    'importlib._bootstrap_external',
+    'zipimport',
+}
+
+MARKER = '@detect-frozen@'
+# detect为缺失的模块放置的占位对象不是模块，跳过
+PROBE = '''\
+import sys
+for name, module in list(sys.modules.items()):
+    if type(module) is type(sys) and isinstance(module.__dict__.get('__file__'), str):
+        print(%r, name, module.__file__)
+''' % MARKER
+
+# 冻结包的__path__为空，未冻结的子模块(例如ctypes.util、email.mime)仍然需要从标准库目录中查找。
+# 追加在包的源码末尾，不改变行号和模块文档字符串
+PACKAGE_PATH = '''
+# detect frozen: 未冻结的子模块仍然从标准库目录中查找
+__path__ = [__import__('os').path.join(__import__('os').path.dirname(__import__('os').__file__), %r)]
+'''
+
+
+def probe_modules(enable):
+    """以detect开关运行空脚本，返回{模块名: 源码路径}"""
+    with tempfile.TemporaryDirectory() as tmpdir:
+        script = os.path.join(tmpdir, 'probe.py')
+        with open(script, 'w') as fp:
+            fp.write(PROBE)
+        args = ('enable=true,run_mode=release,prefilter=false' if enable
+                else 'enable=false')
+        out = subprocess.run([sys.executable, '-D', args, script],
+                             stdout=subprocess.PIPE, universal_newlines=True,
+                             check=True).stdout
+
+    modules = {}
+    for line in out.splitlines():
+        parts = line.split(' ')
+        if len(parts) == 3 and parts[0] == MARKER:
+            modules[parts[1]] = parts[2]
+    return modules
+
+
+def closure():
+    libdir = os.path.dirname(os.__file__)
+    dynload = os.path.join(libdir, 'lib-dynload')
+    baseline = probe_modules(False)
+    if not baseline:
+        sys.exit('failed to probe modules imported at startup')
+
+    entries = []
+    for name, path in sorted(probe_modules(True).items()):
+        if (name in baseline or name in EXCLUDES
+                or not path.endswith('.py') or not path.startswith(libdir + os.sep)
+                or path.startswith(dynload + os.sep)):
+            continue
+        entries.append((name, os.path.relpath(path, libdir)))
+
+    with open(LIST, 'w') as fp:
+        fp.write('# Generated with Tools/freeze/freeze_detect.py closure\n')
+        fp.write('# <module> <path relative to Lib>\n')
+        for name, path in entries:
+            fp.write('%s %s\n' % (name, path))
+    print('%d modules written to %s' % (len(entries), LIST))
+
+
+def read_list(filename):
+    entries = []
+    with open(filename) as fp:
+        for line in fp:
+            line = line.strip()
+            if line and not line.startswith('#'):
+                name, path = line.split()
+                entries.append((name, path))
+    return entries
+
+
+def freeze_module(freeze_importlib, name, source, tmpdir):
+    """编译单个模块，返回重命名为detect专用符号的字节数组定义"""
+    symbol = '_Py_M__detect_' + name.replace('.', '_')
+    output = os.path.join(tmpdir, symbol + '.h')
+    subprocess.run([freeze_importlib, name, source, output], check=True)
+
+    with open(output) as fp:
+        lines = fp.read().splitlines()
+    # 第一行为生成说明，第二行为数组声明
+    lines[1] = 'static const unsigned char %s[] = {' % symbol
+    return symbol, lines[1:]
+
+
+def header(freeze_importlib, libdir, listfile, output):
+    freeze_importlib = os.path.abspath(freeze_importlib)
+    body = ['/* Auto-generated by Tools/freeze/freeze_detect.py */']
+    table = []
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        for name, path in read_list(listfile):
+            source = os.path.join(libdir, path)
+            is_package = os.path.basename(path) == '__init__.py'
+            if is_package:
+                with open(source, encoding='utf-8') as fp:
+                    text = fp.read()
+                source = os.path.join(tmpdir, name + '.py')
+                with open(source, 'w', encoding='utf-8') as fp:
+                    fp.write(text + PACKAGE_PATH % os.path.dirname(path))
+
+            symbol, lines = freeze_module(freeze_importlib, name, source, tmpdir)
+            body.extend(lines)
+            # 负数大小表示包
+            table.append('    {"%s", %s, %s(int)sizeof(%s)}'
+                         % (name, symbol, '-' if is_package else '', symbol))
+
+    body.append('')
+    body.append('#define DETECT_FROZEN_MODULES \\')
+    body.append(', \\\n'.join(table) + ',')
+
+    tmp = output + '.new'
+    with open(tmp, 'w') as fp:
+        fp.write('\n'.join(body) + '\n')
+    os.replace(tmp, output)
+
+
+def main():
+    if len(sys.argv) == 2 and sys.argv[1] == 'closure':
+        closure()
+    elif len(sys.argv) == 6 and sys.argv[1] == 'header':
+        header(*sys.argv[2:])
+    else:
+        sys.exit('usage: %s closure | header FREEZE_IMPORTLIB LIBDIR LIST OUTPUT'
+                 % sys.argv[0])
+
+
+if __name__ == '__main__':
+    main()
@@ -9,25 +9,160 @@ detect_timeout=10
 memory_limit=500
 PYTHON_EXE=$DIR/bin/python3
 
-if [ -n "$filename" ];then
-	cmd_1="$PYTHON_EXE -D enable=true,jump_branch=false,run_mode=${run_mode},detect_timeout=${detect_timeout},memory_limit=${memory_limit} $filename"
-	cmd_2="$PYTHON_EXE -D enable=true,jump_branch=true,run_mode=${run_mode},detect_timeout=${detect_timeout},memory_limit=${memory_limit} $filename"
-
-	t=True
-	rs=`eval $cmd_1 | grep 'Malicious'`
-	res=`echo $rs | sed 's/,/\n/g'| grep 'Malicious'|sed "s/'//g"|sed 's/}//'`
-	if [ -n "$res" ];then
-		final=${res#*:}
-		if [ $final=$t ];then
-			echo $rs
+# 汇总检测结果中各行的结论：任一结果为恶意时为恶意；压缩包中有未检测的入口脚本或者没有入口脚本时视为可疑，
+# 同样给出恶意结论
+aggregate_verdict() {
+	local rs=$1
+
+	if echo "$rs" | grep -q "'IsMalicious': True" || echo "$rs" | grep -q "'Unscanned'";then
+		echo True
+	else
+		echo False
+	fi
+}
+
+# 检测单个脚本或压缩包并输出检测结论，第二个参数为追加的-D配置项。压缩包每个成员输出一行结果，之后再输出
+# 汇总的结论。最后一次检测的完整输出（包括汇总的结论）保存在detect_output中，汇总的结论保存在detect_verdict中
+detect_file() {
+	local filename=$1 extra_args=$2
+	local cmd_1 cmd_2 rs summary second_pass executed total final t=True
+
+	cmd_1="$PYTHON_EXE -D enable=true,jump_branch=false,run_mode=${run_mode},detect_timeout=${detect_timeout},memory_limit=${memory_limit}${extra_args:+,$extra_args} $filename"
+	cmd_2="$PYTHON_EXE -D enable=true,jump_branch=true,run_mode=${run_mode},detect_timeout=${detect_timeout},memory_limit=${memory_limit}${extra_args:+,$extra_args} $filename"
+
+	detect_output=`eval $cmd_1`
+	rs=`echo "$detect_output" | grep 'Malicious'`
+	final=`aggregate_verdict "$rs"`
+	# 未展平分支的检测给出恶意结论，或者证据得分表明无需展平分支再检测时，直接使用第一次的结果
+	second_pass=`echo $rs | grep "'NeedSecondPass': True"`
+	# 主脚本的指令已全部覆盖时，展平分支不会执行到新的代码，同样无需再检测
+	executed=`echo $rs | grep -o "'Executed': [0-9]*" | grep -o '[0-9]*'`
+	total=`echo $rs | grep -o "'Total': [0-9]*" | grep -o '[0-9]*'`
+	if [ -n "$total" ] && [ "$executed" = "$total" ];then
+		second_pass=
+	fi
+	if [ -z "$rs" ] || { [ "$final" != "$t" ] && [ -n "$second_pass" ]; };then
+		detect_output=`eval $cmd_2`
+		rs=`echo "$detect_output" | grep 'Malicious'`
+		final=`aggregate_verdict "$rs"`
+	fi
+	detect_verdict=$final
+
+	if [ `echo "$rs" | grep -c 'Malicious'` -gt 1 ] || echo "$rs" | grep -q "'Unscanned'";then
+		if [ "$final" = "$t" ] && ! echo "$rs" | grep -q "'IsMalicious': True";then
+			summary="{'FileName': '$filename', 'IsMalicious': True, 'Desc': 'Unscanned archive members'}"
 		else
-			rs=`eval $cmd_2 | grep 'Malicious'`
-			echo $rs
+			summary="{'FileName': '$filename', 'IsMalicious': $final}"
 		fi
-	else
-		rs=`eval $cmd_2 | grep 'Malicious'`
-		echo $rs
+		rs="$rs"$'\n'"$summary"
+		detect_output="$detect_output"$'\n'"$summary"
 	fi
+	echo "$rs"
+}
+
+# 检查样本对检测输出的附加断言，断言写在.py样本的注释行中，其他样本写在同名的.expect文件中：
+#   "# detect-expect: 正则"            检测输出中必须有匹配的行
+#   "# detect-expect-not: 正则"        检测输出中不能有匹配的行
+#   "# detect-expect-file: 文件 正则"   文件中必须有匹配的行，文件路径中的@tmp替换为该目录独享的临时目录
+# 输出第一条不满足的断言，全部满足时不输出
+check_expect() {
+	local sample=$1 tmp_dir=$2 expect_file=$1 kind rule path
+
+	if [ "${sample##*.}" != "py" ];then
+		expect_file=$sample.expect
+	fi
+	if [ ! -f "$expect_file" ];then
+		return
+	fi
+
+	sed -n -e 's/^# detect-expect: */output /p' -e 's/^# detect-expect-not: */not /p' \
+		-e 's/^# detect-expect-file: */file /p' "$expect_file" | while read -r kind rule; do
+		case "$kind" in
+			output)
+				if ! echo "$detect_output" | grep -Eq -- "$rule";then
+					echo "no output matching '$rule'"
+					break
+				fi
+				;;
+			not)
+				if echo "$detect_output" | grep -Eq -- "$rule";then
+					echo "unexpected output matching '$rule'"
+					break
+				fi
+				;;
+			file)
+				path=${rule%% *}
+				path=${path//@tmp/$tmp_dir}
+				rule=${rule#* }
+				if ! grep -Eq -- "$rule" "$path" 2>/dev/null;then
+					echo "no line matching '$rule' in $path"
+					break
+				fi
+				;;
+		esac
+	done
+}
+
+# 回归样本自检：样本目录下每个子目录对应一个特性，文件名以malicious_或benign_开头表示期望的结论。
+# 同一目录下的样本按文件名顺序检测，需要先后顺序时加两位数字前缀(例如01_malicious_x.py)。
+# 目录中的detect-args文件或者样本中"# detect-args:"注释行给出追加的-D配置项(非.py样本写在.expect文件中)，
+# 其中的@tmp替换为该目录独享的临时目录。样本在所在目录下检测，批量清单中的相对路径相对于该目录
+selftest() {
+	local samples_dir=`cd "$1" && pwd` feature_dir sample name expect args sample_args tmp_dir rs got error failed=0 count=0
+
+	for feature_dir in "$samples_dir"/*/; do
+		tmp_dir=`mktemp -d`
+		for sample in "$feature_dir"*; do
+			name=`basename $sample`
+			case "${name#[0-9][0-9]_}" in
+				*.expect) continue ;;
+				malicious_*) expect=True ;;
+				benign_*) expect=False ;;
+				*) continue ;;
+			esac
+
+			args=
+			if [ -f "$feature_dir/detect-args" ];then
+				args=`cat "$feature_dir/detect-args"`
+			fi
+			if [ "${name##*.}" = "py" ];then
+				sample_args=`sed -n 's/^# detect-args: *//p' "$sample" | head -1`
+			else
+				sample_args=`sed -n 's/^# detect-args: *//p' "$sample.expect" 2>/dev/null | head -1`
+			fi
+			args=$args${args:+${sample_args:+,}}$sample_args
+			args=${args//@tmp/$tmp_dir}
+
+			cd "$feature_dir"
+			run_mode=release detect_file "$sample" "$args" > /dev/null
+			cd - > /dev/null
+			rs=`echo "$detect_output" | grep 'Malicious'`
+			got=$detect_verdict
+			error=
+			if [ "$got" != "$expect" ];then
+				error=`echo $rs`
+			else
+				error=`check_expect "$sample" "$tmp_dir"`
+			fi
+			count=$((count+1))
+			if [ -z "$error" ];then
+				echo "PASS `basename $feature_dir`/$name"
+			else
+				echo "FAIL `basename $feature_dir`/$name: $error"
+				failed=$((failed+1))
+			fi
+		done
+		rm -rf "$tmp_dir"
+	done
+
+	echo "$((count-failed))/$count samples passed"
+	[ $failed -eq 0 ]
+}
+
+if [ "$filename" = "--selftest" ];then
+	selftest "${2:-$DIR/../Python-3.10.0/Detect/samples}"
+elif [ -n "$filename" ];then
+	detect_file "$filename"
 else
 	echo "please input filepath"
 fi